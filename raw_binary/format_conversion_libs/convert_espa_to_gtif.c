@@ -18,6 +18,244 @@ NOTES:
 #include <unistd.h>
 #include "convert_espa_to_gtif.h"
 
+/******************************************************************************
+MODULE:  convert_band_to_gtif
+
+PURPOSE: Converts a single raw binary band to a GeoTIFF file and its
+associated .tfw (ESRI world file).
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error converting the band to GeoTIFF
+SUCCESS         Successfully converted the band to GeoTIFF
+
+NOTES:
+  1. The band is streamed GTIF_BLOCK_LINES lines at a time, so only a block
+     of the band is held in memory.  For tiled output the block is rounded up
+     to a whole number of tile rows.
+  2. Any requested overviews are built from the source band after the full
+     resolution image has been written.
+  3. This routine only touches files belonging to this band, so it may be
+     run concurrently for different bands.
+******************************************************************************/
+static int convert_band_to_gtif
+(
+    Espa_band_meta_t *bmeta,      /* I: metadata for the band to convert */
+    Espa_proj_meta_t *proj_info,  /* I: global projection information */
+    char *gtif_band,              /* I: name of the output GeoTIFF file */
+    Tiff_output_opts_t *gtif_opts /* I: GeoTIFF layout and compression
+                                        options */
+)
+{
+    char FUNC_NAME[] = "convert_band_to_gtif";  /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    char tfw_file[STR_SIZE];    /* name of the world file for this band */
+    char *cptr = NULL;          /* pointer to the file extension */
+    int line;                   /* current starting line of the block */
+    int nlines;                 /* number of lines in the current block */
+    int block_lines;            /* number of lines per block */
+    int count;                  /* number of chars copied in snprintf */
+    int status = SUCCESS;       /* return status */
+    void *block_buf = NULL;     /* buffer for a block of lines */
+    Espa_band_file_t *band = NULL;    /* raw binary band being converted */
+    TIFF *tiff = NULL;          /* GeoTIFF file being written */
+
+    /* Determine the output world file name */
+    count = snprintf (tfw_file, sizeof (tfw_file), "%s", gtif_band);
+    if (count < 0 || count >= sizeof (tfw_file))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Overflow of tfw_file string");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    cptr = strrchr (tfw_file, '.');
+    strcpy (cptr, ".tfw");
+
+    printf ("Converting %s to %s\n", bmeta->file_name, gtif_band);
+
+    /* Open the raw binary band and the GeoTIFF file */
+    band = open_band_file (bmeta, BAND_READ);
+    if (band == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening the raw binary band: %s",
+            bmeta->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    tiff = open_tiff (gtif_band, "w");
+    if (tiff == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening the GeoTIFF file: %s",
+            gtif_band);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_band_file (band);
+        return (ERROR);
+    }
+
+    /* Tiles must be written a whole tile row at a time */
+    block_lines = GTIF_BLOCK_LINES;
+    if (gtif_opts->tile_size > 0)
+        block_lines = ((block_lines + gtif_opts->tile_size - 1) /
+            gtif_opts->tile_size) * gtif_opts->tile_size;
+
+    block_buf = malloc (band->line_size * block_lines);
+    if (block_buf == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory for the "
+            "block buffer");
+        error_handler (true, FUNC_NAME, errmsg);
+        close_tiff (tiff);
+        close_band_file (band);
+        return (ERROR);
+    }
+
+    /* Set the Tiff, GeoTIFF, and nodata tags.  Only write the nodata tag if
+       the fill value is defined. */
+    if (set_tiff_output_tags (tiff, bmeta->data_type, bmeta->nlines,
+        bmeta->nsamps, gtif_opts) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting the Tiff tags for %s",
+            gtif_band);
+        error_handler (true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+    else if (set_geotiff_tags (tiff, bmeta, proj_info) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting the GeoTIFF tags for %s",
+            gtif_band);
+        error_handler (true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+    else if ((int) bmeta->fill_value != (int) ESPA_INT_META_FILL &&
+        set_tiff_nodata (tiff, bmeta->fill_value) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting the nodata tag for %s",
+            gtif_band);
+        error_handler (true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+
+    /* Stream the band into the GeoTIFF a block of lines at a time */
+    for (line = 0; status == SUCCESS && line < bmeta->nlines;
+         line += block_lines)
+    {
+        nlines = block_lines;
+        if (line + nlines > bmeta->nlines)
+            nlines = bmeta->nlines - line;
+
+        if (read_band_window (band, line, 0, nlines, bmeta->nsamps,
+            block_buf) != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Reading lines starting at %d "
+                "from %s", line, bmeta->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            status = ERROR;
+        }
+        else if (write_tiff_lines (tiff, bmeta->data_type, line, nlines,
+            bmeta->nsamps, block_buf) != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Writing lines starting at %d "
+                "to %s", line, gtif_band);
+            error_handler (true, FUNC_NAME, errmsg);
+            status = ERROR;
+        }
+    }
+
+    /* Add the reduced resolution overviews */
+    if (status == SUCCESS && gtif_opts->noverviews > 0 &&
+        write_tiff_overviews (tiff, band, bmeta->data_type, gtif_opts)
+        != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Writing the overviews to %s",
+            gtif_band);
+        error_handler (true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+
+    /* Clean up for this band */
+    free (block_buf);
+    close_tiff (tiff);
+    close_band_file (band);
+    if (status != SUCCESS)
+        return (ERROR);
+
+    /* Write the ESRI world file */
+    if (write_tiff_world_file (tfw_file, bmeta, proj_info) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Writing the world file: %s",
+            tfw_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  remove_band_source
+
+PURPOSE: Removes the raw binary image and ENVI header files for a band.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error removing the source files
+SUCCESS         Successfully removed the source files
+
+NOTES:
+******************************************************************************/
+static int remove_band_source
+(
+    char *img_file         /* I: name of the raw binary band file */
+)
+{
+    char FUNC_NAME[] = "remove_band_source";  /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    char hdr_file[STR_SIZE];    /* name of the header file for this band */
+    char *cptr = NULL;          /* pointer to the file extension */
+    int count;                  /* number of chars copied in snprintf */
+
+    /* .img file */
+    printf ("  Removing %s\n", img_file);
+    if (unlink (img_file) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Deleting source file: %s",
+            img_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* .hdr file */
+    count = snprintf (hdr_file, sizeof (hdr_file), "%s", img_file);
+    if (count < 0 || count >= sizeof (hdr_file))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Overflow of hdr_file string");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    cptr = strrchr (hdr_file, '.');
+    strcpy (cptr, ".hdr");
+    printf ("  Removing %s\n", hdr_file);
+    if (unlink (hdr_file) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Deleting source file: %s",
+            hdr_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
 /******************************************************************************
 MODULE:  convert_espa_to_gtif
 
@@ -31,31 +269,40 @@ ERROR           Error converting to GeoTIFF
 SUCCESS         Successfully converted to GeoTIFF
 
 NOTES:
-  1. The GDAL tools will be used for converting the raw binary (ENVI format)
-     files to GeoTIFF.
+  1. The raw binary bands are streamed GTIF_BLOCK_LINES lines at a time into
+     GeoTIFF files written directly via the tiff_io library.
   2. An associated .tfw (ESRI world file) will be generated for each GeoTIFF
      file.
+  3. Each band is an independent file, so when built with ENABLE_THREADING
+     the bands are converted concurrently by up to nthreads threads.  Only
+     the output XML is written after all bands are done.
+  4. If gtif_opts is NULL, the GeoTIFFs are written uncompressed in one-line
+     strips without overviews.
 ******************************************************************************/
 int convert_espa_to_gtif
 (
     char *espa_xml_file,   /* I: input ESPA XML metadata filename */
     char *gtif_file,       /* I: base output GeoTIFF filename */
-    bool del_src           /* I: should the source files be removed after
+    bool del_src,          /* I: should the source files be removed after
                                  conversion? */
+    int nthreads,          /* I: number of bands to convert concurrently */
+    Tiff_output_opts_t *gtif_opts  /* I: GeoTIFF layout and compression
+                                         options (NULL for the defaults) */
 )
 {
     char FUNC_NAME[] = "convert_espa_to_gtif";  /* function name */
     char errmsg[STR_SIZE];      /* error message */
-    char gdal_cmd[STR_SIZE];    /* command string for GDAL call */
-    char gtif_band[STR_SIZE];   /* name of the GeoTIFF file for this band */
-    char hdr_file[STR_SIZE];    /* name of the header file for this band */
     char xml_file[STR_SIZE];    /* new XML file for the GeoTIFF product */
-    char tmpfile[STR_SIZE];     /* filename of file.tif.aux.xml */
+    char (*gtif_bands)[STR_SIZE] = NULL;  /* names of the GeoTIFF file for
+                                   each band */
     char *cptr = NULL;          /* pointer to empty space in the band name */
     int i;                      /* looping variable for each band */
     int count;                  /* number of chars copied in snprintf */
+    int status = SUCCESS;       /* status of the band conversions */
+    int curr_status;            /* local copy of the conversion status */
     Espa_internal_meta_t xml_metadata;  /* XML metadata structure to be
                                    populated by reading the XML metadata file */
+    Tiff_output_opts_t def_opts;  /* default GeoTIFF output options */
 
     /* Validate the input metadata file */
     if (validate_xml_file (espa_xml_file) != SUCCESS)
@@ -74,111 +321,87 @@ int convert_espa_to_gtif
         return (ERROR);
     }
 
-    /* Loop through the bands in the XML file and convert them to GeoTIFF.
-       The filenames will have the GeoTIFF base name followed by _ and the
-       band name of each band in the XML file.  Blank spaced in the band name
-       will be replaced with underscores. */
+    if (nthreads < 1)
+        nthreads = 1;
+
+    if (gtif_opts == NULL)
+    {
+        init_tiff_output_opts (&def_opts);
+        gtif_opts = &def_opts;
+    }
+
+    gtif_bands = calloc (xml_metadata.nbands, sizeof (*gtif_bands));
+    if (gtif_bands == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory for the "
+            "GeoTIFF band names");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Determine the output GeoTIFF filenames.  The filenames will have the
+       GeoTIFF base name followed by _ and the band name of each band in the
+       XML file.  Blank spaced in the band name will be replaced with
+       underscores. */
     for (i = 0; i < xml_metadata.nbands; i++)
     {
-        /* Determine the output GeoTIFF band name */
-        count = snprintf (gtif_band, sizeof (gtif_band), "%s_%s.tif",
+        count = snprintf (gtif_bands[i], sizeof (gtif_bands[i]), "%s_%s.tif",
             gtif_file, xml_metadata.band[i].name);
-        if (count < 0 || count >= sizeof (gtif_band))
+        if (count < 0 || count >= sizeof (gtif_bands[i]))
         {
             sprintf (errmsg, "Overflow of gtif_file string");
             error_handler (true, FUNC_NAME, errmsg);
+            free (gtif_bands);
             return (ERROR);
         }
 
         /* Loop through this filename and replace any occurances of blank
            spaces with underscores */
-        while ((cptr = strchr (gtif_band, ' ')) != NULL)
+        while ((cptr = strchr (gtif_bands[i], ' ')) != NULL)
             *cptr = '_';
+    }
 
-        /* Convert the files */
-        printf ("Converting %s to %s\n", xml_metadata.band[i].file_name,
-            gtif_band);
-
-        /* Check if the fill value is defined */
-        if ((int) xml_metadata.band[i].fill_value == (int) ESPA_INT_META_FILL)
-        {
-            /* Fill value is not defined so don't write the nodata tag */
-            count = snprintf (gdal_cmd, sizeof (gdal_cmd),
-                "gdal_translate -of Gtiff -co \"TFW=YES\" -q %s %s",
-                xml_metadata.band[i].file_name, gtif_band);
-        }
-        else
-        {
-            /* Fill value is defined so use the nodata tag */
-            count = snprintf (gdal_cmd, sizeof (gdal_cmd),
-             "gdal_translate -of Gtiff -a_nodata %ld -co \"TFW=YES\" -q %s %s",
-                xml_metadata.band[i].fill_value, xml_metadata.band[i].file_name,
-                gtif_band);
-        }
-        if (count < 0 || count >= sizeof (gdal_cmd))
-        {
-            sprintf (errmsg, "Overflow of gdal_cmd string");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        if (system (gdal_cmd) == -1)
-        {
-            sprintf (errmsg, "Running gdal_translate: %s", gdal_cmd);
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Remove the {gtif_name}.tif.aux.xml file since it's not needed and
-           clutters the results.  Don't worry about testing the unlink
-           results.  If it doesn't unlink it's not fatal. */
-        count = snprintf (tmpfile, sizeof (tmpfile), "%s.aux.xml", gtif_band);
-        if (count < 0 || count >= sizeof (tmpfile))
-        {
-            sprintf (errmsg, "Overflow of tmpfile string");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-        unlink (tmpfile);
+    /* Convert the bands to GeoTIFF, removing the source files if specified.
+       Once a band fails the remaining bands are skipped. */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic) num_threads (nthreads) \
+        private (curr_status)
+#endif
+    for (i = 0; i < xml_metadata.nbands; i++)
+    {
+#ifdef _OPENMP
+        #pragma omp atomic read
+#endif
+        curr_status = status;
+        if (curr_status != SUCCESS)
+            continue;
 
-        /* Remove the source file if specified */
-        if (del_src)
+        if (convert_band_to_gtif (&xml_metadata.band[i],
+            &xml_metadata.global.proj_info, gtif_bands[i], gtif_opts)
+            != SUCCESS ||
+            (del_src && remove_band_source (xml_metadata.band[i].file_name)
+             != SUCCESS))
         {
-            /* .img file */
-            printf ("  Removing %s\n", xml_metadata.band[i].file_name);
-            if (unlink (xml_metadata.band[i].file_name) != 0)
-            {
-                sprintf (errmsg, "Deleting source file: %s",
-                    xml_metadata.band[i].file_name);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-
-            /* .hdr file */
-            count = snprintf (hdr_file, sizeof (hdr_file), "%s",
-                xml_metadata.band[i].file_name);
-            if (count < 0 || count >= sizeof (hdr_file))
-            {
-                sprintf (errmsg, "Overflow of hdr_file string");
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-
-            cptr = strrchr (hdr_file, '.');
-            strcpy (cptr, ".hdr");
-            printf ("  Removing %s\n", hdr_file);
-            if (unlink (hdr_file) != 0)
-            {
-                sprintf (errmsg, "Deleting source file: %s", hdr_file);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
+#ifdef _OPENMP
+            #pragma omp atomic write
+#endif
+            status = ERROR;
         }
+    }
 
-        /* Update the XML file to use the new GeoTIFF band name */
-        strcpy (xml_metadata.band[i].file_name, gtif_band);
+    if (status != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Converting the bands to GeoTIFF");
+        error_handler (true, FUNC_NAME, errmsg);
+        free (gtif_bands);
+        return (ERROR);
     }
 
+    /* Update the XML file to use the new GeoTIFF band names */
+    for (i = 0; i < xml_metadata.nbands; i++)
+        strcpy (xml_metadata.band[i].file_name, gtif_bands[i]);
+    free (gtif_bands);
+
     /* Remove the source XML if specified */
     if (del_src)
     {
@@ -215,4 +438,3 @@ int convert_espa_to_gtif
     /* Successful conversion */
     return (SUCCESS);
 }
-
@@ -22,16 +22,24 @@ NOTES:
 #include "espa_metadata.h"
 #include "parse_metadata.h"
 #include "write_metadata.h"
+#include "raw_binary_band.h"
+#include "tiff_io.h"
 
 /* Defines */
+/* Number of lines read from the raw binary band and written to the GeoTIFF
+   at a time */
+#define GTIF_BLOCK_LINES 256
 
 /* Prototypes */
 int convert_espa_to_gtif
 (
     char *espa_xml_file,   /* I: input ESPA XML metadata filename */
     char *gtif_file,       /* I: base output GeoTIFF filename */
-    bool del_src           /* I: should the source files be removed after
+    bool del_src,          /* I: should the source files be removed after
                                  conversion? */
+    int nthreads,          /* I: number of bands to convert concurrently */
+    Tiff_output_opts_t *gtif_opts  /* I: GeoTIFF layout and compression
+                                         options (NULL for the defaults) */
 );
 
 #endif
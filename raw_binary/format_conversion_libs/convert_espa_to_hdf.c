@@ -562,6 +562,159 @@ int write_sds_attributes
 }
 
 
+/******************************************************************************
+MODULE:  init_hdf_output_opts
+
+PURPOSE: Initializes the HDF output options to the defaults of external,
+uncompressed SDSs without chunking.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void init_hdf_output_opts
+(
+    Hdf_output_opts_t *opts   /* O: output options set to the defaults */
+)
+{
+    opts->compress = HDF_COMPRESS_NONE;
+    opts->deflate_level = 0;
+    opts->chunk_lines = 0;
+    opts->chunk_samps = 0;
+}
+
+
+/******************************************************************************
+MODULE:  hdf_opts_internal
+
+PURPOSE: Determines if the SDSs need to be stored inside the HDF file rather
+than in external big endian raw binary files.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            SDSs are chunked and/or compressed, so they are internal
+false           SDSs are external raw binary files
+
+NOTES:
+  1. The HDF4 library doesn't support chunked or compressed external SDSs.
+******************************************************************************/
+static bool hdf_opts_internal
+(
+    Hdf_output_opts_t *opts   /* I: output options */
+)
+{
+    return (opts->compress != HDF_COMPRESS_NONE || opts->chunk_lines > 0 ||
+        opts->chunk_samps > 0);
+}
+
+
+/******************************************************************************
+MODULE:  set_sds_chunking
+
+PURPOSE: Sets up the chunking and compression for the current SDS.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error setting the chunking or compression
+SUCCESS         Successfully set up the SDS
+
+NOTES:
+  1. If the chunk dimensions aren't specified, HDF_DEFAULT_CHUNK_SIZE is
+     used.  The chunk dimensions are limited to the size of the band.
+  2. The chunk cache is set to hold a full row of chunks, since the band is
+     written a block of whole chunk rows at a time.
+******************************************************************************/
+static int set_sds_chunking
+(
+    int32 sds_id,              /* I: SDS ID to set up */
+    int nlines,                /* I: number of lines in the band */
+    int nsamps,                /* I: number of samples in the band */
+    Hdf_output_opts_t *opts,   /* I: output options */
+    int *chunk_lines           /* O: number of lines per chunk */
+)
+{
+    char FUNC_NAME[] = "set_sds_chunking";  /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    int32 flags = HDF_CHUNK;      /* chunking flags */
+    int32 ncache;                 /* number of chunks in the cache */
+    uint32 config;                /* compression configuration of HDF4 */
+    HDF_CHUNK_DEF chunk_def;      /* chunk and compression definition */
+
+    memset (&chunk_def, 0, sizeof (chunk_def));
+    chunk_def.comp.chunk_lengths[0] = (opts->chunk_lines > 0) ?
+        opts->chunk_lines : HDF_DEFAULT_CHUNK_SIZE;
+    chunk_def.comp.chunk_lengths[1] = (opts->chunk_samps > 0) ?
+        opts->chunk_samps : HDF_DEFAULT_CHUNK_SIZE;
+    if (chunk_def.comp.chunk_lengths[0] > nlines)
+        chunk_def.comp.chunk_lengths[0] = nlines;
+    if (chunk_def.comp.chunk_lengths[1] > nsamps)
+        chunk_def.comp.chunk_lengths[1] = nsamps;
+
+    switch (opts->compress)
+    {
+        case HDF_COMPRESS_NONE:
+            break;
+
+        case HDF_COMPRESS_DEFLATE:
+            flags = HDF_CHUNK | HDF_COMP;
+            chunk_def.comp.comp_type = COMP_CODE_DEFLATE;
+            chunk_def.comp.cinfo.deflate.level = (opts->deflate_level > 0) ?
+                opts->deflate_level : 6;
+            break;
+
+        case HDF_COMPRESS_SZIP:
+            /* Szip encoding is an optional part of the HDF4 library */
+            if (HCget_config_info (COMP_CODE_SZIP, &config) == HDF_ERROR ||
+                !(config & COMP_ENCODER_ENABLED))
+            {
+                snprintf (errmsg, sizeof (errmsg), "Szip encoding is not "
+                    "available in this HDF4 library");
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+            flags = HDF_CHUNK | HDF_COMP;
+            chunk_def.comp.comp_type = COMP_CODE_SZIP;
+            chunk_def.comp.cinfo.szip.options_mask = SZ_NN_OPTION_MASK;
+            chunk_def.comp.cinfo.szip.pixels_per_block =
+                HDF_SZIP_PIXELS_PER_BLOCK;
+            break;
+
+        default:
+            snprintf (errmsg, sizeof (errmsg), "Unsupported HDF compression "
+                "type %d", opts->compress);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+    }
+
+    if (SDsetchunk (sds_id, chunk_def, flags) == HDF_ERROR)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting the chunking (%d x %d) "
+            "for the SDS", (int) chunk_def.comp.chunk_lengths[0],
+            (int) chunk_def.comp.chunk_lengths[1]);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    ncache = (nsamps + chunk_def.comp.chunk_lengths[1] - 1) /
+        chunk_def.comp.chunk_lengths[1];
+    if (SDsetchunkcache (sds_id, ncache, 0) == HDF_ERROR)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting the chunk cache for "
+            "the SDS");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    *chunk_lines = chunk_def.comp.chunk_lengths[0];
+    return (SUCCESS);
+}
+
+
 /******************************************************************************
 MODULE:  create_hdf_metadata
 
@@ -581,26 +734,36 @@ NOTES:
      there, different x,y dimensions will contain the pixel size at the end of
      XDim, YDim.  Example: XDim_15, YDim_15.  For Geographic projections, the
      name will be based on the count of grids instead of the pixel size.
+  3. Each band is streamed from the raw binary file a block of lines at a
+     time, so only a block of the band is held in memory.
+  4. If chunking or compression is requested, the SDSs are written inside
+     the HDF file instead of to external big endian files.  The blocks are
+     then whole rows of chunks, so each chunk is compressed only once.
 ******************************************************************************/
 int create_hdf_metadata
 (
     char *hdf_file,                     /* I: output HDF filename */
     Espa_internal_meta_t *xml_metadata, /* I: XML metadata structure */
-    bool del_src           /* I: should the source files be removed after
+    bool del_src,          /* I: should the source files be removed after
                                  conversion? */
+    Hdf_output_opts_t *hdf_opts  /* I: SDS chunking and compression options
+                                       (NULL for the defaults) */
 )
 {
     char FUNC_NAME[] = "create_hdf_metadata";  /* function name */
-    char errmsg[STR_SIZE];        /* error message */
+    char errmsg[2 * STR_SIZE];    /* error message; room for a file name
+                                     along with the message */
     char bendian_file[STR_SIZE];  /* name of output big endian img file */
     char dim_name[2][STR_SIZE];   /* array of dimension names */
     char hdr_file[STR_SIZE];      /* ENVI header file */
     char *cptr = NULL;            /* pointer to the file extension */
     int i;                        /* looping variable for each SDS */
-    int nbytes;                   /* number of bytes in the data type */
     int nlines;                   /* number of lines in the band */
     int nsamps;                   /* number of samples in the band */
     int dim;                      /* looping variable for dimensions */
+    int line;                     /* current starting line of the block */
+    int block_lines;              /* number of lines per block */
+    int chunk_lines;              /* number of lines per chunk */
     int count;                    /* number of chars copied in snprintf */
     int ngrids;                   /* current number of grids in the product;
                                      different grids are written for different
@@ -615,8 +778,17 @@ int create_hdf_metadata
     int32 dims[2];                /* array for dimension sizes; only 2D prods */
     int32 start[2];               /* starting location to write the HDF data */
     int32 edge[2];                /* number of values to write the HDF data */
-    FILE *fp_rb = NULL;           /* file pointer for the raw binary file */
-    void *file_buf = NULL;        /* pointer to correct input file buffer */
+    bool internal;                /* are the SDSs stored in the HDF file? */
+    void *file_buf = NULL;        /* buffer for a block of lines */
+    Espa_band_file_t *band = NULL;  /* raw binary band being converted */
+    Hdf_output_opts_t def_opts;   /* default HDF output options */
+
+    if (hdf_opts == NULL)
+    {
+        init_hdf_output_opts (&def_opts);
+        hdf_opts = &def_opts;
+    }
+    internal = hdf_opts_internal (hdf_opts);
 
     /* Open the HDF file for creation (overwriting if it exists) */
     hdf_id = SDstart (hdf_file, DFACC_CREATE);
@@ -636,8 +808,8 @@ int create_hdf_metadata
         printf ("Processing SDS: %s\n", xml_metadata->band[i].name);
 
         /* Open the file for this band of data to allow for reading */
-        fp_rb = open_raw_binary (xml_metadata->band[i].file_name, "rb");
-        if (fp_rb == NULL)
+        band = open_band_file (&xml_metadata->band[i], BAND_READ);
+        if (band == NULL)
         {
             sprintf (errmsg, "Opening the input raw binary file: %s",
                 xml_metadata->band[i].file_name);
@@ -656,35 +828,27 @@ int create_hdf_metadata
         {
             case (ESPA_INT8):
                 data_type = DFNT_INT8;
-                nbytes = 1;
                 break;
             case (ESPA_UINT8):
                 data_type = DFNT_UINT8;
-                nbytes = 1;
                 break;
             case (ESPA_INT16):
                 data_type = DFNT_INT16;
-                nbytes = 2;
                 break;
             case (ESPA_UINT16):
                 data_type = DFNT_UINT16;
-                nbytes = 2;
                 break;
             case (ESPA_INT32):
                 data_type = DFNT_INT32;
-                nbytes = 4;
                 break;
             case (ESPA_UINT32):
                 data_type = DFNT_UINT32;
-                nbytes = 4;
                 break;
             case (ESPA_FLOAT32):
                 data_type = DFNT_FLOAT32;
-                nbytes = 4;
                 break;
             case (ESPA_FLOAT64):
                 data_type = DFNT_FLOAT64;
-                nbytes = 8;
                 break;
             default:
                 sprintf (errmsg, "Unsupported ESPA data type.");
@@ -692,27 +856,6 @@ int create_hdf_metadata
                 return (ERROR);
         }
 
-        /* Allocate memory for the file buffer */
-        file_buf = calloc (nlines * nsamps, nbytes);
-        if (file_buf == NULL)
-        {
-            sprintf (errmsg, "Error allocating memory for the file buffer.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Read the data from the raw binary file */
-        if (read_raw_binary (fp_rb, nlines, nsamps, nbytes, file_buf) !=
-            SUCCESS)
-        {
-            sprintf (errmsg, "Reading image data from the raw binary file");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Close the raw binary file */
-        close_raw_binary (fp_rb);
-
         /* Find the location of the file extension, then modify the filename
            a bit to depict the big endian version of the imagery needed for
            the HDF files.  (It's assumed we are running on Linux, thus the
@@ -810,8 +953,26 @@ int create_hdf_metadata
         }
 
         /* Identify the external dataset for this SDS, starting at byte
-           location 0 since these are raw binary files without any headers */
-        if (SDsetexternalfile (sds_id, bendian_file, 0 /* offset */) ==
+           location 0 since these are raw binary files without any headers.
+           Chunked and compressed SDSs are stored in the HDF file itself. */
+        block_lines = HDF_BLOCK_LINES;
+        if (internal)
+        {
+            if (set_sds_chunking (sds_id, nlines, nsamps, hdf_opts,
+                &chunk_lines) != SUCCESS)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Setting up the chunking "
+                    "for this SDS (%d).", i);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+
+            /* Write whole rows of chunks */
+            block_lines = (HDF_BLOCK_LINES / chunk_lines) * chunk_lines;
+            if (block_lines < chunk_lines)
+                block_lines = chunk_lines;
+        }
+        else if (SDsetexternalfile (sds_id, bendian_file, 0 /* offset */) ==
             HDF_ERROR)
         {
             sprintf (errmsg, "Setting the external dataset for this SDS (%d): "
@@ -820,20 +981,50 @@ int create_hdf_metadata
             return (ERROR);
         }
 
-        /* Write the new big endian data to the SDS.  Start writing at the
-           beginning of the SDS, write every element, and write all the
-           elements in both dimensions. */
-        start[0] = start[1] = 0;
-        edge[0] = dims[0];
-        edge[1] = dims[1];
-        if (SDwritedata (sds_id, start, NULL, edge, file_buf) == HDF_ERROR)
+        /* Allocate memory for a block of lines */
+        file_buf = malloc (band->line_size * block_lines);
+        if (file_buf == NULL)
         {
-            sprintf (errmsg, "Writing the external dataset for this SDS (%d): "
-                "%s.", i, bendian_file);
+            snprintf (errmsg, sizeof (errmsg), "Error allocating memory "
+                "for the file buffer.");
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
+        /* Stream the band into the SDS a block of lines at a time.  Write
+           every element of each line in the block. */
+        start[1] = 0;
+        edge[1] = dims[1];
+        for (line = 0; line < nlines; line += block_lines)
+        {
+            start[0] = line;
+            edge[0] = block_lines;
+            if (line + block_lines > nlines)
+                edge[0] = nlines - line;
+
+            if (read_band_window (band, line, 0, edge[0], nsamps, file_buf)
+                != SUCCESS)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Reading lines starting "
+                    "at %d from the raw binary file: %s", line,
+                    xml_metadata->band[i].file_name);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+
+            if (SDwritedata (sds_id, start, NULL, edge, file_buf) ==
+                HDF_ERROR)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Writing lines starting "
+                    "at %d to the dataset for this SDS (%d).", line, i);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+        }
+
+        /* Close the raw binary file */
+        close_band_file (band);
+
         /* Write the SDS-level metadata */
         if (write_sds_attributes (sds_id, &xml_metadata->band[i]) != SUCCESS)
         {
@@ -921,17 +1112,21 @@ ERROR           Error converting to HDF
 SUCCESS         Successfully converted to HDF
 
 NOTES:
-  1. The ESPA raw binary band files will be used, as-is, and linked to as
-     external SDSs from the HDF file.
-  2. An ENVI header file will be written for the HDF files which contain
+  1. By default the ESPA raw binary band files will be written as big endian
+     files and linked to as external SDSs from the HDF file.
+  2. If chunking or compression is requested, the bands are written inside
+     the HDF file and the XML band file names refer to the HDF file.
+  3. An ENVI header file will be written for the HDF files which contain
      SDSs of the same resolution (i.e. not a multi-resolution product).
 ******************************************************************************/
 int convert_espa_to_hdf
 (
     char *espa_xml_file,   /* I: input ESPA XML metadata filename */
     char *hdf_file,        /* I: output HDF filename */
-    bool del_src           /* I: should the source files be removed after
+    bool del_src,          /* I: should the source files be removed after
                                  conversion? */
+    Hdf_output_opts_t *hdf_opts  /* I: SDS chunking and compression options
+                                       (NULL for the defaults) */
 )
 {
     char FUNC_NAME[] = "convert_espa_to_hdf";  /* function name */
@@ -966,7 +1161,8 @@ int convert_espa_to_hdf
 
     /* Create the HDF file for the HDF metadata from the XML metadata.  This
        also creates the big endian files for the HDF file. */
-    if (create_hdf_metadata (hdf_file, &xml_metadata, del_src) != SUCCESS)
+    if (create_hdf_metadata (hdf_file, &xml_metadata, del_src, hdf_opts)
+        != SUCCESS)
     {
         sprintf (errmsg, "Creating the HDF metadata file (%s) which links to "
             "the raw binary bands as external SDSs.", hdf_file);
@@ -1068,9 +1264,24 @@ int convert_espa_to_hdf
     }
 
     /* Loop through the bands and modify the band names to match the new
-       (external) raw binary filenames in the HDF product */
+       (external) raw binary filenames in the HDF product, or the HDF file
+       itself if the SDSs are stored internally */
     for (i = 0; i < xml_metadata.nbands; i++)
     {
+        if (hdf_opts != NULL && hdf_opts_internal (hdf_opts))
+        {
+            count = snprintf (xml_metadata.band[i].file_name,
+                sizeof (xml_metadata.band[i].file_name), "%s", hdf_file);
+            if (count < 0 || count >= sizeof (xml_metadata.band[i].file_name))
+            {
+                snprintf (errmsg, sizeof (errmsg), "Overflow of band "
+                    "file_name string");
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+            continue;
+        }
+
         count = snprintf (bendian_file, sizeof (bendian_file), "%s",
             xml_metadata.band[i].file_name);
         if (count < 0 || count >= sizeof (bendian_file))
@@ -28,11 +28,46 @@ NOTES:
 #include "espa_hdf_eos.h"
 #include "envi_header.h"
 #include "raw_binary_io.h"
+#include "raw_binary_band.h"
 
 /* Defines */
 #define HDF_ERROR -1
 
+/* Number of lines read from the raw binary band and written to the SDS at a
+   time, when the SDS isn't chunked */
+#define HDF_BLOCK_LINES 256
+
+/* Default chunk size (lines and samples) when compression is requested
+   without specifying the chunk dimensions */
+#define HDF_DEFAULT_CHUNK_SIZE 256
+
+/* Number of pixels per szip block */
+#define HDF_SZIP_PIXELS_PER_BLOCK 16
+
+/* Compression applied to the SDSs */
+typedef enum {
+    HDF_COMPRESS_NONE,
+    HDF_COMPRESS_DEFLATE,
+    HDF_COMPRESS_SZIP
+} Hdf_compress_t;
+
+/* Output options for the SDSs in the HDF file */
+typedef struct
+{
+    Hdf_compress_t compress;   /* compression type */
+    int deflate_level;         /* deflate level (1-9); 0 for the default */
+    int chunk_lines;           /* number of lines per chunk; 0 if the SDS
+                                  isn't chunked */
+    int chunk_samps;           /* number of samples per chunk; 0 if the SDS
+                                  isn't chunked */
+} Hdf_output_opts_t;
+
 /* Prototypes */
+void init_hdf_output_opts
+(
+    Hdf_output_opts_t *opts   /* O: output options set to the defaults */
+);
+
 int write_global_attributes
 (
     int32 hdf_id,               /* I: HDF file ID to write attributes */
@@ -49,16 +84,20 @@ int create_hdf_metadata
 (
     char *hdf_file,                     /* I: output HDF filename */
     Espa_internal_meta_t *xml_metadata, /* I: XML metadata structure */
-    bool del_src           /* I: should the source files be removed after
+    bool del_src,          /* I: should the source files be removed after
                                  conversion? */
+    Hdf_output_opts_t *hdf_opts  /* I: SDS chunking and compression options
+                                       (NULL for the defaults) */
 );
 
 int convert_espa_to_hdf
 (
     char *espa_xml_file,   /* I: input ESPA XML metadata filename */
     char *hdf_file,        /* I: output HDF filename */
-    bool del_src           /* I: should the source files be removed after
+    bool del_src,          /* I: should the source files be removed after
                                  conversion? */
+    Hdf_output_opts_t *hdf_opts  /* I: SDS chunking and compression options
+                                       (NULL for the defaults) */
 );
 
 #endif
@@ -587,6 +587,175 @@ int write_global_attributes
     return (SUCCESS);
 }
 
+/******************************************************************************
+MODULE:  init_netcdf_output_opts
+
+PURPOSE: Initializes the NetCDF output options to the defaults of
+DEFLATE_LEVEL compression for all variables and the NetCDF default chunking.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void init_netcdf_output_opts
+(
+    Netcdf_output_opts_t *opts  /* O: output options set to the defaults */
+)
+{
+    opts->deflate_level = DEFLATE_LEVEL;
+    opts->coord_deflate_level = DEFLATE_LEVEL;
+    opts->chunk_lines = 0;
+    opts->chunk_samps = 0;
+    opts->nband_levels = 0;
+}
+
+
+/******************************************************************************
+MODULE:  band_deflate_level
+
+PURPOSE: Determines the deflate level to use for the specified band.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+0-9             Deflate level for the band; 0 for no compression
+
+NOTES:
+******************************************************************************/
+static int band_deflate_level
+(
+    Netcdf_output_opts_t *opts, /* I: output options */
+    char *band_name             /* I: name of the band */
+)
+{
+    int i;                      /* looping variable */
+
+    for (i = 0; i < opts->nband_levels; i++)
+    {
+        if (!strcmp (opts->band_levels[i].name, band_name))
+            return (opts->band_levels[i].deflate_level);
+    }
+
+    return (opts->deflate_level);
+}
+
+
+/******************************************************************************
+MODULE:  set_var_compression
+
+PURPOSE: Turns on compression for the specified variable and increases its
+chunk cache size.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error setting the compression
+SUCCESS         Successfully set the compression
+
+NOTES:
+  1. Nothing is done if the deflate level is 0.
+******************************************************************************/
+static int set_var_compression
+(
+    int ncid,               /* I: NetCDF file ID */
+    int varid,              /* I: variable ID */
+    char *var_name,         /* I: name of the variable, for error messages */
+    int deflate_level       /* I: deflate level; 0 for no compression */
+)
+{
+    char FUNC_NAME[] = "set_var_compression";  /* function name */
+    char errmsg[STR_SIZE];  /* error message */
+    int retval;             /* function call return value */
+
+    if (deflate_level <= 0)
+        return (SUCCESS);
+
+    /* Specify compression for this variable */
+    if ((retval = nc_def_var_deflate (ncid, varid, SHUFFLE, DEFLATE,
+         deflate_level)))
+    {
+        netCDF_ERR (retval);
+        snprintf (errmsg, sizeof (errmsg), "Error specifying the compression "
+            "for variable: %s", var_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Increase the chunk cache size */
+    if ((retval = nc_set_var_chunk_cache (ncid, varid, CACHE_SIZE,
+         CACHE_NELEMS, CACHE_PREEMPTION)))
+    {
+        netCDF_ERR (retval);
+        snprintf (errmsg, sizeof (errmsg), "Error specifying the chunk cache "
+            "size for variable: %s", var_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_coord_var
+
+PURPOSE: Writes the values of a 1D coordinate variable, which are evenly
+spaced from the starting value.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the coordinate variable
+SUCCESS         Successfully wrote the coordinate variable
+
+NOTES:
+  1. The values are computed and written NC_COORD_BLOCK at a time, so no
+     buffer the size of the dimension is needed.
+******************************************************************************/
+static int write_coord_var
+(
+    int ncid,               /* I: NetCDF file ID */
+    int varid,              /* I: coordinate variable ID */
+    int nvals,              /* I: number of values in the coordinate */
+    double start_val,       /* I: value of the first coordinate */
+    double step             /* I: difference between successive values */
+)
+{
+    char FUNC_NAME[] = "write_coord_var";  /* function name */
+    char errmsg[STR_SIZE];  /* error message */
+    int retval;             /* function call return value */
+    size_t i;               /* looping variable */
+    size_t start;           /* index of the first value in the block */
+    size_t count;           /* number of values in the block */
+    float coords[NC_COORD_BLOCK];  /* block of coordinate values */
+
+    for (start = 0; start < (size_t) nvals; start += NC_COORD_BLOCK)
+    {
+        count = nvals - start;
+        if (count > NC_COORD_BLOCK)
+            count = NC_COORD_BLOCK;
+
+        for (i = 0; i < count; i++)
+            coords[i] = start_val + step * (start + i);
+
+        if ((retval = nc_put_vara_float (ncid, varid, &start, &count,
+            coords)))
+        {
+            netCDF_ERR (retval);
+            snprintf (errmsg, sizeof (errmsg), "Error writing coordinate "
+                "values starting at %d", (int) start);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+
+    return (SUCCESS);
+}
+
 /******************************************************************************
 MODULE:  create_netCDF_metadata
 
@@ -606,6 +775,12 @@ NOTES:
      there, different x,y dimensions will contain the pixel size at the end of
      XDim, YDim.  Example: XDim_15, YDim_15.  For Geographic projections, the
      name will be based on the count of grids instead of the pixel size.
+  3. Each band is streamed from the raw binary file into the band variable
+     a block of lines at a time, so only a block of the band is held in
+     memory.  If the chunk shape is specified, the blocks are whole rows of
+     chunks.  If only one chunk dimension is specified, the chunk lines
+     default to NC_BLOCK_LINES and the chunk samples default to the full
+     width of the band.
 ******************************************************************************/
 int create_netcdf_metadata
 (
@@ -613,16 +788,17 @@ int create_netcdf_metadata
     Espa_internal_meta_t *xml_metadata, /* I: XML metadata structure */
     bool del_src,          /* I: should the source files be removed after
                                  conversion? */
-    bool no_compression    /* I: use compression for the NetCDF output file? */
+    Netcdf_output_opts_t *nc_opts  /* I: compression and chunking options
+                                         (NULL for the defaults) */
 )
 {
     char FUNC_NAME[] = "create_netcdf_metadata";  /* function name */
-    char errmsg[STR_SIZE];   /* error message */
+    char errmsg[2 * STR_SIZE];    /* error message; room for a file name
+                                     along with the message */
     char dim_name[2][STR_SIZE];   /* array of dimension names */
     char hdr_file[STR_SIZE];      /* ENVI header file */
     char *cptr = NULL;            /* pointer to the file extension */
     int i;                        /* looping variable for each band */
-    int nbytes;                   /* number of bytes in the data type */
     int nlines;                   /* number of lines in the band */
     int nsamps;                   /* number of samples in the band */
     int count;                    /* number of chars copied in snprintf */
@@ -639,16 +815,24 @@ int create_netcdf_metadata
     int y_varid;                  /* y coordinate variable ID */
     int dimids[2];                /* array for the dimension IDs */
     int dims[2];                  /* array for dimension sizes; only 2D prods */
-    float *xdims = NULL;          /* coordinate values for the x-dimension */
-    float *ydims = NULL;          /* coordinate values for the y-dimension */
-    int x;                        /* loop index */
-    int y;                        /* loop index */
-    FILE *fp_rb = NULL;           /* file pointer for the raw binary file */
-    void *file_buf = NULL;        /* pointer to correct input file buffer */
+    int line;                     /* current starting line of the block */
+    int block_lines;              /* number of lines per block */
+    size_t chunks[2];             /* chunk shape for the band variable */
+    size_t start[2];              /* starting location of the block */
+    size_t edge[2];               /* size of the block */
+    void *file_buf = NULL;        /* buffer for a block of lines */
+    Espa_band_file_t *band = NULL;  /* raw binary band being converted */
+    Netcdf_output_opts_t def_opts;  /* default NetCDF output options */
     int ncid;                     /* NetCDF file ID */
     int band_varid;               /* Variable ID for band */
     int retval = 0;               /* function call return value */
 
+    if (nc_opts == NULL)
+    {
+        init_netcdf_output_opts (&def_opts);
+        nc_opts = &def_opts;
+    }
+
     /* Create the NetCDF file.  The NC_NETCDF4 parameter tells NetCDF to create
        a file in NetCDF-4/HDF5 standard. NC_CLOBBER tells NetCDF to overwrite
        this file, if it already exists. */ 
@@ -678,8 +862,8 @@ int create_netcdf_metadata
         printf ("Processing band: %s\n", xml_metadata->band[i].name);
 
         /* Open the file for this band of data to allow for reading */
-        fp_rb = open_raw_binary (xml_metadata->band[i].file_name, "rb");
-        if (fp_rb == NULL)
+        band = open_band_file (&xml_metadata->band[i], BAND_READ);
+        if (band == NULL)
         {
             sprintf (errmsg, "Opening the input raw binary file: %s",
                 xml_metadata->band[i].file_name);
@@ -698,35 +882,27 @@ int create_netcdf_metadata
         {
             case (ESPA_INT8):
                 data_type = NC_BYTE;
-                nbytes = 1;
                 break;
             case (ESPA_UINT8):
                 data_type = NC_UBYTE;
-                nbytes = 1;
                 break;
             case (ESPA_INT16):
                 data_type = NC_SHORT;
-                nbytes = 2;
                 break;
             case (ESPA_UINT16):
                 data_type = NC_USHORT;
-                nbytes = 2;
                 break;
             case (ESPA_INT32):
                 data_type = NC_INT;
-                nbytes = 4;
                 break;
             case (ESPA_UINT32):
                 data_type = NC_UINT;
-                nbytes = 4;
                 break;
             case (ESPA_FLOAT32):
                 data_type = NC_FLOAT;
-                nbytes = 4;
                 break;
             case (ESPA_FLOAT64):
                 data_type = NC_DOUBLE;
-                nbytes = 8;
                 break;
             default:
                 sprintf (errmsg, "Unsupported ESPA data type.");
@@ -734,27 +910,6 @@ int create_netcdf_metadata
                 return (ERROR);
         }
 
-        /* Allocate memory for the file buffer */
-        file_buf = calloc (nlines * nsamps, nbytes);
-        if (file_buf == NULL)
-        {
-            sprintf (errmsg, "Error allocating memory for the file buffer.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Read the data from the raw binary file */
-        if (read_raw_binary (fp_rb, nlines, nsamps, nbytes, file_buf) !=
-            SUCCESS)
-        {
-            sprintf (errmsg, "Reading image data from the raw binary file");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Close the raw binary file */
-        close_raw_binary (fp_rb);
-
         /* Set the dimension names for this band.  The default is to use YDim,
            XDim for the first band or for any bands matching the resolution of
            the first band */
@@ -844,29 +999,13 @@ int create_netcdf_metadata
         }
 
         /* Set up data compression if it was specified */
-        if (!no_compression)
+        if (set_var_compression (ncid, x_varid, dim_name[1],
+            nc_opts->coord_deflate_level) != SUCCESS)
         {
-            /* Specify compression for this variable */
-            if ((retval = nc_def_var_deflate (ncid, x_varid, SHUFFLE, DEFLATE,
-                 DEFLATE_LEVEL)))
-            {
-                netCDF_ERR (retval);
-                sprintf (errmsg, "Error specifying the compression for "
-                    "variable: %s", dim_name[1]);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-
-            /* Increase the chunk cache size */
-            if ((retval = nc_set_var_chunk_cache (ncid, x_varid, CACHE_SIZE,
-                 CACHE_NELEMS, CACHE_PREEMPTION)))
-            {
-                netCDF_ERR (retval);
-                sprintf (errmsg, "Error specifying the chunk cache size for "
-                    "variable: %s", dim_name[1]);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
+            snprintf (errmsg, sizeof (errmsg), "Setting up the compression "
+                "for variable: %s", dim_name[1]);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
         }
 
         /* Define the y coordinate variable and attributes */
@@ -880,29 +1019,13 @@ int create_netcdf_metadata
         }
 
         /* Set up data compression if it was specified */
-        if (!no_compression)
+        if (set_var_compression (ncid, y_varid, dim_name[0],
+            nc_opts->coord_deflate_level) != SUCCESS)
         {
-            /* Specify compression for this variable */
-            if ((retval = nc_def_var_deflate (ncid, y_varid, SHUFFLE, DEFLATE,
-                 DEFLATE_LEVEL)))
-            {
-                netCDF_ERR (retval);
-                sprintf (errmsg, "Error specifying the compression for "
-                    "variable: %s", dim_name[0]);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-
-            /* Increase the chunk cache size */
-            if ((retval = nc_set_var_chunk_cache (ncid, y_varid, CACHE_SIZE,
-                 CACHE_NELEMS, CACHE_PREEMPTION)))
-            {
-                netCDF_ERR (retval);
-                sprintf (errmsg, "Error specifying the chunk cache size for "
-                    "variable: %s", dim_name[0]);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
+            snprintf (errmsg, sizeof (errmsg), "Setting up the compression "
+                "for variable: %s", dim_name[0]);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
         }
 
         /* Define the band variable */
@@ -918,99 +1041,77 @@ int create_netcdf_metadata
             return (ERROR);
         }
 
-        /* Specify compression for the primary variable */
-        if (!no_compression)
+        /* Specify the chunk shape for the primary variable, if requested */
+        block_lines = NC_BLOCK_LINES;
+        if (nc_opts->chunk_lines > 0 || nc_opts->chunk_samps > 0)
         {
-            if ((retval = nc_def_var_deflate (ncid, band_varid, SHUFFLE,
-                 DEFLATE, DEFLATE_LEVEL)))
+            chunks[0] = (nc_opts->chunk_lines > 0) ? nc_opts->chunk_lines :
+                NC_BLOCK_LINES;
+            chunks[1] = (nc_opts->chunk_samps > 0) ? nc_opts->chunk_samps :
+                nsamps;
+            if (chunks[0] > nlines)
+                chunks[0] = nlines;
+            if (chunks[1] > nsamps)
+                chunks[1] = nsamps;
+
+            if ((retval = nc_def_var_chunking (ncid, band_varid, NC_CHUNKED,
+                chunks)))
             {
                 netCDF_ERR (retval);
-                sprintf (errmsg, "Error specifying the compression for "
-                    "variable: %s", xml_metadata->band[i].name);
+                snprintf (errmsg, sizeof (errmsg), "Error specifying the "
+                    "chunk shape for variable: %s",
+                    xml_metadata->band[i].name);
                 error_handler (true, FUNC_NAME, errmsg);
                 return (ERROR);
             }
 
-            /* Increase the chunk cache size */
-            if ((retval = nc_set_var_chunk_cache (ncid, band_varid, CACHE_SIZE,
-                 CACHE_NELEMS, CACHE_PREEMPTION)))
-            {
-                netCDF_ERR (retval);
-                sprintf (errmsg, "Error specifying the chunk cache size for "
-                    "variable: %s", xml_metadata->band[i].name);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-        }
-
-        /* End define mode. This tells NetCDF we are done defining metadata
-           and are moving to writing the data. */
-        if ((retval = nc_enddef (ncid)))
-        {
-            netCDF_ERR (retval);
-            sprintf (errmsg, "Error ending the define mode.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
+            /* Write whole rows of chunks */
+            block_lines = ((NC_BLOCK_LINES + chunks[0] - 1) / chunks[0]) *
+                chunks[0];
         }
 
-        /* Allocate space for the x coordinate variable */
-        xdims = (float *) calloc (nsamps, sizeof (float));
-        if (xdims == NULL)
+        /* Specify compression for the primary variable */
+        if (set_var_compression (ncid, band_varid, xml_metadata->band[i].name,
+            band_deflate_level (nc_opts, xml_metadata->band[i].name))
+            != SUCCESS)
         {
-            sprintf (errmsg, "Error allocating %d floats for xdims", nsamps);
+            snprintf (errmsg, sizeof (errmsg), "Setting up the compression "
+                "for variable: %s", xml_metadata->band[i].name);
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
-        /* Create the x grid locations for the coordinate variables */
-        for (x = 0; x < nsamps; x++)
-        {
-            xdims[x] = xml_metadata->global.proj_info.ul_corner[0] 
-                + xml_metadata->band[i].pixel_size[0] * x;
-        }
-
-        /* Write the x coordinate variables */
-        if ((retval = nc_put_var_float (ncid, x_varid, xdims)))
+        /* End define mode. This tells NetCDF we are done defining metadata
+           and are moving to writing the data. */
+        if ((retval = nc_enddef (ncid)))
         {
             netCDF_ERR (retval);
-            sprintf (errmsg, "Error writing x coordinate data to variable");
+            snprintf (errmsg, sizeof (errmsg), "Error ending the define "
+                "mode.");
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
-        /* Free the x coordinate variables */
-        free (xdims);
-        xdims = NULL;
-
-        /* Allocate space for the y coordinate variable */
-        ydims = (float *) calloc (nlines, sizeof (float));
-        if (ydims == NULL)
+        /* Write the x and y grid locations for the coordinate variables */
+        if (write_coord_var (ncid, x_varid, nsamps,
+            xml_metadata->global.proj_info.ul_corner[0],
+            xml_metadata->band[i].pixel_size[0]) != SUCCESS)
         {
-            sprintf (errmsg, "Error allocating %d floats for ydims", nlines);
+            snprintf (errmsg, sizeof (errmsg), "Error writing x coordinate "
+                "data to variable");
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
-        /* Create the y grid locations for the coordinate variables */
-        for (y = 0; y < nlines; y++)
-        {
-            ydims[y] = xml_metadata->global.proj_info.ul_corner[1] 
-                - xml_metadata->band[i].pixel_size[1] * y;
-        }
-
-        /* Write the y coordinate variables */
-        if ((retval = nc_put_var_float (ncid, y_varid, ydims)))
+        if (write_coord_var (ncid, y_varid, nlines,
+            xml_metadata->global.proj_info.ul_corner[1],
+            -xml_metadata->band[i].pixel_size[1]) != SUCCESS)
         {
-            netCDF_ERR (retval);
             sprintf (errmsg, "Error writing y coordinate data to variable");
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
-        /* Free the y coordinate variables */
-        free (ydims);
-        ydims = NULL;
-
         /* Write the band metadata.  This must happen before the band data is
            written since the fill value must be written before the band data. */
         if (write_band_attributes (ncid, &xml_metadata->band[i], band_varid,
@@ -1022,19 +1123,52 @@ int create_netcdf_metadata
             return (ERROR);
         }
 
-        /* Write the band variable */
-        if ((retval = nc_put_var (ncid, band_varid, file_buf)))
+        /* Allocate memory for a block of lines */
+        file_buf = malloc (band->line_size * block_lines);
+        if (file_buf == NULL)
         {
-            netCDF_ERR (retval);
-            sprintf (errmsg, "Error writing %s data to variable",
-                xml_metadata->band[i].name);
+            snprintf (errmsg, sizeof (errmsg), "Error allocating memory "
+                "for the file buffer.");
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
-        /* Free the file buffer. */
+        /* Stream the band variable a block of lines at a time */
+        start[1] = 0;
+        edge[1] = nsamps;
+        for (line = 0; line < nlines; line += block_lines)
+        {
+            start[0] = line;
+            edge[0] = block_lines;
+            if (line + block_lines > nlines)
+                edge[0] = nlines - line;
+
+            if (read_band_window (band, line, 0, edge[0], nsamps, file_buf)
+                != SUCCESS)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Reading lines starting "
+                    "at %d from the raw binary file: %s", line,
+                    xml_metadata->band[i].file_name);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+
+            if ((retval = nc_put_vara (ncid, band_varid, start, edge,
+                file_buf)))
+            {
+                netCDF_ERR (retval);
+                snprintf (errmsg, sizeof (errmsg), "Error writing %s data to "
+                    "variable for lines starting at %d",
+                    xml_metadata->band[i].name, line);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+        }
+
+        /* Free the file buffer and close the raw binary file */
         free (file_buf);
         file_buf = NULL;
+        close_band_file (band);
 
         /* Remove the source files if specified */
         if (del_src)
@@ -1102,7 +1236,7 @@ NOTES:
   1. The ESPA raw binary band files will be included in the NetCDF file, 
      rather than being external files. 
   2. No ENVI header file will be created. 
-  3. Compression will be used.
+  3. Compression will be used unless the deflate levels in nc_opts are 0.
 ******************************************************************************/
 int convert_espa_to_netcdf
 (
@@ -1110,7 +1244,8 @@ int convert_espa_to_netcdf
     char *netcdf_file,     /* I: output NetCDF filename */
     bool del_src,          /* I: should the source files be removed after
                                  conversion? */
-    bool no_compression    /* I: use compression for the NetCDF output file? */
+    Netcdf_output_opts_t *nc_opts  /* I: compression and chunking options
+                                         (NULL for the defaults) */
 )
 {
     char FUNC_NAME[] = "convert_espa_to_netcdf";  /* function name */
@@ -1141,7 +1276,7 @@ int convert_espa_to_netcdf
 
     /* Create the NetCDF file for the NetCDF metadata from the XML metadata. */
     if (create_netcdf_metadata (netcdf_file, &xml_metadata, del_src, 
-        no_compression) != SUCCESS)
+        nc_opts) != SUCCESS)
     {
         sprintf (errmsg, "Creating the NetCDF metadata file (%s) which "
             "includes the raw binary bands.", netcdf_file);
@@ -24,13 +24,25 @@ NOTES:
 #include "parse_metadata.h"
 #include "write_metadata.h"
 #include "raw_binary_io.h"
+#include "raw_binary_band.h"
 
-/* Define the compression parameters - use data shuffling (NC_SUFFLE),
-   turn on compression, and use a mid-level compression */
+/* Define the default compression parameters - use data shuffling
+   (NC_SUFFLE), turn on compression, and use a mid-level compression */
 #define SHUFFLE NC_SHUFFLE
 #define DEFLATE 1
 #define DEFLATE_LEVEL 4
 
+/* Number of lines read from the raw binary band and written to the band
+   variable at a time.  This is rounded up to whole rows of chunks if the
+   chunk shape is specified. */
+#define NC_BLOCK_LINES 256
+
+/* Number of coordinate values computed and written at a time */
+#define NC_COORD_BLOCK 1024
+
+/* Maximum number of per-band deflate levels */
+#define NC_MAX_BAND_LEVELS 64
+
 /* Chunking cache parameters - cache size of 1 GB. Number of cache elements
  *    should be over 1000 and a prime number. */
 #define CACHE_SIZE 1000000000
@@ -44,7 +56,37 @@ NOTES:
 #define XDIM_NAME "x"
 #define YDIM_NAME "y"
 
+/* Deflate level for a specific band variable */
+typedef struct
+{
+    char name[STR_SIZE];     /* name of the band */
+    int deflate_level;       /* deflate level (0-9) for this band; 0 for no
+                                compression */
+} Netcdf_band_level_t;
+
+/* Output options for the variables in the NetCDF file */
+typedef struct
+{
+    int deflate_level;       /* deflate level (0-9) for the band variables;
+                                0 for no compression */
+    int coord_deflate_level; /* deflate level (0-9) for the x/y coordinate
+                                variables; 0 for no compression */
+    int chunk_lines;         /* number of lines per chunk for the band
+                                variables; 0 for the NetCDF default */
+    int chunk_samps;         /* number of samples per chunk for the band
+                                variables; 0 for the NetCDF default */
+    int nband_levels;        /* number of per-band deflate levels */
+    Netcdf_band_level_t band_levels[NC_MAX_BAND_LEVELS];
+                             /* deflate levels overriding deflate_level for
+                                specific bands */
+} Netcdf_output_opts_t;
+
 /* Prototypes */
+void init_netcdf_output_opts
+(
+    Netcdf_output_opts_t *opts  /* O: output options set to the defaults */
+);
+
 int write_global_attributes
 (
     int ncid,                /* I: netCDF file ID to write attributes */
@@ -57,7 +99,8 @@ int create_netcdf_metadata
     Espa_internal_meta_t *xml_metadata, /* I: XML metadata structure */
     bool del_src,          /* I: should the source files be removed after
                                  conversion? */
-    bool no_compression    /* I: use compression for the NetCDF output file? */
+    Netcdf_output_opts_t *nc_opts  /* I: compression and chunking options
+                                         (NULL for the defaults) */
 );
 
 int convert_espa_to_netcdf
@@ -66,7 +109,8 @@ int convert_espa_to_netcdf
     char *netcdf_file,     /* I: output netCDF filename */
     bool del_src,          /* I: should the source files be removed after
                                  conversion? */
-    bool no_compression    /* I: use compression for the NetCDF output file? */
+    Netcdf_output_opts_t *nc_opts  /* I: compression and chunking options
+                                         (NULL for the defaults) */
 );
 
 #endif
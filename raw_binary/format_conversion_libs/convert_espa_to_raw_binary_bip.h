@@ -25,8 +25,15 @@ NOTES:
 #include "write_metadata.h"
 #include "raw_binary_io.h"
 #include "envi_header.h"
+#include "raw_binary_band.h"
 
 /* Defines */
+/* Number of lines of all the bands read and interleaved at a time */
+#define BIP_BLOCK_LINES 64
+
+/* Number of pixels transposed at a time.  The output for a block of pixels
+   in all bands should stay in cache while each band is scattered into it. */
+#define BIP_BLOCK_PIXELS 512
 
 /* Prototypes */
 int convert_espa_to_raw_binary_bip
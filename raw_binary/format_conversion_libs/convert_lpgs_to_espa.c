@@ -1364,7 +1364,7 @@ int convert_gtif_to_img
     Envi_header_t envi_hdr;   /* output ENVI header information */
 
     /* Open the TIFF file for reading */
-    fp_tiff = XTIFFOpen (gtif_file, "r");
+    fp_tiff = open_tiff (gtif_file, "r");
     if (fp_tiff == NULL)
     {
         sprintf (errmsg, "Opening the LPGS GeoTIFF file: %s", gtif_file);
@@ -1491,7 +1491,7 @@ int convert_gtif_to_img
     }
 
     /* Close the TIFF and raw binary files */
-    XTIFFClose (fp_tiff);
+    close_tiff (fp_tiff);
     close_raw_binary (fp_rb);
 
     /* Free the memory */
@@ -1547,13 +1547,16 @@ NOTES:
   1. The LPGS GeoTIFF band files will be deciphered from the LPGS MTL file.
   2. The ESPA raw binary band files will be generated from the ESPA XML
      filename.
+  3. Each band is an independent file, so when built with ENABLE_THREADING
+     the bands are converted concurrently by up to nthreads threads.
 ******************************************************************************/
 int convert_lpgs_to_espa
 (
     char *lpgs_mtl_file,   /* I: input LPGS MTL metadata filename */
     char *espa_xml_file,   /* I: output ESPA XML metadata filename */
-    bool del_src           /* I: should the source .tif files be removed after
+    bool del_src,          /* I: should the source .tif files be removed after
                                  conversion? */
+    int nthreads           /* I: number of bands to convert concurrently */
 )
 {
     char FUNC_NAME[] = "convert_lpgs_to_espa";  /* function name */
@@ -1564,6 +1567,8 @@ int convert_lpgs_to_espa
     int i;                   /* looping variable */
     int nlpgs_bands;         /* number of bands in the LPGS product */
     int count;               /* number of chars copied in snprintf */
+    int status = SUCCESS;    /* status of the band conversions */
+    int curr_status;         /* local copy of the conversion status */
     char lpgs_bands[MAX_LPGS_BANDS][STR_SIZE];  /* array containing the file
                                 names of the LPGS bands */
 
@@ -1608,17 +1613,40 @@ int convert_lpgs_to_espa
         return (ERROR);
     }
 
-    /* Convert each of the LPGS GeoTIFF files to raw binary */
+    if (nthreads < 1)
+        nthreads = 1;
+
+    /* Convert each of the LPGS GeoTIFF files to raw binary.  Once a band
+       fails the remaining bands are skipped. */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic) num_threads (nthreads) \
+        private (curr_status)
+#endif
     for (i = 0; i < nlpgs_bands; i++)
     {
+        char band_errmsg[STR_SIZE];   /* error message for this band */
+
+#ifdef _OPENMP
+        #pragma omp atomic read
+#endif
+        curr_status = status;
+        if (curr_status != SUCCESS)
+            continue;
+
         printf ("  Band %d: %s to %s\n", i, lpgs_bands[i],
             xml_metadata.band[i].file_name);
         if (convert_gtif_to_img (lpgs_bands[i], &xml_metadata.band[i],
             &xml_metadata.global) != SUCCESS)
         {
-            sprintf (errmsg, "Converting band %d: %s", i, lpgs_bands[i]);
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
+            /* The band file was echoed along with the band number above */
+            snprintf (band_errmsg, sizeof (band_errmsg), "Converting band %d",
+                i);
+            error_handler (true, FUNC_NAME, band_errmsg);
+#ifdef _OPENMP
+            #pragma omp atomic write
+#endif
+            status = ERROR;
+            continue;
         }
 
         /* Remove the source file if specified */
@@ -1627,13 +1655,20 @@ int convert_lpgs_to_espa
             printf ("  Removing %s\n", lpgs_bands[i]);
             if (unlink (lpgs_bands[i]) != 0)
             {
-                sprintf (errmsg, "Deleting source file: %s", lpgs_bands[i]);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
+                snprintf (band_errmsg, sizeof (band_errmsg), "Deleting "
+                    "source file for band %d", i);
+                error_handler (true, FUNC_NAME, band_errmsg);
+#ifdef _OPENMP
+                #pragma omp atomic write
+#endif
+                status = ERROR;
             }
         }
     }
 
+    if (status != SUCCESS)
+        return (ERROR);
+
     /* Free the metadata structure */
     free_metadata (&xml_metadata);
 
@@ -24,6 +24,7 @@ NOTES:
 #include "espa_metadata.h"
 #include "espa_geoloc.h"
 #include "raw_binary_io.h"
+#include "tiff_io.h"
 #include "write_metadata.h"
 #include "envi_header.h"
 
@@ -56,8 +57,9 @@ int convert_lpgs_to_espa
 (
     char *lpgs_mtl_file,   /* I: input LPGS MTL metadata filename */
     char *espa_xml_file,   /* I: output ESPA XML metadata filename */
-    bool del_src           /* I: should the source .tif files be removed after
+    bool del_src,          /* I: should the source .tif files be removed after
                                  conversion? */
+    int nthreads           /* I: number of bands to convert concurrently */
 );
 
 #endif
@@ -0,0 +1,716 @@
+/*****************************************************************************
+FILE: espa_compact_metadata.c
+  
+PURPOSE: Contains functions for building, expanding, and freeing the compact,
+arena-backed representation of the ESPA internal metadata.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Strings are interned while the compact metadata is built, so repeated
+     values (fill strings, product names, units, dates, ...) are stored only
+     once per scene.  The intern table is only needed while building and is
+     freed before compact_metadata returns.
+*****************************************************************************/
+#include <stdint.h>
+#include "espa_compact_metadata.h"
+
+/* Alignment of arena allocations */
+#define ARENA_ALIGN sizeof (double)
+
+/* Initial number of slots in the string intern table (power of 2) */
+#define INTERN_INIT_SLOTS 256
+
+/* Table used to intern the strings while building the compact metadata */
+typedef struct
+{
+    Espa_arena_t *arena;   /* arena to hold the string data */
+    const char **slots;    /* open-addressed hash table of strings */
+    size_t nslots;         /* number of slots in the table (power of 2) */
+    size_t nused;          /* number of slots in use */
+} Intern_table_t;
+
+
+/******************************************************************************
+MODULE:  arena_alloc
+
+PURPOSE:  Allocates the specified number of bytes from the arena, adding a new
+block to the arena when the current block is full.
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            Error allocating the memory
+non-NULL        Pointer to the zero-initialized memory
+
+NOTES:
+******************************************************************************/
+static void *arena_alloc
+(
+    Espa_arena_t *arena,   /* I/O: arena to allocate from */
+    size_t nbytes          /* I: number of bytes to allocate */
+)
+{
+    char FUNC_NAME[] = "arena_alloc";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Espa_arena_block_t *block = arena->head;  /* current arena block */
+    size_t offset;                /* aligned offset in the current block */
+    size_t block_size;            /* size of a new block */
+
+    /* Use the current block if there is room */
+    if (block != NULL)
+    {
+        offset = (block->used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+        if (offset + nbytes <= block->size)
+        {
+            block->used = offset + nbytes;
+            return (block->data + offset);
+        }
+    }
+
+    /* Otherwise start a new block, big enough for oversized requests */
+    block_size = ESPA_ARENA_BLOCK_SIZE;
+    if (nbytes > block_size)
+        block_size = nbytes;
+    block = calloc (1, sizeof (Espa_arena_block_t) + block_size);
+    if (block == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating %zu bytes for the "
+            "metadata arena", block_size);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    block->size = block_size;
+    block->used = nbytes;
+    block->next = arena->head;
+    arena->head = block;
+    arena->total_size += sizeof (Espa_arena_block_t) + block_size;
+
+    return (block->data);
+}
+
+
+/******************************************************************************
+MODULE:  intern_string
+
+PURPOSE:  Returns the pooled copy of the specified string, adding it to the
+arena if it hasn't been seen before.
+
+RETURN VALUE:
+Type = const char *
+Value           Description
+-----           -----------
+NULL            Error allocating memory
+non-NULL        Pointer to the pooled string
+
+NOTES:
+  1. Uses FNV-1a hashing with linear probing.  The table doubles when it is
+     half full.
+******************************************************************************/
+static const char *intern_string
+(
+    Intern_table_t *table,   /* I/O: intern table */
+    const char *str          /* I: string to intern */
+)
+{
+    char FUNC_NAME[] = "intern_string";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    uint32_t hash;                /* hash of the string */
+    size_t i;                     /* looping variable */
+    size_t len;                   /* length of the string */
+    size_t slot;                  /* current slot in the table */
+    size_t new_nslots;            /* size of the resized table */
+    const char **new_slots = NULL;  /* resized table */
+    const char *cptr = NULL;      /* pointer to the characters */
+    char *pooled = NULL;          /* copy of the string in the arena */
+
+    if (str == NULL)
+        str = "";
+
+    /* Grow the table if it's half full */
+    if (2 * (table->nused + 1) > table->nslots)
+    {
+        new_nslots = (table->nslots == 0) ? INTERN_INIT_SLOTS :
+            2 * table->nslots;
+        new_slots = calloc (new_nslots, sizeof (const char *));
+        if (new_slots == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Allocating the string "
+                "intern table");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (NULL);
+        }
+
+        /* Rehash the existing strings */
+        for (i = 0; i < table->nslots; i++)
+        {
+            if (table->slots[i] == NULL)
+                continue;
+            hash = 2166136261u;
+            for (cptr = table->slots[i]; *cptr != '\0'; cptr++)
+                hash = (hash ^ (unsigned char) *cptr) * 16777619u;
+            slot = hash & (new_nslots - 1);
+            while (new_slots[slot] != NULL)
+                slot = (slot + 1) & (new_nslots - 1);
+            new_slots[slot] = table->slots[i];
+        }
+
+        free (table->slots);
+        table->slots = new_slots;
+        table->nslots = new_nslots;
+    }
+
+    /* Look for the string in the table */
+    hash = 2166136261u;
+    for (cptr = str; *cptr != '\0'; cptr++)
+        hash = (hash ^ (unsigned char) *cptr) * 16777619u;
+    slot = hash & (table->nslots - 1);
+    while (table->slots[slot] != NULL)
+    {
+        if (strcmp (table->slots[slot], str) == 0)
+            return (table->slots[slot]);
+        slot = (slot + 1) & (table->nslots - 1);
+    }
+
+    /* Not found, so copy it into the arena and add it to the table */
+    len = strlen (str);
+    pooled = arena_alloc (table->arena, len + 1);
+    if (pooled == NULL)
+        return (NULL);
+    memcpy (pooled, str, len + 1);
+    table->slots[slot] = pooled;
+    table->nused++;
+
+    return (pooled);
+}
+
+
+/******************************************************************************
+MODULE:  copy_string_field
+
+PURPOSE:  Copies a pooled string into a fixed-size metadata string field.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           String doesn't fit in the field
+SUCCESS         String was copied
+
+NOTES:
+******************************************************************************/
+static int copy_string_field
+(
+    char *field,             /* O: metadata string field */
+    size_t field_size,       /* I: size of the metadata string field */
+    const char *str          /* I: pooled string to copy */
+)
+{
+    char FUNC_NAME[] = "expand_metadata";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    int count;                    /* number of chars copied in snprintf */
+
+    count = snprintf (field, field_size, "%s", str);
+    if (count < 0 || count >= (int) field_size)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Overflow of metadata string "
+            "field (%d characters)", count);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  init_compact_metadata
+
+PURPOSE:  Initializes the compact metadata structure so that it is empty and
+can be safely freed.
+
+RETURN VALUE: N/A
+
+NOTES:
+******************************************************************************/
+void init_compact_metadata
+(
+    Espa_compact_meta_t *cmeta   /* I: compact metadata to be initialized */
+)
+{
+    memset (cmeta, 0, sizeof (Espa_compact_meta_t));
+    cmeta->meta_namespace = "";
+}
+
+
+/******************************************************************************
+MODULE:  compact_metadata
+
+PURPOSE:  Builds the compact, arena-backed representation of the specified
+ESPA internal metadata.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating the compact metadata
+SUCCESS         Successfully built the compact metadata
+
+NOTES:
+  1. The input metadata is not modified and may be freed (free_metadata)
+     once the compact metadata has been built.
+******************************************************************************/
+int compact_metadata
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: metadata to be compacted */
+    Espa_compact_meta_t *cmeta   /* O: compact metadata; should be freed with
+                                       free_compact_metadata */
+)
+{
+    char FUNC_NAME[] = "compact_metadata";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    int i, b;                     /* looping variables */
+    Intern_table_t table;         /* string intern table */
+    Espa_global_meta_t *gmeta = &xml_metadata->global;  /* input global */
+    Espa_compact_global_meta_t *cgmeta = &cmeta->global;  /* output global */
+    Espa_band_meta_t *bmeta = NULL;          /* input band */
+    Espa_compact_band_meta_t *cbmeta = NULL; /* output band */
+
+    init_compact_metadata (cmeta);
+    table.arena = &cmeta->arena;
+    table.slots = NULL;
+    table.nslots = 0;
+    table.nused = 0;
+
+/* Interns a string field, bailing out on an allocation error */
+#define INTERN(dst, src) \
+    if (((dst) = intern_string (&table, (src))) == NULL) goto error;
+
+    /* Global metadata */
+    INTERN (cmeta->meta_namespace, xml_metadata->meta_namespace);
+    INTERN (cgmeta->data_provider, gmeta->data_provider);
+    INTERN (cgmeta->satellite, gmeta->satellite);
+    INTERN (cgmeta->instrument, gmeta->instrument);
+    INTERN (cgmeta->acquisition_date, gmeta->acquisition_date);
+    memcpy (cgmeta->ul_corner, gmeta->ul_corner, sizeof (gmeta->ul_corner));
+    memcpy (cgmeta->lr_corner, gmeta->lr_corner, sizeof (gmeta->lr_corner));
+    memcpy (cgmeta->bounding_coords, gmeta->bounding_coords,
+        sizeof (gmeta->bounding_coords));
+    cgmeta->wrs_system = gmeta->wrs_system;
+    cgmeta->wrs_path = gmeta->wrs_path;
+    cgmeta->wrs_row = gmeta->wrs_row;
+    INTERN (cgmeta->scene_center_time, gmeta->scene_center_time);
+    INTERN (cgmeta->product_id, gmeta->product_id);
+    INTERN (cgmeta->lpgs_metadata_file, gmeta->lpgs_metadata_file);
+    cgmeta->orientation_angle = gmeta->orientation_angle;
+    cgmeta->solar_zenith = gmeta->solar_zenith;
+    cgmeta->solar_azimuth = gmeta->solar_azimuth;
+    INTERN (cgmeta->solar_units, gmeta->solar_units);
+    cgmeta->earth_sun_dist = gmeta->earth_sun_dist;
+    INTERN (cgmeta->level1_production_date, gmeta->level1_production_date);
+    cgmeta->htile = gmeta->htile;
+    cgmeta->vtile = gmeta->vtile;
+
+    /* Projection metadata */
+    cgmeta->proj_info.proj_type = gmeta->proj_info.proj_type;
+    cgmeta->proj_info.datum_type = gmeta->proj_info.datum_type;
+    INTERN (cgmeta->proj_info.units, gmeta->proj_info.units);
+    memcpy (cgmeta->proj_info.ul_corner, gmeta->proj_info.ul_corner,
+        sizeof (gmeta->proj_info.ul_corner));
+    memcpy (cgmeta->proj_info.lr_corner, gmeta->proj_info.lr_corner,
+        sizeof (gmeta->proj_info.lr_corner));
+    INTERN (cgmeta->proj_info.grid_origin, gmeta->proj_info.grid_origin);
+    cgmeta->proj_info.utm_zone = gmeta->proj_info.utm_zone;
+    cgmeta->proj_info.longitude_pole = gmeta->proj_info.longitude_pole;
+    cgmeta->proj_info.latitude_true_scale =
+        gmeta->proj_info.latitude_true_scale;
+    cgmeta->proj_info.false_easting = gmeta->proj_info.false_easting;
+    cgmeta->proj_info.false_northing = gmeta->proj_info.false_northing;
+    cgmeta->proj_info.standard_parallel1 = gmeta->proj_info.standard_parallel1;
+    cgmeta->proj_info.standard_parallel2 = gmeta->proj_info.standard_parallel2;
+    cgmeta->proj_info.central_meridian = gmeta->proj_info.central_meridian;
+    cgmeta->proj_info.origin_latitude = gmeta->proj_info.origin_latitude;
+    cgmeta->proj_info.sphere_radius = gmeta->proj_info.sphere_radius;
+
+    /* Band metadata */
+    cmeta->nbands = xml_metadata->nbands;
+    if (cmeta->nbands > 0)
+    {
+        cmeta->band = arena_alloc (&cmeta->arena,
+            cmeta->nbands * sizeof (Espa_compact_band_meta_t));
+        if (cmeta->band == NULL)
+            goto error;
+    }
+
+    for (i = 0; i < cmeta->nbands; i++)
+    {
+        bmeta = &xml_metadata->band[i];
+        cbmeta = &cmeta->band[i];
+
+        INTERN (cbmeta->product, bmeta->product);
+        INTERN (cbmeta->source, bmeta->source);
+        INTERN (cbmeta->name, bmeta->name);
+        INTERN (cbmeta->category, bmeta->category);
+        cbmeta->data_type = bmeta->data_type;
+        cbmeta->nlines = bmeta->nlines;
+        cbmeta->nsamps = bmeta->nsamps;
+        cbmeta->fill_value = bmeta->fill_value;
+        cbmeta->saturate_value = bmeta->saturate_value;
+        cbmeta->scale_factor = bmeta->scale_factor;
+        cbmeta->add_offset = bmeta->add_offset;
+        cbmeta->resample_method = bmeta->resample_method;
+        INTERN (cbmeta->short_name, bmeta->short_name);
+        INTERN (cbmeta->long_name, bmeta->long_name);
+        INTERN (cbmeta->file_name, bmeta->file_name);
+        cbmeta->pixel_size[0] = bmeta->pixel_size[0];
+        cbmeta->pixel_size[1] = bmeta->pixel_size[1];
+        INTERN (cbmeta->pixel_units, bmeta->pixel_units);
+        INTERN (cbmeta->data_units, bmeta->data_units);
+        cbmeta->valid_range[0] = bmeta->valid_range[0];
+        cbmeta->valid_range[1] = bmeta->valid_range[1];
+        cbmeta->rad_gain = bmeta->rad_gain;
+        cbmeta->rad_bias = bmeta->rad_bias;
+        cbmeta->refl_gain = bmeta->refl_gain;
+        cbmeta->refl_bias = bmeta->refl_bias;
+        cbmeta->k1_const = bmeta->k1_const;
+        cbmeta->k2_const = bmeta->k2_const;
+        INTERN (cbmeta->qa_desc, bmeta->qa_desc);
+        INTERN (cbmeta->app_version, bmeta->app_version);
+        INTERN (cbmeta->production_date, bmeta->production_date);
+
+        /* Bitmap descriptions */
+        cbmeta->nbits = bmeta->nbits;
+        if (bmeta->nbits > 0)
+        {
+            cbmeta->bitmap_description = arena_alloc (&cmeta->arena,
+                bmeta->nbits * sizeof (const char *));
+            if (cbmeta->bitmap_description == NULL)
+                goto error;
+            for (b = 0; b < bmeta->nbits; b++)
+                INTERN (cbmeta->bitmap_description[b],
+                    bmeta->bitmap_description[b]);
+        }
+
+        /* Class values */
+        cbmeta->nclass = bmeta->nclass;
+        if (bmeta->nclass > 0)
+        {
+            cbmeta->class_values = arena_alloc (&cmeta->arena,
+                bmeta->nclass * sizeof (Espa_compact_class_t));
+            if (cbmeta->class_values == NULL)
+                goto error;
+            for (b = 0; b < bmeta->nclass; b++)
+            {
+                cbmeta->class_values[b].class = bmeta->class_values[b].class;
+                INTERN (cbmeta->class_values[b].description,
+                    bmeta->class_values[b].description);
+            }
+        }
+
+        /* Percent coverage */
+        cbmeta->ncover = bmeta->ncover;
+        if (bmeta->ncover > 0)
+        {
+            cbmeta->percent_cover = arena_alloc (&cmeta->arena,
+                bmeta->ncover * sizeof (Espa_compact_percent_cover_t));
+            if (cbmeta->percent_cover == NULL)
+                goto error;
+            for (b = 0; b < bmeta->ncover; b++)
+            {
+                cbmeta->percent_cover[b].percent =
+                    bmeta->percent_cover[b].percent;
+                INTERN (cbmeta->percent_cover[b].description,
+                    bmeta->percent_cover[b].description);
+            }
+        }
+    }
+#undef INTERN
+
+    /* The intern table is no longer needed once the strings are pooled */
+    cmeta->nstrings = (int) table.nused;
+    free (table.slots);
+
+    return (SUCCESS);
+
+error:
+    snprintf (errmsg, sizeof (errmsg), "Building the compact metadata");
+    error_handler (true, FUNC_NAME, errmsg);
+    free (table.slots);
+    free_compact_metadata (cmeta);
+    return (ERROR);
+}
+
+
+/******************************************************************************
+MODULE:  expand_metadata
+
+PURPOSE:  Expands the compact metadata into a regular ESPA internal metadata
+structure, for use with the existing metadata read/write routines.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating or filling the metadata
+SUCCESS         Successfully expanded the metadata
+
+NOTES:
+  1. The output metadata is initialized here and needs to be freed with
+     free_metadata.
+******************************************************************************/
+int expand_metadata
+(
+    Espa_compact_meta_t *cmeta,  /* I: compact metadata to be expanded */
+    Espa_internal_meta_t *xml_metadata  /* O: expanded metadata; should be
+                                              freed with free_metadata */
+)
+{
+    char FUNC_NAME[] = "expand_metadata";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    int i, b;                     /* looping variables */
+    Espa_global_meta_t *gmeta = &xml_metadata->global;  /* output global */
+    Espa_compact_global_meta_t *cgmeta = &cmeta->global;  /* input global */
+    Espa_band_meta_t *bmeta = NULL;          /* output band */
+    Espa_compact_band_meta_t *cbmeta = NULL; /* input band */
+
+    init_metadata_struct (xml_metadata);
+
+/* Copies a pooled string into a fixed-size field, bailing out on overflow */
+#define COPY(dst, src) \
+    if (copy_string_field ((dst), sizeof (dst), (src)) != SUCCESS) goto error;
+
+    /* Global metadata */
+    COPY (xml_metadata->meta_namespace, cmeta->meta_namespace);
+    COPY (gmeta->data_provider, cgmeta->data_provider);
+    COPY (gmeta->satellite, cgmeta->satellite);
+    COPY (gmeta->instrument, cgmeta->instrument);
+    COPY (gmeta->acquisition_date, cgmeta->acquisition_date);
+    memcpy (gmeta->ul_corner, cgmeta->ul_corner, sizeof (gmeta->ul_corner));
+    memcpy (gmeta->lr_corner, cgmeta->lr_corner, sizeof (gmeta->lr_corner));
+    memcpy (gmeta->bounding_coords, cgmeta->bounding_coords,
+        sizeof (gmeta->bounding_coords));
+    gmeta->wrs_system = cgmeta->wrs_system;
+    gmeta->wrs_path = cgmeta->wrs_path;
+    gmeta->wrs_row = cgmeta->wrs_row;
+    COPY (gmeta->scene_center_time, cgmeta->scene_center_time);
+    COPY (gmeta->product_id, cgmeta->product_id);
+    COPY (gmeta->lpgs_metadata_file, cgmeta->lpgs_metadata_file);
+    gmeta->orientation_angle = cgmeta->orientation_angle;
+    gmeta->solar_zenith = cgmeta->solar_zenith;
+    gmeta->solar_azimuth = cgmeta->solar_azimuth;
+    COPY (gmeta->solar_units, cgmeta->solar_units);
+    gmeta->earth_sun_dist = cgmeta->earth_sun_dist;
+    COPY (gmeta->level1_production_date, cgmeta->level1_production_date);
+    gmeta->htile = cgmeta->htile;
+    gmeta->vtile = cgmeta->vtile;
+
+    /* Projection metadata */
+    gmeta->proj_info.proj_type = cgmeta->proj_info.proj_type;
+    gmeta->proj_info.datum_type = cgmeta->proj_info.datum_type;
+    COPY (gmeta->proj_info.units, cgmeta->proj_info.units);
+    memcpy (gmeta->proj_info.ul_corner, cgmeta->proj_info.ul_corner,
+        sizeof (gmeta->proj_info.ul_corner));
+    memcpy (gmeta->proj_info.lr_corner, cgmeta->proj_info.lr_corner,
+        sizeof (gmeta->proj_info.lr_corner));
+    COPY (gmeta->proj_info.grid_origin, cgmeta->proj_info.grid_origin);
+    gmeta->proj_info.utm_zone = cgmeta->proj_info.utm_zone;
+    gmeta->proj_info.longitude_pole = cgmeta->proj_info.longitude_pole;
+    gmeta->proj_info.latitude_true_scale =
+        cgmeta->proj_info.latitude_true_scale;
+    gmeta->proj_info.false_easting = cgmeta->proj_info.false_easting;
+    gmeta->proj_info.false_northing = cgmeta->proj_info.false_northing;
+    gmeta->proj_info.standard_parallel1 = cgmeta->proj_info.standard_parallel1;
+    gmeta->proj_info.standard_parallel2 = cgmeta->proj_info.standard_parallel2;
+    gmeta->proj_info.central_meridian = cgmeta->proj_info.central_meridian;
+    gmeta->proj_info.origin_latitude = cgmeta->proj_info.origin_latitude;
+    gmeta->proj_info.sphere_radius = cgmeta->proj_info.sphere_radius;
+
+    /* Band metadata */
+    if (cmeta->nbands > 0)
+    {
+        if (allocate_band_metadata (xml_metadata, cmeta->nbands) != SUCCESS)
+            goto error;
+    }
+
+    for (i = 0; i < cmeta->nbands; i++)
+    {
+        bmeta = &xml_metadata->band[i];
+        cbmeta = &cmeta->band[i];
+
+        COPY (bmeta->product, cbmeta->product);
+        COPY (bmeta->source, cbmeta->source);
+        COPY (bmeta->name, cbmeta->name);
+        COPY (bmeta->category, cbmeta->category);
+        bmeta->data_type = cbmeta->data_type;
+        bmeta->nlines = cbmeta->nlines;
+        bmeta->nsamps = cbmeta->nsamps;
+        bmeta->fill_value = cbmeta->fill_value;
+        bmeta->saturate_value = cbmeta->saturate_value;
+        bmeta->scale_factor = cbmeta->scale_factor;
+        bmeta->add_offset = cbmeta->add_offset;
+        bmeta->resample_method = cbmeta->resample_method;
+        COPY (bmeta->short_name, cbmeta->short_name);
+        COPY (bmeta->long_name, cbmeta->long_name);
+        COPY (bmeta->file_name, cbmeta->file_name);
+        bmeta->pixel_size[0] = cbmeta->pixel_size[0];
+        bmeta->pixel_size[1] = cbmeta->pixel_size[1];
+        COPY (bmeta->pixel_units, cbmeta->pixel_units);
+        COPY (bmeta->data_units, cbmeta->data_units);
+        bmeta->valid_range[0] = cbmeta->valid_range[0];
+        bmeta->valid_range[1] = cbmeta->valid_range[1];
+        bmeta->rad_gain = cbmeta->rad_gain;
+        bmeta->rad_bias = cbmeta->rad_bias;
+        bmeta->refl_gain = cbmeta->refl_gain;
+        bmeta->refl_bias = cbmeta->refl_bias;
+        bmeta->k1_const = cbmeta->k1_const;
+        bmeta->k2_const = cbmeta->k2_const;
+        COPY (bmeta->qa_desc, cbmeta->qa_desc);
+        COPY (bmeta->app_version, cbmeta->app_version);
+        COPY (bmeta->production_date, cbmeta->production_date);
+
+        /* Bitmap descriptions */
+        if (cbmeta->nbits > 0)
+        {
+            if (allocate_bitmap_metadata (bmeta, cbmeta->nbits) != SUCCESS)
+                goto error;
+            for (b = 0; b < cbmeta->nbits; b++)
+            {
+                if (copy_string_field (bmeta->bitmap_description[b], STR_SIZE,
+                    cbmeta->bitmap_description[b]) != SUCCESS)
+                    goto error;
+            }
+        }
+
+        /* Class values */
+        if (cbmeta->nclass > 0)
+        {
+            if (allocate_class_metadata (bmeta, cbmeta->nclass) != SUCCESS)
+                goto error;
+            for (b = 0; b < cbmeta->nclass; b++)
+            {
+                bmeta->class_values[b].class = cbmeta->class_values[b].class;
+                COPY (bmeta->class_values[b].description,
+                    cbmeta->class_values[b].description);
+            }
+        }
+
+        /* Percent coverage */
+        if (cbmeta->ncover > 0)
+        {
+            if (allocate_percent_coverage_metadata (bmeta, cbmeta->ncover)
+                != SUCCESS)
+                goto error;
+            for (b = 0; b < cbmeta->ncover; b++)
+            {
+                bmeta->percent_cover[b].percent =
+                    cbmeta->percent_cover[b].percent;
+                COPY (bmeta->percent_cover[b].description,
+                    cbmeta->percent_cover[b].description);
+            }
+        }
+    }
+#undef COPY
+
+    return (SUCCESS);
+
+error:
+    snprintf (errmsg, sizeof (errmsg), "Expanding the compact metadata");
+    error_handler (true, FUNC_NAME, errmsg);
+    free_metadata (xml_metadata);
+    xml_metadata->nbands = 0;
+    xml_metadata->band = NULL;
+    return (ERROR);
+}
+
+
+/******************************************************************************
+MODULE:  find_compact_band
+
+PURPOSE:  Finds the band with the specified product and name in the compact
+metadata.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              Band was not found
+>= 0            Index of the band in cmeta->band
+
+NOTES:
+  1. Returns the first matching band.
+******************************************************************************/
+int find_compact_band
+(
+    Espa_compact_meta_t *cmeta,  /* I: compact metadata to search */
+    const char *product,         /* I: product type of the band; NULL to match
+                                       any product */
+    const char *name             /* I: name of the band */
+)
+{
+    int i;                        /* looping variable */
+
+    for (i = 0; i < cmeta->nbands; i++)
+    {
+        if (strcmp (cmeta->band[i].name, name) == 0 &&
+            (product == NULL || strcmp (cmeta->band[i].product, product) == 0))
+            return (i);
+    }
+
+    return (-1);
+}
+
+
+/******************************************************************************
+MODULE:  compact_metadata_size
+
+PURPOSE:  Returns the number of bytes of heap memory held by the compact
+metadata.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+size            Total bytes allocated for the arena
+
+NOTES:
+******************************************************************************/
+size_t compact_metadata_size
+(
+    Espa_compact_meta_t *cmeta   /* I: compact metadata */
+)
+{
+    return (cmeta->arena.total_size);
+}
+
+
+/******************************************************************************
+MODULE:  free_compact_metadata
+
+PURPOSE:  Frees the arena holding the compact metadata and resets the
+structure to empty.
+
+RETURN VALUE: N/A
+
+NOTES:
+******************************************************************************/
+void free_compact_metadata
+(
+    Espa_compact_meta_t *cmeta   /* I: compact metadata to be freed */
+)
+{
+    Espa_arena_block_t *block = cmeta->arena.head;  /* current block */
+    Espa_arena_block_t *next = NULL;                /* next block */
+
+    while (block != NULL)
+    {
+        next = block->next;
+        free (block);
+        block = next;
+    }
+
+    init_compact_metadata (cmeta);
+}
@@ -0,0 +1,204 @@
+/*****************************************************************************
+FILE: espa_compact_metadata.h
+
+PURPOSE: Contains defines and structures for the compact, arena-backed
+representation of the ESPA internal metadata.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Espa_internal_meta_t stores every string in a fixed STR_SIZE (or
+     HUGE_STR_SIZE) array, so a band costs tens of KB no matter how short its
+     strings are.  The compact representation stores each distinct string
+     once in a string pool, and every string, band, class, cover, and bitmap
+     entry lives in a single arena.  The whole thing is released with one
+     call to free_compact_metadata.
+  2. The compact metadata is read-only.  Use compact_metadata to build it
+     from an Espa_internal_meta_t and expand_metadata to get a regular
+     Espa_internal_meta_t back for the existing read/write/subset routines.
+  3. String fields in the compact structures are never NULL.  Empty strings
+     in the original metadata are stored as "".
+*****************************************************************************/
+
+#ifndef ESPA_COMPACT_METADATA_H
+#define ESPA_COMPACT_METADATA_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "error_handler.h"
+#include "espa_metadata.h"
+
+/* Default size of each arena block.  Larger requests get their own block. */
+#define ESPA_ARENA_BLOCK_SIZE 16384
+
+/* Arena block; the memory for the block data follows the header */
+typedef struct Espa_arena_block
+{
+    struct Espa_arena_block *next;  /* next block in the arena */
+    size_t size;                    /* number of bytes available in data */
+    size_t used;                    /* number of bytes used in data */
+    char data[];                    /* block data */
+} Espa_arena_block_t;
+
+/* Arena of memory which is freed all at once */
+typedef struct
+{
+    Espa_arena_block_t *head;   /* current (most recent) block */
+    size_t total_size;          /* total bytes allocated for all blocks */
+} Espa_arena_t;
+
+/* Structures for the compact global and band metadata.  The fields match
+   the ones in espa_metadata.h, with the strings stored as pointers into the
+   string pool. */
+typedef struct
+{
+    int class;                    /* class value */
+    const char *description;      /* class description */
+} Espa_compact_class_t;
+
+typedef struct
+{
+    float percent;                /* percentage for the cover type */
+    const char *description;      /* cover type description */
+} Espa_compact_percent_cover_t;
+
+typedef struct
+{
+    int proj_type;        /* projection number (see GCTP_* in gctp_defines.h) */
+    int datum_type;       /* datum type (see ESPA_* in gctp_defines.h) */
+    const char *units;    /* projection units (degrees, meters) */
+    double ul_corner[2];  /* projection UL x, y */
+    double lr_corner[2];  /* projection LR x, y */
+    const char *grid_origin;  /* origin of the gridded data (UL, CENTER) */
+    int utm_zone;         /* UTM zone; negative for southern zones */
+    double longitude_pole;
+    double latitude_true_scale;
+    double false_easting;
+    double false_northing;
+    double standard_parallel1;
+    double standard_parallel2;
+    double central_meridian;
+    double origin_latitude;
+    double sphere_radius;
+} Espa_compact_proj_meta_t;
+
+typedef struct
+{
+    const char *data_provider;    /* name of the original data provider */
+    const char *satellite;        /* name of the satellite */
+    const char *instrument;       /* name of instrument */
+    const char *acquisition_date; /* date of scene acquisition (yyyy-mm-dd) */
+    double ul_corner[2];          /* geographic UL lat, long */
+    double lr_corner[2];          /* geographic LR lat, long */
+    double bounding_coords[4];    /* geographic west, east, north, south */
+    Espa_compact_proj_meta_t proj_info;  /* projection information */
+    int wrs_system;               /* 1 or 2 */
+    int wrs_path;                 /* WRS path of this scene */
+    int wrs_row;                  /* WRS row of this scene */
+    const char *scene_center_time;  /* GMT time at scene center */
+    const char *product_id;       /* product ID */
+    const char *lpgs_metadata_file; /* name of LPGS metadata file */
+    float orientation_angle;      /* orientation angle of the scene (degrees) */
+    float solar_zenith;           /* solar zenith angle (degrees) */
+    float solar_azimuth;          /* solar azimuth angle (degrees) */
+    const char *solar_units;      /* degrees */
+    float earth_sun_dist;         /* earth-sun distance at the scene center */
+    const char *level1_production_date;  /* level 1 production date */
+    int htile;                    /* MODIS horizontal tile number */
+    int vtile;                    /* MODIS vertical tile number */
+} Espa_compact_global_meta_t;
+
+typedef struct
+{
+    const char *product;         /* product type */
+    const char *source;          /* source type (level1, toa_refl, sr_refl) */
+    const char *name;            /* band name */
+    const char *category;        /* category type (image, qa, browse, index) */
+    enum Espa_data_type data_type;  /* data type of this band */
+    int nlines;                  /* number of lines in the dataset */
+    int nsamps;                  /* number of samples in the dataset */
+    long fill_value;             /* fill value */
+    int saturate_value;          /* saturation value (for Landsat) */
+    float scale_factor;          /* scaling factor */
+    float add_offset;            /* offset to be added */
+    enum Espa_resampling_type resample_method;
+                                 /* resampling method for this band */
+    const char *short_name;      /* short band name */
+    const char *long_name;       /* long band name */
+    const char *file_name;       /* raw binary file name for this band */
+    double pixel_size[2];        /* pixel size x, y */
+    const char *pixel_units;     /* units for pixel size (meters, degrees) */
+    const char *data_units;      /* units of data stored in this band */
+    float valid_range[2];        /* min, max valid value for this band */
+    double rad_gain;             /* gain values for TOA radiance conversion */
+    double rad_bias;             /* bias values for TOA radiance conversion */
+    double refl_gain;            /* gain values for TOA reflectance conversion*/
+    double refl_bias;            /* bias values for TOA reflectance conversion*/
+    double k1_const;             /* K1 thermal constant for BT conversion */
+    double k2_const;             /* K2 thermal constant for BT conversion */
+    int nbits;                   /* number of bits in bitmap_description */
+    const char **bitmap_description;  /* bit descriptions */
+    int nclass;                  /* number of classes in class_values */
+    Espa_compact_class_t *class_values;  /* class value descriptions */
+    int ncover;                  /* number of cover types in percent_cover */
+    Espa_compact_percent_cover_t *percent_cover;  /* percent cover
+                                                     descriptions */
+    const char *qa_desc;         /* description of the QA bits */
+    const char *app_version;     /* version of the application which produced
+                                    the current band */
+    const char *production_date; /* date the band was produced */
+} Espa_compact_band_meta_t;
+
+typedef struct
+{
+    const char *meta_namespace;  /* namespace for this metadata file */
+    Espa_compact_global_meta_t global;  /* global metadata */
+    int nbands;                  /* number of bands in the metadata file */
+    Espa_compact_band_meta_t *band;  /* array of band metadata */
+    Espa_arena_t arena;          /* arena holding the bands and strings */
+    int nstrings;                /* number of distinct strings in the pool */
+} Espa_compact_meta_t;
+
+/* Prototypes */
+void init_compact_metadata
+(
+    Espa_compact_meta_t *cmeta   /* I: compact metadata to be initialized */
+);
+
+int compact_metadata
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: metadata to be compacted */
+    Espa_compact_meta_t *cmeta   /* O: compact metadata; should be freed with
+                                       free_compact_metadata */
+);
+
+int expand_metadata
+(
+    Espa_compact_meta_t *cmeta,  /* I: compact metadata to be expanded */
+    Espa_internal_meta_t *xml_metadata  /* O: expanded metadata; should be
+                                              freed with free_metadata */
+);
+
+int find_compact_band
+(
+    Espa_compact_meta_t *cmeta,  /* I: compact metadata to search */
+    const char *product,         /* I: product type of the band; NULL to match
+                                       any product */
+    const char *name             /* I: name of the band */
+);
+
+size_t compact_metadata_size
+(
+    Espa_compact_meta_t *cmeta   /* I: compact metadata */
+);
+
+void free_compact_metadata
+(
+    Espa_compact_meta_t *cmeta   /* I: compact metadata to be freed */
+);
+
+#endif
@@ -18,36 +18,41 @@ NOTES:
 *****************************************************************************/
 #include <sys/stat.h>
 #include "espa_metadata.h"
+#include "espa_metadata_cache.h"
+
+/* Process-wide cache of the compiled ESPA schema.  The XSD is parsed (and
+   possibly fetched over HTTP) only once per process and then shared by all
+   validations, since a compiled xmlSchemaPtr is read-only during validation.
+   Each validation still uses its own validation context. */
+static xmlSchemaPtr espa_schema_cache = NULL;
+static char espa_schema_cache_src[STR_SIZE] = "";
+
+/* Schemas replaced in the cache after ESPA_SCHEMA changed.  Other threads may
+   still be validating against them, so they are only freed by
+   free_espa_schema_cache. */
+static xmlSchemaPtr *espa_schema_retired = NULL;
+static int espa_schema_nretired = 0;
 
 /******************************************************************************
-MODULE:  validate_xml_file
+MODULE:  get_espa_schema_file
 
-PURPOSE:  Validates the specified XML file with the specified schema file/URL.
+PURPOSE:  Determines the schema file/URL to be used for validating the ESPA
+XML metadata.  The ESPA_SCHEMA environment variable is used if defined,
+followed by the local schema file, followed by the schema on the ESPA http
+site.
 
 RETURN VALUE:
-Type = int
+Type = char *
 Value           Description
 -----           -----------
-ERROR           XML does not validate against the specified schema
-SUCCESS         XML validates
+schema_file     name of the schema file or URL
 
 NOTES:
 ******************************************************************************/
-int validate_xml_file
-(
-    char *meta_file           /* I: name of metadata file to be validated */
-)
+static char *get_espa_schema_file (void)
 {
-    char FUNC_NAME[] = "validate_xml_file";   /* function name */
-    char errmsg[STR_SIZE];        /* error message */
     char *schema_file = NULL;     /* name of schema file or URL to be validated
                                      against */
-    int status;                   /* return status */
-    xmlDocPtr doc = NULL;         /* resulting document tree */
-    xmlSchemaPtr schema = NULL;   /* pointer to the schema */
-    xmlSchemaParserCtxtPtr ctxt = NULL;  /* parser context for the schema */
-    xmlSchemaValidCtxtPtr valid_ctxt = NULL;  /* pointer to validate from the
-                                                 schema */
     struct stat statbuf;          /* buffer for the file stat function */
 
     /* Get the ESPA schema environment variable which specifies the location
@@ -64,15 +69,169 @@ int validate_xml_file
         }
     }
 
-    /* Set up the schema parser and parse the schema file/URL */
-    xmlLineNumbersDefault (1);
-    ctxt = xmlSchemaNewParserCtxt (schema_file);
-    xmlSchemaSetParserErrors (ctxt, (xmlSchemaValidityErrorFunc) fprintf,
-        (xmlSchemaValidityWarningFunc) fprintf, stderr);
-    schema = xmlSchemaParse (ctxt);
+    return (schema_file);
+}
+
+/******************************************************************************
+MODULE:  get_espa_schema
+
+PURPOSE:  Returns the compiled ESPA schema, parsing the schema file/URL on the
+first call and returning the cached schema on subsequent calls.
+
+RETURN VALUE:
+Type = xmlSchemaPtr
+Value           Description
+-----           -----------
+NULL            Error parsing the schema
+non-NULL        Pointer to the compiled schema
+
+NOTES:
+  1. The cache is process-wide.  Parsing is serialized so concurrent callers
+     compile the schema only once.
+  2. If ESPA_SCHEMA changes between calls, the schema is re-parsed from the
+     new location.  The previous schema is retired rather than freed, since
+     another thread may still be validating against it.
+  3. The returned schema is owned by the cache and must not be freed by the
+     caller.  Use free_espa_schema_cache to release it.
+******************************************************************************/
+static xmlSchemaPtr get_espa_schema (void)
+{
+    char FUNC_NAME[] = "get_espa_schema";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    char *schema_file = NULL;     /* name of schema file or URL */
+    xmlSchemaPtr schema = NULL;   /* pointer to the schema */
+    xmlSchemaParserCtxtPtr ctxt = NULL;  /* parser context for the schema */
+    xmlSchemaPtr *retired = NULL; /* grown list of retired schemas */
+
+    schema_file = get_espa_schema_file ();
+
+#ifdef _OPENMP
+    #pragma omp critical (espa_schema_cache)
+#endif
+    {
+        if (espa_schema_cache != NULL &&
+            strcmp (espa_schema_cache_src, schema_file) != 0)
+        {  /* schema location changed; retire the stale schema.  If the list
+              can't grow, the schema is leaked rather than freed while it may
+              be in use. */
+            retired = realloc (espa_schema_retired,
+                (espa_schema_nretired + 1) * sizeof (xmlSchemaPtr));
+            if (retired != NULL)
+            {
+                espa_schema_retired = retired;
+                espa_schema_retired[espa_schema_nretired++] =
+                    espa_schema_cache;
+            }
+            espa_schema_cache = NULL;
+            espa_schema_cache_src[0] = '\0';
+        }
+
+        if (espa_schema_cache == NULL)
+        {
+            /* Set up the schema parser and parse the schema file/URL */
+            xmlLineNumbersDefault (1);
+            ctxt = xmlSchemaNewParserCtxt (schema_file);
+            if (ctxt != NULL)
+            {
+                xmlSchemaSetParserErrors (ctxt,
+                    (xmlSchemaValidityErrorFunc) fprintf,
+                    (xmlSchemaValidityWarningFunc) fprintf, stderr);
+                espa_schema_cache = xmlSchemaParse (ctxt);
+
+                /* Free the schema parser context */
+                xmlSchemaFreeParserCtxt (ctxt);
+            }
+
+            if (espa_schema_cache != NULL)
+            {
+                strncpy (espa_schema_cache_src, schema_file, STR_SIZE - 1);
+                espa_schema_cache_src[STR_SIZE-1] = '\0';
+            }
+        }
+
+        schema = espa_schema_cache;
+    }
+
+    if (schema == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Unable to parse the schema %s.  "
+            "ESPA_SCHEMA environment variable isn't defined or is invalid.  "
+            "The first default schema location of %s doesn't exist.  And the "
+            "second default location of %s was used as the last default.",
+            schema_file, LOCAL_ESPA_SCHEMA, ESPA_SCHEMA);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    return (schema);
+}
+
+/******************************************************************************
+MODULE:  free_espa_schema_cache
+
+PURPOSE:  Frees the cached compiled ESPA schema, along with any schemas
+retired after ESPA_SCHEMA changed, and cleans up the XML library.
+
+RETURN VALUE: N/A
+
+NOTES:
+  1. This is optional and is intended to be called once at the end of
+     processing (e.g. for leak checking).  A later validation will simply
+     re-parse the schema.
+  2. No validations may be in progress when this is called.
+******************************************************************************/
+void free_espa_schema_cache (void)
+{
+    int i;                        /* looping variable */
+
+#ifdef _OPENMP
+    #pragma omp critical (espa_schema_cache)
+#endif
+    {
+        if (espa_schema_cache != NULL)
+        {
+            xmlSchemaFree (espa_schema_cache);
+            espa_schema_cache = NULL;
+            espa_schema_cache_src[0] = '\0';
+        }
+
+        for (i = 0; i < espa_schema_nretired; i++)
+            xmlSchemaFree (espa_schema_retired[i]);
+        free (espa_schema_retired);
+        espa_schema_retired = NULL;
+        espa_schema_nretired = 0;
+    }
+
+    xmlSchemaCleanupTypes();
+    xmlCleanupParser();   /* cleanup the XML library */
+}
+
+/******************************************************************************
+MODULE:  validate_xml_doc
+
+PURPOSE:  Validates the specified XML file against the compiled schema.
 
-    /* Free the schema parser context */
-    xmlSchemaFreeParserCtxt (ctxt);
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           XML does not validate against the specified schema
+SUCCESS         XML validates
+
+NOTES:
+******************************************************************************/
+static int validate_xml_doc
+(
+    xmlSchemaPtr schema,      /* I: compiled schema to validate against */
+    char *meta_file           /* I: name of metadata file to be validated */
+)
+{
+    char FUNC_NAME[] = "validate_xml_doc";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    int status;                   /* return status */
+    xmlDocPtr doc = NULL;         /* resulting document tree */
+    xmlSchemaValidCtxtPtr valid_ctxt = NULL;  /* pointer to validate from the
+                                                 schema */
 
     /* Load the XML file and parse it to the document tree */
     doc = xmlReadFile (meta_file, NULL, 0);
@@ -80,21 +239,29 @@ int validate_xml_file
     {
         sprintf (errmsg, "Could not parse %s", meta_file);
         error_handler (true, FUNC_NAME, errmsg);
-        sprintf (errmsg, "Possible schema file not found.  ESPA_SCHEMA "
-            "environment variable isn't defined.  The first default schema "
-            "location of %s doesn't exist.  And the second default location of "
-            "%s was used as the last default.", LOCAL_ESPA_SCHEMA, ESPA_SCHEMA);
-        error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    /* Identify the schema file as the validation source */
+    /* Identify the schema as the validation source */
     valid_ctxt = xmlSchemaNewValidCtxt (schema);
+    if (valid_ctxt == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Unable to create the validation "
+            "context for %s", meta_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        xmlFreeDoc (doc);
+        return (ERROR);
+    }
     xmlSchemaSetValidErrors (valid_ctxt, (xmlSchemaValidityErrorFunc) fprintf,
         (xmlSchemaValidityWarningFunc) fprintf, stderr);
 
     /* Validate the XML metadata against the schema */
     status = xmlSchemaValidateDoc (valid_ctxt, doc);
+
+    /* Free the per-document resources; the schema stays cached */
+    xmlSchemaFreeValidCtxt (valid_ctxt);
+    xmlFreeDoc (doc);
+
     if (status > 0)
     {
         sprintf (errmsg, "%s fails to validate", meta_file);
@@ -109,19 +276,194 @@ int validate_xml_file
         return (ERROR);
     }
 
-    /* Free the resources and clean up the memory */
-    xmlSchemaFreeValidCtxt (valid_ctxt);
-    xmlFreeDoc (doc);
-    if (schema != NULL)
-        xmlSchemaFree (schema);
-    xmlSchemaCleanupTypes();
-    xmlCleanupParser();   /* cleanup the XML library */
-    xmlMemoryDump();      /* for debugging */
-
     /* Successful completion */
     return (SUCCESS);
 }
 
+/******************************************************************************
+MODULE:  validate_xml_file
+
+PURPOSE:  Validates the specified XML file with the specified schema file/URL.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           XML does not validate against the specified schema
+SUCCESS         XML validates
+
+NOTES:
+  1. The schema is parsed on the first call and cached for the life of the
+     process, so repeated validations don't re-read (or re-fetch) the XSD.
+  2. When the metadata cache is enabled (see espa_metadata_cache.h) and the
+     cache for this exact XML file records that it was already validated
+     against this exact schema file, the XML isn't validated again and the
+     schema isn't loaded at all.  A successful validation is recorded in a
+     current cache.
+******************************************************************************/
+int validate_xml_file
+(
+    char *meta_file           /* I: name of metadata file to be validated */
+)
+{
+    int status;                   /* return status */
+    bool use_cache;               /* is the metadata cache being used */
+    uint64_t schema_key = 0;      /* identity of the schema for the metadata
+                                     cache */
+    xmlSchemaPtr schema = NULL;   /* pointer to the cached schema */
+    Espa_metadata_cache_key_t key;  /* identity of the XML file for the
+                                       metadata cache */
+
+    /* Skip the validation if the cache shows it was already done */
+    use_cache = metadata_cache_enabled ()
+        && get_metadata_cache_key (meta_file, &key) == SUCCESS;
+    if (use_cache)
+    {
+        schema_key = get_metadata_cache_schema_key (get_espa_schema_file ());
+        if (metadata_cache_validated (meta_file, &key, schema_key))
+            return (SUCCESS);
+    }
+
+    /* Get the compiled schema, parsing it if this is the first call */
+    schema = get_espa_schema ();
+    if (schema == NULL)
+        return (ERROR);
+
+    status = validate_xml_doc (schema, meta_file);
+    if (status == SUCCESS && use_cache)
+        mark_metadata_cache_validated (meta_file, &key, schema_key);
+
+    return (status);
+}
+
+/******************************************************************************
+MODULE:  validate_xml_files
+
+PURPOSE:  Validates a list of XML files against the ESPA schema, using a
+single compiled schema for all of the files.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              The schema could not be parsed or memory could not be
+                allocated
+>= 0            Number of files which failed to validate
+
+NOTES:
+  1. Every file is validated, even after a failure, so the caller gets a
+     complete report.  If status is not NULL, status[i] is set to SUCCESS or
+     ERROR for meta_files[i].
+  2. The files are validated in parallel when OpenMP is enabled and nthreads
+     is greater than 1.  The validation errors for each file are written to
+     stderr as they are found.
+  3. The metadata cache is used as in validate_xml_file.  The cache of every
+     file is checked first, and the schema is only loaded if at least one
+     file still needs to be validated.
+******************************************************************************/
+int validate_xml_files
+(
+    int nfiles,               /* I: number of metadata files */
+    char **meta_files,        /* I: names of metadata files to be validated */
+    int nthreads,             /* I: number of threads to use */
+    int *status               /* O: validation status for each file; may be
+                                    NULL */
+)
+{
+    char FUNC_NAME[] = "validate_xml_files";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    int i;                        /* looping variable */
+    int nfail = 0;                /* number of files failing validation */
+    int nvalidate = 0;            /* number of files needing validation */
+    int curr_status;              /* validation status of the current file */
+    bool use_cache;               /* is the metadata cache being used */
+    uint64_t schema_key = 0;      /* identity of the schema for the metadata
+                                     cache */
+    bool *cached = NULL;          /* does each file have a cache key */
+    bool *validated = NULL;       /* does the cache show each file was
+                                     already validated */
+    xmlSchemaPtr schema = NULL;   /* pointer to the cached schema */
+    Espa_metadata_cache_key_t *key = NULL;  /* identity of each file for the
+                                               metadata cache */
+
+    if (nfiles < 1)
+        return (0);
+
+    cached = calloc (nfiles, sizeof (bool));
+    validated = calloc (nfiles, sizeof (bool));
+    key = calloc (nfiles, sizeof (Espa_metadata_cache_key_t));
+    if (cached == NULL || validated == NULL || key == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating the metadata cache "
+            "status of %d files", nfiles);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (cached);
+        free (validated);
+        free (key);
+        return (-1);
+    }
+
+    /* Find the files the cache shows were already validated */
+    use_cache = metadata_cache_enabled ();
+    if (use_cache)
+        schema_key = get_metadata_cache_schema_key (get_espa_schema_file ());
+    for (i = 0; i < nfiles; i++)
+    {
+        cached[i] = use_cache
+            && get_metadata_cache_key (meta_files[i], &key[i]) == SUCCESS;
+        validated[i] = cached[i]
+            && metadata_cache_validated (meta_files[i], &key[i], schema_key);
+        if (!validated[i])
+            nvalidate++;
+    }
+
+    /* Get the compiled schema once for all of the files, if any of them
+       need it */
+    if (nvalidate > 0)
+    {
+        schema = get_espa_schema ();
+        if (schema == NULL)
+        {
+            free (cached);
+            free (validated);
+            free (key);
+            return (-1);
+        }
+
+        /* Initialize the parser in this thread before any worker threads use
+           it */
+        xmlInitParser ();
+    }
+
+    if (nthreads < 1)
+        nthreads = 1;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic) num_threads (nthreads) private (curr_status) reduction (+:nfail)
+#endif
+    for (i = 0; i < nfiles; i++)
+    {
+        if (validated[i])
+            curr_status = SUCCESS;
+        else
+        {
+            curr_status = validate_xml_doc (schema, meta_files[i]);
+            if (curr_status == SUCCESS && cached[i])
+                mark_metadata_cache_validated (meta_files[i], &key[i],
+                    schema_key);
+        }
+        if (curr_status != SUCCESS)
+            nfail++;
+        if (status != NULL)
+            status[i] = curr_status;
+    }
+
+    free (cached);
+    free (validated);
+    free (key);
+    return (nfail);
+}
+
 
 /******************************************************************************
 MODULE:  init_metadata_struct
@@ -180,6 +522,63 @@ void init_metadata_struct
 }
 
 
+/******************************************************************************
+MODULE:  init_band_metadata
+
+PURPOSE:  Initializes a single band in the ESPA internal metadata structure.
+
+RETURN VALUE: N/A
+
+NOTES:
+  1. Initializes the bitmap_description and class_values for the band to NULL
+     and sets the nbits, nclass, ncover to 0.  Initializes the other fields to
+     fill to make it easy to distinguish if they were populated by reading
+     an input metadata file or assigned directly.
+******************************************************************************/
+void init_band_metadata
+(
+    Espa_band_meta_t *bmeta     /* I: pointer to band metadata structure to
+                                      be initialized */
+)
+{
+    bmeta->nbits = 0;
+    bmeta->bitmap_description = NULL;
+    bmeta->nclass = 0;
+    bmeta->class_values = NULL;
+    bmeta->ncover = 0;
+    bmeta->percent_cover = NULL;
+
+    strcpy (bmeta->product, ESPA_STRING_META_FILL);
+    strcpy (bmeta->source, ESPA_STRING_META_FILL);
+    strcpy (bmeta->name, ESPA_STRING_META_FILL);
+    strcpy (bmeta->category, ESPA_STRING_META_FILL);
+    bmeta->data_type = ESPA_UINT8;
+    bmeta->nlines = ESPA_INT_META_FILL;
+    bmeta->nsamps = ESPA_INT_META_FILL;
+    bmeta->fill_value = ESPA_INT_META_FILL;
+    bmeta->saturate_value = ESPA_INT_META_FILL;
+    bmeta->scale_factor = ESPA_FLOAT_META_FILL;
+    bmeta->add_offset = ESPA_FLOAT_META_FILL;
+    bmeta->resample_method = ESPA_NONE;
+    strcpy (bmeta->short_name, ESPA_STRING_META_FILL);
+    strcpy (bmeta->long_name, ESPA_STRING_META_FILL);
+    strcpy (bmeta->file_name, ESPA_STRING_META_FILL);
+    bmeta->pixel_size[0] = bmeta->pixel_size[1] = ESPA_FLOAT_META_FILL;
+    strcpy (bmeta->pixel_units, ESPA_STRING_META_FILL);
+    strcpy (bmeta->data_units, ESPA_STRING_META_FILL);
+    bmeta->valid_range[0] = bmeta->valid_range[1] = ESPA_FLOAT_META_FILL;
+    bmeta->rad_gain = ESPA_FLOAT_META_FILL;
+    bmeta->rad_bias = ESPA_FLOAT_META_FILL;
+    bmeta->refl_gain = ESPA_FLOAT_META_FILL;
+    bmeta->refl_bias = ESPA_FLOAT_META_FILL;
+    bmeta->k1_const = ESPA_FLOAT_META_FILL;
+    bmeta->k2_const = ESPA_FLOAT_META_FILL;
+    strcpy (bmeta->qa_desc, ESPA_STRING_META_FILL);
+    strcpy (bmeta->app_version, ESPA_STRING_META_FILL);
+    strcpy (bmeta->production_date, ESPA_STRING_META_FILL);
+}
+
+
 /******************************************************************************
 MODULE:  allocate_band_metadata
 
@@ -221,49 +620,9 @@ int allocate_band_metadata
     }
     bmeta = internal_meta->band;
 
-    /* Set the nbits, nclass, ncover fields in the band metadata to 0 for each
-       band and initialize the pointers to NULL.  Initialize the other fields to
-       fill to make it easy to distinguish if they were populated by reading
-       an input metadata file or assigned directly. */
+    /* Initialize each of the bands */
     for (i = 0; i < nbands; i++)
-    {
-        bmeta[i].nbits = 0;
-        bmeta[i].bitmap_description = NULL;
-        bmeta[i].nclass = 0;
-        bmeta[i].class_values = NULL;
-        bmeta[i].ncover = 0;
-        bmeta[i].percent_cover = NULL;
-
-        strcpy (bmeta[i].product, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].source, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].name, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].category, ESPA_STRING_META_FILL);
-        bmeta[i].data_type = ESPA_UINT8;
-        bmeta[i].nlines = ESPA_INT_META_FILL;
-        bmeta[i].nsamps = ESPA_INT_META_FILL;
-        bmeta[i].fill_value = ESPA_INT_META_FILL;
-        bmeta[i].saturate_value = ESPA_INT_META_FILL;
-        bmeta[i].scale_factor = ESPA_FLOAT_META_FILL;
-        bmeta[i].add_offset = ESPA_FLOAT_META_FILL;
-        bmeta[i].resample_method = ESPA_NONE;
-        strcpy (bmeta[i].short_name, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].long_name, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].file_name, ESPA_STRING_META_FILL);
-        bmeta[i].pixel_size[0] = bmeta[i].pixel_size[1] = ESPA_FLOAT_META_FILL;
-        strcpy (bmeta[i].pixel_units, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].data_units, ESPA_STRING_META_FILL);
-        bmeta[i].valid_range[0] = bmeta[i].valid_range[1] =
-            ESPA_FLOAT_META_FILL;
-        bmeta[i].rad_gain = ESPA_FLOAT_META_FILL;
-        bmeta[i].rad_bias = ESPA_FLOAT_META_FILL;
-        bmeta[i].refl_gain = ESPA_FLOAT_META_FILL;
-        bmeta[i].refl_bias = ESPA_FLOAT_META_FILL;
-        bmeta[i].k1_const = ESPA_FLOAT_META_FILL;
-        bmeta[i].k2_const = ESPA_FLOAT_META_FILL;
-        strcpy (bmeta[i].qa_desc, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].app_version, ESPA_STRING_META_FILL);
-        strcpy (bmeta[i].production_date, ESPA_STRING_META_FILL);
-    }
+        init_band_metadata (&bmeta[i]);
 
     return (SUCCESS);
 }
@@ -209,12 +209,29 @@ int validate_xml_file
     char *meta_file           /* I: name of metadata file to be validated */
 );
 
+int validate_xml_files
+(
+    int nfiles,               /* I: number of metadata files */
+    char **meta_files,        /* I: names of metadata files to be validated */
+    int nthreads,             /* I: number of threads to use */
+    int *status               /* O: validation status for each file; may be
+                                    NULL */
+);
+
+void free_espa_schema_cache (void);
+
 void init_metadata_struct
 (
     Espa_internal_meta_t *internal_meta   /* I: pointer to internal metadata
                                                 structure to be initialized */
 );
 
+void init_band_metadata
+(
+    Espa_band_meta_t *bmeta     /* I: pointer to band metadata structure to
+                                      be initialized */
+);
+
 int allocate_band_metadata
 (
     Espa_internal_meta_t *internal_meta,  /* I: pointer to internal metadata
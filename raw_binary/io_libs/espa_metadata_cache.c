@@ -0,0 +1,1134 @@
+/*****************************************************************************
+FILE: espa_metadata_cache.c
+
+PURPOSE: Contains functions for reading and writing the binary sidecar cache
+of the ESPA internal metadata.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The cache file is a fixed size header followed by the serialized
+     metadata.  The numeric fields are stored as their native binary values
+     and each string is stored as its length followed by its characters, so
+     the cache holds only the characters actually used instead of the full
+     fixed size string arrays.
+  2. The cache is optional.  A missing, stale, or damaged cache just means
+     the XML is parsed, so the routines which look for a cache or write one
+     don't print any error messages.  The directory of a scene may well be
+     read-only to some of the tools.
+  3. A new cache is written to a temporary file and renamed into place, so
+     tools running at the same time never see a partially written cache.
+*****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "espa_metadata_cache.h"
+
+/* Byte order marker; reads back differently on a system with a different
+   byte order */
+#define CACHE_BYTE_ORDER 0x01020304
+
+/* Number of bytes initially allocated for the serialized metadata, which is
+   doubled as needed */
+#define CACHE_INIT_ALLOC 65536
+
+/* FNV-1a hash constants */
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/* Header of the cache file */
+typedef struct
+{
+    char magic[ESPA_METADATA_CACHE_MAGIC_SIZE];  /* cache format identifier */
+    uint32_t byte_order;        /* CACHE_BYTE_ORDER */
+    uint64_t validated_schema;  /* identity of the schema the XML has been
+                                   validated against, or 0 if it hasn't
+                                   been validated */
+    char schema_version[16];    /* ESPA_SCHEMA_VERSION */
+    Espa_metadata_cache_key_t key;  /* identity of the XML file */
+    uint64_t data_size;         /* number of bytes of serialized metadata
+                                   following the header */
+    uint64_t data_hash;         /* hash of the serialized metadata */
+} Cache_header_t;
+
+/* Buffer the metadata is serialized into */
+typedef struct
+{
+    unsigned char *data;        /* serialized metadata */
+    size_t size;                /* number of bytes used in data */
+    size_t alloc;               /* number of bytes allocated for data */
+    bool error;                 /* did an allocation fail */
+} Cache_buffer_t;
+
+/* Serialized metadata being read */
+typedef struct
+{
+    const unsigned char *data;  /* serialized metadata */
+    size_t size;                /* number of bytes in data */
+    size_t pos;                 /* current read position in data */
+    bool error;                 /* did a read run past the end of the data or
+                                   find an invalid value */
+} Cache_reader_t;
+
+#define put_value(buf, value) put_bytes (buf, &(value), sizeof (value))
+#define get_value(reader, value) get_bytes (reader, &(value), sizeof (value))
+
+/******************************************************************************
+MODULE:  hash_bytes
+
+PURPOSE: Adds a block of bytes to a 64-bit FNV-1a hash.
+
+RETURN VALUE:
+Type = uint64_t
+Value           Description
+-----           -----------
+hash            Updated hash value
+
+NOTES:
+  1. Start the hash with FNV_OFFSET_BASIS.
+******************************************************************************/
+static uint64_t hash_bytes
+(
+    uint64_t hash,              /* I: hash of the preceding bytes */
+    const unsigned char *data,  /* I: bytes to add to the hash */
+    size_t size                 /* I: number of bytes */
+)
+{
+    size_t i;                   /* looping variable */
+
+    for (i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+
+    return (hash);
+}
+
+
+/******************************************************************************
+MODULE:  get_cache_filename
+
+PURPOSE: Forms the name of the cache file for an XML metadata file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The cache filename is too long
+SUCCESS         Successful completion
+
+NOTES:
+******************************************************************************/
+static int get_cache_filename
+(
+    char *metafile,             /* I: XML metadata filename */
+    char *cachefile,            /* O: cache filename */
+    size_t size                 /* I: size of the cachefile buffer */
+)
+{
+    int count;                  /* number of characters in the filename */
+
+    count = snprintf (cachefile, size, "%s%s", metafile,
+        ESPA_METADATA_CACHE_EXTENSION);
+    if (count < 0 || (size_t) count >= size)
+        return (ERROR);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  header_is_current
+
+PURPOSE: Determines if a cache header belongs to the current XML file and
+the current cache format.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The cache is current
+false           The cache is stale or isn't a cache file
+
+NOTES:
+******************************************************************************/
+static bool header_is_current
+(
+    const Cache_header_t *header,          /* I: cache header */
+    const Espa_metadata_cache_key_t *key   /* I: identity of the XML file */
+)
+{
+    return (memcmp (header->magic, ESPA_METADATA_CACHE_MAGIC,
+                ESPA_METADATA_CACHE_MAGIC_SIZE) == 0
+        && header->byte_order == CACHE_BYTE_ORDER
+        && strncmp (header->schema_version, ESPA_SCHEMA_VERSION,
+                sizeof (header->schema_version)) == 0
+        && header->key.size == key->size
+        && header->key.mtime == key->mtime
+        && header->key.mtime_nsec == key->mtime_nsec
+        && header->key.hash == key->hash);
+}
+
+
+/******************************************************************************
+MODULE:  read_cache_header
+
+PURPOSE: Opens the cache file for an XML metadata file and reads its header,
+if the cache is current.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              There is no current cache for the XML file
+>= 0            File descriptor of the open cache file
+
+NOTES:
+  1. On success the file is positioned just past the header.  The caller is
+     responsible for closing the file.
+******************************************************************************/
+static int read_cache_header
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file */
+    int flags,                        /* I: open flags (O_RDONLY or O_RDWR) */
+    Cache_header_t *header            /* O: cache header */
+)
+{
+    char cachefile[STR_SIZE];         /* cache filename */
+    int fd;                           /* cache file descriptor */
+
+    if (get_cache_filename (metafile, cachefile, sizeof (cachefile))
+        != SUCCESS)
+        return (-1);
+
+    fd = open (cachefile, flags);
+    if (fd < 0)
+        return (-1);
+
+    if (read (fd, header, sizeof (*header)) != sizeof (*header)
+        || !header_is_current (header, key))
+    {
+        close (fd);
+        return (-1);
+    }
+
+    return (fd);
+}
+
+
+/******************************************************************************
+MODULE:  put_bytes
+
+PURPOSE: Appends bytes to the serialized metadata buffer, growing the buffer
+as needed.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. An allocation failure sets the error flag in the buffer, and the
+     remaining bytes are ignored.
+******************************************************************************/
+static void put_bytes
+(
+    Cache_buffer_t *buf,        /* I/O: serialized metadata buffer */
+    const void *data,           /* I: bytes to append */
+    size_t size                 /* I: number of bytes */
+)
+{
+    size_t new_alloc;           /* new size of the buffer */
+    unsigned char *new_data;    /* reallocated buffer */
+
+    if (buf->error)
+        return;
+
+    if (buf->size + size > buf->alloc)
+    {
+        new_alloc = buf->alloc > 0 ? buf->alloc : CACHE_INIT_ALLOC;
+        while (buf->size + size > new_alloc)
+            new_alloc *= 2;
+
+        new_data = realloc (buf->data, new_alloc);
+        if (new_data == NULL)
+        {
+            buf->error = true;
+            return;
+        }
+        buf->data = new_data;
+        buf->alloc = new_alloc;
+    }
+
+    memcpy (buf->data + buf->size, data, size);
+    buf->size += size;
+}
+
+
+/******************************************************************************
+MODULE:  put_string
+
+PURPOSE: Appends a string to the serialized metadata buffer as its length
+followed by its characters.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_string
+(
+    Cache_buffer_t *buf,        /* I/O: serialized metadata buffer */
+    const char *str             /* I: string to append */
+)
+{
+    uint32_t len = strlen (str);    /* length of the string */
+
+    put_value (buf, len);
+    put_bytes (buf, str, len);
+}
+
+
+/******************************************************************************
+MODULE:  get_bytes
+
+PURPOSE: Reads bytes from the serialized metadata.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. Reading past the end of the data sets the error flag in the reader and
+     zeroes the destination.
+******************************************************************************/
+static void get_bytes
+(
+    Cache_reader_t *reader,     /* I/O: serialized metadata being read */
+    void *dest,                 /* O: bytes read */
+    size_t size                 /* I: number of bytes to read */
+)
+{
+    if (reader->error || size > reader->size - reader->pos)
+    {
+        reader->error = true;
+        memset (dest, 0, size);
+        return;
+    }
+
+    memcpy (dest, reader->data + reader->pos, size);
+    reader->pos += size;
+}
+
+
+/******************************************************************************
+MODULE:  get_string
+
+PURPOSE: Reads a string from the serialized metadata.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. A string which doesn't fit in the destination sets the error flag in
+     the reader.  The destination is always NUL terminated.
+******************************************************************************/
+static void get_string
+(
+    Cache_reader_t *reader,     /* I/O: serialized metadata being read */
+    char *dest,                 /* O: string read */
+    size_t size                 /* I: size of the destination */
+)
+{
+    uint32_t len;               /* length of the string */
+
+    get_value (reader, len);
+    if (reader->error || len >= size)
+    {
+        reader->error = true;
+        dest[0] = '\0';
+        return;
+    }
+
+    get_bytes (reader, dest, len);
+    dest[len] = '\0';
+}
+
+
+/******************************************************************************
+MODULE:  get_count
+
+PURPOSE: Reads the number of entries in an array of the serialized metadata.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+count           Number of entries, or 0 if the count isn't valid
+
+NOTES:
+  1. Every entry takes at least min_entry_size bytes, so a count which can't
+     fit in the rest of the data sets the error flag in the reader.  This
+     keeps a damaged cache from causing a huge allocation.
+******************************************************************************/
+static int get_count
+(
+    Cache_reader_t *reader,     /* I/O: serialized metadata being read */
+    size_t min_entry_size       /* I: minimum size of an entry in bytes */
+)
+{
+    int count;                  /* number of entries */
+
+    get_value (reader, count);
+    if (reader->error || count < 0
+        || (size_t) count > (reader->size - reader->pos) / min_entry_size)
+    {
+        reader->error = true;
+        return (0);
+    }
+
+    return (count);
+}
+
+
+/******************************************************************************
+MODULE:  put_global_metadata
+
+PURPOSE: Serializes the global metadata.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_global_metadata
+(
+    Cache_buffer_t *buf,              /* I/O: serialized metadata buffer */
+    const Espa_global_meta_t *gmeta   /* I: global metadata */
+)
+{
+    const Espa_proj_meta_t *proj = &gmeta->proj_info;  /* projection info */
+
+    put_string (buf, gmeta->data_provider);
+    put_string (buf, gmeta->satellite);
+    put_string (buf, gmeta->instrument);
+    put_string (buf, gmeta->acquisition_date);
+    put_value (buf, gmeta->ul_corner);
+    put_value (buf, gmeta->lr_corner);
+    put_value (buf, gmeta->bounding_coords);
+
+    put_value (buf, proj->proj_type);
+    put_value (buf, proj->datum_type);
+    put_string (buf, proj->units);
+    put_value (buf, proj->ul_corner);
+    put_value (buf, proj->lr_corner);
+    put_string (buf, proj->grid_origin);
+    put_value (buf, proj->utm_zone);
+    put_value (buf, proj->longitude_pole);
+    put_value (buf, proj->latitude_true_scale);
+    put_value (buf, proj->false_easting);
+    put_value (buf, proj->false_northing);
+    put_value (buf, proj->standard_parallel1);
+    put_value (buf, proj->standard_parallel2);
+    put_value (buf, proj->central_meridian);
+    put_value (buf, proj->origin_latitude);
+    put_value (buf, proj->sphere_radius);
+
+    put_value (buf, gmeta->wrs_system);
+    put_value (buf, gmeta->wrs_path);
+    put_value (buf, gmeta->wrs_row);
+    put_string (buf, gmeta->scene_center_time);
+    put_string (buf, gmeta->product_id);
+    put_string (buf, gmeta->lpgs_metadata_file);
+    put_value (buf, gmeta->orientation_angle);
+    put_value (buf, gmeta->solar_zenith);
+    put_value (buf, gmeta->solar_azimuth);
+    put_string (buf, gmeta->solar_units);
+    put_value (buf, gmeta->earth_sun_dist);
+    put_string (buf, gmeta->level1_production_date);
+    put_value (buf, gmeta->htile);
+    put_value (buf, gmeta->vtile);
+}
+
+
+/******************************************************************************
+MODULE:  get_global_metadata
+
+PURPOSE: Reads the serialized global metadata.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. Errors are flagged in the reader.
+******************************************************************************/
+static void get_global_metadata
+(
+    Cache_reader_t *reader,           /* I/O: serialized metadata being read */
+    Espa_global_meta_t *gmeta         /* O: global metadata */
+)
+{
+    Espa_proj_meta_t *proj = &gmeta->proj_info;  /* projection info */
+
+    get_string (reader, gmeta->data_provider, STR_SIZE);
+    get_string (reader, gmeta->satellite, STR_SIZE);
+    get_string (reader, gmeta->instrument, STR_SIZE);
+    get_string (reader, gmeta->acquisition_date, STR_SIZE);
+    get_value (reader, gmeta->ul_corner);
+    get_value (reader, gmeta->lr_corner);
+    get_value (reader, gmeta->bounding_coords);
+
+    get_value (reader, proj->proj_type);
+    get_value (reader, proj->datum_type);
+    get_string (reader, proj->units, STR_SIZE);
+    get_value (reader, proj->ul_corner);
+    get_value (reader, proj->lr_corner);
+    get_string (reader, proj->grid_origin, STR_SIZE);
+    get_value (reader, proj->utm_zone);
+    get_value (reader, proj->longitude_pole);
+    get_value (reader, proj->latitude_true_scale);
+    get_value (reader, proj->false_easting);
+    get_value (reader, proj->false_northing);
+    get_value (reader, proj->standard_parallel1);
+    get_value (reader, proj->standard_parallel2);
+    get_value (reader, proj->central_meridian);
+    get_value (reader, proj->origin_latitude);
+    get_value (reader, proj->sphere_radius);
+
+    get_value (reader, gmeta->wrs_system);
+    get_value (reader, gmeta->wrs_path);
+    get_value (reader, gmeta->wrs_row);
+    get_string (reader, gmeta->scene_center_time, STR_SIZE);
+    get_string (reader, gmeta->product_id, STR_SIZE);
+    get_string (reader, gmeta->lpgs_metadata_file, STR_SIZE);
+    get_value (reader, gmeta->orientation_angle);
+    get_value (reader, gmeta->solar_zenith);
+    get_value (reader, gmeta->solar_azimuth);
+    get_string (reader, gmeta->solar_units, STR_SIZE);
+    get_value (reader, gmeta->earth_sun_dist);
+    get_string (reader, gmeta->level1_production_date, STR_SIZE);
+    get_value (reader, gmeta->htile);
+    get_value (reader, gmeta->vtile);
+}
+
+
+/******************************************************************************
+MODULE:  put_band_metadata
+
+PURPOSE: Serializes the metadata for one band.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_band_metadata
+(
+    Cache_buffer_t *buf,              /* I/O: serialized metadata buffer */
+    const Espa_band_meta_t *bmeta     /* I: band metadata */
+)
+{
+    int i;                            /* looping variable */
+    int32_t value;                    /* enumerated value */
+
+    put_string (buf, bmeta->product);
+    put_string (buf, bmeta->source);
+    put_string (buf, bmeta->name);
+    put_string (buf, bmeta->category);
+    value = bmeta->data_type;
+    put_value (buf, value);
+    put_value (buf, bmeta->nlines);
+    put_value (buf, bmeta->nsamps);
+    put_value (buf, bmeta->fill_value);
+    put_value (buf, bmeta->saturate_value);
+    put_value (buf, bmeta->scale_factor);
+    put_value (buf, bmeta->add_offset);
+    value = bmeta->resample_method;
+    put_value (buf, value);
+    put_string (buf, bmeta->short_name);
+    put_string (buf, bmeta->long_name);
+    put_string (buf, bmeta->file_name);
+    put_value (buf, bmeta->pixel_size);
+    put_string (buf, bmeta->pixel_units);
+    put_string (buf, bmeta->data_units);
+    put_value (buf, bmeta->valid_range);
+    put_value (buf, bmeta->rad_gain);
+    put_value (buf, bmeta->rad_bias);
+    put_value (buf, bmeta->refl_gain);
+    put_value (buf, bmeta->refl_bias);
+    put_value (buf, bmeta->k1_const);
+    put_value (buf, bmeta->k2_const);
+    put_string (buf, bmeta->qa_desc);
+    put_string (buf, bmeta->app_version);
+    put_string (buf, bmeta->production_date);
+
+    put_value (buf, bmeta->nbits);
+    for (i = 0; i < bmeta->nbits; i++)
+        put_string (buf, bmeta->bitmap_description[i]);
+
+    put_value (buf, bmeta->nclass);
+    for (i = 0; i < bmeta->nclass; i++)
+    {
+        put_value (buf, bmeta->class_values[i].class);
+        put_string (buf, bmeta->class_values[i].description);
+    }
+
+    put_value (buf, bmeta->ncover);
+    for (i = 0; i < bmeta->ncover; i++)
+    {
+        put_value (buf, bmeta->percent_cover[i].percent);
+        put_string (buf, bmeta->percent_cover[i].description);
+    }
+}
+
+
+/******************************************************************************
+MODULE:  get_band_metadata
+
+PURPOSE: Reads the serialized metadata for one band.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating the bit, class, or cover arrays
+SUCCESS         Successful completion
+
+NOTES:
+  1. Errors in the serialized data are flagged in the reader.
+******************************************************************************/
+static int get_band_metadata
+(
+    Cache_reader_t *reader,           /* I/O: serialized metadata being read */
+    Espa_band_meta_t *bmeta           /* O: band metadata, initialized via
+                                            init_band_metadata */
+)
+{
+    int i;                            /* looping variable */
+    int count;                        /* number of bits, classes, or covers */
+    int32_t value;                    /* enumerated value */
+
+    get_string (reader, bmeta->product, STR_SIZE);
+    get_string (reader, bmeta->source, STR_SIZE);
+    get_string (reader, bmeta->name, STR_SIZE);
+    get_string (reader, bmeta->category, STR_SIZE);
+    get_value (reader, value);
+    bmeta->data_type = value;
+    get_value (reader, bmeta->nlines);
+    get_value (reader, bmeta->nsamps);
+    get_value (reader, bmeta->fill_value);
+    get_value (reader, bmeta->saturate_value);
+    get_value (reader, bmeta->scale_factor);
+    get_value (reader, bmeta->add_offset);
+    get_value (reader, value);
+    bmeta->resample_method = value;
+    get_string (reader, bmeta->short_name, STR_SIZE);
+    get_string (reader, bmeta->long_name, STR_SIZE);
+    get_string (reader, bmeta->file_name, STR_SIZE);
+    get_value (reader, bmeta->pixel_size);
+    get_string (reader, bmeta->pixel_units, STR_SIZE);
+    get_string (reader, bmeta->data_units, STR_SIZE);
+    get_value (reader, bmeta->valid_range);
+    get_value (reader, bmeta->rad_gain);
+    get_value (reader, bmeta->rad_bias);
+    get_value (reader, bmeta->refl_gain);
+    get_value (reader, bmeta->refl_bias);
+    get_value (reader, bmeta->k1_const);
+    get_value (reader, bmeta->k2_const);
+    get_string (reader, bmeta->qa_desc, HUGE_STR_SIZE);
+    get_string (reader, bmeta->app_version, STR_SIZE);
+    get_string (reader, bmeta->production_date, STR_SIZE);
+
+    count = get_count (reader, sizeof (uint32_t));
+    if (count > 0)
+    {
+        if (allocate_bitmap_metadata (bmeta, count) != SUCCESS)
+            return (ERROR);
+        for (i = 0; i < count; i++)
+            get_string (reader, bmeta->bitmap_description[i], STR_SIZE);
+    }
+
+    count = get_count (reader, sizeof (int) + sizeof (uint32_t));
+    if (count > 0)
+    {
+        if (allocate_class_metadata (bmeta, count) != SUCCESS)
+            return (ERROR);
+        for (i = 0; i < count; i++)
+        {
+            get_value (reader, bmeta->class_values[i].class);
+            get_string (reader, bmeta->class_values[i].description,
+                STR_SIZE);
+        }
+    }
+
+    count = get_count (reader, sizeof (float) + sizeof (uint32_t));
+    if (count > 0)
+    {
+        if (allocate_percent_coverage_metadata (bmeta, count) != SUCCESS)
+            return (ERROR);
+        for (i = 0; i < count; i++)
+        {
+            get_value (reader, bmeta->percent_cover[i].percent);
+            get_string (reader, bmeta->percent_cover[i].description,
+                STR_SIZE);
+        }
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  metadata_cache_enabled
+
+PURPOSE: Determines if the metadata cache is enabled by the
+ESPA_METADATA_CACHE environment variable.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The cache is enabled
+false           The cache is not enabled
+
+NOTES:
+  1. The cache is enabled when the environment variable is set to anything
+     other than an empty string, 0, no, or false.
+******************************************************************************/
+bool metadata_cache_enabled (void)
+{
+    char *env = getenv (ESPA_METADATA_CACHE_ENV);  /* environment value */
+
+    if (env == NULL || env[0] == '\0' || !strcmp (env, "0")
+        || !strcasecmp (env, "no") || !strcasecmp (env, "false"))
+        return (false);
+
+    return (true);
+}
+
+
+/******************************************************************************
+MODULE:  get_metadata_cache_key
+
+PURPOSE: Gets the size, modification time, and content hash of an XML
+metadata file, which identify the cache for it.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The XML file isn't a local file which can be read
+SUCCESS         Successful completion
+
+NOTES:
+  1. The contents are hashed through a read-only mapping of the file.
+  2. No error message is printed, since XML metadata specified as a URL
+     simply can't have a cache.
+******************************************************************************/
+int get_metadata_cache_key
+(
+    char *metafile,                   /* I: XML metadata filename */
+    Espa_metadata_cache_key_t *key    /* O: identity of the XML file */
+)
+{
+    int fd;                           /* XML file descriptor */
+    struct stat file_stat;            /* XML file status */
+    void *contents = NULL;            /* mapped XML file contents */
+
+    fd = open (metafile, O_RDONLY);
+    if (fd < 0)
+        return (ERROR);
+
+    if (fstat (fd, &file_stat) != 0 || !S_ISREG (file_stat.st_mode))
+    {
+        close (fd);
+        return (ERROR);
+    }
+    key->size = file_stat.st_size;
+    key->mtime = file_stat.st_mtim.tv_sec;
+    key->mtime_nsec = file_stat.st_mtim.tv_nsec;
+    key->hash = FNV_OFFSET_BASIS;
+
+    if (file_stat.st_size > 0)
+    {
+        contents = mmap (NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd,
+            0);
+        if (contents == MAP_FAILED)
+        {
+            close (fd);
+            return (ERROR);
+        }
+        key->hash = hash_bytes (key->hash, contents, file_stat.st_size);
+        munmap (contents, file_stat.st_size);
+    }
+    close (fd);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_metadata_cache
+
+PURPOSE: Loads the metadata for an XML metadata file from its cache, if
+there is a current cache for it.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           There is no usable cache; the metadata is left initialized
+SUCCESS         The metadata was loaded from the cache
+
+NOTES:
+  1. The whole cache is read with a single read call and checked against
+     its hash before any of it is used.
+  2. The metadata structure is the same as parse_metadata would produce from
+     the XML file, and is freed with free_metadata.
+******************************************************************************/
+int read_metadata_cache
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file,
+                                                from get_metadata_cache_key */
+    Espa_internal_meta_t *metadata    /* I/O: metadata structure which has
+                                              been initialized via
+                                              init_metadata_struct */
+)
+{
+    int i;                            /* looping variable */
+    int fd;                           /* cache file descriptor */
+    int nbands;                       /* number of bands in the cache */
+    ssize_t nread;                    /* number of bytes read */
+    size_t total;                     /* total number of bytes read */
+    struct stat file_stat;            /* cache file status */
+    unsigned char *data = NULL;       /* serialized metadata */
+    Cache_header_t header;            /* cache header */
+    Cache_reader_t reader;            /* serialized metadata being read */
+
+    fd = read_cache_header (metafile, key, O_RDONLY, &header);
+    if (fd < 0)
+        return (ERROR);
+
+    /* Read the serialized metadata following the header */
+    if (fstat (fd, &file_stat) != 0
+        || (uint64_t) file_stat.st_size != sizeof (header) + header.data_size
+        || header.data_size == 0)
+    {
+        close (fd);
+        return (ERROR);
+    }
+
+    data = malloc (header.data_size);
+    if (data == NULL)
+    {
+        close (fd);
+        return (ERROR);
+    }
+
+    total = 0;
+    while (total < header.data_size)
+    {
+        nread = read (fd, data + total, header.data_size - total);
+        if (nread < 0 && errno == EINTR)
+            continue;
+        if (nread <= 0)
+            break;
+        total += nread;
+    }
+    close (fd);
+
+    if (total != header.data_size
+        || hash_bytes (FNV_OFFSET_BASIS, data, total) != header.data_hash)
+    {
+        free (data);
+        return (ERROR);
+    }
+
+    /* Fill the metadata structure */
+    reader.data = data;
+    reader.size = total;
+    reader.pos = 0;
+    reader.error = false;
+
+    get_string (&reader, metadata->meta_namespace, STR_SIZE);
+    get_global_metadata (&reader, &metadata->global);
+
+    nbands = get_count (&reader, sizeof (uint32_t));
+    if (!reader.error && nbands > 0)
+    {
+        if (allocate_band_metadata (metadata, nbands) != SUCCESS)
+            reader.error = true;
+
+        for (i = 0; i < nbands && !reader.error; i++)
+        {
+            if (get_band_metadata (&reader, &metadata->band[i]) != SUCCESS)
+                reader.error = true;
+        }
+    }
+    free (data);
+
+    /* Everything in the cache should have been used */
+    if (reader.error || reader.pos != reader.size)
+    {
+        free_metadata (metadata);
+        init_metadata_struct (metadata);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_metadata_cache
+
+PURPOSE: Writes the cache for an XML metadata file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The cache could not be written
+SUCCESS         Successful completion
+
+NOTES:
+  1. The key should be taken from the XML file before it was parsed.  If the
+     XML file has changed since then, the cache isn't written.
+  2. The cache is written to a temporary file in the same directory and then
+     renamed, replacing any existing cache.
+  3. A cache which can't be written isn't an error for the caller; the XML
+     is just parsed again the next time.
+******************************************************************************/
+int write_metadata_cache
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file the
+                                                metadata was parsed from */
+    Espa_internal_meta_t *metadata    /* I: metadata parsed from the XML */
+)
+{
+    int i;                            /* looping variable */
+    int fd;                           /* temporary file descriptor */
+    bool ok;                          /* was the cache written */
+    ssize_t nwritten;                 /* number of bytes written */
+    size_t total;                     /* total number of bytes written */
+    char cachefile[STR_SIZE];         /* cache filename */
+    char tmpfile[STR_SIZE];           /* temporary cache filename */
+    struct stat file_stat;            /* XML file status */
+    Cache_header_t header;            /* cache header */
+    Cache_buffer_t buf;               /* serialized metadata */
+
+    if (get_cache_filename (metafile, cachefile, sizeof (cachefile))
+        != SUCCESS
+        || snprintf (tmpfile, sizeof (tmpfile), "%s.XXXXXX", cachefile)
+        >= (int) sizeof (tmpfile))
+        return (ERROR);
+
+    /* Serialize the metadata, with the header at the start of the buffer */
+    buf.data = NULL;
+    buf.size = 0;
+    buf.alloc = 0;
+    buf.error = false;
+
+    memset (&header, 0, sizeof (header));
+    put_value (&buf, header);
+    put_string (&buf, metadata->meta_namespace);
+    put_global_metadata (&buf, &metadata->global);
+    put_value (&buf, metadata->nbands);
+    for (i = 0; i < metadata->nbands; i++)
+        put_band_metadata (&buf, &metadata->band[i]);
+    if (buf.error)
+    {
+        free (buf.data);
+        return (ERROR);
+    }
+
+    memcpy (header.magic, ESPA_METADATA_CACHE_MAGIC,
+        ESPA_METADATA_CACHE_MAGIC_SIZE);
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.validated_schema = 0;
+    strncpy (header.schema_version, ESPA_SCHEMA_VERSION,
+        sizeof (header.schema_version) - 1);
+    header.key = *key;
+    header.data_size = buf.size - sizeof (header);
+    header.data_hash = hash_bytes (FNV_OFFSET_BASIS,
+        buf.data + sizeof (header), header.data_size);
+    memcpy (buf.data, &header, sizeof (header));
+
+    /* Write the temporary file */
+    fd = mkstemp (tmpfile);
+    if (fd < 0)
+    {
+        free (buf.data);
+        return (ERROR);
+    }
+
+    total = 0;
+    while (total < buf.size)
+    {
+        nwritten = write (fd, buf.data + total, buf.size - total);
+        if (nwritten < 0 && errno == EINTR)
+            continue;
+        if (nwritten <= 0)
+            break;
+        total += nwritten;
+    }
+    free (buf.data);
+
+    /* mkstemp creates the file readable only by the owner, but the other
+       tools in the chain may run as other users */
+    ok = (total == buf.size && fchmod (fd, 0644) == 0);
+    if (close (fd) != 0)
+        ok = false;
+
+    /* Don't install a cache for XML which changed while it was parsed */
+    if (ok)
+    {
+        ok = (stat (metafile, &file_stat) == 0
+            && file_stat.st_size == key->size
+            && file_stat.st_mtim.tv_sec == key->mtime
+            && file_stat.st_mtim.tv_nsec == key->mtime_nsec);
+    }
+
+    if (!ok || rename (tmpfile, cachefile) != 0)
+    {
+        unlink (tmpfile);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  get_metadata_cache_schema_key
+
+PURPOSE: Gets the identity of the schema file/URL the XML is validated
+against, which keys the validated flag in the cache.
+
+RETURN VALUE:
+Type = uint64_t
+Value           Description
+-----           -----------
+key             Hash of the schema name, size, and modification time
+
+NOTES:
+  1. The size and modification time are only available for a local schema
+     file.  A URL is identified by its name alone, since the ESPA schemas
+     are published under versioned names.
+******************************************************************************/
+uint64_t get_metadata_cache_schema_key
+(
+    const char *schema_file           /* I: schema filename or URL */
+)
+{
+    uint64_t key;                     /* schema identity */
+    int64_t value;                    /* schema size or modification time */
+    struct stat file_stat;            /* schema file status */
+
+    key = hash_bytes (FNV_OFFSET_BASIS, (const unsigned char *) schema_file,
+        strlen (schema_file));
+
+    if (stat (schema_file, &file_stat) == 0)
+    {
+        value = file_stat.st_size;
+        key = hash_bytes (key, (const unsigned char *) &value, sizeof (value));
+        value = file_stat.st_mtim.tv_sec;
+        key = hash_bytes (key, (const unsigned char *) &value, sizeof (value));
+        value = file_stat.st_mtim.tv_nsec;
+        key = hash_bytes (key, (const unsigned char *) &value, sizeof (value));
+    }
+
+    return (key);
+}
+
+
+/******************************************************************************
+MODULE:  metadata_cache_validated
+
+PURPOSE: Determines if there is a current cache for an XML metadata file
+which records that the XML has been validated against the given schema.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The XML has already been validated
+false           The XML needs to be validated
+
+NOTES:
+******************************************************************************/
+bool metadata_cache_validated
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file */
+    uint64_t schema_key               /* I: identity of the schema, from
+                                            get_metadata_cache_schema_key */
+)
+{
+    int fd;                           /* cache file descriptor */
+    Cache_header_t header;            /* cache header */
+
+    fd = read_cache_header (metafile, key, O_RDONLY, &header);
+    if (fd < 0)
+        return (false);
+    close (fd);
+
+    return (schema_key != 0 && header.validated_schema == schema_key);
+}
+
+
+/******************************************************************************
+MODULE:  mark_metadata_cache_validated
+
+PURPOSE: Records in the cache for an XML metadata file that the XML has been
+validated against the given schema.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           There is no current cache or it couldn't be updated
+SUCCESS         Successful completion
+
+NOTES:
+  1. Only the validated schema in the header is rewritten.  The key ties it
+     to the exact contents of the XML file that was validated, and the
+     schema key to the exact schema file.
+******************************************************************************/
+int mark_metadata_cache_validated
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file */
+    uint64_t schema_key               /* I: identity of the schema the XML
+                                            was validated against */
+)
+{
+    int fd;                           /* cache file descriptor */
+    Cache_header_t header;            /* cache header */
+
+    fd = read_cache_header (metafile, key, O_RDWR, &header);
+    if (fd < 0)
+        return (ERROR);
+
+    if (pwrite (fd, &schema_key, sizeof (schema_key),
+        offsetof (Cache_header_t, validated_schema)) != sizeof (schema_key))
+    {
+        close (fd);
+        return (ERROR);
+    }
+
+    if (close (fd) != 0)
+        return (ERROR);
+
+    return (SUCCESS);
+}
@@ -0,0 +1,108 @@
+/*****************************************************************************
+FILE: espa_metadata_cache.h
+
+PURPOSE: Contains defines, structures, and prototypes for the binary sidecar
+cache of the ESPA internal metadata.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The cache is a compact binary copy of the Espa_internal_meta_t parsed
+     from an XML metadata file, written next to the XML file with
+     ESPA_METADATA_CACHE_EXTENSION appended to its name.  A processing chain
+     running several ESPA tools on the same scene then parses the XML only
+     once.
+  2. The cache is only used when the ESPA_METADATA_CACHE environment variable
+     is set to something other than 0, no, or false.
+  3. A cache is only used for the XML file it was written from.  It is keyed
+     by the size, modification time, and a hash of the contents of the XML
+     file, along with the cache format version and the ESPA schema version.
+     A cache which doesn't match is ignored and the XML is parsed instead.
+     The record that the XML was validated is in turn keyed by the schema
+     it was validated against, so switching or editing the schema means the
+     XML is validated again.
+  4. The cache is written in the native byte order and is meant to be read
+     on the system which wrote it.  A cache from a system with a different
+     byte order is ignored.
+*****************************************************************************/
+
+#ifndef ESPA_METADATA_CACHE_H
+#define ESPA_METADATA_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "error_handler.h"
+#include "espa_metadata.h"
+
+/* Extension appended to the XML filename to get the cache filename */
+#define ESPA_METADATA_CACHE_EXTENSION ".mdcache"
+
+/* Environment variable which enables the cache */
+#define ESPA_METADATA_CACHE_ENV "ESPA_METADATA_CACHE"
+
+/* Identifies (and versions) the cache file format; change the version
+   whenever the format or Espa_internal_meta_t changes */
+#define ESPA_METADATA_CACHE_MAGIC "ESPAMDC2"
+#define ESPA_METADATA_CACHE_MAGIC_SIZE 8
+
+/* Identity of the XML file a cache belongs to */
+typedef struct
+{
+    int64_t size;           /* size of the XML file in bytes */
+    int64_t mtime;          /* modification time of the XML file (seconds) */
+    int64_t mtime_nsec;     /* nanoseconds part of the modification time */
+    uint64_t hash;          /* hash of the contents of the XML file */
+} Espa_metadata_cache_key_t;
+
+/* Prototypes */
+bool metadata_cache_enabled (void);
+
+int get_metadata_cache_key
+(
+    char *metafile,                   /* I: XML metadata filename */
+    Espa_metadata_cache_key_t *key    /* O: identity of the XML file */
+);
+
+int read_metadata_cache
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file,
+                                                from get_metadata_cache_key */
+    Espa_internal_meta_t *metadata    /* I/O: metadata structure which has
+                                              been initialized via
+                                              init_metadata_struct */
+);
+
+int write_metadata_cache
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file the
+                                                metadata was parsed from */
+    Espa_internal_meta_t *metadata    /* I: metadata parsed from the XML */
+);
+
+uint64_t get_metadata_cache_schema_key
+(
+    const char *schema_file           /* I: schema filename or URL */
+);
+
+bool metadata_cache_validated
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file */
+    uint64_t schema_key               /* I: identity of the schema, from
+                                            get_metadata_cache_schema_key */
+);
+
+int mark_metadata_cache_validated
+(
+    char *metafile,                   /* I: XML metadata filename */
+    const Espa_metadata_cache_key_t *key,  /* I: identity of the XML file */
+    uint64_t schema_key               /* I: identity of the schema the XML
+                                            was validated against */
+);
+
+#endif
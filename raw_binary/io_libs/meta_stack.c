@@ -29,6 +29,10 @@ SUCCESS         Memory was allocated and stack initialized successfully
 NOTES:
   1. Uses the MAX_STACK_SIZE variable in meta_stack.h to specify the size
      of the stack of strings.
+  2. Only the array of string pointers is allocated here.  The strings
+     themselves are allocated by push as the stack grows, and sized to the
+     element names, since the stack depth in practice is only the nesting
+     depth of the XML.
 ******************************************************************************/
 int init_stack
 (
@@ -39,9 +43,8 @@ int init_stack
 {
     char FUNC_NAME[] = "init_stack";   /* function name */
     char errmsg[STR_SIZE];             /* error message */
-    int i;                             /* looping variable */
 
-    /* Allocate memory to hold MAX_STACK_SIZE strings */
+    /* Allocate memory to hold MAX_STACK_SIZE string pointers */
     *stack = calloc (MAX_STACK_SIZE, sizeof (char *));
     if (*stack == NULL)
     {
@@ -51,18 +54,6 @@ int init_stack
         return (ERROR);
     }
 
-    /* Allocate memory for each of the strings in the array */
-    for (i = 0; i < MAX_STACK_SIZE; i++)
-    {
-        (*stack)[i] = calloc (STR_SIZE, sizeof (char));
-        if ((*stack)[i] == NULL)
-        {
-            sprintf (errmsg, "Allocating individual strings in the stack.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-    }
-
     /* Initialize the top of the stack such that it is empty */
     *top_of_stack = -1;
 
@@ -91,7 +82,11 @@ void free_stack
     int i;                             /* looping variable */
 
 
-    /* Free memory for each of the strings in the array */
+    if (*stack == NULL)
+        return;
+
+    /* Free memory for each of the strings in the array; strings which were
+       never pushed are NULL */
     for (i = 0; i < MAX_STACK_SIZE; i++)
         free ((*stack)[i]);
 
@@ -124,8 +119,9 @@ int push
 {
     char FUNC_NAME[] = "push";   /* function name */
     char errmsg[STR_SIZE];       /* error message */
-    int count;                   /* number of chars copied in snprintf */
     int stack_top;               /* value for the top of the stack */
+    size_t len;                  /* length of the string to push */
+    char *strptr = NULL;         /* resized string for this stack entry */
 
     /* Capture the stack top */
     stack_top = *top_of_stack;
@@ -141,14 +137,27 @@ int push
     else
     {
         stack_top++;
-        count = snprintf (stack[stack_top], STR_SIZE, "%s", strval);
-        if (count < 0 || count >= STR_SIZE)
+        len = strlen (strval);
+        if (len >= STR_SIZE)
         {
             sprintf (errmsg, "Overflow of current stack string at top %d",
                 stack_top);
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
+
+        /* Size the entry to the string; realloc reuses the entry already
+           allocated at this depth when it can */
+        strptr = realloc (stack[stack_top], len + 1);
+        if (strptr == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Allocating the stack string "
+                "at top %d", stack_top);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        memcpy (strptr, strval, len + 1);
+        stack[stack_top] = strptr;
     }
 
     /* Update the stack top */
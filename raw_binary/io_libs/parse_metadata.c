@@ -17,6 +17,8 @@ NOTES:
 *****************************************************************************/
 
 #include "espa_metadata.h"
+#include "parse_metadata.h"
+#include "espa_metadata_cache.h"
 
 /******************************************************************************
 MODULE:  add_global_metadata_proj_info_albers
@@ -2082,6 +2084,80 @@ int add_band_metadata
 }
 
 
+/******************************************************************************
+MODULE:  init_parse_context
+
+PURPOSE: Initialize the parser context.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error initializing the context
+SUCCESS         Successfully initialized the context
+
+NOTES:
+1. free_parse_context releases the memory allocated for the context.
+******************************************************************************/
+int init_parse_context
+(
+    Espa_parse_context_t *context     /* O: parser context to initialize */
+)
+{
+    /* The element stack is only needed by parse_xml_into_struct, which
+       allocates it on first use */
+    context->stack = NULL;
+    reset_parse_context (context);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  reset_parse_context
+
+PURPOSE: Reset the parser context to the start of a new XML file.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+1. The element stack is emptied but kept, so it can be reused.
+******************************************************************************/
+void reset_parse_context
+(
+    Espa_parse_context_t *context     /* I/O: parser context to reset */
+)
+{
+    context->nbands = 0;
+    context->global_metadata = false;
+    context->bands_metadata = false;
+    context->cur_band = 0;
+    context->top_of_stack = 0;
+}
+
+
+/******************************************************************************
+MODULE:  free_parse_context
+
+PURPOSE: Free the memory allocated for the parser context.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void free_parse_context
+(
+    Espa_parse_context_t *context     /* I/O: parser context to free */
+)
+{
+    if (context->stack != NULL)
+        free_stack (&context->stack);
+    context->stack = NULL;
+}
+
+
 /******************************************************************************
 MODULE:  parse_xml_into_struct
 
@@ -2095,16 +2171,19 @@ ERROR           Error parsing the metadata elements
 SUCCESS         Successful parse of the metadata values
 
 NOTES:
-1. Uses a stack of character strings to keep track of the nodes that have
-   been parsed.  The stack must be allocated before calling this routine.
+1. Uses the stack of character strings in the parser context to keep track
+   of the nodes that have been parsed.  The context must be initialized via
+   init_parse_context before calling this routine; the stack is allocated
+   the first time it is needed.
+2. All of the parsing state is kept in the context, so different threads can
+   parse different files at the same time using their own contexts.
 ******************************************************************************/
 int parse_xml_into_struct
 (
     xmlNode *a_node,                  /* I: pointer to the current node */
     Espa_internal_meta_t *metadata,   /* I: ESPA internal metadata structure
                                             to be filled */
-    int *top_of_stack,                /* I: pointer to top of the stack */
-    char **stack                      /* I: stack to use for parsing */
+    Espa_parse_context_t *context     /* I/O: parser context */
 )
 {
     char FUNC_NAME[] = "parse_xml_into_struct";  /* function name */
@@ -2112,16 +2191,18 @@ int parse_xml_into_struct
     char *curr_stack_element = NULL;  /* element popped from the stack */
     xmlNode *cur_node = NULL;    /* pointer to the current node */
     xmlNode *sib_node = NULL;    /* pointer to the sibling node */
-    static int nbands = 0;       /* number of bands in the XML structure */
-    static bool global_metadata = false;  /* are we parsing the global metadata
-                                    section of the ESPA metadata? */
-    static bool bands_metadata = false;   /* are we parsing the bands metadata
-                                    section of the ESPA metadata? */
-    static int cur_band = 0;     /* current band being processed in the
-                                    bands metadata section */
     bool skip_child;             /* boolean to specify the children of this
                                     node should not be processed */
 
+    /* Allocate the element stack if this context hasn't used it yet */
+    if (context->stack == NULL &&
+        init_stack (&context->top_of_stack, &context->stack))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Initializing the stack.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
     /* Start at the input node and traverse the tree, visiting all the children
        and siblings */
     for (cur_node = a_node; cur_node;
@@ -2136,7 +2217,8 @@ int parse_xml_into_struct
             /* Push the element to the stack and turn the booleans on if this
                is either the global_metadata or the bands elements */
             //printf ("***Pushed %s\n", cur_node->name); fflush (stdout);
-            if (push (top_of_stack, stack, (const char *) cur_node->name))
+            if (push (&context->top_of_stack, context->stack,
+                (const char *) cur_node->name))
             {
                 sprintf (errmsg, "Pushing element '%s' to the stack.",
                     cur_node->name);
@@ -2150,7 +2232,7 @@ int parse_xml_into_struct
             if (xmlStrEqual (cur_node->name,
                 (const xmlChar *) "global_metadata"))
             {
-                if (global_metadata)
+                if (context->global_metadata)
                 {
                     sprintf (errmsg, "Current element node is '%s' however we "
                         "are already in the global_metadata section.",
@@ -2158,7 +2240,7 @@ int parse_xml_into_struct
                     error_handler (true, FUNC_NAME, errmsg);
                     return (ERROR);
                 }
-                global_metadata = true;
+                context->global_metadata = true;
             }
 
             /* Turn the boolean on if this is the bands metadata. Flag an
@@ -2167,27 +2249,29 @@ int parse_xml_into_struct
                allocate memory for the nbands. */
             if (xmlStrEqual (cur_node->name, (const xmlChar *) "bands"))
             {
-                if (bands_metadata)
+                if (context->bands_metadata)
                 {
                     sprintf (errmsg, "Current element node is '%s' however we "
                         "are already in the bands section.", cur_node->name);
                     error_handler (true, FUNC_NAME, errmsg);
                     return (ERROR);
                 }
-                bands_metadata = true;
-                cur_band = 0;  /* reset to zero for start of band count */
+                context->bands_metadata = true;
+                context->cur_band = 0;  /* reset to zero for start of band
+                                           count */
 
                 /* Count the number of siblings which are band elements */
-                nbands = 0;
+                context->nbands = 0;
                 for (sib_node = cur_node->children; sib_node;
                      sib_node = xmlNextElementSibling (sib_node))
                 {
                     /* If this is a band element then count it */
                     if (xmlStrEqual (sib_node->name, (const xmlChar *) "band"))
-                        nbands++;
+                        context->nbands++;
                 }
 
-                if (allocate_band_metadata (metadata, nbands) != SUCCESS)
+                if (allocate_band_metadata (metadata, context->nbands)
+                    != SUCCESS)
                 {   /* Error messages already printed */
                     return (ERROR);
                 }
@@ -2209,7 +2293,7 @@ int parse_xml_into_struct
             /* If we are IN the global metadata (don't process the actual
                global_metadata element) then consume this node and add the
                information to the global metadata structure */
-            if (global_metadata && !xmlStrEqual (cur_node->name,
+            if (context->global_metadata && !xmlStrEqual (cur_node->name,
                 (const xmlChar *) "global_metadata"))
             {
                 if (add_global_metadata (cur_node, &metadata->global))
@@ -2228,19 +2312,20 @@ int parse_xml_into_struct
             /* If we are IN the bands metadata and at a band element, then
                consume this node and add the information to the band metadata
                structure for the current band */
-            if (bands_metadata && xmlStrEqual (cur_node->name,
+            if (context->bands_metadata && xmlStrEqual (cur_node->name,
                 (const xmlChar *) "band"))
             {
-                if (cur_band >= nbands)
+                if (context->cur_band >= context->nbands)
                 {
                     sprintf (errmsg, "Number of bands consumed already "
                         "reached the total number of bands allocated for this "
-                        "XML file (%d).", nbands);
+                        "XML file (%d).", context->nbands);
                     error_handler (true, FUNC_NAME, errmsg);
                     return (ERROR);
                 }
 
-                if (add_band_metadata (cur_node, &metadata->band[cur_band++]))
+                if (add_band_metadata (cur_node,
+                    &metadata->band[context->cur_band++]))
                 {
                     sprintf (errmsg, "Consuming band metadata element '%s'.",
                         cur_node->name);
@@ -2264,7 +2349,7 @@ int parse_xml_into_struct
         if (!skip_child)
         {
             if (parse_xml_into_struct (cur_node->children, metadata,
-                top_of_stack, stack))
+                context))
             {
                 sprintf (errmsg, "Parsing the children of this element '%s'.",
                     cur_node->name);
@@ -2277,7 +2362,8 @@ int parse_xml_into_struct
            the stack */
         if (cur_node->type == XML_ELEMENT_NODE)
         {
-            curr_stack_element = pop (top_of_stack, stack);
+            curr_stack_element = pop (&context->top_of_stack,
+                context->stack);
             if (curr_stack_element == NULL)
             {
                 sprintf (errmsg, "Popping elements off the stack.");
@@ -2287,9 +2373,9 @@ int parse_xml_into_struct
             //printf ("***Popped %s\n", curr_stack_element); fflush (stdout);
 
             if (!strcmp (curr_stack_element, "global_metadata"))
-                global_metadata = false;
+                context->global_metadata = false;
             if (!strcmp (curr_stack_element, "bands"))
-                bands_metadata = false;
+                context->bands_metadata = false;
         }
     }  /* for cur_node */
 
@@ -2297,6 +2383,87 @@ int parse_xml_into_struct
 }
 
 
+/******************************************************************************
+MODULE:  init_load_options
+
+PURPOSE: Initialize the load options to load all of the metadata.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void init_load_options
+(
+    Espa_load_options_t *options    /* O: load options to initialize */
+)
+{
+    options->global_only = false;
+    options->nband_names = 0;
+    options->band_names = NULL;
+    options->skip_qa_descriptions = false;
+}
+
+
+/******************************************************************************
+MODULE:  parse_metadata_r
+
+PURPOSE: Parse the input metadata file and populate the associated ESPA
+internal metadata file, using the caller's parser context.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error parsing the metadata elements
+SUCCESS         Successful parse of the metadata values
+
+NOTES:
+1. The file is parsed in a single pass by parse_metadata_stream, which fills
+   the metadata structure straight from the XML reader without building a
+   document tree.  parse_xml_into_struct and the add_* routines are kept for
+   existing callers.
+2. This routine is reentrant.  Threads can parse metadata files at the same
+   time as long as each one uses its own context and metadata structure.
+   Multi-threaded callers should call xmlInitParser once from the main thread
+   before starting the threads, as libxml2 requires, and should not call
+   xmlCleanupParser until all the threads are done.
+3. When the metadata cache is enabled (see espa_metadata_cache.h), the
+   metadata is loaded from the cache next to the XML file if it is current.
+   Otherwise the XML is parsed and the cache is written for the next tool.
+******************************************************************************/
+int parse_metadata_r
+(
+    char *metafile,                 /* I: input metadata file or URL */
+    Espa_internal_meta_t *metadata, /* I: input metadata structure which has
+                                          been initialized via
+                                          init_metadata_struct */
+    Espa_parse_context_t *context   /* I/O: parser context, initialized via
+                                            init_parse_context */
+)
+{
+    int status;                     /* return status */
+    bool use_cache;                 /* is the metadata cache being used */
+    Espa_metadata_cache_key_t key;  /* identity of the XML file for the
+                                       cache */
+
+    /* Use the cache if it's enabled and is current for this XML file */
+    use_cache = metadata_cache_enabled ()
+        && get_metadata_cache_key (metafile, &key) == SUCCESS;
+    if (use_cache && read_metadata_cache (metafile, &key, metadata) == SUCCESS)
+        return (SUCCESS);
+
+    status = parse_metadata_stream (metafile, metadata, NULL, context);
+
+    /* Failing to write the cache isn't an error; the XML will just be
+       parsed again next time */
+    if (status == SUCCESS && use_cache)
+        write_metadata_cache (metafile, &key, metadata);
+
+    return (status);
+}
+
+
 /******************************************************************************
 MODULE:  parse_metadata
 
@@ -2311,11 +2478,10 @@ ERROR           Error parsing the metadata elements
 SUCCESS         Successful parse of the metadata values
 
 NOTES:
-1. Uses a stack of character strings to keep track of the nodes that have beend
-   found in the metadata document.
-2. For debugging purposes
-   xmlDocDump (stderr, doc);
-   can be used to dump/print the XML doc to the screen.
+1. Uses a parser context for just this call.  Use parse_metadata_r to reuse a
+   context across files or to parse files from several threads.
+2. Like validate_xml_file, this no longer calls xmlCleanupParser, which would
+   tear down libxml2 under any other thread using it.
 ******************************************************************************/
 int parse_metadata
 (
@@ -2325,222 +2491,60 @@ int parse_metadata
                                           init_metadata_struct */
 )
 {
-    char FUNC_NAME[] = "parse_metadata";  /* function name */
-    char errmsg[STR_SIZE];        /* error message */
-    xmlTextReaderPtr reader;  /* reader for the XML file */
-    xmlDocPtr doc = NULL;     /* document tree pointer */
-    xmlNodePtr current=NULL;  /* pointer to the current node */
-    int status;               /* return status */
-    int nodeType;             /* node type (element, text, attribute, etc.) */
-    int top_of_stack;         /* top of the stack */
-    int count;                /* number of chars copied in snprintf */
-    char **stack = NULL;      /* stack to keep track of elements in the tree */
-
-    /* Establish the reader for this metadata file */
-    reader = xmlNewTextReaderFilename (metafile);
-    if (reader == NULL)
-    {
-        sprintf (errmsg, "Setting up reader for %s", metafile);
-        error_handler (true, FUNC_NAME, errmsg);
+    Espa_parse_context_t context;   /* parser context for this file */
+    int status;                     /* return status */
+
+    if (init_parse_context (&context) != SUCCESS)
+    {   /* Error messages already printed */
         return (ERROR);
     }
 
-    /* Use the reader to parse the XML file, looking at each of the nodes,
-       until the entire file has been parsed.  Start by reading the first
-       node in the file. */
-    status = xmlTextReaderRead (reader);
-    while (status == 1)
-    {
-        /* Determine what kind of node the reader is at (element, end element,
-           attribute, text/white space) and handle the information as desired */
-        nodeType = xmlTextReaderNodeType (reader);
-        if (nodeType == -1)
-        {
-            sprintf (errmsg, "Getting node type");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-        switch (nodeType)
-        {
-            case XML_READER_TYPE_ELEMENT:
-            {  /* Node is an element (ex. <global_metadata> */
-                xmlNodePtr node=NULL;
-                if (doc==NULL)
-                {
-                    doc=xmlNewDoc (BAD_CAST "1.0");
-                }
+    status = parse_metadata_r (metafile, metadata, &context);
+    free_parse_context (&context);
 
-                /* Get the URI defining the namespace for this node */
-                if (xmlTextReaderConstNamespaceUri (reader) != NULL)
-                {
-                    /* Search the namespace for a document */
-                    xmlNsPtr ns = xmlSearchNs (doc, current,
-                        xmlTextReaderConstNamespaceUri(reader));
+    return (status);
+}
 
-                    /* Create a tree node for this element in the XML file
-                       using the element name */
-                    node = xmlNewNode (ns, xmlTextReaderConstName(reader));
 
-                    /* If the namespace is empty (i.e. root) then create a
-                       new namespace pointer with this node */
-                    if (ns == NULL)
-                    {
-                        ns = xmlNewNs (node,
-                            xmlTextReaderConstNamespaceUri(reader),
-                            xmlTextReaderConstPrefix(reader));
-                    }
-                }
-                else
-                {
-                    /* Create a tree node for this element in the XML file
-                       using the element name */
-                    node = xmlNewNode (0, xmlTextReaderConstName(reader));
-                }
+/******************************************************************************
+MODULE:  parse_metadata_options
 
-                /* Set the element as the root if appropriate otherwise add
-                   it as a child to the previous element */
-                if (current == NULL)
-                {
-                    xmlDocSetRootElement (doc, node);
-                }
-                else
-                {
-                    xmlAddChild (current, node);
-                }
-                current = node;
+PURPOSE: Parse the parts of the input metadata file requested by the load
+options and populate the associated ESPA internal metadata file.
 
-                /* If the element has attributes, then handle them */
-                if (xmlTextReaderHasAttributes (reader))
-                {
-                    /* Get the number of attributes and then process each one */
-                    int i;
-                    int n_att = xmlTextReaderAttributeCount (reader);
-                    for (i = 0; i < n_att; i++)
-                    {
-                        /* Read each attribute, obtain the name and value,
-                           then add it as a property for this node in the
-                           tree */
-                        const xmlChar *k = NULL;
-                        xmlChar *v = NULL;
-                        xmlTextReaderMoveToAttributeNo (reader, i);
-                        k = xmlTextReaderConstName (reader);
-                        v = xmlTextReaderValue (reader);
-                        if (xmlTextReaderConstNamespaceUri (reader) != NULL)
-                        {
-                            if (!xmlStrEqual (
-                                xmlTextReaderConstNamespaceUri(reader),
-                                BAD_CAST "http://www.w3.org/2000/xmlns/"))
-                            {
-                                /* Search the namespace for the document */
-                                xmlNsPtr ns = xmlSearchNs (doc, current,
-                                    xmlTextReaderConstNamespaceUri(reader));
-                                if (ns == NULL)
-                                {
-                                    ns = xmlNewNs (node,
-                                        xmlTextReaderConstNamespaceUri(reader),
-                                        xmlTextReaderConstPrefix(reader));
-                                }
-
-                                /* Create a new property tagged with this
-                                   namespace and carried by this node */
-                                xmlNewNsProp (current, ns,
-                                    xmlTextReaderConstLocalName(reader), v);
-                            }
-                         }
-                         else
-                         {
-                            /* Add the attribute as a property of the node
-                               in the tree */
-                            xmlNewProp (current, k, v);
-                         }
-
-                         /* Free the XML value pointer */
-                         xmlFree (v);
-                    }
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error parsing the metadata elements
+SUCCESS         Successful parse of the metadata values
 
-                    /* We are done with the attributes so go to the current
-                       attribute node */
-                    xmlTextReaderMoveToElement (reader);
-                }
+NOTES:
+1. Bands which aren't loaded don't appear in the band array at all, so nbands
+   is the number of bands loaded.  Callers asking for named bands need to
+   check that they were found.
+2. Parsing stops once everything requested has been loaded, so the rest of
+   the file isn't read.  Use validate_xml_file to check the whole file.
+******************************************************************************/
+int parse_metadata_options
+(
+    char *metafile,                 /* I: input metadata file or URL */
+    Espa_internal_meta_t *metadata, /* I: input metadata structure which has
+                                          been initialized via
+                                          init_metadata_struct */
+    const Espa_load_options_t *options  /* I: parts of the metadata to load */
+)
+{
+    Espa_parse_context_t context;   /* parser context for this file */
+    int status;                     /* return status */
 
-                /* If this is an empty element, then return to the parent */
-                if (xmlTextReaderIsEmptyElement(reader))
-                    current = current->parent;
-                break;
-            }  /* End: Node is an element */
-
-            case XML_READER_TYPE_END_ELEMENT:
-            {  /* Node is an end element (ex. </global_metadata>, so return
-                  to the parent */
-                current = current->parent;
-                break;
-            }
-
-            case XML_READER_TYPE_TEXT:
-            {  /* Node is text or white space */
-                /* Read the value of the text and add it as text for the
-                   node, which is then added as a child to the tree */
-                const xmlChar *v = xmlTextReaderConstValue (reader);
-                xmlNodePtr node = xmlNewDocText (doc, v);
-                xmlAddChild (current, node);
-                break;
-            }
-        }  /* end switch */
-
-        /* Read the next node */
-        status = xmlTextReaderRead (reader);
-    }  /* end while */
-    if (status != 0)
-    {
-        sprintf (errmsg, "Failed to parse %s", metafile);
-        error_handler (true, FUNC_NAME, errmsg);
+    if (init_parse_context (&context) != SUCCESS)
+    {   /* Error messages already printed */
         return (ERROR);
     }
 
-    /* If the document tree is not NULL then send in the root node of the
-       tree to be parsed and read into the ESPA metadata structure */
-    if (doc != NULL)
-    {
-        /* Store the namespace for the overall metadata file */
-        xmlNsPtr ns = xmlDocGetRootElement(doc)->nsDef;
-        count = snprintf (metadata->meta_namespace,
-            sizeof (metadata->meta_namespace), "%s", (const char *) ns->href);
-        if (count < 0 || count >= sizeof (metadata->meta_namespace))
-        {
-            sprintf (errmsg, "Overflow of metadata->meta_namespace string");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Initialize the stack to hold the elements */
-        if (init_stack (&top_of_stack, &stack))
-        {
-            sprintf (errmsg, "Initializing the stack.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-        //print_element_names (xmlDocGetRootElement (doc));
-
-        /* Parse the XML document into our ESPA internal metadata structure */
-        if (parse_xml_into_struct (xmlDocGetRootElement(doc), metadata,
-            &top_of_stack, stack))
-        {
-            sprintf (errmsg, "Parsing the metadata file into the internal "
-                "metadata structure.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Clean up the XML document and the stack */
-        xmlFreeDoc (doc);
-        free_stack (&stack);
-    }
-
-    /* Free the reader and associated memory */
-    xmlFreeTextReader (reader);
-    xmlCleanupParser();
-    xmlMemoryDump();
+    status = parse_metadata_stream (metafile, metadata, options, &context);
+    free_parse_context (&context);
 
-    return (SUCCESS);
+    return (status);
 }
-
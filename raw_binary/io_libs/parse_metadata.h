@@ -24,6 +24,34 @@ NOTES:
 #include "error_handler.h"
 #include "espa_metadata.h"
 
+/* Parsing state for one XML metadata file.  Each thread parsing metadata
+   needs its own context; a context can be reused for any number of files. */
+typedef struct
+{
+    int nbands;             /* number of bands in the XML structure */
+    bool global_metadata;   /* are we parsing the global metadata section of
+                               the ESPA metadata? */
+    bool bands_metadata;    /* are we parsing the bands metadata section of
+                               the ESPA metadata? */
+    int cur_band;           /* current band being processed in the bands
+                               metadata section */
+    int top_of_stack;       /* top of the element stack */
+    char **stack;           /* stack of the elements being parsed; only used
+                               by parse_xml_into_struct, which allocates it */
+} Espa_parse_context_t;
+
+/* Parts of the metadata file to load, for callers which only need some of
+   the metadata.  Initialize via init_load_options, which loads everything. */
+typedef struct
+{
+    bool global_only;       /* load only the global metadata, no bands */
+    int nband_names;        /* number of names in band_names; 0 loads all the
+                               bands */
+    char **band_names;      /* names (name attribute) of the bands to load */
+    bool skip_qa_descriptions;  /* skip the bitmap_description, class_values,
+                                   and percent_coverage of the bands */
+} Espa_load_options_t;
+
 int add_global_metadata_proj_info_albers
 (
     xmlNode *a_node,            /* I: pointer to the element node to process */
@@ -97,13 +125,54 @@ int add_band_metadata
                                       band in the bands structure */
 );
 
+int init_parse_context
+(
+    Espa_parse_context_t *context     /* O: parser context to initialize */
+);
+
+void reset_parse_context
+(
+    Espa_parse_context_t *context     /* I/O: parser context to reset */
+);
+
+void free_parse_context
+(
+    Espa_parse_context_t *context     /* I/O: parser context to free */
+);
+
 int parse_xml_into_struct
 (
     xmlNode *a_node,                  /* I: pointer to the current node */
     Espa_internal_meta_t *metadata,   /* I: ESPA internal metadata structure
                                             to be filled */
-    int *top_of_stack,                /* I: pointer to top of the stack */
-    char **stack                      /* I: stack to use for parsing */
+    Espa_parse_context_t *context     /* I/O: parser context */
+);
+
+void init_load_options
+(
+    Espa_load_options_t *options    /* O: load options to initialize */
+);
+
+int parse_metadata_stream
+(
+    char *metafile,                 /* I: input metadata file or URL */
+    Espa_internal_meta_t *metadata, /* I: input metadata structure which has
+                                          been initialized via
+                                          init_metadata_struct */
+    const Espa_load_options_t *options, /* I: parts of the metadata to load;
+                                              NULL loads all of it */
+    Espa_parse_context_t *context   /* I/O: parser context, initialized via
+                                            init_parse_context */
+);
+
+int parse_metadata_r
+(
+    char *metafile,                 /* I: input metadata file or URL */
+    Espa_internal_meta_t *metadata, /* I: input metadata structure which has
+                                          been initialized via
+                                          init_metadata_struct */
+    Espa_parse_context_t *context   /* I/O: parser context, initialized via
+                                            init_parse_context */
 );
 
 int parse_metadata
@@ -114,4 +183,13 @@ int parse_metadata
                                           init_metadata_struct */
 );
 
+int parse_metadata_options
+(
+    char *metafile,                 /* I: input metadata file or URL */
+    Espa_internal_meta_t *metadata, /* I: input metadata structure which has
+                                          been initialized via
+                                          init_metadata_struct */
+    const Espa_load_options_t *options  /* I: parts of the metadata to load */
+);
+
 #endif
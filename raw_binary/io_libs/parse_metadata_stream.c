@@ -0,0 +1,1853 @@
+/*****************************************************************************
+FILE: parse_metadata_stream.c
+
+PURPOSE: Contains the single-pass streaming parser for the ESPA internal
+metadata files.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The metadata structure is filled directly from the xmlTextReader events
+     as the file is read.  No document tree is built and no element stack of
+     strings is needed; the parser only tracks a token and a role for each
+     open element.
+  2. Element and attribute names are converted to tokens by a switch on the
+     first character of the name, so looking up a name costs at most a few
+     string compares instead of walking a chain of xmlStrEqual calls.
+  3. The band, bit, class, and cover arrays are grown as their elements are
+     read, since the number of elements isn't known until the end of their
+     container element.  The arrays are left at their grown size; the unused
+     entries past nbands, nbits, etc. are never touched.
+  4. The results are the same as parsing the document tree with
+     parse_xml_into_struct.
+  5. The load options allow only part of the metadata to be loaded.  Skipped
+     sections are passed over by the reader without being processed, and the
+     rest of the file isn't read at all once everything requested has been
+     loaded.
+*****************************************************************************/
+
+#include "parse_metadata.h"
+
+/* Maximum element depth tracked by the parser.  The ESPA metadata elements
+   are at most five levels deep; anything deeper than this is skipped. */
+#define STREAM_MAX_DEPTH 32
+
+/* Number of entries initially allocated for the band, bit, class, and cover
+   arrays, which are doubled as needed */
+#define STREAM_INIT_ALLOC 8
+
+/* Maximum number of characters of element text echoed in a warning */
+#define STREAM_MAX_ECHO 256
+
+/* Namespace URI of the namespace declaration attributes */
+#define XMLNS_URI "http://www.w3.org/2000/xmlns/"
+
+/* Tokens for the element and attribute names used in the ESPA metadata */
+typedef enum
+{
+    TOK_UNKNOWN = 0,
+    TOK_ACQUISITION_DATE, TOK_ADD_OFFSET, TOK_ALBERS_PROJ_PARAMS,
+    TOK_APP_VERSION, TOK_AZIMUTH,
+    TOK_BAND, TOK_BANDS, TOK_BIAS, TOK_BIT, TOK_BITMAP_DESCRIPTION,
+    TOK_BOUNDING_COORDINATES,
+    TOK_CATEGORY, TOK_CENTRAL_MERIDIAN, TOK_CLASS, TOK_CLASS_VALUES,
+    TOK_CORNER, TOK_CORNER_POINT, TOK_COVER,
+    TOK_DATA_PROVIDER, TOK_DATA_TYPE, TOK_DATA_UNITS, TOK_DATUM,
+    TOK_EARTH_SUN_DISTANCE, TOK_EAST,
+    TOK_FALSE_EASTING, TOK_FALSE_NORTHING, TOK_FILE_NAME, TOK_FILL_VALUE,
+    TOK_GAIN, TOK_GLOBAL_METADATA, TOK_GRID_ORIGIN,
+    TOK_HTILE,
+    TOK_INSTRUMENT,
+    TOK_K1, TOK_K2,
+    TOK_LATITUDE, TOK_LATITUDE_TRUE_SCALE, TOK_LEVEL1_PRODUCTION_DATE,
+    TOK_LOCATION, TOK_LONG_NAME, TOK_LONGITUDE, TOK_LONGITUDE_POLE,
+    TOK_LPGS_METADATA_FILE,
+    TOK_MAX, TOK_MIN, TOK_MODIS,
+    TOK_NAME, TOK_NLINES, TOK_NORTH, TOK_NSAMPS, TOK_NUM,
+    TOK_ORIENTATION_ANGLE, TOK_ORIGIN_LATITUDE,
+    TOK_PATH, TOK_PERCENT_COVERAGE, TOK_PIXEL_SIZE, TOK_PRODUCT,
+    TOK_PRODUCT_ID, TOK_PRODUCTION_DATE, TOK_PROJECTION,
+    TOK_PROJECTION_INFORMATION, TOK_PS_PROJ_PARAMS,
+    TOK_QA_DESCRIPTION,
+    TOK_RADIANCE, TOK_REFLECTANCE, TOK_RESAMPLE_METHOD, TOK_ROW,
+    TOK_SATELLITE, TOK_SATURATE_VALUE, TOK_SCALE_FACTOR,
+    TOK_SCENE_CENTER_TIME, TOK_SHORT_NAME, TOK_SIN_PROJ_PARAMS,
+    TOK_SOLAR_ANGLES, TOK_SOURCE, TOK_SOUTH, TOK_SPHERE_RADIUS,
+    TOK_STANDARD_PARALLEL1, TOK_STANDARD_PARALLEL2, TOK_SYSTEM,
+    TOK_THERMAL_CONST, TOK_TYPE,
+    TOK_UNITS, TOK_UTM_PROJ_PARAMS,
+    TOK_VALID_RANGE, TOK_VTILE,
+    TOK_WEST, TOK_WRS,
+    TOK_X, TOK_Y,
+    TOK_ZENITH, TOK_ZONE_CODE
+} Stream_token_t;
+
+/* Role of an open element within the ESPA metadata, which determines how
+   its children and text are handled */
+typedef enum
+{
+    ROLE_PASS,              /* element outside the metadata sections; its
+                               children are searched for the sections */
+    ROLE_GLOBAL,            /* global_metadata */
+    ROLE_GLOBAL_FIELD,      /* text-valued global metadata element */
+    ROLE_BOUNDING,          /* bounding_coordinates */
+    ROLE_BOUNDING_FIELD,    /* west, east, north, south */
+    ROLE_PROJ,              /* projection_information */
+    ROLE_PROJ_FIELD,        /* grid_origin */
+    ROLE_PROJ_PARAMS,       /* utm, ps, albers, or sin_proj_params */
+    ROLE_PROJ_PARAM_FIELD,  /* projection parameter value */
+    ROLE_BANDS,             /* bands */
+    ROLE_BAND,              /* band */
+    ROLE_BAND_FIELD,        /* text-valued band metadata element */
+    ROLE_BAND_LIST,         /* bitmap_description, class_values, or
+                               percent_coverage */
+    ROLE_BAND_LIST_ITEM,    /* bit, class, or cover */
+    ROLE_SKIP               /* element whose children are skipped */
+} Stream_role_t;
+
+/* Open element being parsed */
+typedef struct
+{
+    Stream_token_t token;   /* token for the element name */
+    Stream_role_t role;     /* role of the element in the metadata */
+    bool has_child;         /* has a child element or text node been read */
+} Stream_element_t;
+
+/* State of the streaming parser for one file */
+typedef struct
+{
+    xmlTextReaderPtr reader;          /* reader for the XML file */
+    Espa_internal_meta_t *metadata;   /* metadata structure being filled */
+    Espa_parse_context_t *context;    /* parser context */
+    const Espa_load_options_t *options;  /* parts of the metadata to load;
+                                            NULL loads all of it */
+    bool global_done;       /* has the global metadata been loaded */
+    bool done;              /* has everything requested been loaded */
+    Stream_element_t elem[STREAM_MAX_DEPTH];  /* open elements, by depth */
+    int band_alloc;         /* number of bands allocated in metadata */
+    int list_alloc;         /* number of entries allocated in the current
+                               bit, class, or cover array */
+    bool has_text;          /* was text read for the current element */
+    int text_len;           /* length of the text read; can be larger than
+                               the text buffer, which flags an overflow */
+    char text[HUGE_STR_SIZE];  /* text of the current element */
+} Stream_state_t;
+
+/* Mapping of an attribute or element value to a numeric value */
+typedef struct
+{
+    const char *name;       /* value in the XML file */
+    int value;              /* corresponding numeric value */
+} Stream_value_t;
+
+static const Stream_value_t proj_values[] =
+{
+    {"GEO", GCTP_GEO_PROJ},
+    {"UTM", GCTP_UTM_PROJ},
+    {"PS", GCTP_PS_PROJ},
+    {"ALBERS", GCTP_ALBERS_PROJ},
+    {"SIN", GCTP_SIN_PROJ},
+    {NULL, 0}
+};
+
+static const Stream_value_t datum_values[] =
+{
+    {"WGS84", ESPA_WGS84},
+    {"NAD27", ESPA_NAD27},
+    {"NAD83", ESPA_NAD83},
+    {NULL, 0}
+};
+
+static const Stream_value_t data_type_values[] =
+{
+    {"INT8", ESPA_INT8},
+    {"UINT8", ESPA_UINT8},
+    {"INT16", ESPA_INT16},
+    {"UINT16", ESPA_UINT16},
+    {"INT32", ESPA_INT32},
+    {"UINT32", ESPA_UINT32},
+    {"FLOAT32", ESPA_FLOAT32},
+    {"FLOAT64", ESPA_FLOAT64},
+    {NULL, 0}
+};
+
+static const Stream_value_t resample_values[] =
+{
+    {"cubic convolution", ESPA_CC},
+    {"nearest neighbor", ESPA_NN},
+    {"bilinear", ESPA_BI},
+    {"none", ESPA_NONE},
+    {NULL, 0}
+};
+
+
+/******************************************************************************
+MODULE:  lookup_token
+
+PURPOSE: Converts an element or attribute name to its token.
+
+RETURN VALUE:
+Type = Stream_token_t
+Value           Description
+-----           -----------
+TOK_UNKNOWN     Name isn't used in the ESPA metadata
+TOK_*           Token for the name
+
+NOTES:
+******************************************************************************/
+static Stream_token_t lookup_token
+(
+    const char *name        /* I: element or attribute name */
+)
+{
+#define MATCH(str, tok) if (!strcmp (name, str)) return (tok)
+
+    switch (name[0])
+    {
+        case 'a':
+            MATCH ("acquisition_date", TOK_ACQUISITION_DATE);
+            MATCH ("add_offset", TOK_ADD_OFFSET);
+            MATCH ("albers_proj_params", TOK_ALBERS_PROJ_PARAMS);
+            MATCH ("app_version", TOK_APP_VERSION);
+            MATCH ("azimuth", TOK_AZIMUTH);
+            break;
+        case 'b':
+            MATCH ("band", TOK_BAND);
+            MATCH ("bands", TOK_BANDS);
+            MATCH ("bias", TOK_BIAS);
+            MATCH ("bit", TOK_BIT);
+            MATCH ("bitmap_description", TOK_BITMAP_DESCRIPTION);
+            MATCH ("bounding_coordinates", TOK_BOUNDING_COORDINATES);
+            break;
+        case 'c':
+            MATCH ("category", TOK_CATEGORY);
+            MATCH ("central_meridian", TOK_CENTRAL_MERIDIAN);
+            MATCH ("class", TOK_CLASS);
+            MATCH ("class_values", TOK_CLASS_VALUES);
+            MATCH ("corner", TOK_CORNER);
+            MATCH ("corner_point", TOK_CORNER_POINT);
+            MATCH ("cover", TOK_COVER);
+            break;
+        case 'd':
+            MATCH ("data_provider", TOK_DATA_PROVIDER);
+            MATCH ("data_type", TOK_DATA_TYPE);
+            MATCH ("data_units", TOK_DATA_UNITS);
+            MATCH ("datum", TOK_DATUM);
+            break;
+        case 'e':
+            MATCH ("earth_sun_distance", TOK_EARTH_SUN_DISTANCE);
+            MATCH ("east", TOK_EAST);
+            break;
+        case 'f':
+            MATCH ("false_easting", TOK_FALSE_EASTING);
+            MATCH ("false_northing", TOK_FALSE_NORTHING);
+            MATCH ("file_name", TOK_FILE_NAME);
+            MATCH ("fill_value", TOK_FILL_VALUE);
+            break;
+        case 'g':
+            MATCH ("gain", TOK_GAIN);
+            MATCH ("global_metadata", TOK_GLOBAL_METADATA);
+            MATCH ("grid_origin", TOK_GRID_ORIGIN);
+            break;
+        case 'h':
+            MATCH ("htile", TOK_HTILE);
+            break;
+        case 'i':
+            MATCH ("instrument", TOK_INSTRUMENT);
+            break;
+        case 'k':
+            MATCH ("k1", TOK_K1);
+            MATCH ("k2", TOK_K2);
+            break;
+        case 'l':
+            MATCH ("latitude", TOK_LATITUDE);
+            MATCH ("latitude_true_scale", TOK_LATITUDE_TRUE_SCALE);
+            MATCH ("level1_production_date", TOK_LEVEL1_PRODUCTION_DATE);
+            MATCH ("location", TOK_LOCATION);
+            MATCH ("long_name", TOK_LONG_NAME);
+            MATCH ("longitude", TOK_LONGITUDE);
+            MATCH ("longitude_pole", TOK_LONGITUDE_POLE);
+            MATCH ("lpgs_metadata_file", TOK_LPGS_METADATA_FILE);
+            break;
+        case 'm':
+            MATCH ("max", TOK_MAX);
+            MATCH ("min", TOK_MIN);
+            MATCH ("modis", TOK_MODIS);
+            break;
+        case 'n':
+            MATCH ("name", TOK_NAME);
+            MATCH ("nlines", TOK_NLINES);
+            MATCH ("north", TOK_NORTH);
+            MATCH ("nsamps", TOK_NSAMPS);
+            MATCH ("num", TOK_NUM);
+            break;
+        case 'o':
+            MATCH ("orientation_angle", TOK_ORIENTATION_ANGLE);
+            MATCH ("origin_latitude", TOK_ORIGIN_LATITUDE);
+            break;
+        case 'p':
+            MATCH ("path", TOK_PATH);
+            MATCH ("percent_coverage", TOK_PERCENT_COVERAGE);
+            MATCH ("pixel_size", TOK_PIXEL_SIZE);
+            MATCH ("product", TOK_PRODUCT);
+            MATCH ("product_id", TOK_PRODUCT_ID);
+            MATCH ("production_date", TOK_PRODUCTION_DATE);
+            MATCH ("projection", TOK_PROJECTION);
+            MATCH ("projection_information", TOK_PROJECTION_INFORMATION);
+            MATCH ("ps_proj_params", TOK_PS_PROJ_PARAMS);
+            break;
+        case 'q':
+            MATCH ("qa_description", TOK_QA_DESCRIPTION);
+            break;
+        case 'r':
+            MATCH ("radiance", TOK_RADIANCE);
+            MATCH ("reflectance", TOK_REFLECTANCE);
+            MATCH ("resample_method", TOK_RESAMPLE_METHOD);
+            MATCH ("row", TOK_ROW);
+            break;
+        case 's':
+            MATCH ("satellite", TOK_SATELLITE);
+            MATCH ("saturate_value", TOK_SATURATE_VALUE);
+            MATCH ("scale_factor", TOK_SCALE_FACTOR);
+            MATCH ("scene_center_time", TOK_SCENE_CENTER_TIME);
+            MATCH ("short_name", TOK_SHORT_NAME);
+            MATCH ("sin_proj_params", TOK_SIN_PROJ_PARAMS);
+            MATCH ("solar_angles", TOK_SOLAR_ANGLES);
+            MATCH ("source", TOK_SOURCE);
+            MATCH ("south", TOK_SOUTH);
+            MATCH ("sphere_radius", TOK_SPHERE_RADIUS);
+            MATCH ("standard_parallel1", TOK_STANDARD_PARALLEL1);
+            MATCH ("standard_parallel2", TOK_STANDARD_PARALLEL2);
+            MATCH ("system", TOK_SYSTEM);
+            break;
+        case 't':
+            MATCH ("thermal_const", TOK_THERMAL_CONST);
+            MATCH ("type", TOK_TYPE);
+            break;
+        case 'u':
+            MATCH ("units", TOK_UNITS);
+            MATCH ("utm_proj_params", TOK_UTM_PROJ_PARAMS);
+            break;
+        case 'v':
+            MATCH ("valid_range", TOK_VALID_RANGE);
+            MATCH ("vtile", TOK_VTILE);
+            break;
+        case 'w':
+            MATCH ("west", TOK_WEST);
+            MATCH ("wrs", TOK_WRS);
+            break;
+        case 'x':
+            MATCH ("x", TOK_X);
+            break;
+        case 'y':
+            MATCH ("y", TOK_Y);
+            break;
+        case 'z':
+            MATCH ("zenith", TOK_ZENITH);
+            MATCH ("zone_code", TOK_ZONE_CODE);
+            break;
+    }
+
+#undef MATCH
+    return (TOK_UNKNOWN);
+}
+
+
+/******************************************************************************
+MODULE:  lookup_value
+
+PURPOSE: Converts an attribute or element value to its numeric value.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            Value was found and returned
+false           Value isn't in the table
+
+NOTES:
+******************************************************************************/
+static bool lookup_value
+(
+    const Stream_value_t *table,  /* I: NULL-terminated table of values */
+    const char *name,             /* I: value in the XML file */
+    int *value                    /* O: corresponding numeric value */
+)
+{
+    for (; table->name != NULL; table++)
+    {
+        if (!strcmp (table->name, name))
+        {
+            *value = table->value;
+            return (true);
+        }
+    }
+
+    return (false);
+}
+
+
+/******************************************************************************
+MODULE:  copy_value
+
+PURPOSE: Copies an attribute or element value to a string field in the
+metadata structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The value doesn't fit in the field
+SUCCESS         Successfully copied the value
+
+NOTES:
+******************************************************************************/
+static int copy_value
+(
+    char *field,            /* O: metadata string field */
+    size_t field_size,      /* I: size of the string field */
+    const char *value,      /* I: value to copy */
+    size_t value_len,       /* I: length of the value */
+    const char *field_name  /* I: name of the field, for error messages */
+)
+{
+    char FUNC_NAME[] = "copy_value";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+
+    if (value_len >= field_size)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Overflow of %s string",
+            field_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    memcpy (field, value, value_len + 1);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  copy_text
+
+PURPOSE: Copies the text of the current element to a string field in the
+metadata structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The text doesn't fit in the field
+SUCCESS         Successfully copied the text
+
+NOTES:
+******************************************************************************/
+static int copy_text
+(
+    Stream_state_t *state,  /* I: parser state holding the text */
+    char *field,            /* O: metadata string field */
+    size_t field_size,      /* I: size of the string field */
+    const char *field_name  /* I: name of the field, for error messages */
+)
+{
+    return (copy_value (field, field_size, state->text, state->text_len,
+        field_name));
+}
+
+
+/******************************************************************************
+MODULE:  in_espa_namespace
+
+PURPOSE: Determines if the current element is in the ESPA namespace, warning
+about it if not.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            Element is in the ESPA namespace
+false           Element isn't in the ESPA namespace and should be skipped
+
+NOTES:
+******************************************************************************/
+static bool in_espa_namespace
+(
+    Stream_state_t *state,  /* I: parser state */
+    bool fatal              /* I: report the skip as an error rather than as a
+                                  warning (matches the tree parser) */
+)
+{
+    char FUNC_NAME[] = "in_espa_namespace";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    const xmlChar *uri = xmlTextReaderConstNamespaceUri (state->reader);
+
+    if (uri != NULL && xmlStrEqual (uri, (const xmlChar *) ESPA_NS))
+        return (true);
+
+    snprintf (errmsg, sizeof (errmsg), "Skipping %s since it is not in the "
+        "ESPA namespace",
+        (const char *) xmlTextReaderConstLocalName (state->reader));
+    error_handler (fatal, FUNC_NAME, errmsg);
+    return (false);
+}
+
+
+/******************************************************************************
+MODULE:  add_band
+
+PURPOSE: Adds a band to the metadata structure, growing the band array as
+needed.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating memory for the band
+SUCCESS         Successfully added the band
+
+NOTES:
+1. The band is initialized via init_band_metadata.
+******************************************************************************/
+static int add_band
+(
+    Stream_state_t *state   /* I/O: parser state */
+)
+{
+    char FUNC_NAME[] = "add_band";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Espa_internal_meta_t *metadata = state->metadata;
+    Espa_band_meta_t *band = NULL;   /* reallocated band array */
+    int nalloc;                   /* new number of bands allocated */
+
+    if (metadata->nbands >= state->band_alloc)
+    {
+        nalloc = state->band_alloc > 0 ? 2 * state->band_alloc
+            : STREAM_INIT_ALLOC;
+        band = realloc (metadata->band, nalloc * sizeof (Espa_band_meta_t));
+        if (band == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Allocating ESPA band "
+                "metadata for %d bands", nalloc);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        metadata->band = band;
+        state->band_alloc = nalloc;
+    }
+
+    init_band_metadata (&metadata->band[metadata->nbands]);
+    metadata->nbands++;
+    state->context->nbands = metadata->nbands;
+    state->context->cur_band = metadata->nbands - 1;
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  add_band_list_item
+
+PURPOSE: Adds a bit, class, or cover entry to the current band, growing the
+associated array as needed.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating memory for the entry
+SUCCESS         Successfully added the entry
+
+NOTES:
+1. New entries are zeroed, like the entries allocated by the
+   allocate_*_metadata routines.
+******************************************************************************/
+static int add_band_list_item
+(
+    Stream_state_t *state,  /* I/O: parser state */
+    Stream_token_t item     /* I: TOK_BIT, TOK_CLASS, or TOK_COVER */
+)
+{
+    char FUNC_NAME[] = "add_band_list_item";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Espa_band_meta_t *bmeta =
+        &state->metadata->band[state->metadata->nbands - 1];
+    int *count = NULL;            /* number of entries in the array */
+    void **array = NULL;          /* array being added to */
+    size_t entry_size = 0;        /* size of one array entry */
+    void *new_array = NULL;       /* reallocated array */
+    int nalloc;                   /* new number of entries allocated */
+
+    switch (item)
+    {
+        case TOK_BIT:
+            count = &bmeta->nbits;
+            array = (void **) &bmeta->bitmap_description;
+            entry_size = sizeof (char *);
+            break;
+        case TOK_CLASS:
+            count = &bmeta->nclass;
+            array = (void **) &bmeta->class_values;
+            entry_size = sizeof (Espa_class_t);
+            break;
+        default:
+            count = &bmeta->ncover;
+            array = (void **) &bmeta->percent_cover;
+            entry_size = sizeof (Espa_percent_cover_t);
+            break;
+    }
+
+    if (*count >= state->list_alloc)
+    {
+        nalloc = state->list_alloc > 0 ? 2 * state->list_alloc
+            : STREAM_INIT_ALLOC;
+        new_array = realloc (*array, nalloc * entry_size);
+        if (new_array == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Allocating ESPA band "
+                "metadata for %d entries", nalloc);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        *array = new_array;
+        state->list_alloc = nalloc;
+    }
+
+    /* Zero the new entry, allocating the string for a bit description */
+    if (item == TOK_BIT)
+    {
+        bmeta->bitmap_description[*count] = calloc (STR_SIZE, sizeof (char));
+        if (bmeta->bitmap_description[*count] == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Allocating ESPA band "
+                "metadata for %d nbits", *count + 1);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+    else
+        memset ((char *) *array + *count * entry_size, 0, entry_size);
+    (*count)++;
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  add_attributes
+
+PURPOSE: Adds the attributes of the current element to the metadata structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error adding the attributes
+SUCCESS         Successfully added the attributes
+
+NOTES:
+1. The reader is moved back to the element when done.
+******************************************************************************/
+static int add_attributes
+(
+    Stream_state_t *state,  /* I/O: parser state */
+    Stream_token_t element  /* I: token for the current element */
+)
+{
+    char FUNC_NAME[] = "add_attributes";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Espa_global_meta_t *gmeta = &state->metadata->global;
+    Espa_band_meta_t *bmeta = NULL;  /* current band */
+    const xmlChar *uri = NULL;    /* namespace of the attribute */
+    const char *name = NULL;      /* attribute name */
+    const char *value = NULL;     /* attribute value */
+    int value_len;                /* length of the attribute value */
+    int enum_value;               /* numeric value of the attribute */
+    const char *elem_name = NULL; /* element name */
+    char location = '\0';         /* first char of the corner (UL or LR) */
+    double coord[2] = {-9999.0, -9999.0};  /* corner coordinates */
+    bool known;                   /* is the attribute known */
+    int status = SUCCESS;         /* return status */
+
+    elem_name = (const char *) xmlTextReaderConstLocalName (state->reader);
+    if (state->metadata->nbands > 0)
+        bmeta = &state->metadata->band[state->metadata->nbands - 1];
+
+    /* Initialize the datum to no datum */
+    if (element == TOK_PROJECTION_INFORMATION)
+        gmeta->proj_info.datum_type = ESPA_NODATUM;
+
+    while (status == SUCCESS &&
+        xmlTextReaderMoveToNextAttribute (state->reader) == 1)
+    {
+        /* Namespace declarations aren't metadata */
+        uri = xmlTextReaderConstNamespaceUri (state->reader);
+        if (uri != NULL && xmlStrEqual (uri, (const xmlChar *) XMLNS_URI))
+            continue;
+
+        name = (const char *) xmlTextReaderConstLocalName (state->reader);
+        value = (const char *) xmlTextReaderConstValue (state->reader);
+        value_len = strlen (value);
+        known = true;
+
+        switch (element)
+        {
+            case TOK_SOLAR_ANGLES:
+                switch (lookup_token (name))
+                {
+                    case TOK_ZENITH:
+                        gmeta->solar_zenith = atof (value);
+                        break;
+                    case TOK_AZIMUTH:
+                        gmeta->solar_azimuth = atof (value);
+                        break;
+                    case TOK_UNITS:
+                        status = copy_value (gmeta->solar_units,
+                            sizeof (gmeta->solar_units), value, value_len,
+                            "gmeta->solar_units");
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_WRS:
+                switch (lookup_token (name))
+                {
+                    case TOK_SYSTEM:
+                        gmeta->wrs_system = atoi (value);
+                        break;
+                    case TOK_PATH:
+                        gmeta->wrs_path = atoi (value);
+                        break;
+                    case TOK_ROW:
+                        gmeta->wrs_row = atoi (value);
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_MODIS:
+                switch (lookup_token (name))
+                {
+                    case TOK_HTILE:
+                        gmeta->htile = atoi (value);
+                        break;
+                    case TOK_VTILE:
+                        gmeta->vtile = atoi (value);
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_CORNER:
+            case TOK_CORNER_POINT:
+                switch (lookup_token (name))
+                {
+                    case TOK_LOCATION:
+                        location = '\0';
+                        if (!strcmp (value, "UL") || !strcmp (value, "LR"))
+                            location = value[0];
+                        else
+                        {
+                            snprintf (errmsg, sizeof (errmsg), "Unknown "
+                                "corner location specified (%s). UL and LR "
+                                "expected.", value);
+                            error_handler (false, FUNC_NAME, errmsg);
+                        }
+                        break;
+                    case TOK_LATITUDE:
+                        if (element == TOK_CORNER)
+                            coord[0] = atof (value);
+                        else
+                            known = false;
+                        break;
+                    case TOK_LONGITUDE:
+                        if (element == TOK_CORNER)
+                            coord[1] = atof (value);
+                        else
+                            known = false;
+                        break;
+                    case TOK_X:
+                        if (element == TOK_CORNER_POINT)
+                            coord[0] = atof (value);
+                        else
+                            known = false;
+                        break;
+                    case TOK_Y:
+                        if (element == TOK_CORNER_POINT)
+                            coord[1] = atof (value);
+                        else
+                            known = false;
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_PROJECTION_INFORMATION:
+                switch (lookup_token (name))
+                {
+                    case TOK_PROJECTION:
+                        if (lookup_value (proj_values, value, &enum_value))
+                            gmeta->proj_info.proj_type = enum_value;
+                        break;
+                    case TOK_DATUM:
+                        if (lookup_value (datum_values, value, &enum_value))
+                            gmeta->proj_info.datum_type = enum_value;
+                        break;
+                    case TOK_UNITS:
+                        status = copy_value (gmeta->proj_info.units,
+                            sizeof (gmeta->proj_info.units), value, value_len,
+                            "gmeta->proj_info.units");
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_BAND:
+                switch (lookup_token (name))
+                {
+                    case TOK_PRODUCT:
+                        status = copy_value (bmeta->product,
+                            sizeof (bmeta->product), value, value_len,
+                            "bmeta->product");
+                        break;
+                    case TOK_SOURCE:
+                        status = copy_value (bmeta->source,
+                            sizeof (bmeta->source), value, value_len,
+                            "bmeta->source");
+                        break;
+                    case TOK_NAME:
+                        status = copy_value (bmeta->name,
+                            sizeof (bmeta->name), value, value_len,
+                            "bmeta->name");
+                        break;
+                    case TOK_CATEGORY:
+                        status = copy_value (bmeta->category,
+                            sizeof (bmeta->category), value, value_len,
+                            "bmeta->category");
+                        break;
+                    case TOK_DATA_TYPE:
+                        if (lookup_value (data_type_values, value,
+                            &enum_value))
+                            bmeta->data_type = enum_value;
+                        break;
+                    case TOK_NLINES:
+                        bmeta->nlines = atoi (value);
+                        break;
+                    case TOK_NSAMPS:
+                        bmeta->nsamps = atoi (value);
+                        break;
+                    case TOK_FILL_VALUE:
+                        bmeta->fill_value = atoi (value);
+                        break;
+                    case TOK_SATURATE_VALUE:
+                        bmeta->saturate_value = atoi (value);
+                        break;
+                    case TOK_SCALE_FACTOR:
+                        bmeta->scale_factor = atof (value);
+                        break;
+                    case TOK_ADD_OFFSET:
+                        bmeta->add_offset = atof (value);
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_PIXEL_SIZE:
+                switch (lookup_token (name))
+                {
+                    case TOK_X:
+                        bmeta->pixel_size[0] = atof (value);
+                        break;
+                    case TOK_Y:
+                        bmeta->pixel_size[1] = atof (value);
+                        break;
+                    case TOK_UNITS:
+                        status = copy_value (bmeta->pixel_units,
+                            sizeof (bmeta->pixel_units), value, value_len,
+                            "bmeta->pixel_units");
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_VALID_RANGE:
+                switch (lookup_token (name))
+                {
+                    case TOK_MIN:
+                        bmeta->valid_range[0] = atof (value);
+                        break;
+                    case TOK_MAX:
+                        bmeta->valid_range[1] = atof (value);
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_RADIANCE:
+            case TOK_REFLECTANCE:
+                switch (lookup_token (name))
+                {
+                    case TOK_GAIN:
+                        if (element == TOK_RADIANCE)
+                            bmeta->rad_gain = atof (value);
+                        else
+                            bmeta->refl_gain = atof (value);
+                        break;
+                    case TOK_BIAS:
+                        if (element == TOK_RADIANCE)
+                            bmeta->rad_bias = atof (value);
+                        else
+                            bmeta->refl_bias = atof (value);
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_THERMAL_CONST:
+                switch (lookup_token (name))
+                {
+                    case TOK_K1:
+                        bmeta->k1_const = atof (value);
+                        break;
+                    case TOK_K2:
+                        bmeta->k2_const = atof (value);
+                        break;
+                    default:
+                        known = false;
+                }
+                break;
+
+            case TOK_CLASS:
+                if (lookup_token (name) == TOK_NUM)
+                    bmeta->class_values[bmeta->nclass - 1].class =
+                        atoi (value);
+                else
+                    known = false;
+                break;
+
+            case TOK_COVER:
+                if (lookup_token (name) == TOK_TYPE)
+                    status = copy_value (
+                        bmeta->percent_cover[bmeta->ncover - 1].description,
+                        STR_SIZE, value, value_len,
+                        "bmeta->percent_cover[ncover].description");
+                else
+                    known = false;
+                break;
+
+            default:
+                known = false;
+        }
+
+        if (!known)
+        {
+            snprintf (errmsg, sizeof (errmsg), "WARNING: unknown attribute "
+                "for element (%s): %s", elem_name, name);
+            error_handler (false, FUNC_NAME, errmsg);
+        }
+    }
+    xmlTextReaderMoveToElement (state->reader);
+    if (status != SUCCESS)
+        return (ERROR);
+
+    /* Populate the correct corner point */
+    if (location != '\0')
+    {
+        double *corner = NULL;    /* corner to populate */
+        if (element == TOK_CORNER)
+            corner = location == 'U' ? gmeta->ul_corner : gmeta->lr_corner;
+        else
+            corner = location == 'U' ? gmeta->proj_info.ul_corner
+                : gmeta->proj_info.lr_corner;
+        corner[0] = coord[0];
+        corner[1] = coord[1];
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  is_proj_param
+
+PURPOSE: Determines if an element is one of the parameters of a projection
+parameters element.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            Element is a parameter of the projection
+false           Element isn't a parameter of the projection
+
+NOTES:
+******************************************************************************/
+static bool is_proj_param
+(
+    Stream_token_t params,  /* I: token for the projection parameters
+                                  element */
+    Stream_token_t element  /* I: token for the parameter element */
+)
+{
+    switch (element)
+    {
+        case TOK_ZONE_CODE:
+            return (params == TOK_UTM_PROJ_PARAMS);
+        case TOK_LONGITUDE_POLE:
+        case TOK_LATITUDE_TRUE_SCALE:
+            return (params == TOK_PS_PROJ_PARAMS);
+        case TOK_STANDARD_PARALLEL1:
+        case TOK_STANDARD_PARALLEL2:
+        case TOK_ORIGIN_LATITUDE:
+            return (params == TOK_ALBERS_PROJ_PARAMS);
+        case TOK_SPHERE_RADIUS:
+            return (params == TOK_SIN_PROJ_PARAMS);
+        case TOK_CENTRAL_MERIDIAN:
+            return (params == TOK_ALBERS_PROJ_PARAMS ||
+                params == TOK_SIN_PROJ_PARAMS);
+        case TOK_FALSE_EASTING:
+        case TOK_FALSE_NORTHING:
+            return (params != TOK_UTM_PROJ_PARAMS);
+        default:
+            return (false);
+    }
+}
+
+
+/******************************************************************************
+MODULE:  band_selected
+
+PURPOSE: Determines if the current band element is one of the bands to be
+loaded.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            Band is to be loaded
+false           Band is to be skipped
+
+NOTES:
+1. Bands are selected by their name attribute.
+******************************************************************************/
+static bool band_selected
+(
+    Stream_state_t *state   /* I: parser state */
+)
+{
+    const Espa_load_options_t *options = state->options;
+    const char *name = NULL;      /* band name */
+    bool selected = false;        /* is the band selected */
+    int i;                        /* looping variable */
+
+    if (options == NULL || options->nband_names <= 0)
+        return (true);
+
+    if (xmlTextReaderMoveToAttribute (state->reader,
+        (const xmlChar *) "name") == 1)
+    {
+        name = (const char *) xmlTextReaderConstValue (state->reader);
+        for (i = 0; i < options->nband_names && !selected; i++)
+            selected = !strcmp (name, options->band_names[i]);
+        xmlTextReaderMoveToElement (state->reader);
+    }
+
+    return (selected);
+}
+
+
+/******************************************************************************
+MODULE:  load_complete
+
+PURPOSE: Determines if everything requested by the load options has been
+loaded, so the rest of the file doesn't need to be read.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            Everything requested has been loaded
+false           The rest of the file needs to be read
+
+NOTES:
+1. Band names are expected to be unique, so the band subset is complete once
+   as many bands as names have been loaded.
+******************************************************************************/
+static bool load_complete
+(
+    Stream_state_t *state   /* I: parser state */
+)
+{
+    const Espa_load_options_t *options = state->options;
+
+    if (options == NULL || !state->global_done)
+        return (false);
+
+    return (options->global_only || (options->nband_names > 0 &&
+        state->metadata->nbands >= options->nband_names));
+}
+
+
+/******************************************************************************
+MODULE:  start_element
+
+PURPOSE: Handles the start of an element.  The role of the element is
+determined from the role of its parent and its attributes are added to the
+metadata structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error processing the element
+SUCCESS         Successfully processed the element
+
+NOTES:
+1. Elements given the ROLE_SKIP role are skipped by the caller along with all
+   of their children, so they are never ended.
+******************************************************************************/
+static int start_element
+(
+    Stream_state_t *state,  /* I/O: parser state */
+    int depth               /* I: depth of the element in the document */
+)
+{
+    char FUNC_NAME[] = "start_element";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Espa_global_meta_t *gmeta = &state->metadata->global;
+    Espa_band_meta_t *bmeta = NULL;  /* current band */
+    Stream_element_t *cur = &state->elem[depth];  /* current element */
+    Stream_element_t *parent = NULL; /* parent element */
+    Stream_role_t parent_role = ROLE_PASS;  /* role of the parent element */
+    Stream_token_t item;          /* token for the entries of a band list */
+    bool skip_qa = false;         /* skip the QA descriptions */
+    const char *name = NULL;      /* element name */
+    const xmlChar *uri = NULL;    /* element namespace */
+    int proj_type;                /* projection type for the parameters */
+    int count;                    /* number of chars copied in snprintf */
+
+    name = (const char *) xmlTextReaderConstLocalName (state->reader);
+    cur->token = lookup_token (name);
+    cur->role = ROLE_SKIP;
+    cur->has_child = false;
+
+    if (depth > 0)
+    {
+        parent = &state->elem[depth - 1];
+        parent->has_child = true;
+        parent_role = parent->role;
+    }
+    else
+    {
+        /* Store the namespace for the overall metadata file */
+        uri = xmlTextReaderConstNamespaceUri (state->reader);
+        if (uri == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Root element %s is not in a "
+                "namespace", name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        count = snprintf (state->metadata->meta_namespace,
+            sizeof (state->metadata->meta_namespace), "%s",
+            (const char *) uri);
+        if (count < 0 || count >= sizeof (state->metadata->meta_namespace))
+        {
+            snprintf (errmsg, sizeof (errmsg), "Overflow of "
+                "metadata->meta_namespace string");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+
+    switch (parent_role)
+    {
+        case ROLE_PASS:
+            /* Look for the global_metadata and bands sections */
+            if (cur->token == TOK_GLOBAL_METADATA)
+            {
+                state->context->global_metadata = true;
+                cur->role = ROLE_GLOBAL;
+            }
+            else if (cur->token == TOK_BANDS)
+            {
+                /* The bands are skipped when only loading global metadata */
+                if (state->options != NULL && state->options->global_only)
+                    break;
+                state->context->bands_metadata = true;
+                cur->role = ROLE_BANDS;
+            }
+            else
+                cur->role = ROLE_PASS;
+            break;
+
+        case ROLE_GLOBAL:
+            if (!in_espa_namespace (state, true))
+                break;
+
+            switch (cur->token)
+            {
+                case TOK_DATA_PROVIDER:
+                case TOK_SATELLITE:
+                case TOK_INSTRUMENT:
+                case TOK_ACQUISITION_DATE:
+                case TOK_SCENE_CENTER_TIME:
+                case TOK_LEVEL1_PRODUCTION_DATE:
+                case TOK_EARTH_SUN_DISTANCE:
+                case TOK_LPGS_METADATA_FILE:
+                case TOK_PRODUCT_ID:
+                case TOK_ORIENTATION_ANGLE:
+                    cur->role = ROLE_GLOBAL_FIELD;
+                    break;
+                case TOK_SOLAR_ANGLES:
+                case TOK_WRS:
+                case TOK_MODIS:
+                case TOK_CORNER:
+                    if (add_attributes (state, cur->token) != SUCCESS)
+                        return (ERROR);
+                    break;
+                case TOK_BOUNDING_COORDINATES:
+                    cur->role = ROLE_BOUNDING;
+                    break;
+                case TOK_PROJECTION_INFORMATION:
+                    if (add_attributes (state, cur->token) != SUCCESS)
+                        return (ERROR);
+                    cur->role = ROLE_PROJ;
+                    break;
+                default:
+                    snprintf (errmsg, sizeof (errmsg), "Unknown element (%s) "
+                        "in the global_metadata", name);
+                    error_handler (false, FUNC_NAME, errmsg);
+            }
+            break;
+
+        case ROLE_BOUNDING:
+            if (!in_espa_namespace (state, false))
+                break;
+
+            switch (cur->token)
+            {
+                case TOK_WEST:
+                case TOK_EAST:
+                case TOK_NORTH:
+                case TOK_SOUTH:
+                    cur->role = ROLE_BOUNDING_FIELD;
+                    break;
+                default:
+                    snprintf (errmsg, sizeof (errmsg), "Unknown bounding "
+                        "coords element: %s", name);
+                    error_handler (false, FUNC_NAME, errmsg);
+            }
+            break;
+
+        case ROLE_PROJ:
+            switch (cur->token)
+            {
+                case TOK_CORNER_POINT:
+                    if (add_attributes (state, cur->token) != SUCCESS)
+                        return (ERROR);
+                    break;
+                case TOK_GRID_ORIGIN:
+                    cur->role = ROLE_PROJ_FIELD;
+                    break;
+                case TOK_UTM_PROJ_PARAMS:
+                case TOK_PS_PROJ_PARAMS:
+                case TOK_ALBERS_PROJ_PARAMS:
+                case TOK_SIN_PROJ_PARAMS:
+                    /* Make sure the projection type specified matches the
+                       projection parameters type */
+                    if (cur->token == TOK_UTM_PROJ_PARAMS)
+                        proj_type = GCTP_UTM_PROJ;
+                    else if (cur->token == TOK_PS_PROJ_PARAMS)
+                        proj_type = GCTP_PS_PROJ;
+                    else if (cur->token == TOK_ALBERS_PROJ_PARAMS)
+                        proj_type = GCTP_ALBERS_PROJ;
+                    else
+                        proj_type = GCTP_SIN_PROJ;
+                    if (gmeta->proj_info.proj_type != proj_type)
+                    {
+                        snprintf (errmsg, sizeof (errmsg), "Projection type "
+                            "doesn't match, so the fact that %s exists is a "
+                            "mismatch in the projection_information.", name);
+                        error_handler (true, FUNC_NAME, errmsg);
+                        return (ERROR);
+                    }
+                    cur->role = ROLE_PROJ_PARAMS;
+                    break;
+                default:
+                    snprintf (errmsg, sizeof (errmsg), "Unknown projection "
+                        "information element: %s", name);
+                    error_handler (false, FUNC_NAME, errmsg);
+            }
+            break;
+
+        case ROLE_PROJ_PARAMS:
+            if (is_proj_param (parent->token, cur->token))
+                cur->role = ROLE_PROJ_PARAM_FIELD;
+            else
+            {
+                snprintf (errmsg, sizeof (errmsg), "Unknown projection "
+                    "parameters element: %s", name);
+                error_handler (false, FUNC_NAME, errmsg);
+            }
+            break;
+
+        case ROLE_BANDS:
+            if (cur->token != TOK_BAND)
+                break;
+
+            /* As in the tree parser, a band element without a prefix which
+               is outside the ESPA namespace still takes up a band, which is
+               left as fill, unless only some of the bands are loaded */
+            if (!in_espa_namespace (state, true))
+            {
+                if (xmlTextReaderConstPrefix (state->reader) == NULL &&
+                    (state->options == NULL ||
+                    state->options->nband_names <= 0) &&
+                    add_band (state) != SUCCESS)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Consuming band "
+                        "metadata element '%s'.", name);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    return (ERROR);
+                }
+                break;
+            }
+
+            if (!band_selected (state))
+                break;
+
+            if (add_band (state) != SUCCESS ||
+                add_attributes (state, cur->token) != SUCCESS)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Consuming band metadata "
+                    "element '%s'.", name);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+            cur->role = ROLE_BAND;
+            break;
+
+        case ROLE_BAND:
+            bmeta = &state->metadata->band[state->metadata->nbands - 1];
+            skip_qa = state->options != NULL &&
+                state->options->skip_qa_descriptions;
+            switch (cur->token)
+            {
+                case TOK_SHORT_NAME:
+                case TOK_LONG_NAME:
+                case TOK_FILE_NAME:
+                case TOK_RESAMPLE_METHOD:
+                case TOK_DATA_UNITS:
+                case TOK_QA_DESCRIPTION:
+                case TOK_APP_VERSION:
+                case TOK_PRODUCTION_DATE:
+                    cur->role = ROLE_BAND_FIELD;
+                    break;
+                case TOK_PIXEL_SIZE:
+                case TOK_VALID_RANGE:
+                case TOK_RADIANCE:
+                case TOK_REFLECTANCE:
+                case TOK_THERMAL_CONST:
+                    if (add_attributes (state, cur->token) != SUCCESS)
+                        return (ERROR);
+                    break;
+                case TOK_BITMAP_DESCRIPTION:
+                case TOK_CLASS_VALUES:
+                case TOK_PERCENT_COVERAGE:
+                    if (skip_qa)
+                        break;
+                    if (cur->token == TOK_BITMAP_DESCRIPTION)
+                        state->list_alloc = bmeta->nbits;
+                    else if (cur->token == TOK_CLASS_VALUES)
+                        state->list_alloc = bmeta->nclass;
+                    else
+                        state->list_alloc = bmeta->ncover;
+                    cur->role = ROLE_BAND_LIST;
+                    break;
+                default:
+                    snprintf (errmsg, sizeof (errmsg), "Unknown element (%s) "
+                        "in the band metadata", name);
+                    error_handler (false, FUNC_NAME, errmsg);
+            }
+            break;
+
+        case ROLE_BAND_LIST:
+            /* Only the entries matching the list are used */
+            if (parent->token == TOK_BITMAP_DESCRIPTION)
+                item = TOK_BIT;
+            else if (parent->token == TOK_CLASS_VALUES)
+                item = TOK_CLASS;
+            else
+                item = TOK_COVER;
+            if (cur->token != item)
+                break;
+
+            if (add_band_list_item (state, item) != SUCCESS)
+                return (ERROR);
+            if (item != TOK_BIT &&
+                add_attributes (state, cur->token) != SUCCESS)
+                return (ERROR);
+            cur->role = ROLE_BAND_LIST_ITEM;
+            break;
+
+        default:
+            /* Children of text-valued elements are ignored */
+            break;
+    }
+
+    /* Start collecting the text for a new element.  Skipped elements, such as
+       the children of text-valued elements, leave the text alone. */
+    if (cur->role != ROLE_SKIP)
+        state->has_text = false;
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  add_text
+
+PURPOSE: Saves the text read for a text-valued element, so it can be added to
+the metadata structure at the end of the element.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+1. Like the tree parser, only text which is the first child of the element is
+   used.
+******************************************************************************/
+static void add_text
+(
+    Stream_state_t *state,  /* I/O: parser state */
+    int depth               /* I: depth of the text node in the document */
+)
+{
+    Stream_element_t *parent = NULL;  /* element containing the text */
+    const char *value = NULL;     /* text value */
+
+    if (depth < 1 || depth > STREAM_MAX_DEPTH)
+        return;
+    parent = &state->elem[depth - 1];
+
+    switch (parent->role)
+    {
+        case ROLE_GLOBAL_FIELD:
+        case ROLE_BOUNDING_FIELD:
+        case ROLE_PROJ_FIELD:
+        case ROLE_PROJ_PARAM_FIELD:
+        case ROLE_BAND_FIELD:
+        case ROLE_BAND_LIST_ITEM:
+            if (parent->has_child)
+                break;
+            value = (const char *) xmlTextReaderConstValue (state->reader);
+            state->text_len = strlen (value);
+            snprintf (state->text, sizeof (state->text), "%s", value);
+            state->has_text = true;
+            break;
+        default:
+            break;
+    }
+    parent->has_child = true;
+}
+
+
+/******************************************************************************
+MODULE:  add_element_text
+
+PURPOSE: Adds the text of a text-valued element to the metadata structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error adding the text
+SUCCESS         Successfully added the text
+
+NOTES:
+******************************************************************************/
+static int add_element_text
+(
+    Stream_state_t *state,  /* I/O: parser state */
+    Stream_token_t element  /* I: token for the element */
+)
+{
+    char FUNC_NAME[] = "add_element_text";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Espa_global_meta_t *gmeta = &state->metadata->global;
+    Espa_proj_meta_t *proj = &gmeta->proj_info;
+    Espa_band_meta_t *bmeta = NULL;  /* current band */
+    const char *text = state->text;  /* text of the element */
+    int enum_value;               /* numeric value of the text */
+
+    if (state->metadata->nbands > 0)
+        bmeta = &state->metadata->band[state->metadata->nbands - 1];
+
+    switch (element)
+    {
+        /* Global metadata */
+        case TOK_DATA_PROVIDER:
+            return (copy_text (state, gmeta->data_provider,
+                sizeof (gmeta->data_provider), "gmeta->data_provider"));
+        case TOK_SATELLITE:
+            return (copy_text (state, gmeta->satellite,
+                sizeof (gmeta->satellite), "gmeta->satellite"));
+        case TOK_INSTRUMENT:
+            return (copy_text (state, gmeta->instrument,
+                sizeof (gmeta->instrument), "gmeta->instrument"));
+        case TOK_ACQUISITION_DATE:
+            return (copy_text (state, gmeta->acquisition_date,
+                sizeof (gmeta->acquisition_date), "gmeta->acquisition_date"));
+        case TOK_SCENE_CENTER_TIME:
+            return (copy_text (state, gmeta->scene_center_time,
+                sizeof (gmeta->scene_center_time),
+                "gmeta->scene_center_time"));
+        case TOK_LEVEL1_PRODUCTION_DATE:
+            return (copy_text (state, gmeta->level1_production_date,
+                sizeof (gmeta->level1_production_date),
+                "gmeta->level1_production_date"));
+        case TOK_LPGS_METADATA_FILE:
+            return (copy_text (state, gmeta->lpgs_metadata_file,
+                sizeof (gmeta->lpgs_metadata_file),
+                "gmeta->lpgs_metadata_file"));
+        case TOK_PRODUCT_ID:
+            return (copy_text (state, gmeta->product_id,
+                sizeof (gmeta->product_id), "gmeta->product_id"));
+        case TOK_EARTH_SUN_DISTANCE:
+            gmeta->earth_sun_dist = atof (text);
+            break;
+        case TOK_ORIENTATION_ANGLE:
+            gmeta->orientation_angle = atof (text);
+            break;
+
+        /* Bounding coordinates */
+        case TOK_WEST:
+            gmeta->bounding_coords[ESPA_WEST] = atof (text);
+            break;
+        case TOK_EAST:
+            gmeta->bounding_coords[ESPA_EAST] = atof (text);
+            break;
+        case TOK_NORTH:
+            gmeta->bounding_coords[ESPA_NORTH] = atof (text);
+            break;
+        case TOK_SOUTH:
+            gmeta->bounding_coords[ESPA_SOUTH] = atof (text);
+            break;
+
+        /* Projection information */
+        case TOK_GRID_ORIGIN:
+            return (copy_text (state, proj->grid_origin,
+                sizeof (proj->grid_origin), "gmeta->proj_info.grid_origin"));
+        case TOK_ZONE_CODE:
+            proj->utm_zone = atoi (text);
+            break;
+        case TOK_LONGITUDE_POLE:
+            proj->longitude_pole = atof (text);
+            break;
+        case TOK_LATITUDE_TRUE_SCALE:
+            proj->latitude_true_scale = atof (text);
+            break;
+        case TOK_FALSE_EASTING:
+            proj->false_easting = atof (text);
+            break;
+        case TOK_FALSE_NORTHING:
+            proj->false_northing = atof (text);
+            break;
+        case TOK_STANDARD_PARALLEL1:
+            proj->standard_parallel1 = atof (text);
+            break;
+        case TOK_STANDARD_PARALLEL2:
+            proj->standard_parallel2 = atof (text);
+            break;
+        case TOK_CENTRAL_MERIDIAN:
+            proj->central_meridian = atof (text);
+            break;
+        case TOK_ORIGIN_LATITUDE:
+            proj->origin_latitude = atof (text);
+            break;
+        case TOK_SPHERE_RADIUS:
+            proj->sphere_radius = atof (text);
+            break;
+
+        /* Band metadata */
+        case TOK_SHORT_NAME:
+            return (copy_text (state, bmeta->short_name,
+                sizeof (bmeta->short_name), "bmeta->short_name"));
+        case TOK_LONG_NAME:
+            return (copy_text (state, bmeta->long_name,
+                sizeof (bmeta->long_name), "bmeta->long_name"));
+        case TOK_FILE_NAME:
+            return (copy_text (state, bmeta->file_name,
+                sizeof (bmeta->file_name), "bmeta->file_name"));
+        case TOK_DATA_UNITS:
+            return (copy_text (state, bmeta->data_units,
+                sizeof (bmeta->data_units), "bmeta->data_units"));
+        case TOK_QA_DESCRIPTION:
+            return (copy_text (state, bmeta->qa_desc,
+                sizeof (bmeta->qa_desc), "bmeta->qa_desc"));
+        case TOK_APP_VERSION:
+            return (copy_text (state, bmeta->app_version,
+                sizeof (bmeta->app_version), "bmeta->app_version"));
+        case TOK_PRODUCTION_DATE:
+            return (copy_text (state, bmeta->production_date,
+                sizeof (bmeta->production_date), "bmeta->production_date"));
+        case TOK_RESAMPLE_METHOD:
+            if (lookup_value (resample_values, text, &enum_value))
+                bmeta->resample_method = enum_value;
+            else
+            {
+                snprintf (errmsg, sizeof (errmsg), "WARNING: unknown option "
+                    "for element (%s): %.*s", "resample_method",
+                    STREAM_MAX_ECHO, text);
+                error_handler (false, FUNC_NAME, errmsg);
+            }
+            break;
+        case TOK_BIT:
+            return (copy_text (state,
+                bmeta->bitmap_description[bmeta->nbits - 1], STR_SIZE,
+                "bmeta->bitmap_description[nbits]"));
+        case TOK_CLASS:
+            return (copy_text (state,
+                bmeta->class_values[bmeta->nclass - 1].description, STR_SIZE,
+                "bmeta->class_values[nclass].description"));
+        case TOK_COVER:
+            bmeta->percent_cover[bmeta->ncover - 1].percent = atof (text);
+            break;
+
+        default:
+            break;
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  end_element
+
+PURPOSE: Handles the end of an element.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error processing the element
+SUCCESS         Successfully processed the element
+
+NOTES:
+******************************************************************************/
+static int end_element
+(
+    Stream_state_t *state,  /* I/O: parser state */
+    int depth               /* I: depth of the element in the document */
+)
+{
+    char FUNC_NAME[] = "end_element";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Stream_element_t *cur = &state->elem[depth];  /* current element */
+
+    switch (cur->role)
+    {
+        case ROLE_GLOBAL:
+            state->context->global_metadata = false;
+            state->global_done = true;
+            state->done = load_complete (state);
+            break;
+
+        case ROLE_BAND:
+            state->done = load_complete (state);
+            break;
+
+        case ROLE_BANDS:
+            state->context->bands_metadata = false;
+            break;
+
+        case ROLE_GLOBAL_FIELD:
+        case ROLE_BOUNDING_FIELD:
+        case ROLE_PROJ_FIELD:
+        case ROLE_PROJ_PARAM_FIELD:
+        case ROLE_BAND_FIELD:
+        case ROLE_BAND_LIST_ITEM:
+            /* Expect the element to contain the text value of this field */
+            if (!state->has_text)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Processing metadata "
+                    "element: %s.",
+                    (const char *) xmlTextReaderConstLocalName (state->reader));
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+            if (add_element_text (state, cur->token) != SUCCESS)
+                return (ERROR);
+            state->has_text = false;
+            break;
+
+        default:
+            break;
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  parse_metadata_stream
+
+PURPOSE: Parse the input metadata file and populate the associated ESPA
+internal metadata structure in a single pass, without building a document
+tree.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error parsing the metadata elements
+SUCCESS         Successful parse of the metadata values
+
+NOTES:
+1. The parser context's section flags and band counts are updated as the file
+   is parsed; its element stack isn't used.
+2. If load options are specified, only the requested parts of the metadata are
+   loaded.  The bands that are loaded keep their order in the file.  Since
+   the parse stops once everything requested has been loaded, the rest of the
+   file isn't checked for errors; use validate_xml_file for that.
+3. Like parse_metadata_r, this routine is reentrant as long as each thread uses
+   its own context and metadata structure.
+******************************************************************************/
+int parse_metadata_stream
+(
+    char *metafile,                 /* I: input metadata file or URL */
+    Espa_internal_meta_t *metadata, /* I: input metadata structure which has
+                                          been initialized via
+                                          init_metadata_struct */
+    const Espa_load_options_t *options, /* I: parts of the metadata to load;
+                                              NULL loads all of it */
+    Espa_parse_context_t *context   /* I/O: parser context, initialized via
+                                            init_parse_context */
+)
+{
+    char FUNC_NAME[] = "parse_metadata_stream";  /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Stream_state_t state;         /* parser state */
+    int status;                   /* return status */
+    int depth;                    /* depth of the current node */
+    bool skip;                    /* skip the children of the current node */
+
+    /* Start from a clean context, in case a previous parse failed part way
+       through */
+    reset_parse_context (context);
+
+    /* Establish the reader for this metadata file */
+    state.reader = xmlNewTextReaderFilename (metafile);
+    if (state.reader == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting up reader for %s",
+            metafile);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    state.metadata = metadata;
+    state.context = context;
+    state.options = options;
+    state.global_done = false;
+    state.done = false;
+    state.band_alloc = metadata->nbands;
+    state.list_alloc = 0;
+    state.has_text = false;
+    state.text_len = 0;
+
+    /* Handle each of the nodes as they are read from the file */
+    status = xmlTextReaderRead (state.reader);
+    while (status == 1 && !state.done)
+    {
+        skip = false;
+        depth = xmlTextReaderDepth (state.reader);
+        switch (xmlTextReaderNodeType (state.reader))
+        {
+            case -1:
+                snprintf (errmsg, sizeof (errmsg), "Getting node type");
+                error_handler (true, FUNC_NAME, errmsg);
+                xmlFreeTextReader (state.reader);
+                return (ERROR);
+
+            case XML_READER_TYPE_ELEMENT:
+                if (depth >= STREAM_MAX_DEPTH)
+                {
+                    skip = true;
+                    break;
+                }
+                if (start_element (&state, depth) != SUCCESS)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Parsing the metadata "
+                        "file into the internal metadata structure.");
+                    error_handler (true, FUNC_NAME, errmsg);
+                    xmlFreeTextReader (state.reader);
+                    return (ERROR);
+                }
+
+                /* Skip the element and its children if they aren't needed,
+                   otherwise end an empty element right away since there
+                   isn't an end element node for it */
+                if (state.elem[depth].role == ROLE_SKIP)
+                    skip = true;
+                else if (xmlTextReaderIsEmptyElement (state.reader) &&
+                    end_element (&state, depth) != SUCCESS)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Parsing the metadata "
+                        "file into the internal metadata structure.");
+                    error_handler (true, FUNC_NAME, errmsg);
+                    xmlFreeTextReader (state.reader);
+                    return (ERROR);
+                }
+                break;
+
+            case XML_READER_TYPE_END_ELEMENT:
+                if (depth < STREAM_MAX_DEPTH &&
+                    end_element (&state, depth) != SUCCESS)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Parsing the metadata "
+                        "file into the internal metadata structure.");
+                    error_handler (true, FUNC_NAME, errmsg);
+                    xmlFreeTextReader (state.reader);
+                    return (ERROR);
+                }
+                break;
+
+            case XML_READER_TYPE_TEXT:
+                add_text (&state, depth);
+                break;
+        }
+
+        /* Move past the subtree of a skipped element, otherwise read the
+           next node */
+        if (skip)
+            status = xmlTextReaderNext (state.reader);
+        else
+            status = xmlTextReaderRead (state.reader);
+    }
+    if (status != 0 && !state.done)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Failed to parse %s", metafile);
+        error_handler (true, FUNC_NAME, errmsg);
+        xmlFreeTextReader (state.reader);
+        return (ERROR);
+    }
+
+    /* Free the reader and associated memory */
+    xmlFreeTextReader (state.reader);
+
+    return (SUCCESS);
+}
@@ -0,0 +1,618 @@
+/*****************************************************************************
+FILE: raw_binary_band.c
+
+PURPOSE: Contains functions for opening/closing raw binary band files via a
+band handle, reading/writing arbitrary line/sample windows of a band, and
+memory-mapping a band for zero-copy access.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Windows which span the full width of the band are transferred with a
+     single system call.  Partial-width windows require one call per line,
+     unless the band has been memory-mapped in which case no system calls
+     are needed at all.
+*****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "raw_binary_band.h"
+
+/******************************************************************************
+MODULE: espa_data_type_size
+
+PURPOSE: Returns the number of bytes per pixel for the specified ESPA data
+type.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        Unsupported data type
+> 0          Number of bytes per pixel
+
+NOTES:
+*****************************************************************************/
+int espa_data_type_size
+(
+    enum Espa_data_type data_type   /* I: ESPA data type */
+)
+{
+    switch (data_type)
+    {
+        case ESPA_INT8:
+        case ESPA_UINT8:
+            return 1;
+        case ESPA_INT16:
+        case ESPA_UINT16:
+            return 2;
+        case ESPA_INT32:
+        case ESPA_UINT32:
+        case ESPA_FLOAT32:
+            return 4;
+        case ESPA_FLOAT64:
+            return 8;
+    }
+
+    return ERROR;
+}
+
+
+/******************************************************************************
+MODULE: full_pread
+
+PURPOSE: Reads exactly count bytes from the specified offset, continuing
+across short reads and interrupted calls.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred or end of file was reached early
+SUCCESS      All bytes were read
+
+NOTES:
+*****************************************************************************/
+static int full_pread
+(
+    int fd,           /* I: file descriptor to read from */
+    void *buf,        /* O: buffer to read into */
+    size_t count,     /* I: number of bytes to read */
+    off_t offset      /* I: file offset to start reading from */
+)
+{
+    char *ptr = buf;  /* current location in the buffer */
+    ssize_t nread;    /* number of bytes read by the current call */
+
+    while (count > 0)
+    {
+        nread = pread (fd, ptr, count, offset);
+        if (nread < 0 && errno == EINTR)
+            continue;
+        if (nread <= 0)
+            return ERROR;
+        ptr += nread;
+        offset += nread;
+        count -= nread;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: full_pwrite
+
+PURPOSE: Writes exactly count bytes at the specified offset, continuing
+across short writes and interrupted calls.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred writing the data
+SUCCESS      All bytes were written
+
+NOTES:
+*****************************************************************************/
+static int full_pwrite
+(
+    int fd,           /* I: file descriptor to write to */
+    const void *buf,  /* I: buffer to write from */
+    size_t count,     /* I: number of bytes to write */
+    off_t offset      /* I: file offset to start writing to */
+)
+{
+    const char *ptr = buf;  /* current location in the buffer */
+    ssize_t nwritten;       /* number of bytes written by the current call */
+
+    while (count > 0)
+    {
+        nwritten = pwrite (fd, ptr, count, offset);
+        if (nwritten < 0 && errno == EINTR)
+            continue;
+        if (nwritten <= 0)
+            return ERROR;
+        ptr += nwritten;
+        offset += nwritten;
+        count -= nwritten;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: check_band_window
+
+PURPOSE: Verifies the requested window lies within the band.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        The window is empty or extends outside of the band
+SUCCESS      The window is valid
+
+NOTES:
+*****************************************************************************/
+static int check_band_window
+(
+    Espa_band_file_t *band,  /* I: band handle */
+    int start_line,          /* I: first line of the window (0-based) */
+    int start_samp,          /* I: first sample of the window (0-based) */
+    int nlines,              /* I: number of lines in the window */
+    int nsamps,              /* I: number of samples in the window */
+    char *module             /* I: calling module name */
+)
+{
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+
+    if (start_line < 0 || start_samp < 0 || nlines <= 0 || nsamps <= 0 ||
+        start_line + nlines > band->nlines ||
+        start_samp + nsamps > band->nsamps)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Window of %d lines x %d samples "
+            "starting at line %d, sample %d is outside the %d x %d band %s.",
+            nlines, nsamps, start_line, start_samp, band->nlines, band->nsamps,
+            band->file_name);
+        error_handler (true, module, errmsg);
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: open_band_file
+
+PURPOSE: Opens the raw binary file for the specified band and returns a band
+handle for windowed access.
+
+RETURN VALUE:
+Type = Espa_band_file_t *
+Value        Description
+-----        -----------
+NULL         Error opening the band file
+non-NULL     Pointer to the band handle; must be released with
+             close_band_file
+
+NOTES:
+  1. BAND_WRITE creates the file and extends it to the full band size so
+     windows may be written in any order, and so the band may be mapped.
+*****************************************************************************/
+Espa_band_file_t *open_band_file
+(
+    Espa_band_meta_t *bmeta,     /* I: metadata for the band to be opened;
+                                       file_name, nlines, nsamps, and
+                                       data_type are used */
+    Espa_band_access_t access    /* I: access mode for the band file */
+)
+{
+    char FUNC_NAME[] = "open_band_file"; /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    int flags;               /* open flags for the file */
+    int nbytes;              /* number of bytes per pixel */
+    struct stat statbuf;     /* file status of the band file */
+    Espa_band_file_t *band = NULL;  /* band handle */
+
+    /* Determine the pixel size for this band */
+    nbytes = espa_data_type_size (bmeta->data_type);
+    if (nbytes == ERROR)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Unsupported ESPA data type for "
+            "band %s.", bmeta->name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return NULL;
+    }
+
+    /* Allocate and populate the band handle */
+    band = calloc (1, sizeof (Espa_band_file_t));
+    if (band == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory for the band "
+            "handle.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return NULL;
+    }
+    snprintf (band->file_name, sizeof (band->file_name), "%s",
+        bmeta->file_name);
+    band->access = access;
+    band->nlines = bmeta->nlines;
+    band->nsamps = bmeta->nsamps;
+    band->nbytes = nbytes;
+    band->line_size = (size_t) bmeta->nsamps * nbytes;
+    band->band_size = (off_t) band->line_size * bmeta->nlines;
+    band->map = NULL;
+
+    /* Open the file with the specified access */
+    switch (access)
+    {
+        case BAND_READ:
+            flags = O_RDONLY;
+            break;
+        case BAND_WRITE:
+            flags = O_RDWR | O_CREAT | O_TRUNC;
+            break;
+        case BAND_READ_WRITE:
+            flags = O_RDWR;
+            break;
+        default:
+            snprintf (errmsg, sizeof (errmsg), "Invalid access type for band "
+                "file %s.", band->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            free (band);
+            return NULL;
+    }
+
+    band->fd = open (band->file_name, flags, 0644);
+    if (band->fd < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening raw binary band file %s.",
+            band->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (band);
+        return NULL;
+    }
+
+    if (access == BAND_WRITE)
+    {
+        /* Size the new file for the full band */
+        if (ftruncate (band->fd, band->band_size) != 0)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Sizing raw binary band file "
+                "%s to %lld bytes.", band->file_name,
+                (long long) band->band_size);
+            error_handler (true, FUNC_NAME, errmsg);
+            close (band->fd);
+            free (band);
+            return NULL;
+        }
+    }
+    else
+    {
+        /* Make sure the existing file holds the full band */
+        if (fstat (band->fd, &statbuf) != 0 ||
+            statbuf.st_size < band->band_size)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Raw binary band file %s is "
+                "smaller than the %d x %d band described in the metadata.",
+                band->file_name, band->nlines, band->nsamps);
+            error_handler (true, FUNC_NAME, errmsg);
+            close (band->fd);
+            free (band);
+            return NULL;
+        }
+    }
+
+    return band;
+}
+
+
+/******************************************************************************
+MODULE: read_band_window
+
+PURPOSE: Reads a window of nlines x nsamps pixels from the band, starting at
+the specified line and sample, into a contiguous buffer.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred reading the window
+SUCCESS      Reading was successful
+
+NOTES:
+*****************************************************************************/
+int read_band_window
+(
+    Espa_band_file_t *band,  /* I: band handle to read from */
+    int start_line,          /* I: first line of the window (0-based) */
+    int start_samp,          /* I: first sample of the window (0-based) */
+    int nlines,              /* I: number of lines in the window */
+    int nsamps,              /* I: number of samples in the window */
+    void *buf                /* O: buffer of nlines * nsamps pixels
+                                   (sufficient space should already have
+                                   been allocated) */
+)
+{
+    char FUNC_NAME[] = "read_band_window"; /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    int line;                /* current line in the window */
+    size_t win_line_size;    /* number of bytes per window line */
+    off_t offset;            /* file offset of the current line */
+    char *out = buf;         /* current location in the output buffer */
+
+    if (check_band_window (band, start_line, start_samp, nlines, nsamps,
+        FUNC_NAME) != SUCCESS)
+        return ERROR;
+
+    win_line_size = (size_t) nsamps * band->nbytes;
+    offset = (off_t) start_line * band->line_size +
+             (off_t) start_samp * band->nbytes;
+
+    /* Full-width windows are contiguous in the file */
+    if (nsamps == band->nsamps)
+    {
+        if (band->map != NULL)
+            memcpy (out, (char *) band->map + offset, win_line_size * nlines);
+        else if (full_pread (band->fd, out, win_line_size * nlines, offset)
+            != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Reading lines %d-%d from the "
+                "raw binary band file %s.", start_line,
+                start_line + nlines - 1, band->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+        }
+        return SUCCESS;
+    }
+
+    for (line = 0; line < nlines; line++)
+    {
+        if (band->map != NULL)
+            memcpy (out, (char *) band->map + offset, win_line_size);
+        else if (full_pread (band->fd, out, win_line_size, offset) != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Reading line %d from the raw "
+                "binary band file %s.", start_line + line, band->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+        }
+        out += win_line_size;
+        offset += band->line_size;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: write_band_window
+
+PURPOSE: Writes a window of nlines x nsamps pixels from a contiguous buffer
+to the band, starting at the specified line and sample.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred writing the window
+SUCCESS      Writing was successful
+
+NOTES:
+*****************************************************************************/
+int write_band_window
+(
+    Espa_band_file_t *band,  /* I: band handle to write to */
+    int start_line,          /* I: first line of the window (0-based) */
+    int start_samp,          /* I: first sample of the window (0-based) */
+    int nlines,              /* I: number of lines in the window */
+    int nsamps,              /* I: number of samples in the window */
+    const void *buf          /* I: buffer of nlines * nsamps pixels */
+)
+{
+    char FUNC_NAME[] = "write_band_window"; /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    int line;                /* current line in the window */
+    size_t win_line_size;    /* number of bytes per window line */
+    off_t offset;            /* file offset of the current line */
+    const char *in = buf;    /* current location in the input buffer */
+
+    if (band->access == BAND_READ)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Raw binary band file %s was "
+            "opened read-only.", band->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    if (check_band_window (band, start_line, start_samp, nlines, nsamps,
+        FUNC_NAME) != SUCCESS)
+        return ERROR;
+
+    win_line_size = (size_t) nsamps * band->nbytes;
+    offset = (off_t) start_line * band->line_size +
+             (off_t) start_samp * band->nbytes;
+
+    /* Full-width windows are contiguous in the file */
+    if (nsamps == band->nsamps)
+    {
+        if (band->map != NULL)
+            memcpy ((char *) band->map + offset, in, win_line_size * nlines);
+        else if (full_pwrite (band->fd, in, win_line_size * nlines, offset)
+            != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Writing lines %d-%d to the "
+                "raw binary band file %s.", start_line,
+                start_line + nlines - 1, band->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+        }
+        return SUCCESS;
+    }
+
+    for (line = 0; line < nlines; line++)
+    {
+        if (band->map != NULL)
+            memcpy ((char *) band->map + offset, in, win_line_size);
+        else if (full_pwrite (band->fd, in, win_line_size, offset) != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Writing line %d to the raw "
+                "binary band file %s.", start_line + line, band->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+        }
+        in += win_line_size;
+        offset += band->line_size;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: map_band_file
+
+PURPOSE: Memory-maps the full band, providing a zero-copy view of the band
+data.  Subsequent window reads/writes on the handle go through the mapping.
+
+RETURN VALUE:
+Type = void *
+Value        Description
+-----        -----------
+NULL         Error mapping the band file
+non-NULL     Pointer to the first pixel of the band (line 0, sample 0)
+
+NOTES:
+  1. Bands opened with BAND_READ are mapped read-only.  Otherwise the mapping
+     is shared and writable, and changes are flushed to the file no later
+     than close_band_file.
+  2. Mapping an already mapped band returns the existing mapping.
+*****************************************************************************/
+void *map_band_file
+(
+    Espa_band_file_t *band   /* I: band handle to be memory-mapped */
+)
+{
+    char FUNC_NAME[] = "map_band_file"; /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    int prot;                /* memory protection for the mapping */
+    void *map = NULL;        /* memory-mapped view of the band */
+
+    if (band->map != NULL)
+        return band->map;
+
+    prot = PROT_READ;
+    if (band->access != BAND_READ)
+        prot |= PROT_WRITE;
+
+    map = mmap (NULL, band->band_size, prot, MAP_SHARED, band->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Memory-mapping raw binary band "
+            "file %s.", band->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return NULL;
+    }
+
+    /* Bands are typically walked top to bottom */
+    madvise (map, band->band_size, MADV_SEQUENTIAL);
+
+    band->map = map;
+    return band->map;
+}
+
+
+/******************************************************************************
+MODULE: band_line_ptr
+
+PURPOSE: Returns a pointer to the start of the specified line in a
+memory-mapped band.
+
+RETURN VALUE:
+Type = void *
+Value        Description
+-----        -----------
+NULL         The band is not mapped or the line is out of range
+non-NULL     Pointer to the first pixel of the line
+
+NOTES:
+*****************************************************************************/
+void *band_line_ptr
+(
+    Espa_band_file_t *band,  /* I: memory-mapped band handle */
+    int line                 /* I: line to point to (0-based) */
+)
+{
+    if (band->map == NULL || line < 0 || line >= band->nlines)
+        return NULL;
+
+    return (char *) band->map + (size_t) line * band->line_size;
+}
+
+
+/******************************************************************************
+MODULE: close_band_file
+
+PURPOSE: Unmaps (if mapped) and closes the band file, and frees the band
+handle.
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred flushing or closing the band file
+SUCCESS      Closing was successful
+
+NOTES:
+*****************************************************************************/
+int close_band_file
+(
+    Espa_band_file_t *band   /* I: band handle to be closed and freed */
+)
+{
+    char FUNC_NAME[] = "close_band_file"; /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the filename
+                                   along with the message */
+    int status = SUCCESS;    /* return status */
+
+    if (band == NULL)
+        return SUCCESS;
+
+    if (band->map != NULL)
+    {
+        if (band->access != BAND_READ &&
+            msync (band->map, band->band_size, MS_SYNC) != 0)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Flushing the mapping of raw "
+                "binary band file %s.", band->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            status = ERROR;
+        }
+        munmap (band->map, band->band_size);
+    }
+
+    if (close (band->fd) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Closing raw binary band file %s.",
+            band->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+
+    free (band);
+    return status;
+}
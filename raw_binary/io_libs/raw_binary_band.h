@@ -0,0 +1,106 @@
+/*****************************************************************************
+FILE: raw_binary_band.h
+
+PURPOSE: Contains defines and structures for the band handle interface to
+the raw binary band files, supporting windowed (line/sample block) access
+and optional memory-mapped views of a band.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. A band handle is opened from the band metadata, so the dimensions and
+     data type of the band come from the XML and don't need to be passed
+     around by the caller.
+  2. Reads and writes are positional (pread/pwrite) so the handle keeps no
+     file position state between calls.
+*****************************************************************************/
+
+#ifndef RAW_BINARY_BAND_H
+#define RAW_BINARY_BAND_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+#include "error_handler.h"
+#include "espa_metadata.h"
+
+/* Access modes for the band handle */
+typedef enum {
+    BAND_READ,           /* read-only access to an existing band file */
+    BAND_WRITE,          /* create (or truncate) the band file for writing */
+    BAND_READ_WRITE      /* read and update an existing band file */
+} Espa_band_access_t;
+
+/* Band handle structure */
+typedef struct
+{
+    char file_name[STR_SIZE];   /* name of the raw binary band file */
+    int fd;                     /* file descriptor of the band file */
+    Espa_band_access_t access;  /* access mode the band was opened with */
+    int nlines;                 /* number of lines in the band */
+    int nsamps;                 /* number of samples in the band */
+    int nbytes;                 /* number of bytes per pixel */
+    size_t line_size;           /* number of bytes per line */
+    off_t band_size;            /* total number of bytes in the band */
+    void *map;                  /* memory-mapped view of the band; NULL if
+                                   the band has not been mapped */
+} Espa_band_file_t;
+
+/* Prototypes */
+int espa_data_type_size
+(
+    enum Espa_data_type data_type   /* I: ESPA data type */
+);
+
+Espa_band_file_t *open_band_file
+(
+    Espa_band_meta_t *bmeta,     /* I: metadata for the band to be opened;
+                                       file_name, nlines, nsamps, and
+                                       data_type are used */
+    Espa_band_access_t access    /* I: access mode for the band file */
+);
+
+int read_band_window
+(
+    Espa_band_file_t *band,  /* I: band handle to read from */
+    int start_line,          /* I: first line of the window (0-based) */
+    int start_samp,          /* I: first sample of the window (0-based) */
+    int nlines,              /* I: number of lines in the window */
+    int nsamps,              /* I: number of samples in the window */
+    void *buf                /* O: buffer of nlines * nsamps pixels
+                                   (sufficient space should already have
+                                   been allocated) */
+);
+
+int write_band_window
+(
+    Espa_band_file_t *band,  /* I: band handle to write to */
+    int start_line,          /* I: first line of the window (0-based) */
+    int start_samp,          /* I: first sample of the window (0-based) */
+    int nlines,              /* I: number of lines in the window */
+    int nsamps,              /* I: number of samples in the window */
+    const void *buf          /* I: buffer of nlines * nsamps pixels */
+);
+
+void *map_band_file
+(
+    Espa_band_file_t *band   /* I: band handle to be memory-mapped */
+);
+
+void *band_line_ptr
+(
+    Espa_band_file_t *band,  /* I: memory-mapped band handle */
+    int line                 /* I: line to point to (0-based) */
+);
+
+int close_band_file
+(
+    Espa_band_file_t *band   /* I: band handle to be closed and freed */
+);
+
+#endif
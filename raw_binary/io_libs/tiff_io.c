@@ -18,6 +18,39 @@ NOTES:
 /* TIFF_READ_FORMAT, TIFF_WRITE_FORMAT, TIFF_READ_WRITE_FORMAT */
 const char tiff_format[][3] = {"r", "w", "a"};
 
+/* Tag extender which was installed before ours, to be chained */
+static TIFFExtendProc parent_extender = NULL;
+
+
+/******************************************************************************
+MODULE: espa_tag_extender
+
+PURPOSE: Registers the custom (non-baseline) Tiff tags written by ESPA with
+the Tiff file.  Called by libtiff each time a Tiff file is opened.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+*****************************************************************************/
+static void espa_tag_extender
+(
+    TIFF *tiff       /* I: pointer to Tiff file being opened */
+)
+{
+    static const TIFFFieldInfo espa_field_info[] =
+    {
+        {TIFFTAG_GDAL_NODATA, -1, -1, TIFF_ASCII, FIELD_CUSTOM, 1, 0,
+         "GDALNoDataValue"}
+    };
+
+    TIFFMergeFieldInfo (tiff, espa_field_info,
+        sizeof (espa_field_info) / sizeof (espa_field_info[0]));
+
+    if (parent_extender != NULL)
+        (*parent_extender) (tiff);
+}
+
 
 /******************************************************************************
 MODULE: set_geotiff_datum
@@ -521,7 +554,8 @@ int set_geotiff_tags
 /******************************************************************************
 MODULE: set_tiff_tags
 
-PURPOSE: Sets the Tiff tags for the current Tiff pointer
+PURPOSE: Sets the Tiff tags for the current Tiff pointer, using the default
+(uncompressed, one-line strip) layout
 
 RETURN VALUE:
 Type = N/A
@@ -537,19 +571,88 @@ void set_tiff_tags
     int nsamps       /* I: number of samples */
 )
 {
+    /* The default layout can't fail */
+    set_tiff_output_tags (tiff, data_type, nlines, nsamps, NULL);
+}
+
+
+/******************************************************************************
+MODULE: init_tiff_output_opts
+
+PURPOSE: Initializes the Tiff output options to the defaults of no
+compression, one-line strips, and no overviews
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+*****************************************************************************/
+void init_tiff_output_opts
+(
+    Tiff_output_opts_t *opts  /* O: output options set to the defaults */
+)
+{
+    opts->compress = TIFF_COMPRESS_NONE;
+    opts->compress_level = 0;
+    opts->predictor = false;
+    opts->tile_size = 0;
+    opts->noverviews = 0;
+}
+
+
+/******************************************************************************
+MODULE: set_tiff_output_tags
+
+PURPOSE: Sets the Tiff tags for the current Tiff pointer, including the
+layout (strips or tiles) and compression tags from the output options
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        Invalid options, or the codec is not available in libtiff
+SUCCESS      Setting the tags was successful
+
+NOTES:
+  1. The predictor is horizontal differencing for integer data and the
+     floating point predictor for float data.  It is ignored for
+     uncompressed output.
+*****************************************************************************/
+int set_tiff_output_tags
+(
+    TIFF *tiff,               /* I: pointer to Tiff file */
+    int data_type,            /* I: data type of this band (see ESPA_* in
+                                    espa_metadata.h) */
+    int nlines,               /* I: number of lines */
+    int nsamps,               /* I: number of samples */
+    Tiff_output_opts_t *opts  /* I: output layout and compression options;
+                                    NULL for the defaults */
+)
+{
+    char FUNC_NAME[] = "set_tiff_output_tags"; /* function name */
+    char errmsg[STR_SIZE];      /* error message */
     int samps_per_pixel = 1;    /* number of samples per pixel */
     int rows_per_strip = 1;     /* number of rows written to a strip */
+    int compression;            /* libtiff compression scheme */
+    int predictor;              /* libtiff predictor */
+    bool is_float;              /* is this a floating point data type? */
+    Tiff_output_opts_t def_opts;  /* default output options */
+
+    if (opts == NULL)
+    {
+        init_tiff_output_opts (&def_opts);
+        opts = &def_opts;
+    }
 
     /* Set the Tiff tags based on the input and some known defaults */
     TIFFSetField (tiff, TIFFTAG_SOFTWARE, "ESPA");
     TIFFSetField (tiff, TIFFTAG_IMAGEWIDTH, nsamps);
     TIFFSetField (tiff, TIFFTAG_IMAGELENGTH, nlines);
-    TIFFSetField (tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
     TIFFSetField (tiff, TIFFTAG_SAMPLESPERPIXEL, samps_per_pixel);
-    TIFFSetField (tiff, TIFFTAG_ROWSPERSTRIP,rows_per_strip);
     TIFFSetField (tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
     TIFFSetField (tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
 
+    is_float = false;
     switch (data_type)
     {
         case ESPA_INT8:
@@ -579,12 +682,112 @@ void set_tiff_tags
         case ESPA_FLOAT32:
             TIFFSetField (tiff, TIFFTAG_BITSPERSAMPLE, 32);
             TIFFSetField (tiff, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+            is_float = true;
             break;
         case ESPA_FLOAT64:
             TIFFSetField (tiff, TIFFTAG_BITSPERSAMPLE, 64);
             TIFFSetField (tiff, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+            is_float = true;
+            break;
+    }
+
+    /* Set up the compression */
+    switch (opts->compress)
+    {
+        case TIFF_COMPRESS_NONE:
+            compression = COMPRESSION_NONE;
+            break;
+        case TIFF_COMPRESS_DEFLATE:
+            compression = COMPRESSION_ADOBE_DEFLATE;
+            break;
+        case TIFF_COMPRESS_LZW:
+            compression = COMPRESSION_LZW;
             break;
+        case TIFF_COMPRESS_ZSTD:
+#ifdef COMPRESSION_ZSTD
+            compression = COMPRESSION_ZSTD;
+            break;
+#else
+            snprintf (errmsg, sizeof (errmsg), "ZSTD compression is not "
+                "supported by this version of libtiff");
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+#endif
+        default:
+            snprintf (errmsg, sizeof (errmsg), "Unsupported compression type "
+                "%d", opts->compress);
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+    }
+
+    if (!TIFFIsCODECConfigured (compression))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Compression type %d is not "
+            "configured in libtiff", opts->compress);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+    TIFFSetField (tiff, TIFFTAG_COMPRESSION, compression);
+
+    /* Make sure the compression level is valid for the codec; only DEFLATE
+       and ZSTD take a level */
+    if (opts->compress_level < 0 ||
+        (opts->compress_level > 0 && opts->compress != TIFF_COMPRESS_DEFLATE
+         && opts->compress != TIFF_COMPRESS_ZSTD) ||
+        (opts->compress == TIFF_COMPRESS_DEFLATE &&
+         opts->compress_level > TIFF_MAX_DEFLATE_LEVEL) ||
+        (opts->compress == TIFF_COMPRESS_ZSTD &&
+         opts->compress_level > TIFF_MAX_ZSTD_LEVEL))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Compression level %d is not "
+            "valid for compression type %d", opts->compress_level,
+            opts->compress);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    /* Set up the layout; tiles or strips.  Uncompressed strips are one line,
+       but compressed strips use the libtiff default size (about 8K bytes)
+       since one-line strips compress poorly. */
+    if (opts->tile_size > 0)
+    {
+        if (opts->tile_size % 16 != 0)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Tile size %d is not a "
+                "multiple of 16", opts->tile_size);
+            error_handler (true, FUNC_NAME, errmsg);
+            return ERROR;
+        }
+        TIFFSetField (tiff, TIFFTAG_TILEWIDTH, opts->tile_size);
+        TIFFSetField (tiff, TIFFTAG_TILELENGTH, opts->tile_size);
+    }
+    else
+    {
+        if (compression != COMPRESSION_NONE)
+            rows_per_strip = TIFFDefaultStripSize (tiff, 0);
+        TIFFSetField (tiff, TIFFTAG_ROWSPERSTRIP, rows_per_strip);
+    }
+
+    if (compression == COMPRESSION_NONE)
+        return SUCCESS;
+
+    if (opts->predictor)
+    {
+        predictor = is_float ? PREDICTOR_FLOATINGPOINT : PREDICTOR_HORIZONTAL;
+        TIFFSetField (tiff, TIFFTAG_PREDICTOR, predictor);
+    }
+
+    if (opts->compress_level > 0)
+    {
+        if (opts->compress == TIFF_COMPRESS_DEFLATE)
+            TIFFSetField (tiff, TIFFTAG_ZIPQUALITY, opts->compress_level);
+#ifdef COMPRESSION_ZSTD
+        else if (opts->compress == TIFF_COMPRESS_ZSTD)
+            TIFFSetField (tiff, TIFFTAG_ZSTD_LEVEL, opts->compress_level);
+#endif
     }
+
+    return SUCCESS;
 }
 
 
@@ -613,9 +816,23 @@ TIFF *open_tiff
     char FUNC_NAME[] = "open_tiff"; /* function name */
     char errmsg[STR_SIZE];   /* error message */
     TIFF *tiff = NULL;       /* pointer to the Tiff file */
-
-    /* Open the file with the specified access type */
-    tiff = XTIFFOpen (tiff_file, access_type);
+    static bool extender_set = false;  /* has the tag extender been set? */
+
+    /* Register the ESPA custom tags before the first file is opened, then
+       open the file with the specified access type.  The tag extenders
+       (ours and libgeotiff's) are installed on first use without locking, so
+       opens are serialized when bands are processed in parallel. */
+#ifdef _OPENMP
+    #pragma omp critical (espa_open_tiff)
+#endif
+    {
+        if (!extender_set)
+        {
+            parent_extender = TIFFSetTagExtender (espa_tag_extender);
+            extender_set = true;
+        }
+        tiff = XTIFFOpen (tiff_file, access_type);
+    }
     if (tiff == NULL)
     {
         sprintf (errmsg, "Opening Tiff file %s with %s access.", tiff_file,
@@ -649,9 +866,224 @@ void close_tiff
 
 
 /******************************************************************************
-MODULE: write_tiff
+MODULE: set_tiff_nodata
 
-PURPOSE: Writes nlines of data to the Tiff file
+PURPOSE: Sets the GDAL nodata tag for the current Tiff pointer to the
+specified fill value
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred setting the nodata tag
+SUCCESS      Setting the tag was successful
+
+NOTES:
+  1. The tag is registered by open_tiff, so the Tiff file must have been
+     opened via open_tiff.
+*****************************************************************************/
+int set_tiff_nodata
+(
+    TIFF *tiff,          /* I: pointer to Tiff file */
+    long fill_value      /* I: fill value to be written as the nodata tag */
+)
+{
+    char FUNC_NAME[] = "set_tiff_nodata"; /* function name */
+    char errmsg[STR_SIZE];      /* error message */
+    char nodata[STR_SIZE];      /* nodata value as an ASCII string */
+
+    sprintf (nodata, "%ld", fill_value);
+    if (TIFFSetField (tiff, TIFFTAG_GDAL_NODATA, nodata) != 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Setting the nodata tag to %ld",
+            fill_value);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: write_tiff_world_file
+
+PURPOSE: Writes the ESRI world file (.tfw) for the GeoTiff band
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred writing the world file
+SUCCESS      Writing was successful
+
+NOTES:
+  1. The world file references the center of the UL pixel, consistent with
+     the RasterPixelIsPoint tiepoint written by set_geotiff_tags.
+*****************************************************************************/
+int write_tiff_world_file
+(
+    char *tfw_file,              /* I: name of the world file to be written */
+    Espa_band_meta_t *bmeta,     /* I: band metadata */
+    Espa_proj_meta_t *proj_info  /* I: global projection information */
+)
+{
+    char FUNC_NAME[] = "write_tiff_world_file"; /* function name */
+    char errmsg[STR_SIZE];      /* error message */
+    double ul_x, ul_y;          /* center of the UL pixel */
+    FILE *fp = NULL;            /* pointer to the world file */
+
+    if (!strcmp (proj_info->grid_origin, "CENTER"))
+    {  /* projection corners represent center of the pixel */
+        ul_x = proj_info->ul_corner[0];
+        ul_y = proj_info->ul_corner[1];
+    }
+    else
+    {  /* projection corners represent UL corner of the pixel */
+        ul_x = proj_info->ul_corner[0] + 0.5 * bmeta->pixel_size[0];
+        ul_y = proj_info->ul_corner[1] - 0.5 * bmeta->pixel_size[1];
+    }
+
+    fp = fopen (tfw_file, "w");
+    if (fp == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening world file %s for "
+            "writing.", tfw_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    /* x pixel size, rotation terms, negative y pixel size, UL center */
+    fprintf (fp, "%.10f\n", bmeta->pixel_size[0]);
+    fprintf (fp, "%.10f\n", 0.0);
+    fprintf (fp, "%.10f\n", 0.0);
+    fprintf (fp, "%.10f\n", -bmeta->pixel_size[1]);
+    fprintf (fp, "%.10f\n", ul_x);
+    fprintf (fp, "%.10f\n", ul_y);
+
+    if (fclose (fp) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Closing world file %s.", tfw_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: write_tiff_tiles
+
+PURPOSE: Writes a block of whole tile rows to a tiled Tiff file
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred writing data to the Tiff file
+SUCCESS      Writing was successful
+
+NOTES:
+*****************************************************************************/
+static int write_tiff_tiles
+(
+    TIFF *tiff,      /* I: pointer to the tiled Tiff file */
+    int nbytes,      /* I: number of bytes per pixel */
+    int start_line,  /* I: first line in the Tiff file to be written */
+    int nlines,      /* I: number of lines to write to the file */
+    int nsamps,      /* I: number of samples to write to the file */
+    void *img_buf    /* I: array of nlines * nsamps * nbytes to be written */
+)
+{
+    char FUNC_NAME[] = "write_tiff_tiles"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    uint32_t tile_width;     /* width of the tiles */
+    uint32_t tile_length;    /* length of the tiles */
+    uint32_t image_length;   /* number of lines in the Tiff file */
+    int tline, tsamp;        /* starting line/sample of the current tile */
+    int line;                /* looping variable for lines in a tile */
+    int ncopy_lines;         /* number of image lines in the current tile */
+    int ncopy_samps;         /* number of image samples in the current tile */
+    size_t line_size;        /* number of bytes per image line */
+    size_t tile_line_size;   /* number of bytes per tile line */
+    size_t tile_size;        /* number of bytes per tile */
+    char *tile_buf = NULL;   /* buffer for a single padded tile */
+    char *src = (char *) img_buf;  /* byte pointer to the image buffer */
+
+    TIFFGetField (tiff, TIFFTAG_TILEWIDTH, &tile_width);
+    TIFFGetField (tiff, TIFFTAG_TILELENGTH, &tile_length);
+    TIFFGetField (tiff, TIFFTAG_IMAGELENGTH, &image_length);
+
+    if (start_line % tile_length != 0 ||
+        (nlines % tile_length != 0 &&
+         (uint32_t) (start_line + nlines) != image_length))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Lines %d-%d do not cover whole "
+            "rows of %u-line tiles", start_line, start_line + nlines - 1,
+            tile_length);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    line_size = (size_t) nsamps * nbytes;
+    tile_line_size = (size_t) tile_width * nbytes;
+    tile_size = tile_line_size * tile_length;
+    tile_buf = calloc (tile_size, 1);
+    if (tile_buf == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory for the tile "
+            "buffer");
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    for (tline = 0; tline < nlines; tline += tile_length)
+    {
+        ncopy_lines = nlines - tline;
+        if (ncopy_lines > (int) tile_length)
+            ncopy_lines = tile_length;
+
+        for (tsamp = 0; tsamp < nsamps; tsamp += tile_width)
+        {
+            ncopy_samps = nsamps - tsamp;
+            if (ncopy_samps > (int) tile_width)
+                ncopy_samps = tile_width;
+
+            /* Only the partial tiles on the right or bottom edge need the
+               padding cleared */
+            if (ncopy_lines < (int) tile_length ||
+                ncopy_samps < (int) tile_width)
+                memset (tile_buf, 0, tile_size);
+
+            for (line = 0; line < ncopy_lines; line++)
+                memcpy (&tile_buf[line * tile_line_size],
+                    &src[(tline + line) * line_size + (size_t) tsamp * nbytes],
+                    (size_t) ncopy_samps * nbytes);
+
+            if (TIFFWriteEncodedTile (tiff, TIFFComputeTile (tiff, tsamp,
+                start_line + tline, 0, 0), tile_buf, tile_size) < 0)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Writing the tile at line "
+                    "%d, sample %d to the Tiff file.", start_line + tline,
+                    tsamp);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (tile_buf);
+                return ERROR;
+            }
+        }
+    }
+
+    free (tile_buf);
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: write_tiff_lines
+
+PURPOSE: Writes nlines of data to the Tiff file, starting at the specified
+line
  
 RETURN VALUE:
 Type = int
@@ -661,74 +1093,242 @@ ERROR        An error occurred writing data to the Tiff file
 SUCCESS      Writing was successful
 
 NOTES:
+  1. Strip-organized Tiff files must be written sequentially, so successive
+     calls should cover the lines in increasing order.
+  2. For tiled Tiff files the block of lines must start on a tile row and
+     cover whole tile rows, other than the last block in the image.  Each
+     tile is padded out to the full tile size before it is written.
 *****************************************************************************/
-int write_tiff
+int write_tiff_lines
 (
     TIFF *tiff,      /* I: pointer to the Tiff file */
     int data_type,   /* I: data type of the array to be written (see
                            Espa_data_type in espa_metadata.h) */
+    int start_line,  /* I: first line in the Tiff file to be written */
     int nlines,      /* I: number of lines to write to the file */
     int nsamps,      /* I: number of samples to write to the file */
     void *img_buf    /* I: array of nlines * nsamps * size to be written to the
                            Tiff file */
 )
 {
-    char FUNC_NAME[] = "write_tiff"; /* function name */
+    char FUNC_NAME[] = "write_tiff_lines"; /* function name */
     char errmsg[STR_SIZE];   /* error message */
     int line;                /* looping variable */
-    int curr_pix;            /* current pixel for start of line */
-    int8_t *int8_ptr = NULL;     /* pointer for int8 data types */
-    uint8_t *uint8_ptr = NULL;   /* pointer for uint8 data types */
-    int16_t *int16_ptr = NULL;   /* pointer for int16 data types */
-    uint16_t *uint16_ptr = NULL; /* pointer for uint16 data types */
-    int32_t *int32_ptr = NULL;   /* pointer for int32 data types */
-    uint32_t *uint32_ptr = NULL; /* pointer for uint32 data types */
-    float *float_ptr = NULL;     /* pointer for float data types */
-    double *double_ptr = NULL;   /* pointer for double data types */
-    void *void_ptr = NULL;       /* pointer to current line in img_buf */
+    int nbytes;              /* number of bytes per pixel */
+    size_t line_size;        /* number of bytes per line */
+    char *line_ptr = NULL;   /* pointer to current line in img_buf */
 
-    /* Set up the data type specific pointers */
-    switch (data_type)
+    nbytes = espa_data_type_size (data_type);
+    if (nbytes == ERROR)
     {
-        case ESPA_INT8: int8_ptr = img_buf; break;
-        case ESPA_UINT8: uint8_ptr = img_buf; break;
-        case ESPA_INT16: int16_ptr = img_buf; break;
-        case ESPA_UINT16: uint16_ptr = img_buf; break;
-        case ESPA_INT32: uint32_ptr = img_buf; break;
-        case ESPA_UINT32: uint32_ptr = img_buf; break;
-        case ESPA_FLOAT32: float_ptr = img_buf; break;
-        case ESPA_FLOAT64: double_ptr = img_buf; break;
-        default:
-            sprintf (errmsg, "Unsupported data type %d", data_type);
+        snprintf (errmsg, sizeof (errmsg), "Unsupported data type %d",
+            data_type);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+    line_size = (size_t) nsamps * nbytes;
+
+    /* Tiled files are written a tile at a time */
+    if (TIFFIsTiled (tiff))
+        return write_tiff_tiles (tiff, nbytes, start_line, nlines, nsamps,
+            img_buf);
+
+    /* Write the data to the Tiff file, one scanline at a time */
+    line_ptr = img_buf;
+    for (line = 0; line < nlines; line++)
+    {
+        if (TIFFWriteScanline (tiff, line_ptr, start_line + line, 0) < 0)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Writing line %d to the Tiff "
+                "file.", start_line + line);
             error_handler (true, FUNC_NAME, errmsg);
             return ERROR;
+        }
+        line_ptr += line_size;
     }
 
-    /* Write the data to the Tiff file. Use the void pointer to point to
-       the location of the current line in the data type specific pointer. */
-    for (line = 0; line < nlines; line++)
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE: write_tiff
+
+PURPOSE: Writes nlines of data to the Tiff file
+ 
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred writing data to the Tiff file
+SUCCESS      Writing was successful
+
+NOTES:
+*****************************************************************************/
+int write_tiff
+(
+    TIFF *tiff,      /* I: pointer to the Tiff file */
+    int data_type,   /* I: data type of the array to be written (see
+                           Espa_data_type in espa_metadata.h) */
+    int nlines,      /* I: number of lines to write to the file */
+    int nsamps,      /* I: number of samples to write to the file */
+    void *img_buf    /* I: array of nlines * nsamps * size to be written to the
+                           Tiff file */
+)
+{
+    return write_tiff_lines (tiff, data_type, 0, nlines, nsamps, img_buf);
+}
+
+
+/******************************************************************************
+MODULE: write_tiff_overviews
+
+PURPOSE: Finishes the full resolution image in the Tiff file and appends the
+requested number of reduced resolution overview images, each half the size
+of the previous one
+
+RETURN VALUE:
+Type = int
+Value        Description
+-----        -----------
+ERROR        An error occurred writing the overviews
+SUCCESS      Writing was successful
+
+NOTES:
+  1. The full resolution image must already be completely written, and the
+     source band is read back to build the overviews.
+  2. Overviews are nearest neighbor decimations of the source band, so fill
+     and QA values are preserved as-is.
+  3. Each overview is written as a separate IFD with the reduced image
+     subfile type, using the same layout and compression as the full
+     resolution image.
+*****************************************************************************/
+int write_tiff_overviews
+(
+    TIFF *tiff,                /* I: pointer to the Tiff file */
+    Espa_band_file_t *band,    /* I: source band handle, opened for reading */
+    int data_type,             /* I: data type of the band (see ESPA_* in
+                                     espa_metadata.h) */
+    Tiff_output_opts_t *opts   /* I: output options; noverviews specifies
+                                     the number of overview levels */
+)
+{
+    char FUNC_NAME[] = "write_tiff_overviews"; /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int level;                /* current overview level */
+    int factor;               /* decimation factor for the current level */
+    int ovr_nlines;           /* number of lines in the current overview */
+    int ovr_nsamps;           /* number of samples in the current overview */
+    int block_lines;          /* number of overview lines per write */
+    int start_line;           /* first overview line of the current block */
+    int nblock;               /* number of lines in the current block */
+    int line, samp;           /* looping variables */
+    int nbytes = band->nbytes;  /* number of bytes per pixel */
+    char *src_line = NULL;    /* full resolution source line */
+    char *ovr_buf = NULL;     /* block of overview lines */
+    char *ovr_ptr = NULL;     /* pointer to the current overview pixel */
+
+    if (opts == NULL || opts->noverviews <= 0)
+        return SUCCESS;
+
+    /* The reduction factor for each level is 1 << level */
+    if (opts->noverviews > TIFF_MAX_OVERVIEWS)
     {
-        curr_pix = line * nsamps;
-        switch (data_type)
+        snprintf (errmsg, sizeof (errmsg), "Number of overviews %d exceeds "
+            "the maximum of %d", opts->noverviews, TIFF_MAX_OVERVIEWS);
+        error_handler (true, FUNC_NAME, errmsg);
+        return ERROR;
+    }
+
+    /* Overview blocks must cover whole tile rows for tiled output */
+    block_lines = (opts->tile_size > 0) ? opts->tile_size : 256;
+
+    src_line = malloc (band->line_size);
+    ovr_buf = malloc ((size_t) block_lines * band->line_size);
+    if (src_line == NULL || ovr_buf == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory for the "
+            "overview buffers");
+        error_handler (true, FUNC_NAME, errmsg);
+        free (src_line);
+        free (ovr_buf);
+        return ERROR;
+    }
+
+    for (level = 1; level <= opts->noverviews; level++)
+    {
+        factor = 1 << level;
+        ovr_nlines = (band->nlines + factor - 1) / factor;
+        ovr_nsamps = (band->nsamps + factor - 1) / factor;
+
+        /* Close out the previous image and start the overview IFD */
+        if (!TIFFWriteDirectory (tiff))
         {
-            case ESPA_INT8: void_ptr = &int8_ptr[curr_pix]; break;
-            case ESPA_UINT8: void_ptr = &uint8_ptr[curr_pix]; break;
-            case ESPA_INT16: void_ptr = &int16_ptr[curr_pix]; break;
-            case ESPA_UINT16: void_ptr = &uint16_ptr[curr_pix]; break;
-            case ESPA_INT32: void_ptr = &int32_ptr[curr_pix]; break;
-            case ESPA_UINT32: void_ptr = &uint32_ptr[curr_pix]; break;
-            case ESPA_FLOAT32: void_ptr = &float_ptr[curr_pix]; break;
-            case ESPA_FLOAT64: void_ptr = &double_ptr[curr_pix]; break;
+            snprintf (errmsg, sizeof (errmsg), "Writing the Tiff directory "
+                "for overview level %d", level);
+            error_handler (true, FUNC_NAME, errmsg);
+            free (src_line);
+            free (ovr_buf);
+            return ERROR;
         }
 
-        if (TIFFWriteScanline (tiff, void_ptr, line, 0) < 0)
+        if (set_tiff_output_tags (tiff, data_type, ovr_nlines, ovr_nsamps,
+            opts) != SUCCESS)
         {
-            sprintf (errmsg, "Writing line %d to the Tiff file.", line);
+            snprintf (errmsg, sizeof (errmsg), "Setting the Tiff tags for "
+                "overview level %d", level);
             error_handler (true, FUNC_NAME, errmsg);
+            free (src_line);
+            free (ovr_buf);
             return ERROR;
         }
+        TIFFSetField (tiff, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+
+        for (start_line = 0; start_line < ovr_nlines;
+             start_line += block_lines)
+        {
+            nblock = ovr_nlines - start_line;
+            if (nblock > block_lines)
+                nblock = block_lines;
+
+            ovr_ptr = ovr_buf;
+            for (line = 0; line < nblock; line++)
+            {
+                if (read_band_window (band, (start_line + line) * factor, 0,
+                    1, band->nsamps, src_line) != SUCCESS)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Reading source line "
+                        "%d for overview level %d",
+                        (start_line + line) * factor, level);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    free (src_line);
+                    free (ovr_buf);
+                    return ERROR;
+                }
+
+                for (samp = 0; samp < ovr_nsamps; samp++)
+                {
+                    memcpy (ovr_ptr, &src_line[(size_t) samp * factor *
+                        nbytes], nbytes);
+                    ovr_ptr += nbytes;
+                }
+            }
+
+            if (write_tiff_lines (tiff, data_type, start_line, nblock,
+                ovr_nsamps, ovr_buf) != SUCCESS)
+            {
+                snprintf (errmsg, sizeof (errmsg), "Writing overview level %d",
+                    level);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (src_line);
+                free (ovr_buf);
+                return ERROR;
+            }
+        }
     }
 
+    free (src_line);
+    free (ovr_buf);
     return SUCCESS;
 }
 
@@ -23,15 +23,50 @@ NOTES:
 #include "geotiffio.h"
 #include "espa_metadata.h"
 #include "parse_metadata.h"
+#include "raw_binary_band.h"
 #include "error_handler.h"
 
 /* Defines */
+/* GDAL private tag holding the nodata value as an ASCII string; recognized
+   by GDAL-based readers */
+#define TIFFTAG_GDAL_NODATA 42113
+
 typedef enum {
   TIFF_READ_FORMAT,
   TIFF_WRITE_FORMAT,
   TIFF_READ_WRITE_FORMAT,
 } Tiff_format_t;
 
+/* Valid compression levels for the codecs which take a level, and the
+   maximum number of overview levels (each level halves the size) */
+#define TIFF_MAX_DEFLATE_LEVEL 9
+#define TIFF_MAX_ZSTD_LEVEL 22
+#define TIFF_MAX_OVERVIEWS 16
+
+/* Compression schemes supported for Tiff output */
+typedef enum {
+  TIFF_COMPRESS_NONE,
+  TIFF_COMPRESS_DEFLATE,
+  TIFF_COMPRESS_LZW,
+  TIFF_COMPRESS_ZSTD
+} Tiff_compress_t;
+
+/* Output layout and compression options for writing Tiff files */
+typedef struct
+{
+    Tiff_compress_t compress;  /* compression scheme */
+    int compress_level;        /* DEFLATE (1-9) or ZSTD (1-22) level; 0 uses
+                                  the library default */
+    bool predictor;            /* apply the horizontal (integer) or floating
+                                  point predictor before compressing */
+    int tile_size;             /* width and length of square tiles, which
+                                  must be a multiple of 16; 0 writes strips
+                                  (one-line strips when uncompressed) */
+    int noverviews;            /* number of internal overview levels, each
+                                  reduced by a factor of 2 (0 to
+                                  TIFF_MAX_OVERVIEWS) */
+} Tiff_output_opts_t;
+
 /* Prototypes */
 int set_geotiff_datum
 (
@@ -56,6 +91,33 @@ void set_tiff_tags
     int nsamps              /* I: number of samples */
 );
 
+void init_tiff_output_opts
+(
+    Tiff_output_opts_t *opts  /* O: output options set to the defaults */
+);
+
+int set_tiff_output_tags
+(
+    TIFF *tiff_fptr,          /* I: pointer to Tiff file */
+    int data_type,            /* I: data type of this band (see ESPA_* in
+                                    espa_metadata.h) */
+    int nlines,               /* I: number of lines */
+    int nsamps,               /* I: number of samples */
+    Tiff_output_opts_t *opts  /* I: output layout and compression options;
+                                    NULL for the defaults */
+);
+
+int write_tiff_overviews
+(
+    TIFF *tiff_fptr,          /* I: pointer to Tiff file, with the full
+                                    resolution image already written */
+    Espa_band_file_t *band,   /* I: raw binary band holding the full
+                                    resolution image */
+    int data_type,            /* I: data type of this band (see ESPA_* in
+                                    espa_metadata.h) */
+    Tiff_output_opts_t *opts  /* I: output layout and compression options */
+);
+
 TIFF *open_tiff
 (
     char *tiff_file,     /* I: name of the input Tiff file to be opened */
@@ -69,6 +131,31 @@ void close_tiff
     TIFF *tiff_fptr    /* I: pointer to Tiff file to be closed */
 );
 
+int set_tiff_nodata
+(
+    TIFF *tiff_fptr,     /* I: pointer to Tiff file */
+    long fill_value      /* I: fill value to be written as the nodata tag */
+);
+
+int write_tiff_world_file
+(
+    char *tfw_file,              /* I: name of the world file to be written */
+    Espa_band_meta_t *bmeta,     /* I: band metadata */
+    Espa_proj_meta_t *proj_info  /* I: global projection information */
+);
+
+int write_tiff_lines
+(
+    TIFF *tif_fptr,  /* I: pointer to the Tiff file */
+    int data_type,   /* I: data type of the array to be written (see
+                           Espa_data_type in espa_metadata.h) */
+    int start_line,  /* I: first line in the Tiff file to be written */
+    int nlines,      /* I: number of lines to write to the file */
+    int nsamps,      /* I: number of samples to write to the file */
+    void *img_buf    /* I: array of nlines * nsamps * size to be written to the
+                           Tiff file */
+);
+
 int write_tiff
 (
     TIFF *tif_fptr,  /* I: pointer to the Tiff file */
@@ -1,6 +1,6 @@
 /*****************************************************************************
 FILE: write_metadata.c
-  
+
 PURPOSE: Contains functions for writing/appending the ESPA internal metadata
 files along with printing to stdout.
 
@@ -14,125 +14,294 @@ NOTES:
      metadata format found in ESPA Raw Binary Format v1.2.doc.  The schema for
      the ESPA internal metadata format is available at
      http://espa.cr.usgs.gov/schema/espa_internal_metadata_v1_2.xsd.
+  2. The XML is built in memory and written with a single write to a
+     temporary file, which is then renamed over the XML file.  Readers never
+     see a partially written XML file.
+  3. Writers hold an exclusive lock on the directory of the XML file from
+     reading the current XML through renaming the new one into place, so
+     tools updating the same XML file at the same time don't lose each
+     other's bands.  If the directory can't be locked, a warning is printed
+     and the XML file is updated unlocked.
 *****************************************************************************/
 
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "parse_metadata.h"
 #include "write_metadata.h"
 
+/* Number of bytes initially allocated for the XML buffer, which is doubled
+   as needed.  This holds a typical Landsat XML file without growing. */
+#define XML_INIT_ALLOC 65536
+
+/* Number of bands initially allocated in a metadata update, which is doubled
+   as needed */
+#define UPDATE_INIT_ALLOC 8
+
+/* In-memory XML file being built */
+typedef struct
+{
+    char *data;             /* XML text; not NUL terminated */
+    size_t size;            /* number of bytes used in data */
+    size_t alloc;           /* number of bytes allocated for data */
+    bool error;             /* did an allocation fail */
+} Xml_buffer_t;
+
 /******************************************************************************
-MODULE:  write_metadata
+MODULE:  reserve_xml
 
-PURPOSE: Write the metadata structure to the specified XML metadata file
+PURPOSE: Makes sure there is room for the specified number of bytes at the
+end of the XML buffer.
 
 RETURN VALUE:
-Type = int
+Type = bool
 Value           Description
 -----           -----------
-ERROR           Error writing the metadata file
-SUCCESS         Successfully wrote the metadata file
+true            The space is available
+false           The buffer couldn't be grown; the error flag is set
 
 NOTES:
-  1. If the XML file specified already exists, it will be overwritten.
-  2. Use this routine to create a new metadata file.  To append bands to an
-     existing metadata file, use append_metadata.
-  3. It is recommended that validate_meta be used after writing the XML file
-     to make sure the new file is valid against the ESPA schema.
 ******************************************************************************/
-int write_metadata
+static bool reserve_xml
 (
-    Espa_internal_meta_t *metadata,  /* I: input metadata structure to be
-                                           written to XML */
-    char *xml_file                   /* I: name of the XML metadata file to
-                                           be written to or overwritten */
+    Xml_buffer_t *buf,      /* I/O: XML buffer */
+    size_t size             /* I: number of bytes needed */
 )
 {
-    char FUNC_NAME[] = "write_metadata";       /* function name */
-    char errmsg[STR_SIZE];   /* error message */
-    char myproj[STR_SIZE];   /* projection type string */
-    char mydatum[STR_SIZE];  /* datum string */
-    char my_dtype[STR_SIZE]; /* data type string */
-    char my_rtype[STR_SIZE]; /* resampling type string */
-    int i, j;                /* looping variables */
-    FILE *fptr = NULL;       /* file pointer to the XML metadata file */
-    Espa_global_meta_t *gmeta = &metadata->global;  /* pointer to the global
-                                                       metadata structure */
-    Espa_band_meta_t *bmeta = metadata->band;  /* pointer to the array of
-                                                  bands metadata */
-
-    /* Open the metadata XML file for write or rewrite privelages */
-    fptr = fopen (xml_file, "w");
-    if (fptr == NULL)
-    {
-        sprintf (errmsg, "Opening %s for write access.", xml_file);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
+    size_t new_alloc;       /* new size of the buffer */
+    char *new_data;         /* reallocated buffer */
+
+    if (buf->error)
+        return (false);
+    if (buf->size + size <= buf->alloc)
+        return (true);
+
+    new_alloc = buf->alloc > 0 ? buf->alloc : XML_INIT_ALLOC;
+    while (buf->size + size > new_alloc)
+        new_alloc *= 2;
+
+    new_data = realloc (buf->data, new_alloc);
+    if (new_data == NULL)
+    {
+        buf->error = true;
+        return (false);
+    }
+    buf->data = new_data;
+    buf->alloc = new_alloc;
+
+    return (true);
+}
+
+
+/******************************************************************************
+MODULE:  put_bytes
+
+PURPOSE: Appends bytes to the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_bytes
+(
+    Xml_buffer_t *buf,      /* I/O: XML buffer */
+    const char *data,       /* I: bytes to append */
+    size_t size             /* I: number of bytes */
+)
+{
+    if (!reserve_xml (buf, size))
+        return;
+
+    memcpy (buf->data + buf->size, data, size);
+    buf->size += size;
+}
+
+
+/******************************************************************************
+MODULE:  put_str
+
+PURPOSE: Appends a string to the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_str
+(
+    Xml_buffer_t *buf,      /* I/O: XML buffer */
+    const char *str         /* I: string to append */
+)
+{
+    put_bytes (buf, str, strlen (str));
+}
+
+
+/******************************************************************************
+MODULE:  put_fmt
+
+PURPOSE: Appends formatted text to the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The text is formatted straight into the buffer.  Only the numeric
+     values are written this way; strings are copied with put_str.
+******************************************************************************/
+static void put_fmt
+(
+    Xml_buffer_t *buf,      /* I/O: XML buffer */
+    const char *format,     /* I: printf format */
+    ...                     /* I: values to format */
+)
+{
+    va_list ap;             /* variable argument list */
+    int count;              /* number of characters formatted */
+    size_t room;            /* number of bytes available in the buffer */
+
+    if (!reserve_xml (buf, STR_SIZE))
+        return;
+
+    room = buf->alloc - buf->size;
+    va_start (ap, format);
+    count = vsnprintf (buf->data + buf->size, room, format, ap);
+    va_end (ap);
+    if (count < 0)
+    {
+        buf->error = true;
+        return;
+    }
+
+    /* Grow the buffer and format again if it didn't fit */
+    if ((size_t) count >= room)
+    {
+        if (!reserve_xml (buf, count + 1))
+            return;
+        va_start (ap, format);
+        vsnprintf (buf->data + buf->size, count + 1, format, ap);
+        va_end (ap);
     }
 
+    buf->size += count;
+}
+
+
+/******************************************************************************
+MODULE:  put_element
+
+PURPOSE: Appends a text-valued element on its own line to the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_element
+(
+    Xml_buffer_t *buf,      /* I/O: XML buffer */
+    const char *indent,     /* I: indentation for the element */
+    const char *name,       /* I: element name */
+    const char *value       /* I: element text */
+)
+{
+    put_str (buf, indent);
+    put_str (buf, "<");
+    put_str (buf, name);
+    put_str (buf, ">");
+    put_str (buf, value);
+    put_str (buf, "</");
+    put_str (buf, name);
+    put_str (buf, ">\n");
+}
+
+
+/******************************************************************************
+MODULE:  put_global_xml
+
+PURPOSE: Appends the XML header and the global metadata to the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_global_xml
+(
+    Xml_buffer_t *buf,                /* I/O: XML buffer */
+    Espa_global_meta_t *gmeta         /* I: global metadata */
+)
+{
+    const char *myproj;      /* projection type string */
+    const char *mydatum;     /* datum string */
+
     /* Write the overall header */
-    fprintf (fptr,
+    put_str (buf,
         "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n\n"
-        "<espa_metadata version=\"%s\"\n"
-        "xmlns=\"%s\"\n"
+        "<espa_metadata version=\"" ESPA_SCHEMA_VERSION "\"\n"
+        "xmlns=\"" ESPA_NS "\"\n"
         "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\n"
-        "xsi:schemaLocation=\"%s %s\">\n\n", ESPA_SCHEMA_VERSION, ESPA_NS,
-        ESPA_SCHEMA_LOCATION, ESPA_SCHEMA);
+        "xsi:schemaLocation=\"" ESPA_SCHEMA_LOCATION " " ESPA_SCHEMA "\">\n\n");
 
     /* Write the global metadata */
-    fprintf (fptr,
-        "    <global_metadata>\n"
-        "        <data_provider>%s</data_provider>\n"
-        "        <satellite>%s</satellite>\n"
-        "        <instrument>%s</instrument>\n",
-        gmeta->data_provider, gmeta->satellite, gmeta->instrument);
+    put_str (buf, "    <global_metadata>\n");
+    put_element (buf, "        ", "data_provider", gmeta->data_provider);
+    put_element (buf, "        ", "satellite", gmeta->satellite);
+    put_element (buf, "        ", "instrument", gmeta->instrument);
 
     if (strcmp (gmeta->acquisition_date, ESPA_STRING_META_FILL))
-        fprintf (fptr,
-        "        <acquisition_date>%s</acquisition_date>\n",
-        gmeta->acquisition_date);
+        put_element (buf, "        ", "acquisition_date",
+            gmeta->acquisition_date);
 
     if (strcmp (gmeta->scene_center_time, ESPA_STRING_META_FILL))
-        fprintf (fptr,
-        "        <scene_center_time>%s</scene_center_time>\n",
-        gmeta->scene_center_time);
+        put_element (buf, "        ", "scene_center_time",
+            gmeta->scene_center_time);
 
     if (strcmp (gmeta->level1_production_date, ESPA_STRING_META_FILL))
-        fprintf (fptr,
-        "        <level1_production_date>%s</level1_production_date>\n",
-        gmeta->level1_production_date);
+        put_element (buf, "        ", "level1_production_date",
+            gmeta->level1_production_date);
 
     if (fabs (gmeta->solar_azimuth - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
         fabs (gmeta->solar_zenith - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        fprintf (fptr,
-        "        <solar_angles zenith=\"%f\" azimuth=\"%f\" units=\"%s\"/>\n",
-        gmeta->solar_zenith, gmeta->solar_azimuth, gmeta->solar_units);
+    {
+        put_fmt (buf,
+            "        <solar_angles zenith=\"%f\" azimuth=\"%f\" units=\"",
+            gmeta->solar_zenith, gmeta->solar_azimuth);
+        put_str (buf, gmeta->solar_units);
+        put_str (buf, "\"/>\n");
+    }
 
     if (fabs (gmeta->earth_sun_dist - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        fprintf (fptr,
-        "        <earth_sun_distance>%f</earth_sun_distance>\n",
-        gmeta->earth_sun_dist);
+        put_fmt (buf,
+            "        <earth_sun_distance>%f</earth_sun_distance>\n",
+            gmeta->earth_sun_dist);
 
     if (gmeta->wrs_system != ESPA_INT_META_FILL)
-        fprintf (fptr,
-        "        <wrs system=\"%d\" path=\"%d\" row=\"%d\"/>\n",
-        gmeta->wrs_system, gmeta->wrs_path, gmeta->wrs_row);
+        put_fmt (buf,
+            "        <wrs system=\"%d\" path=\"%d\" row=\"%d\"/>\n",
+            gmeta->wrs_system, gmeta->wrs_path, gmeta->wrs_row);
 
     if (gmeta->htile != ESPA_INT_META_FILL &&
         gmeta->vtile != ESPA_INT_META_FILL)
-        fprintf (fptr,
-        "        <modis htile=\"%d\" vtile=\"%d\"/>\n",
-        gmeta->htile, gmeta->vtile);
+        put_fmt (buf,
+            "        <modis htile=\"%d\" vtile=\"%d\"/>\n",
+            gmeta->htile, gmeta->vtile);
 
     if (strcmp (gmeta->product_id, ESPA_STRING_META_FILL))
-        fprintf (fptr,
-        "        <product_id>%s</product_id>\n", gmeta->product_id);
+        put_element (buf, "        ", "product_id", gmeta->product_id);
 
     if (strcmp (gmeta->lpgs_metadata_file, ESPA_STRING_META_FILL))
-        fprintf (fptr,
-        "        <lpgs_metadata_file>%s</lpgs_metadata_file>\n",
-        gmeta->lpgs_metadata_file);
+        put_element (buf, "        ", "lpgs_metadata_file",
+            gmeta->lpgs_metadata_file);
 
     /* Write the global metadata - corners and bounding coords */
-    fprintf (fptr,
+    put_fmt (buf,
         "        <corner location=\"UL\" latitude=\"%lf\" longitude=\"%lf\"/>\n"
         "        <corner location=\"LR\" latitude=\"%lf\" longitude=\"%lf\"/>\n"
         "        <bounding_coordinates>\n"
@@ -149,44 +318,43 @@ int write_metadata
     /* Write the global metadata - projection information */
     switch (gmeta->proj_info.proj_type)
     {
-        case GCTP_GEO_PROJ: strcpy (myproj, "GEO"); break;
-        case GCTP_UTM_PROJ: strcpy (myproj, "UTM"); break;
-        case GCTP_ALBERS_PROJ: strcpy (myproj, "ALBERS"); break;
-        case GCTP_PS_PROJ: strcpy (myproj, "PS"); break;
-        case GCTP_SIN_PROJ: strcpy (myproj, "SIN"); break;
-        default: strcpy (myproj, "undefined"); break;
+        case GCTP_GEO_PROJ: myproj = "GEO"; break;
+        case GCTP_UTM_PROJ: myproj = "UTM"; break;
+        case GCTP_ALBERS_PROJ: myproj = "ALBERS"; break;
+        case GCTP_PS_PROJ: myproj = "PS"; break;
+        case GCTP_SIN_PROJ: myproj = "SIN"; break;
+        default: myproj = "undefined"; break;
     }
+    put_str (buf, "        <projection_information projection=\"");
+    put_str (buf, myproj);
     if (gmeta->proj_info.datum_type != ESPA_NODATUM)
     {
         switch (gmeta->proj_info.datum_type)
         {
-            case ESPA_WGS84: strcpy (mydatum, "WGS84"); break;
-            case ESPA_NAD27: strcpy (mydatum, "NAD27"); break;
-            case ESPA_NAD83: strcpy (mydatum, "NAD83"); break;
+            case ESPA_WGS84: mydatum = "WGS84"; break;
+            case ESPA_NAD27: mydatum = "NAD27"; break;
+            case ESPA_NAD83: mydatum = "NAD83"; break;
+            default: mydatum = "undefined"; break;
         }
-        fprintf (fptr,
-            "        <projection_information projection=\"%s\" datum=\"%s\" "
-            "units=\"%s\">\n", myproj, mydatum,
-            gmeta->proj_info.units);
-    }
-    else
-    {
-        fprintf (fptr,
-            "        <projection_information projection=\"%s\" units=\"%s\">\n",
-            myproj, gmeta->proj_info.units);
+        put_str (buf, "\" datum=\"");
+        put_str (buf, mydatum);
     }
-    fprintf (fptr,
+    put_str (buf, "\" units=\"");
+    put_str (buf, gmeta->proj_info.units);
+    put_str (buf, "\">\n");
+
+    put_fmt (buf,
         "            <corner_point location=\"UL\" x=\"%lf\" y=\"%lf\"/>\n"
-        "            <corner_point location=\"LR\" x=\"%lf\" y=\"%lf\"/>\n"
-        "            <grid_origin>%s</grid_origin>\n",
+        "            <corner_point location=\"LR\" x=\"%lf\" y=\"%lf\"/>\n",
         gmeta->proj_info.ul_corner[0], gmeta->proj_info.ul_corner[1],
-        gmeta->proj_info.lr_corner[0], gmeta->proj_info.lr_corner[1],
+        gmeta->proj_info.lr_corner[0], gmeta->proj_info.lr_corner[1]);
+    put_element (buf, "            ", "grid_origin",
         gmeta->proj_info.grid_origin);
 
     /* UTM-specific parameters */
     if (gmeta->proj_info.proj_type == GCTP_UTM_PROJ)
     {
-        fprintf (fptr,
+        put_fmt (buf,
             "            <utm_proj_params>\n"
             "                <zone_code>%d</zone_code>\n"
             "            </utm_proj_params>\n",
@@ -196,7 +364,7 @@ int write_metadata
     /* ALBERS-specific parameters */
     if (gmeta->proj_info.proj_type == GCTP_ALBERS_PROJ)
     {
-        fprintf (fptr,
+        put_fmt (buf,
             "            <albers_proj_params>\n"
             "                <standard_parallel1>%lf</standard_parallel1>\n"
             "                <standard_parallel2>%lf</standard_parallel2>\n"
@@ -214,7 +382,7 @@ int write_metadata
     /* PS-specific parameters */
     if (gmeta->proj_info.proj_type == GCTP_PS_PROJ)
     {
-        fprintf (fptr,
+        put_fmt (buf,
             "            <ps_proj_params>\n"
             "                <longitude_pole>%lf</longitude_pole>\n"
             "                <latitude_true_scale>%lf</latitude_true_scale>\n"
@@ -229,7 +397,7 @@ int write_metadata
     /* SIN-specific parameters */
     if (gmeta->proj_info.proj_type == GCTP_SIN_PROJ)
     {
-        fprintf (fptr,
+        put_fmt (buf,
             "            <sin_proj_params>\n"
             "                <sphere_radius>%lf</sphere_radius>\n"
             "                <central_meridian>%lf</central_meridian>\n"
@@ -240,451 +408,1444 @@ int write_metadata
             gmeta->proj_info.false_easting, gmeta->proj_info.false_northing);
     }
 
-    fprintf (fptr,
-        "        </projection_information>\n");
+    put_str (buf, "        </projection_information>\n");
 
     /* Continue with the global metadata */
-    fprintf (fptr,
+    put_fmt (buf,
         "        <orientation_angle>%f</orientation_angle>\n",
-            gmeta->orientation_angle);
+        gmeta->orientation_angle);
 
-    fprintf (fptr,
-        "    </global_metadata>\n\n");
+    put_str (buf, "    </global_metadata>\n\n");
+}
 
-    /* Write the bands metadata */
-    fprintf (fptr,
-        "    <bands>\n");
 
-    /* Write the bands themselves.  Make sure the optional parameters have
-       been specified and are not fill, otherwise don't write them out. */
-    for (i = 0; i < metadata->nbands; i++)
+/******************************************************************************
+MODULE:  put_band_xml
+
+PURPOSE: Appends the metadata for one band to the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. Optional parameters are only written if they have been specified and
+     are not fill.
+******************************************************************************/
+static void put_band_xml
+(
+    Xml_buffer_t *buf,                /* I/O: XML buffer */
+    Espa_band_meta_t *bmeta           /* I: band metadata */
+)
+{
+    const char *my_dtype;    /* data type string */
+    const char *my_rtype;    /* resampling type string */
+    int j;                   /* looping variable */
+
+    switch (bmeta->data_type)
     {
-        switch (bmeta[i].data_type)
-        {
-            case ESPA_INT8: strcpy (my_dtype, "INT8"); break;
-            case ESPA_UINT8: strcpy (my_dtype, "UINT8"); break;
-            case ESPA_INT16: strcpy (my_dtype, "INT16"); break;
-            case ESPA_UINT16: strcpy (my_dtype, "UINT16"); break;
-            case ESPA_INT32: strcpy (my_dtype, "INT32"); break;
-            case ESPA_UINT32: strcpy (my_dtype, "UINT32"); break;
-            case ESPA_FLOAT32: strcpy (my_dtype, "FLOAT32"); break;
-            case ESPA_FLOAT64: strcpy (my_dtype, "FLOAT64"); break;
-            default: strcpy (my_dtype, "undefined"); break;
-        }
+        case ESPA_INT8: my_dtype = "INT8"; break;
+        case ESPA_UINT8: my_dtype = "UINT8"; break;
+        case ESPA_INT16: my_dtype = "INT16"; break;
+        case ESPA_UINT16: my_dtype = "UINT16"; break;
+        case ESPA_INT32: my_dtype = "INT32"; break;
+        case ESPA_UINT32: my_dtype = "UINT32"; break;
+        case ESPA_FLOAT32: my_dtype = "FLOAT32"; break;
+        case ESPA_FLOAT64: my_dtype = "FLOAT64"; break;
+        default: my_dtype = "undefined"; break;
+    }
 
-        switch (bmeta[i].resample_method)
-        {
-            case ESPA_CC: strcpy (my_rtype, "cubic convolution"); break;
-            case ESPA_NN: strcpy (my_rtype, "nearest neighbor"); break;
-            case ESPA_BI: strcpy (my_rtype, "bilinear"); break;
-            case ESPA_NONE: strcpy (my_rtype, "none"); break;
-            default: strcpy (my_rtype, "undefined"); break;
-        }
+    switch (bmeta->resample_method)
+    {
+        case ESPA_CC: my_rtype = "cubic convolution"; break;
+        case ESPA_NN: my_rtype = "nearest neighbor"; break;
+        case ESPA_BI: my_rtype = "bilinear"; break;
+        case ESPA_NONE: my_rtype = "none"; break;
+        default: my_rtype = "undefined"; break;
+    }
 
-        if (!strcmp (bmeta[i].source, ESPA_STRING_META_FILL)) /*no source type*/
-            fprintf (fptr,
-                "        <band product=\"%s\" name=\"%s\" category=\"%s\" "
-                "data_type=\"%s\" nlines=\"%d\" nsamps=\"%d\"",
-                bmeta[i].product, bmeta[i].name, bmeta[i].category, my_dtype,
-                bmeta[i].nlines, bmeta[i].nsamps);
-        else  /* contains a source type */
-            fprintf (fptr,
-                "        <band product=\"%s\" source=\"%s\" name=\"%s\" "
-                "category=\"%s\" data_type=\"%s\" nlines=\"%d\" nsamps=\"%d\"",
-                bmeta[i].product, bmeta[i].source, bmeta[i].name,
-                bmeta[i].category, my_dtype, bmeta[i].nlines, bmeta[i].nsamps);
-
-        if (bmeta[i].fill_value != ESPA_INT_META_FILL)
-            fprintf (fptr, " fill_value=\"%ld\"", bmeta[i].fill_value);
-        if (bmeta[i].saturate_value != ESPA_INT_META_FILL)
-            fprintf (fptr, " saturate_value=\"%d\"",
-            bmeta[i].saturate_value);
-        if (fabs (bmeta[i].scale_factor-ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-            fprintf (fptr, " scale_factor=\"%f\"", bmeta[i].scale_factor);
-        if (fabs (bmeta[i].add_offset-ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-            fprintf (fptr, " add_offset=\"%f\"", bmeta[i].add_offset);
-        fprintf (fptr, ">\n");
-
-        fprintf (fptr,
-            "            <short_name>%s</short_name>\n"
-            "            <long_name>%s</long_name>\n"
-            "            <file_name>%s</file_name>\n"
-            "            <pixel_size x=\"%g\" y=\"%g\" units=\"%s\"/>\n"
-            "            <resample_method>%s</resample_method>\n",
-            bmeta[i].short_name, bmeta[i].long_name, bmeta[i].file_name,
-            bmeta[i].pixel_size[0], bmeta[i].pixel_size[1],
-            bmeta[i].pixel_units, my_rtype);
-
-        if (strcmp (bmeta[i].data_units, ESPA_STRING_META_FILL))
-            fprintf (fptr,
-                "            <data_units>%s</data_units>\n",
-                bmeta[i].data_units);
-
-        if (fabs (bmeta[i].valid_range[0] - ESPA_FLOAT_META_FILL) >
-            ESPA_EPSILON &&
-            fabs (bmeta[i].valid_range[1] - ESPA_FLOAT_META_FILL) >
-            ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <valid_range min=\"%f\" max=\"%f\"/>\n",
-                bmeta[i].valid_range[0], bmeta[i].valid_range[1]);
-        }
+    put_str (buf, "        <band product=\"");
+    put_str (buf, bmeta->product);
+    if (strcmp (bmeta->source, ESPA_STRING_META_FILL))
+    {   /* contains a source type */
+        put_str (buf, "\" source=\"");
+        put_str (buf, bmeta->source);
+    }
+    put_str (buf, "\" name=\"");
+    put_str (buf, bmeta->name);
+    put_str (buf, "\" category=\"");
+    put_str (buf, bmeta->category);
+    put_str (buf, "\" data_type=\"");
+    put_str (buf, my_dtype);
+    put_fmt (buf, "\" nlines=\"%d\" nsamps=\"%d\"", bmeta->nlines,
+        bmeta->nsamps);
+
+    if (bmeta->fill_value != ESPA_INT_META_FILL)
+        put_fmt (buf, " fill_value=\"%ld\"", bmeta->fill_value);
+    if (bmeta->saturate_value != ESPA_INT_META_FILL)
+        put_fmt (buf, " saturate_value=\"%d\"", bmeta->saturate_value);
+    if (fabs (bmeta->scale_factor - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
+        put_fmt (buf, " scale_factor=\"%f\"", bmeta->scale_factor);
+    if (fabs (bmeta->add_offset - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
+        put_fmt (buf, " add_offset=\"%f\"", bmeta->add_offset);
+    put_str (buf, ">\n");
+
+    put_element (buf, "            ", "short_name", bmeta->short_name);
+    put_element (buf, "            ", "long_name", bmeta->long_name);
+    put_element (buf, "            ", "file_name", bmeta->file_name);
+    put_fmt (buf, "            <pixel_size x=\"%g\" y=\"%g\" units=\"",
+        bmeta->pixel_size[0], bmeta->pixel_size[1]);
+    put_str (buf, bmeta->pixel_units);
+    put_str (buf, "\"/>\n");
+    put_element (buf, "            ", "resample_method", my_rtype);
+
+    if (strcmp (bmeta->data_units, ESPA_STRING_META_FILL))
+        put_element (buf, "            ", "data_units", bmeta->data_units);
+
+    if (fabs (bmeta->valid_range[0] - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
+        fabs (bmeta->valid_range[1] - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
+    {
+        put_fmt (buf,
+            "            <valid_range min=\"%f\" max=\"%f\"/>\n",
+            bmeta->valid_range[0], bmeta->valid_range[1]);
+    }
 
-        if (fabs (bmeta[i].rad_gain - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
-            fabs (bmeta[i].rad_bias - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <radiance gain=\"%.5g\" bias=\"%.5g\"/>\n",
-                bmeta[i].rad_gain, bmeta[i].rad_bias);
-        }
+    if (fabs (bmeta->rad_gain - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
+        fabs (bmeta->rad_bias - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
+    {
+        put_fmt (buf,
+            "            <radiance gain=\"%.5g\" bias=\"%.5g\"/>\n",
+            bmeta->rad_gain, bmeta->rad_bias);
+    }
 
-        if (fabs (bmeta[i].refl_gain - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
-            fabs (bmeta[i].refl_bias - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <reflectance gain=\"%.5g\" bias=\"%.5g\"/>\n",
-                bmeta[i].refl_gain, bmeta[i].refl_bias);
-        }
+    if (fabs (bmeta->refl_gain - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
+        fabs (bmeta->refl_bias - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
+    {
+        put_fmt (buf,
+            "            <reflectance gain=\"%.5g\" bias=\"%.5g\"/>\n",
+            bmeta->refl_gain, bmeta->refl_bias);
+    }
 
-        if (fabs (bmeta[i].k1_const - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
-            fabs (bmeta[i].k2_const - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <thermal_const k1=\"%.2f\" k2=\"%.2f\"/>\n",
-                bmeta[i].k1_const, bmeta[i].k2_const);
-        }
+    if (fabs (bmeta->k1_const - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
+        fabs (bmeta->k2_const - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
+    {
+        put_fmt (buf,
+            "            <thermal_const k1=\"%.2f\" k2=\"%.2f\"/>\n",
+            bmeta->k1_const, bmeta->k2_const);
+    }
 
-        if (bmeta[i].nbits != ESPA_INT_META_FILL && bmeta[i].nbits > 0)
+    if (bmeta->nbits != ESPA_INT_META_FILL && bmeta->nbits > 0)
+    {
+        put_str (buf, "            <bitmap_description>\n");
+        for (j = 0; j < bmeta->nbits; j++)
         {
-            fprintf (fptr,
-                "            <bitmap_description>\n");
-            for (j = 0; j < bmeta[i].nbits; j++)
-            {
-                fprintf (fptr,
-                    "                <bit num=\"%d\">%s</bit>\n",
-                    j, bmeta[i].bitmap_description[j]);
-            }
-            fprintf (fptr,
-                "            </bitmap_description>\n");
+            put_fmt (buf, "                <bit num=\"%d\">", j);
+            put_str (buf, bmeta->bitmap_description[j]);
+            put_str (buf, "</bit>\n");
         }
+        put_str (buf, "            </bitmap_description>\n");
+    }
 
-        if (bmeta[i].nclass != ESPA_INT_META_FILL && bmeta[i].nclass > 0)
+    if (bmeta->nclass != ESPA_INT_META_FILL && bmeta->nclass > 0)
+    {
+        put_str (buf, "            <class_values>\n");
+        for (j = 0; j < bmeta->nclass; j++)
         {
-            fprintf (fptr,
-                "            <class_values>\n");
-            for (j = 0; j < bmeta[i].nclass; j++)
-            {
-                fprintf (fptr,
-                    "                <class num=\"%d\">%s</class>\n",
-                     bmeta[i].class_values[j].class,
-                     bmeta[i].class_values[j].description);
-            }
-            fprintf (fptr,
-                "            </class_values>\n");
+            put_fmt (buf, "                <class num=\"%d\">",
+                bmeta->class_values[j].class);
+            put_str (buf, bmeta->class_values[j].description);
+            put_str (buf, "</class>\n");
         }
+        put_str (buf, "            </class_values>\n");
+    }
 
-        if (strcmp (bmeta[i].qa_desc, ESPA_STRING_META_FILL))
-            fprintf (fptr,
-                "            <qa_description>%s"
-                "            </qa_description>\n", bmeta[i].qa_desc);
+    if (strcmp (bmeta->qa_desc, ESPA_STRING_META_FILL))
+    {
+        put_str (buf, "            <qa_description>");
+        put_str (buf, bmeta->qa_desc);
+        put_str (buf, "            </qa_description>\n");
+    }
 
-        if (bmeta[i].ncover != ESPA_FLOAT_META_FILL && bmeta[i].ncover > 0)
+    if (bmeta->ncover != ESPA_FLOAT_META_FILL && bmeta->ncover > 0)
+    {
+        put_str (buf, "            <percent_coverage>\n");
+        for (j = 0; j < bmeta->ncover; j++)
         {
-            fprintf (fptr,
-                "            <percent_coverage>\n");
-            for (j = 0; j < bmeta[i].ncover; j++)
-            {
-                fprintf (fptr,
-                    "                <cover type=\"%s\">%.2f</cover>\n",
-                     bmeta[i].percent_cover[j].description,
-                     bmeta[i].percent_cover[j].percent);
-            }
-            fprintf (fptr,
-                "            </percent_coverage>\n");
+            put_str (buf, "                <cover type=\"");
+            put_str (buf, bmeta->percent_cover[j].description);
+            put_fmt (buf, "\">%.2f</cover>\n",
+                bmeta->percent_cover[j].percent);
         }
-
-        fprintf (fptr,
-            "            <app_version>%s</app_version>\n"
-            "            <production_date>%s</production_date>\n"
-            "        </band>\n",
-            bmeta[i].app_version, bmeta[i].production_date);
+        put_str (buf, "            </percent_coverage>\n");
     }
 
-    /* Finish it off */
-    fprintf (fptr,
-        "    </bands>\n");
-    fprintf (fptr,
-        "</espa_metadata>\n");
+    put_element (buf, "            ", "app_version", bmeta->app_version);
+    put_element (buf, "            ", "production_date",
+        bmeta->production_date);
+    put_str (buf, "        </band>\n");
+}
 
-    /* Close the XML file */
-    fclose (fptr);
 
-    /* Successful generation */
-    return (SUCCESS);
+/******************************************************************************
+MODULE:  put_metadata_xml
+
+PURPOSE: Appends a complete XML metadata file for the metadata structure to
+the XML buffer.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void put_metadata_xml
+(
+    Xml_buffer_t *buf,                /* I/O: XML buffer */
+    Espa_internal_meta_t *metadata    /* I: metadata to be written */
+)
+{
+    int i;                            /* looping variable */
+
+    put_global_xml (buf, &metadata->global);
+
+    put_str (buf, "    <bands>\n");
+    for (i = 0; i < metadata->nbands; i++)
+        put_band_xml (buf, &metadata->band[i]);
+    put_str (buf, "    </bands>\n");
+    put_str (buf, "</espa_metadata>\n");
 }
 
 
 /******************************************************************************
-MODULE:  append_metadata
+MODULE:  lock_xml_dir
 
-PURPOSE: Append additional bands to an existing metadata file
+PURPOSE: Takes an exclusive lock on the directory containing an XML
+metadata file.
 
 RETURN VALUE:
 Type = int
 Value           Description
 -----           -----------
-ERROR           Error appending the metadata file
-SUCCESS         Successfully appended to the metadata file
+-1              The directory could not be locked
+>= 0            Descriptor holding the lock; release it with
+                unlock_xml_dir
 
 NOTES:
-  1. If the XML file specified already exists, it will be overwritten.
-  2. Use this routine to append bands to and existing metadata file, use
-     write_metadata to create a new metadata file.
-  3. It is recommended that validate_meta be used after appending to the XML
-     file to make sure the new file is valid against the ESPA schema.
+  1. The lock is on the directory rather than on the XML file, since the
+     XML file is replaced by a new file on every write.  It blocks until
+     any other writer of an XML file in the same directory is done.
+  2. The directory may not be lockable, e.g. on a read-only or network
+     filesystem which doesn't support flock.  A warning is printed and the
+     caller goes ahead with the write unlocked.  The XML file is still
+     replaced atomically; only concurrent updates of the same XML file can
+     lose bands then.
 ******************************************************************************/
-int append_metadata
+static int lock_xml_dir
 (
-    int nbands,               /* I: number of bands to be appended */
-    Espa_band_meta_t *bmeta,  /* I: pointer to the array of bands metadata
-                                    containing nbands */
-    char *xml_file            /* I: name of the XML metadata file for appending
-                                    the bands in bmeta */
+    char *xml_file            /* I: name of the XML metadata file */
 )
 {
-    char FUNC_NAME[] = "append_metadata";       /* function name */
-    char errmsg[STR_SIZE];   /* error message */
-    char my_dtype[STR_SIZE]; /* data type string */
-    char my_rtype[STR_SIZE]; /* resampling type string */
-    char linebuf[MAX_LINE_SIZE];  /* buffer to hold each line */
-    char *cur_ptr;           /* pointer index in the line buffer */
-    int i, j;                /* looping variables */
-    FILE *fptr = NULL;       /* file pointer to the XML metadata file */
-    fpos_t cur_pos;          /* current position in the file */
-
-    /* Open the metadata XML file for write or rewrite privelages */
-    fptr = fopen (xml_file, "r+");
-    if (fptr == NULL)
-    {
-        sprintf (errmsg, "Opening %s for write access.", xml_file);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Skip through the XML file looking for the closing </bands> element.
-       That's where we want to append the new bands and then close everything
-       off (i.e. bands and espa_metadata). Note, if the closing </bands>
-       element is not found in the XML file, then the bands will simply be
-       appended at the end of the XML file. This will likely leave an XML
-       file which does not validate against the ESPA schema, but the input
-       XML likely didn't validate either in this case. */
-    if (fgetpos (fptr, &cur_pos) == -1)
+    char FUNC_NAME[] = "lock_xml_dir";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    char dir[STR_SIZE];       /* directory of the XML file */
+    char *slash = NULL;       /* last slash in the XML filename */
+    int fd;                   /* directory descriptor */
+    int count;                /* number of characters copied */
+
+    count = snprintf (dir, sizeof (dir), "%s", xml_file);
+    if (count < 0 || count >= (int) sizeof (dir))
     {
-        sprintf (errmsg, "Getting the current position in the XML fstream.");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
+        snprintf (errmsg, sizeof (errmsg), "Overflow of the directory for %s; "
+            "updating it unlocked", xml_file);
+        error_handler (false, FUNC_NAME, errmsg);
+        return (-1);
     }
-    while (fgets (linebuf, MAX_LINE_SIZE, fptr))
-    {
-        /* Skip past the front end white space from proper indentation in
-           the metadata file */
-        cur_ptr = linebuf;
-        while (cur_ptr[0] == ' ' || cur_ptr[0] == '\t')
-            cur_ptr++;
-        if (!strncmp (cur_ptr, "</bands>", 8))
-        {
-            /* </bands> line was found.  Now seek back to the beginning of
-               that line in the file. */
-            if (fsetpos (fptr, &cur_pos) == -1)
-            {
-                sprintf (errmsg, "Setting current position in the XML fstream "
-                    "to the start of the </bands> line.");
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
 
-            /* Clear the while loop */
-            break;
-        }
+    slash = strrchr (dir, '/');
+    if (slash == NULL)
+        strcpy (dir, ".");
+    else if (slash == dir)
+        dir[1] = '\0';
+    else
+        *slash = '\0';
 
-        /* Store the location of the current stream so we can get back here */
-        if (fgetpos (fptr, &cur_pos) == -1)
-        {
-            sprintf (errmsg, "Getting current position in the XML fstream.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
+    fd = open (dir, O_RDONLY);
+    if (fd < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening directory %s to lock it; "
+            "updating %s unlocked", dir, xml_file);
+        error_handler (false, FUNC_NAME, errmsg);
+        return (-1);
     }
 
-    /* Append the new bands.  Make sure the optional parameters have been
-       specified and are not fill, otherwise don't write them out. */
-    for (i = 0; i < nbands; i++)
+    while (flock (fd, LOCK_EX) != 0)
     {
-        switch (bmeta[i].data_type)
+        if (errno != EINTR)
         {
-            case ESPA_INT8: strcpy (my_dtype, "INT8"); break;
-            case ESPA_UINT8: strcpy (my_dtype, "UINT8"); break;
-            case ESPA_INT16: strcpy (my_dtype, "INT16"); break;
-            case ESPA_UINT16: strcpy (my_dtype, "UINT16"); break;
-            case ESPA_INT32: strcpy (my_dtype, "INT32"); break;
-            case ESPA_UINT32: strcpy (my_dtype, "UINT32"); break;
-            case ESPA_FLOAT32: strcpy (my_dtype, "FLOAT32"); break;
-            case ESPA_FLOAT64: strcpy (my_dtype, "FLOAT64"); break;
-            default: strcpy (my_dtype, "undefined"); break;
+            snprintf (errmsg, sizeof (errmsg), "Locking directory %s; "
+                "updating %s unlocked", dir, xml_file);
+            error_handler (false, FUNC_NAME, errmsg);
+            close (fd);
+            return (-1);
         }
+    }
 
-        switch (bmeta[i].resample_method)
-        {
-            case ESPA_CC: strcpy (my_rtype, "cubic convolution"); break;
-            case ESPA_NN: strcpy (my_rtype, "nearest neighbor"); break;
-            case ESPA_BI: strcpy (my_rtype, "bilinear"); break;
-            case ESPA_NONE: strcpy (my_rtype, "none"); break;
-            default: strcpy (my_rtype, "undefined"); break;
-        }
+    return (fd);
+}
 
-        if (!strcmp (bmeta[i].source, ESPA_STRING_META_FILL)) /*no source type*/
-            fprintf (fptr,
-                "        <band product=\"%s\" name=\"%s\" category=\"%s\" "
-                "data_type=\"%s\" nlines=\"%d\" nsamps=\"%d\"",
-                bmeta[i].product, bmeta[i].name, bmeta[i].category, my_dtype,
-                bmeta[i].nlines, bmeta[i].nsamps);
-        else  /* contains a source type */
-            fprintf (fptr,
-                "        <band product=\"%s\" source=\"%s\" name=\"%s\" "
-                "category=\"%s\" data_type=\"%s\" nlines=\"%d\" nsamps=\"%d\"",
-                bmeta[i].product, bmeta[i].source, bmeta[i].name,
-                bmeta[i].category, my_dtype, bmeta[i].nlines, bmeta[i].nsamps);
-
-        if (bmeta[i].fill_value != ESPA_INT_META_FILL)
-            fprintf (fptr, " fill_value=\"%ld\"", bmeta[i].fill_value);
-        if (bmeta[i].saturate_value != ESPA_INT_META_FILL)
-            fprintf (fptr, " saturate_value=\"%d\"",
-            bmeta[i].saturate_value);
-        if (fabs (bmeta[i].scale_factor - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-            fprintf (fptr, " scale_factor=\"%f\"", bmeta[i].scale_factor);
-        if (fabs (bmeta[i].add_offset - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-            fprintf (fptr, " add_offset=\"%f\"", bmeta[i].add_offset);
-        fprintf (fptr, ">\n");
-
-        fprintf (fptr,
-            "            <short_name>%s</short_name>\n"
-            "            <long_name>%s</long_name>\n"
-            "            <file_name>%s</file_name>\n"
-            "            <pixel_size x=\"%g\" y=\"%g\" units=\"%s\"/>\n"
-            "            <resample_method>%s</resample_method>\n",
-            bmeta[i].short_name, bmeta[i].long_name, bmeta[i].file_name,
-            bmeta[i].pixel_size[0], bmeta[i].pixel_size[1],
-            bmeta[i].pixel_units, my_rtype);
-
-        if (strcmp (bmeta[i].data_units, ESPA_STRING_META_FILL))
-            fprintf (fptr,
-                "            <data_units>%s</data_units>\n",
-                bmeta[i].data_units);
-
-        if (fabs (bmeta[i].valid_range[0] - ESPA_FLOAT_META_FILL) >
-            ESPA_EPSILON &&
-            fabs (bmeta[i].valid_range[1] - ESPA_FLOAT_META_FILL) >
-            ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <valid_range min=\"%f\" max=\"%f\"/>\n",
-                bmeta[i].valid_range[0], bmeta[i].valid_range[1]);
-        }
 
-        if (fabs (bmeta[i].rad_gain - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
-            fabs (bmeta[i].rad_bias - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <radiance gain=\"%.5g\" bias=\"%.5g\"/>\n",
-                bmeta[i].rad_gain, bmeta[i].rad_bias);
-        }
+/******************************************************************************
+MODULE:  unlock_xml_dir
 
-        if (fabs (bmeta[i].refl_gain - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
-            fabs (bmeta[i].refl_bias - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <reflectance gain=\"%.5g\" bias=\"%.5g\"/>\n",
-                bmeta[i].refl_gain, bmeta[i].refl_bias);
-        }
+PURPOSE: Releases the lock from lock_xml_dir.
 
-        if (fabs (bmeta[i].k1_const - ESPA_FLOAT_META_FILL) > ESPA_EPSILON &&
-            fabs (bmeta[i].k2_const - ESPA_FLOAT_META_FILL) > ESPA_EPSILON)
-        {
-            fprintf (fptr,
-                "            <thermal_const k1=\"%.2f\" k2=\"%.2f\"/>\n",
-                bmeta[i].k1_const, bmeta[i].k2_const);
-        }
+RETURN VALUE:
+Type = None
 
-        if (bmeta[i].nbits != ESPA_INT_META_FILL && bmeta[i].nbits > 0)
-        {
-            fprintf (fptr,
-                "            <bitmap_description>\n");
-            for (j = 0; j < bmeta[i].nbits; j++)
-            {
-                fprintf (fptr,
-                    "                <bit num=\"%d\">%s</bit>\n",
-                    j, bmeta[i].bitmap_description[j]);
-            }
-            fprintf (fptr,
-                "            </bitmap_description>\n");
-        }
+NOTES:
+  1. Nothing is done if the directory wasn't locked.
+******************************************************************************/
+static void unlock_xml_dir
+(
+    int lock_fd               /* I: descriptor from lock_xml_dir */
+)
+{
+    if (lock_fd >= 0)
+        close (lock_fd);
+}
 
-        if (bmeta[i].nclass != ESPA_INT_META_FILL && bmeta[i].nclass > 0)
-        {
-            fprintf (fptr,
-                "            <class_values>\n");
-            for (j = 0; j < bmeta[i].nclass; j++)
-            {
-                fprintf (fptr,
-                    "                <class num=\"%d\">%s</class>\n",
-                     bmeta[i].class_values[j].class,
-                     bmeta[i].class_values[j].description);
-            }
-            fprintf (fptr,
-                "            </class_values>\n");
-        }
 
-        if (strcmp (bmeta[i].qa_desc, ESPA_STRING_META_FILL))
-            fprintf (fptr,
-                "            <qa_description>%s"
-                "            </qa_description>\n", bmeta[i].qa_desc);
+/******************************************************************************
+MODULE:  sync_xml_dir
 
-        if (bmeta[i].ncover != ESPA_FLOAT_META_FILL && bmeta[i].ncover > 0)
-        {
-            fprintf (fptr,
-                "            <percent_coverage>\n");
-            for (j = 0; j < bmeta[i].ncover; j++)
-            {
-                fprintf (fptr,
-                    "                <cover type=\"%s\">%.2f</cover>\n",
-                     bmeta[i].percent_cover[j].description,
-                     bmeta[i].percent_cover[j].percent);
-            }
-            fprintf (fptr,
-                "            </percent_coverage>\n");
-        }
+PURPOSE: Flushes the directory containing an XML metadata file to disk.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error flushing the directory
+SUCCESS         Successfully flushed the directory
 
-        fprintf (fptr,
-            "            <app_version>%s</app_version>\n"
-            "            <production_date>%s</production_date>\n"
-            "        </band>\n",
-            bmeta[i].app_version, bmeta[i].production_date);
+NOTES:
+  1. A rename is only on disk once the directory holding the file has been
+     flushed.
+******************************************************************************/
+static int sync_xml_dir
+(
+    char *xml_file            /* I: name of the XML metadata file */
+)
+{
+    char FUNC_NAME[] = "sync_xml_dir";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    char dir[STR_SIZE];       /* directory of the XML file */
+    char *slash = NULL;       /* last slash in the XML filename */
+    int fd;                   /* directory descriptor */
+    int count;                /* number of characters copied */
+    int status;               /* return status */
+
+    count = snprintf (dir, sizeof (dir), "%s", xml_file);
+    if (count < 0 || count >= (int) sizeof (dir))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Overflow of the directory for %s",
+            xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
     }
 
-    /* Finish it off */
-    fprintf (fptr,
-        "    </bands>\n");
-    fprintf (fptr,
-        "</espa_metadata>\n");
+    slash = strrchr (dir, '/');
+    if (slash == NULL)
+        strcpy (dir, ".");
+    else if (slash == dir)
+        dir[1] = '\0';
+    else
+        *slash = '\0';
 
-    /* Close the XML file */
-    fclose (fptr);
+    fd = open (dir, O_RDONLY);
+    if (fd < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening directory %s to flush it",
+            dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    status = SUCCESS;
+    if (fsync (fd) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Flushing directory %s to disk",
+            dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+    close (fd);
+
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  write_xml_file
+
+PURPOSE: Writes the XML buffer to the XML metadata file by way of a temporary
+file which is renamed over it.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the metadata file
+SUCCESS         Successfully wrote the metadata file
+
+NOTES:
+  1. A replaced XML file keeps its permissions.  A new XML file gets the
+     same permissions fopen would give it.
+  2. The caller should hold the lock from lock_xml_dir.
+  3. The new XML file and then its directory are flushed to disk, so the
+     new XML file is in place once this returns successfully.
+******************************************************************************/
+static int write_xml_file
+(
+    Xml_buffer_t *buf,        /* I: XML buffer to be written */
+    char *xml_file            /* I: name of the XML metadata file */
+)
+{
+    char FUNC_NAME[] = "write_xml_file";   /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the temporary
+                                   filename along with the message */
+    char tmpfile[STR_SIZE];   /* temporary XML filename */
+    int fd = -1;              /* temporary file descriptor */
+    int attempt;              /* attempt at a unique temporary filename */
+    int count;                /* number of characters in the filename */
+    ssize_t nwritten;         /* number of bytes written */
+    size_t total;             /* total number of bytes written */
+    struct stat file_stat;    /* status of the existing XML file */
+
+    if (buf->error)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory for the XML "
+            "for %s", xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Create a temporary file in the same directory, so it can be renamed
+       over the XML file */
+    for (attempt = 0; attempt < 100 && fd < 0; attempt++)
+    {
+        count = snprintf (tmpfile, sizeof (tmpfile), "%s.tmp%ld_%d", xml_file,
+            (long) getpid (), attempt);
+        if (count < 0 || count >= (int) sizeof (tmpfile))
+        {
+            snprintf (errmsg, sizeof (errmsg), "Overflow of the temporary "
+                "filename for %s", xml_file);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+
+        fd = open (tmpfile, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd < 0 && errno != EEXIST)
+            break;
+    }
+    if (fd < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Creating temporary file %s for "
+            "write access.", tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Write the whole XML file at once */
+    total = 0;
+    while (total < buf->size)
+    {
+        nwritten = write (fd, buf->data + total, buf->size - total);
+        if (nwritten < 0 && errno == EINTR)
+            continue;
+        if (nwritten <= 0)
+            break;
+        total += nwritten;
+    }
+
+    if (total != buf->size)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Writing the XML to temporary "
+            "file %s", tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        close (fd);
+        unlink (tmpfile);
+        return (ERROR);
+    }
+
+    /* Keep the permissions of the XML file being replaced */
+    if (stat (xml_file, &file_stat) == 0)
+        fchmod (fd, file_stat.st_mode & 07777);
+
+    /* Make sure the new XML is on disk before it replaces the old one, so a
+       crash can't leave an empty XML file in its place */
+    if (fsync (fd) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Flushing temporary file %s to "
+            "disk", tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        close (fd);
+        unlink (tmpfile);
+        return (ERROR);
+    }
+
+    if (close (fd) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Closing temporary file %s",
+            tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlink (tmpfile);
+        return (ERROR);
+    }
+
+    /* Replace the XML file */
+    if (rename (tmpfile, xml_file) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Renaming temporary file %s to %s",
+            tmpfile, xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlink (tmpfile);
+        return (ERROR);
+    }
+
+    /* Flush the rename to disk as well, so a crash can't bring back the old
+       XML file */
+    if (sync_xml_dir (xml_file) != SUCCESS)
+    {  /* Error messages already printed */
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_xml_file
+
+PURPOSE: Reads a whole XML metadata file into the XML buffer.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the metadata file
+SUCCESS         Successfully read the metadata file
+
+NOTES:
+******************************************************************************/
+static int read_xml_file
+(
+    char *xml_file,           /* I: name of the XML metadata file */
+    Xml_buffer_t *buf         /* I/O: XML buffer the file is appended to */
+)
+{
+    char FUNC_NAME[] = "read_xml_file";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int fd;                   /* XML file descriptor */
+    ssize_t nread;            /* number of bytes read */
+    struct stat file_stat;    /* XML file status */
+
+    fd = open (xml_file, O_RDONLY);
+    if (fd < 0 || fstat (fd, &file_stat) != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Opening %s for read access.",
+            xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        if (fd >= 0)
+            close (fd);
+        return (ERROR);
+    }
+
+    /* Read until the end of the file, in case it is still growing */
+    reserve_xml (buf, file_stat.st_size + 1);
+    while (!buf->error)
+    {
+        nread = read (fd, buf->data + buf->size, buf->alloc - buf->size);
+        if (nread < 0 && errno == EINTR)
+            continue;
+        if (nread < 0)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Reading %s", xml_file);
+            error_handler (true, FUNC_NAME, errmsg);
+            close (fd);
+            return (ERROR);
+        }
+        if (nread == 0)
+            break;
+        buf->size += nread;
+        reserve_xml (buf, 1);
+    }
+    close (fd);
+
+    if (buf->error)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Allocating memory to read %s",
+            xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  find_bands_end
+
+PURPOSE: Finds the start of the line holding the closing </bands> element in
+an XML metadata file.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+offset          Offset of the start of the </bands> line, or the size of the
+                XML if there isn't one
+
+NOTES:
+  1. The </bands> element is expected at the start of its line after any
+     indentation, as write_metadata writes it.
+******************************************************************************/
+static size_t find_bands_end
+(
+    Xml_buffer_t *buf         /* I: XML file contents */
+)
+{
+    size_t line;              /* offset of the start of the current line */
+    size_t pos;               /* offset in the current line */
+
+    line = 0;
+    while (line < buf->size)
+    {
+        /* Skip past the front end white space from proper indentation in
+           the metadata file */
+        pos = line;
+        while (pos < buf->size
+            && (buf->data[pos] == ' ' || buf->data[pos] == '\t'))
+            pos++;
+        if (buf->size - pos >= 8 && !strncmp (&buf->data[pos], "</bands>", 8))
+            return (line);
+
+        /* Move to the next line */
+        while (pos < buf->size && buf->data[pos] != '\n')
+            pos++;
+        line = pos + 1;
+    }
+
+    return (buf->size);
+}
+
+
+/******************************************************************************
+MODULE:  copy_band_metadata
+
+PURPOSE: Copies the metadata for a band, including its bit, class, and cover
+descriptions.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating memory for the descriptions
+SUCCESS         Successfully copied the band
+
+NOTES:
+  1. The output band should not have any descriptions allocated.  Its
+     descriptions are freed along with the rest of the metadata they are
+     in, e.g. by free_metadata.
+******************************************************************************/
+static int copy_band_metadata
+(
+    Espa_band_meta_t *inband,     /* I: band metadata to copy */
+    Espa_band_meta_t *outband     /* O: copy of the band metadata */
+)
+{
+    int k;                        /* looping variable */
+
+    *outband = *inband;
+    outband->nbits = 0;
+    outband->bitmap_description = NULL;
+    outband->nclass = 0;
+    outband->class_values = NULL;
+    outband->ncover = 0;
+    outband->percent_cover = NULL;
+
+    if (inband->nbits > 0)
+    {
+        if (allocate_bitmap_metadata (outband, inband->nbits) != SUCCESS)
+        {  /* Error messages already printed */
+            return (ERROR);
+        }
+        for (k = 0; k < inband->nbits; k++)
+            memcpy (outband->bitmap_description[k],
+                inband->bitmap_description[k], STR_SIZE);
+    }
+
+    if (inband->nclass > 0)
+    {
+        if (allocate_class_metadata (outband, inband->nclass) != SUCCESS)
+        {  /* Error messages already printed */
+            return (ERROR);
+        }
+        memcpy (outband->class_values, inband->class_values,
+            inband->nclass * sizeof (Espa_class_t));
+    }
+
+    if (inband->ncover > 0)
+    {
+        if (allocate_percent_coverage_metadata (outband, inband->ncover)
+            != SUCCESS)
+        {  /* Error messages already printed */
+            return (ERROR);
+        }
+        memcpy (outband->percent_cover, inband->percent_cover,
+            inband->ncover * sizeof (Espa_percent_cover_t));
+    }
 
-    /* Successful append */
     return (SUCCESS);
 }
 
 
+/******************************************************************************
+MODULE:  free_band_descriptions
+
+PURPOSE: Frees the bit, class, and cover descriptions of a band.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void free_band_descriptions
+(
+    Espa_band_meta_t *bmeta       /* I/O: band metadata */
+)
+{
+    int k;                        /* looping variable */
+
+    if (bmeta->bitmap_description != NULL)
+    {
+        for (k = 0; k < bmeta->nbits; k++)
+            free (bmeta->bitmap_description[k]);
+        free (bmeta->bitmap_description);
+    }
+    free (bmeta->class_values);
+    free (bmeta->percent_cover);
+
+    bmeta->nbits = 0;
+    bmeta->bitmap_description = NULL;
+    bmeta->nclass = 0;
+    bmeta->class_values = NULL;
+    bmeta->ncover = 0;
+    bmeta->percent_cover = NULL;
+}
+
+
+/******************************************************************************
+MODULE:  find_band
+
+PURPOSE: Finds the band with the same product and name as a given band.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              There is no matching band
+>= 0            Index of the matching band
+
+NOTES:
+******************************************************************************/
+static int find_band
+(
+    int nbands,                   /* I: number of bands to search */
+    Espa_band_meta_t *bands,      /* I: bands to search */
+    Espa_band_meta_t *bmeta       /* I: band to look for */
+)
+{
+    int i;                        /* looping variable */
+
+    for (i = 0; i < nbands; i++)
+    {
+        if (!strcmp (bands[i].name, bmeta->name)
+            && !strcmp (bands[i].product, bmeta->product))
+            return (i);
+    }
+
+    return (-1);
+}
+
+
+/******************************************************************************
+MODULE:  attr_value_matches
+
+PURPOSE: Compares an attribute value in the XML text with a string.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The attribute value is the string
+false           The attribute value differs from the string
+
+NOTES:
+  1. The predefined XML entities in the attribute value are decoded, as the
+     parser would decode them.
+******************************************************************************/
+static bool attr_value_matches
+(
+    const char *value,        /* I: attribute value in the XML text */
+    size_t len,               /* I: length of the attribute value */
+    const char *str           /* I: string to compare it with */
+)
+{
+    static const char *entity[] = {"&amp;", "&lt;", "&gt;", "&quot;",
+        "&apos;"};                /* predefined XML entities */
+    static const char decoded[] = "&<>\"'";  /* decoded entities */
+    size_t pos;               /* offset in the attribute value */
+    size_t elen;              /* length of the entity */
+    int k;                    /* looping variable */
+
+    pos = 0;
+    while (pos < len)
+    {
+        elen = 1;
+        if (value[pos] == '&')
+        {
+            for (k = 0; k < 5; k++)
+            {
+                elen = strlen (entity[k]);
+                if (len - pos >= elen
+                    && !strncmp (&value[pos], entity[k], elen))
+                    break;
+            }
+            if (k == 5)
+                elen = 1;
+            else if (*str++ != decoded[k])
+                return (false);
+        }
+        if (elen == 1 && *str++ != value[pos])
+            return (false);
+        pos += elen;
+    }
+
+    return (*str == '\0');
+}
+
+
+/******************************************************************************
+MODULE:  band_tag_matches
+
+PURPOSE: Determines whether a <band> start tag in the XML text is for the
+same product and name as a given band.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The product and name attributes match the band
+false           The tag is for some other band
+
+NOTES:
+******************************************************************************/
+static bool band_tag_matches
+(
+    const char *tag,          /* I: attributes of the start tag, following
+                                    "<band" */
+    size_t len,               /* I: length of the attributes */
+    Espa_band_meta_t *bmeta   /* I: band to compare with */
+)
+{
+    size_t pos;               /* offset in the tag */
+    size_t name_start;        /* offset of the attribute name */
+    size_t name_len;          /* length of the attribute name */
+    size_t value_start;       /* offset of the attribute value */
+    char quote;               /* quote around the attribute value */
+    bool product_match = false;  /* does the product match? */
+    bool name_match = false;  /* does the name match? */
+
+    pos = 0;
+    while (pos < len)
+    {
+        /* Get the attribute name */
+        while (pos < len && isspace ((unsigned char) tag[pos]))
+            pos++;
+        name_start = pos;
+        while (pos < len && tag[pos] != '=' && tag[pos] != '/'
+            && !isspace ((unsigned char) tag[pos]))
+            pos++;
+        name_len = pos - name_start;
+        while (pos < len && isspace ((unsigned char) tag[pos]))
+            pos++;
+        if (pos >= len || tag[pos] != '=')
+        {
+            pos++;
+            continue;
+        }
+
+        /* Get the quoted attribute value */
+        pos++;
+        while (pos < len && isspace ((unsigned char) tag[pos]))
+            pos++;
+        if (pos >= len || (tag[pos] != '"' && tag[pos] != '\''))
+            return (false);
+        quote = tag[pos++];
+        value_start = pos;
+        while (pos < len && tag[pos] != quote)
+            pos++;
+
+        if (name_len == 7 && !strncmp (&tag[name_start], "product", 7))
+            product_match = attr_value_matches (&tag[value_start],
+                pos - value_start, bmeta->product);
+        else if (name_len == 4 && !strncmp (&tag[name_start], "name", 4))
+            name_match = attr_value_matches (&tag[value_start],
+                pos - value_start, bmeta->name);
+        pos++;
+    }
+
+    return (product_match && name_match);
+}
+
+
+/******************************************************************************
+MODULE:  find_next_band
+
+PURPOSE: Finds the next <band> element in the XML text.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           A comment or band element isn't closed
+SUCCESS         Successfully searched for the band
+
+NOTES:
+  1. If there are no more bands, band_start and band_end are set to limit.
+  2. A band element which starts its line takes in the indentation before
+     it and the end of line after it, so it can be replaced by the output of
+     put_band_xml.
+  3. Elements in comments are skipped.
+******************************************************************************/
+static int find_next_band
+(
+    Xml_buffer_t *buf,        /* I: XML file contents */
+    size_t pos,               /* I: offset to start searching at */
+    size_t limit,             /* I: offset to stop searching at */
+    size_t *band_start,       /* O: offset of the start of the band */
+    size_t *attr_start,       /* O: offset of the band's attributes */
+    size_t *attr_len,         /* O: length of the band's attributes */
+    size_t *band_end          /* O: offset following the end of the band */
+)
+{
+    char FUNC_NAME[] = "find_next_band";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    const char *data = buf->data;  /* XML text */
+    size_t tag_end;           /* offset of the end of the start tag */
+    char quote;               /* quote being skipped in the start tag */
+    bool line_start;          /* does the band start its line? */
+
+    *band_start = limit;
+    *band_end = limit;
+
+    while (pos < limit)
+    {
+        if (data[pos] != '<')
+        {
+            pos++;
+            continue;
+        }
+
+        /* Skip comments */
+        if (limit - pos >= 4 && !strncmp (&data[pos], "<!--", 4))
+        {
+            for (pos += 4; pos < limit; pos++)
+            {
+                if (limit - pos >= 3 && !strncmp (&data[pos], "-->", 3))
+                    break;
+            }
+            if (pos >= limit)
+            {
+                error_handler (true, FUNC_NAME, "Unterminated comment in "
+                    "the XML");
+                return (ERROR);
+            }
+            pos += 3;
+            continue;
+        }
+
+        /* Look for a band, but not the bands element */
+        if (limit - pos > 5 && !strncmp (&data[pos], "<band", 5)
+            && (isspace ((unsigned char) data[pos+5]) || data[pos+5] == '>'
+            || data[pos+5] == '/'))
+            break;
+        pos++;
+    }
+    if (pos >= limit)
+        return (SUCCESS);
+
+    /* Find the end of the start tag, skipping quoted attribute values */
+    quote = '\0';
+    for (tag_end = pos + 5; tag_end < limit; tag_end++)
+    {
+        if (quote != '\0')
+        {
+            if (data[tag_end] == quote)
+                quote = '\0';
+        }
+        else if (data[tag_end] == '"' || data[tag_end] == '\'')
+            quote = data[tag_end];
+        else if (data[tag_end] == '>')
+            break;
+    }
+    if (tag_end >= limit)
+    {
+        error_handler (true, FUNC_NAME, "Unterminated band start tag in the "
+            "XML");
+        return (ERROR);
+    }
+    *attr_start = pos + 5;
+    *attr_len = tag_end - *attr_start;
+
+    /* Take in the indentation if the band starts its line */
+    *band_start = pos;
+    while (*band_start > 0 && (data[*band_start-1] == ' '
+        || data[*band_start-1] == '\t'))
+        (*band_start)--;
+    line_start = *band_start == 0 || data[*band_start-1] == '\n';
+    if (!line_start)
+        *band_start = pos;
+
+    /* Find the end of the band, unless the start tag closes it */
+    if (data[tag_end-1] == '/')
+        pos = tag_end + 1;
+    else
+    {
+        for (pos = tag_end + 1; pos < limit; pos++)
+        {
+            if (limit - pos >= 7 && !strncmp (&data[pos], "</band>", 7))
+                break;
+        }
+        if (pos >= limit)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Unterminated band element "
+                "%.*s in the XML", (int) (*attr_len < 80 ? *attr_len : 80),
+                &data[*attr_start]);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        pos += 7;
+    }
+
+    /* Take in the end of the line if the band starts its line */
+    *band_end = pos;
+    if (line_start)
+    {
+        while (pos < limit && (data[pos] == ' ' || data[pos] == '\t'
+            || data[pos] == '\r'))
+            pos++;
+        if (pos < limit && data[pos] == '\n')
+            *band_end = pos + 1;
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_metadata
+
+PURPOSE: Write the metadata structure to the specified XML metadata file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the metadata file
+SUCCESS         Successfully wrote the metadata file
+
+NOTES:
+  1. If the XML file specified already exists, it will be overwritten.
+  2. Use this routine to create a new metadata file.  To append bands to an
+     existing metadata file, use append_metadata.  To add or replace bands
+     from several places with a single write, use the metadata update
+     routines (init_metadata_update, etc.).
+  3. It is recommended that validate_meta be used after writing the XML file
+     to make sure the new file is valid against the ESPA schema.
+******************************************************************************/
+int write_metadata
+(
+    Espa_internal_meta_t *metadata,  /* I: input metadata structure to be
+                                           written to XML */
+    char *xml_file                   /* I: name of the XML metadata file to
+                                           be written to or overwritten */
+)
+{
+    int status;              /* return status */
+    int lock_fd;             /* descriptor holding the directory lock */
+    Xml_buffer_t buf = {NULL, 0, 0, false};  /* XML being written */
+
+    /* Build the XML file in memory */
+    put_metadata_xml (&buf, metadata);
+
+    /* Replace the XML file */
+    lock_fd = lock_xml_dir (xml_file);
+    status = write_xml_file (&buf, xml_file);
+    unlock_xml_dir (lock_fd);
+    free (buf.data);
+
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  append_metadata
+
+PURPOSE: Append additional bands to an existing metadata file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error appending the metadata file
+SUCCESS         Successfully appended to the metadata file
+
+NOTES:
+  1. The XML file is replaced by a new file with the bands appended.
+  2. Use this routine to append bands to and existing metadata file, use
+     write_metadata to create a new metadata file.
+  3. It is recommended that validate_meta be used after appending to the XML
+     file to make sure the new file is valid against the ESPA schema.
+  4. The existing XML is kept as is up to the closing </bands> element, so
+     it isn't parsed.  Note, if the closing </bands> element is not found in
+     the XML file, then the bands will simply be appended at the end of the
+     XML file.  This will likely leave an XML file which does not validate
+     against the ESPA schema, but the input XML likely didn't validate
+     either in this case.
+******************************************************************************/
+int append_metadata
+(
+    int nbands,               /* I: number of bands to be appended */
+    Espa_band_meta_t *bmeta,  /* I: pointer to the array of bands metadata
+                                    containing nbands */
+    char *xml_file            /* I: name of the XML metadata file for appending
+                                    the bands in bmeta */
+)
+{
+    int i;                   /* looping variable */
+    int status;              /* return status */
+    int lock_fd;             /* descriptor holding the directory lock */
+    Xml_buffer_t buf = {NULL, 0, 0, false};  /* XML being written */
+
+    /* Read the current XML under the lock, so no other writer can replace
+       it before the new XML is in place */
+    lock_fd = lock_xml_dir (xml_file);
+
+    if (read_xml_file (xml_file, &buf) != SUCCESS)
+    {  /* Error messages already printed */
+        unlock_xml_dir (lock_fd);
+        free (buf.data);
+        return (ERROR);
+    }
+
+    /* Append the new bands in place of the closing elements and then close
+       everything off (i.e. bands and espa_metadata) */
+    buf.size = find_bands_end (&buf);
+    for (i = 0; i < nbands; i++)
+        put_band_xml (&buf, &bmeta[i]);
+    put_str (&buf, "    </bands>\n");
+    put_str (&buf, "</espa_metadata>\n");
+
+    status = write_xml_file (&buf, xml_file);
+    unlock_xml_dir (lock_fd);
+    free (buf.data);
+
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  init_metadata_update
+
+PURPOSE: Starts an empty batch of band updates for an existing XML metadata
+file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The XML filename is too long
+SUCCESS         Successfully initialized the update
+
+NOTES:
+  1. Add bands to the update with add_metadata_update_band, write them all
+     with commit_metadata_update, and then release the update with
+     free_metadata_update.
+******************************************************************************/
+int init_metadata_update
+(
+    Espa_metadata_update_t *update,  /* O: metadata update to initialize */
+    char *xml_file                   /* I: name of the XML metadata file to
+                                           be updated */
+)
+{
+    char FUNC_NAME[] = "init_metadata_update";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int count;               /* number of characters copied */
+
+    update->nbands = 0;
+    update->band_alloc = 0;
+    update->band = NULL;
+
+    count = snprintf (update->xml_file, sizeof (update->xml_file), "%s",
+        xml_file);
+    if (count < 0 || count >= (int) sizeof (update->xml_file))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Overflow of the XML filename %s",
+            xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  add_metadata_update_band
+
+PURPOSE: Adds a band to a batch of band updates.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating memory for the band
+SUCCESS         Successfully added the band
+
+NOTES:
+  1. The band is copied, so the caller's band can be changed or freed.
+  2. When the update is committed, the band replaces the band in the XML
+     file with the same product and name.  If there is no such band, it is
+     appended to the bands.
+  3. A band with the same product and name as a band already in the update
+     replaces that band in the update.
+******************************************************************************/
+int add_metadata_update_band
+(
+    Espa_metadata_update_t *update,  /* I/O: metadata update */
+    Espa_band_meta_t *bmeta          /* I: band to add or replace */
+)
+{
+    char FUNC_NAME[] = "add_metadata_update_band";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int indx;                /* index of the band in the update */
+    int new_alloc;           /* new number of bands allocated */
+    Espa_band_meta_t *new_band = NULL;  /* reallocated array of bands */
+
+    /* Replace the same band from an earlier call */
+    indx = find_band (update->nbands, update->band, bmeta);
+    if (indx >= 0)
+    {
+        free_band_descriptions (&update->band[indx]);
+        return (copy_band_metadata (bmeta, &update->band[indx]));
+    }
+
+    /* Make room for another band */
+    if (update->nbands == update->band_alloc)
+    {
+        new_alloc = update->band_alloc > 0 ? update->band_alloc * 2
+            : UPDATE_INIT_ALLOC;
+        new_band = realloc (update->band, new_alloc * sizeof (*new_band));
+        if (new_band == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Allocating the metadata "
+                "update for %d bands", new_alloc);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        update->band = new_band;
+        update->band_alloc = new_alloc;
+    }
+
+    if (copy_band_metadata (bmeta, &update->band[update->nbands]) != SUCCESS)
+    {  /* Error messages already printed; free whatever was copied */
+        free_band_descriptions (&update->band[update->nbands]);
+        return (ERROR);
+    }
+    update->nbands++;
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  commit_metadata_update
+
+PURPOSE: Writes a batch of band updates to the XML metadata file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error updating the metadata file
+SUCCESS         Successfully updated the metadata file
+
+NOTES:
+  1. Each band in the update replaces the <band> element in the current XML
+     file with the same product and name, or is inserted before the closing
+     </bands> element if there isn't one.  The rest of the XML is kept as
+     is, so it isn't parsed and elements this library doesn't know about
+     are kept.
+  2. The current XML is read and the new XML written while holding the
+     directory lock.  Other tools updating the same XML file at the same
+     time have their bands merged in turn rather than overwritten.
+  3. The update is left as is, so the caller still needs to call
+     free_metadata_update.
+  4. It is recommended that validate_meta be used after updating the XML
+     file to make sure the new file is valid against the ESPA schema.
+******************************************************************************/
+int commit_metadata_update
+(
+    Espa_metadata_update_t *update   /* I: metadata update to be written */
+)
+{
+    char FUNC_NAME[] = "commit_metadata_update";   /* function name */
+    char errmsg[2 * STR_SIZE];  /* error message; room for the XML
+                                   filename along with the message */
+    int i;                   /* looping variable */
+    int status;              /* return status */
+    int lock_fd;             /* descriptor holding the directory lock */
+    size_t bands_end;        /* offset of the </bands> line */
+    size_t copied;           /* offset of the XML copied so far */
+    size_t band_start;       /* offset of the start of a band */
+    size_t band_end;         /* offset following the end of a band */
+    size_t attr_start;       /* offset of the attributes of a band */
+    size_t attr_len;         /* length of the attributes of a band */
+    bool *replaced = NULL;   /* has the band in the update replaced a band
+                                in the XML? */
+    Xml_buffer_t xml = {NULL, 0, 0, false};  /* current XML */
+    Xml_buffer_t buf = {NULL, 0, 0, false};  /* XML being written */
+
+    if (update->nbands > 0)
+    {
+        replaced = calloc (update->nbands, sizeof (bool));
+        if (replaced == NULL)
+        {
+            error_handler (true, FUNC_NAME, "Allocating the replaced flags "
+                "of the update bands");
+            return (ERROR);
+        }
+    }
+
+    lock_fd = lock_xml_dir (update->xml_file);
+
+    /* Get the current XML */
+    if (read_xml_file (update->xml_file, &xml) != SUCCESS)
+    {  /* Error messages already printed */
+        unlock_xml_dir (lock_fd);
+        free (xml.data);
+        free (replaced);
+        return (ERROR);
+    }
+
+    bands_end = find_bands_end (&xml);
+    if (bands_end == xml.size)
+    {
+        snprintf (errmsg, sizeof (errmsg), "No closing </bands> element in "
+            "%s", update->xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlock_xml_dir (lock_fd);
+        free (xml.data);
+        free (replaced);
+        return (ERROR);
+    }
+
+    /* Copy the XML up to the closing </bands> element, replacing the bands
+       which are in the update */
+    status = SUCCESS;
+    copied = 0;
+    band_end = 0;
+    while (band_end < bands_end)
+    {
+        status = find_next_band (&xml, band_end, bands_end, &band_start,
+            &attr_start, &attr_len, &band_end);
+        if (status != SUCCESS || band_start == bands_end)
+            break;
+
+        for (i = 0; i < update->nbands; i++)
+        {
+            if (!replaced[i] && band_tag_matches (&xml.data[attr_start],
+                attr_len, &update->band[i]))
+                break;
+        }
+        if (i == update->nbands)
+            continue;
+
+        put_bytes (&buf, xml.data + copied, band_start - copied);
+        put_band_xml (&buf, &update->band[i]);
+        replaced[i] = true;
+        copied = band_end;
+    }
+
+    /* Add the new bands and then copy the rest of the XML */
+    if (status == SUCCESS)
+    {
+        put_bytes (&buf, xml.data + copied, bands_end - copied);
+        for (i = 0; i < update->nbands; i++)
+        {
+            if (!replaced[i])
+                put_band_xml (&buf, &update->band[i]);
+        }
+        put_bytes (&buf, xml.data + bands_end, xml.size - bands_end);
+
+        status = write_xml_file (&buf, update->xml_file);
+    }
+    else
+    {
+        snprintf (errmsg, sizeof (errmsg), "Finding the bands in %s",
+            update->xml_file);
+        error_handler (true, FUNC_NAME, errmsg);
+    }
+    unlock_xml_dir (lock_fd);
+
+    free (buf.data);
+    free (xml.data);
+    free (replaced);
+
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  free_metadata_update
+
+PURPOSE: Frees the bands in a batch of band updates.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void free_metadata_update
+(
+    Espa_metadata_update_t *update   /* I/O: metadata update to be freed */
+)
+{
+    int i;                   /* looping variable */
+
+    for (i = 0; i < update->nbands; i++)
+        free_band_descriptions (&update->band[i]);
+    free (update->band);
+
+    update->nbands = 0;
+    update->band_alloc = 0;
+    update->band = NULL;
+}
+
+
+
+
 /******************************************************************************
 MODULE:  print_metadata_struct
 
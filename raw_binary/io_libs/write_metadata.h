@@ -24,6 +24,16 @@ NOTES:
 /* maximum number of characters per line in the XML file */
 #define MAX_LINE_SIZE 1024
 
+/* Batch of bands to be added to or replaced in an existing XML metadata
+   file with a single write.  Initialize via init_metadata_update. */
+typedef struct
+{
+    char xml_file[STR_SIZE];   /* name of the XML metadata file to update */
+    int nbands;                /* number of bands in the update */
+    int band_alloc;            /* number of bands allocated in band */
+    Espa_band_meta_t *band;    /* copies of the bands to add or replace */
+} Espa_metadata_update_t;
+
 /* Prototypes */
 int write_metadata
 (
@@ -42,6 +52,29 @@ int append_metadata
                                     the bands in bmeta */
 );
 
+int init_metadata_update
+(
+    Espa_metadata_update_t *update,  /* O: metadata update to initialize */
+    char *xml_file                   /* I: name of the XML metadata file to
+                                           be updated */
+);
+
+int add_metadata_update_band
+(
+    Espa_metadata_update_t *update,  /* I/O: metadata update */
+    Espa_band_meta_t *bmeta          /* I: band to add or replace */
+);
+
+int commit_metadata_update
+(
+    Espa_metadata_update_t *update   /* I: metadata update to be written */
+);
+
+void free_metadata_update
+(
+    Espa_metadata_update_t *update   /* I/O: metadata update to be freed */
+);
+
 void print_metadata_struct
 (
     Espa_internal_meta_t *metadata  /* I: input metadata structure to be
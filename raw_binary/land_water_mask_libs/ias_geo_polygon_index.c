@@ -0,0 +1,623 @@
+/* Standard Library Includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+/* IAS Library Includes */
+#include "ias_lw_geo.h"
+#include "ias_logging.h"
+
+/* Local Defines */
+#define INDEX_MAGIC "LWPIDX01"  /* Identifies (and versions) an index file */
+#define INDEX_MAGIC_SIZE 8
+#define INDEX_HEADER_SIZE 40    /* Magic, polygon file size and time, number
+                                   of parents, tile size, columns and rows */
+#define INDEX_RECORD_SIZE 40    /* Offset and bounding box of a parent */
+
+/* Spatial index header.  The index file holds the header, followed by the
+   start of each tile's entries (num_tiles + 1 values, CSR style), the offset
+   and bounding box of each parent polygon, and the parent polygon numbers
+   in each tile.  The tiles are stored in row (latitude) major order, so the
+   entries for a run of columns in a row are contiguous. */
+typedef struct polygon_index_header
+{
+    int64_t polygon_size;           /* Size of the indexed polygon file */
+    int64_t polygon_mtime;          /* Modify time of the polygon file */
+    unsigned int nparent_polygons;  /* Number of parent polygons */
+    int tile_size;                  /* Tile size (degrees) */
+    int num_cols;                   /* Number of longitude tiles */
+    int num_rows;                   /* Number of latitude tiles */
+} POLYGON_INDEX_HEADER;
+
+/*****************************************************************************
+NAME:  get_tile_range
+
+PURPOSE:  Find the range of tiles covered by a coordinate range.  Coordinates
+          outside the globe are clamped to the edge tiles, so a range which
+          overlaps a polygon's bounding box always overlaps its tiles.
+
+RETURN VALUE:
+Type = void
+
+*****************************************************************************/
+static void get_tile_range
+(
+    double min,             /* I: Minimum coordinate (degrees) */
+    double max,             /* I: Maximum coordinate (degrees) */
+    double origin,          /* I: Coordinate of the first tile edge */
+    int tile_size,          /* I: Tile size (degrees) */
+    int num_tiles,          /* I: Number of tiles in this direction */
+    int *first,             /* O: First tile covered */
+    int *last               /* O: Last tile covered */
+)
+{
+    double tile;            /* Fractional tile */
+
+    tile = floor((min - origin) / tile_size);
+    if (tile < 0.0)
+        *first = 0;
+    else if (tile > num_tiles - 1)
+        *first = num_tiles - 1;
+    else
+        *first = (int)tile;
+
+    tile = floor((max - origin) / tile_size);
+    if (tile < 0.0)
+        *last = 0;
+    else if (tile > num_tiles - 1)
+        *last = num_tiles - 1;
+    else
+        *last = (int)tile;
+}
+
+/*****************************************************************************
+NAME:  get_file_stamp
+
+PURPOSE:  Get the size and modify time of the polygon file, which are stored
+          in the index to detect an index built from a different polygon.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+*****************************************************************************/
+static int get_file_stamp
+(
+    const char *polygon_file,   /* I: Polygon filename */
+    int64_t *size,              /* O: File size (bytes) */
+    int64_t *mtime              /* O: File modify time */
+)
+{
+    struct stat file_stat;      /* File status */
+
+    if (stat(polygon_file, &file_stat) != 0)
+    {
+        IAS_LOG_ERROR("Getting the status of %s", polygon_file);
+        return ERROR;
+    }
+
+    *size = file_stat.st_size;
+    *mtime = file_stat.st_mtime;
+
+    return SUCCESS;
+}
+
+/*****************************************************************************
+NAME:  get_index_name
+
+PURPOSE:  Build the default index filename for a polygon file.
+
+RETURN VALUE:
+Type = char *
+Value    Description
+-----    -----------
+NULL     Operation failed
+other    Index filename; the caller frees it
+
+*****************************************************************************/
+static char *get_index_name
+(
+    const char *polygon_file    /* I: Polygon filename */
+)
+{
+    char *index_file;           /* Index filename */
+
+    index_file = malloc(strlen(polygon_file)
+        + strlen(IAS_GEO_POLYGON_INDEX_EXTENSION) + 1);
+    if (index_file == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon index filename");
+        return NULL;
+    }
+
+    sprintf(index_file, "%s%s", polygon_file, IAS_GEO_POLYGON_INDEX_EXTENSION);
+
+    return index_file;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_build_polygon_index
+
+PURPOSE:  Build the spatial index sidecar for a polygon file.  Each parent
+          polygon is added to every tile its bounding box touches, so a
+          scene only needs to look at the parents listed in the tiles it
+          covers instead of scanning the whole parent table.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES:
+  1. The index is tied to the size and modify time of the polygon file, so
+     it needs to be rebuilt whenever the polygon file is replaced.
+  2. The index is written next to the polygon file, where
+     ias_geo_load_indexed_polygon looks for it.  It is written to a
+     temporary file and renamed into place, so a land/water mask run reading
+     the old index never sees a partially written one.
+*****************************************************************************/
+int ias_geo_build_polygon_index
+(
+    const char *polygon_file    /* I: Polygon filename */
+)
+{
+    POLYGON_INDEX_HEADER header;    /* Index header */
+    FILE *fp;                       /* Polygon/index file pointer */
+    char *index_file;               /* Index filename */
+    char *temp_file;                /* Temporary index filename */
+    int64_t *offset;                /* Parent polygon offsets */
+    IAS_DBL_XY *bb_min;             /* Bounding box min x/y values */
+    IAS_DBL_XY *bb_max;             /* Bounding box max x/y values */
+    unsigned int *tile_start;       /* Start of the entries of each tile */
+    unsigned int *cursor;           /* Next free entry of each tile */
+    unsigned int *entries;          /* Parent polygons in each tile */
+    unsigned int num_tiles;         /* Number of tiles */
+    unsigned int i;                 /* Parent polygon counter */
+    int first_col, last_col;        /* Tile columns of a bounding box */
+    int first_row, last_row;        /* Tile rows of a bounding box */
+    int row, col;                   /* Tile row and column */
+    int status = SUCCESS;           /* Return status */
+
+    index_file = get_index_name(polygon_file);
+    if (index_file == NULL)
+        return ERROR;
+
+    /* Read the parent table of the polygon file */
+    if ((fp = fopen(polygon_file, "r")) == NULL)
+    {
+        IAS_LOG_ERROR("Unable to open %s for reading.", polygon_file);
+        free(index_file);
+        return ERROR;
+    }
+
+    if (ias_geo_read_polygon_parents(fp, &header.nparent_polygons, &offset,
+        &bb_min, &bb_max) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Reading the parent polygon table from %s",
+            polygon_file);
+        fclose(fp);
+        free(index_file);
+        return ERROR;
+    }
+    fclose(fp);
+
+    if (get_file_stamp(polygon_file, &header.polygon_size,
+        &header.polygon_mtime) != SUCCESS)
+    {
+        free(offset);
+        free(bb_min);
+        free(bb_max);
+        free(index_file);
+        return ERROR;
+    }
+
+    header.tile_size = IAS_GEO_POLYGON_INDEX_TILE_SIZE;
+    header.num_cols = 360 / header.tile_size;
+    header.num_rows = 180 / header.tile_size;
+    num_tiles = header.num_cols * header.num_rows;
+
+    tile_start = calloc(num_tiles + 1, sizeof(unsigned int));
+    cursor = malloc(num_tiles * sizeof(unsigned int));
+    if (tile_start == NULL || cursor == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon index tiles");
+        free(tile_start);
+        free(cursor);
+        free(offset);
+        free(bb_min);
+        free(bb_max);
+        free(index_file);
+        return ERROR;
+    }
+
+    /* Count the parents touching each tile, then turn the counts into the
+       start of each tile's entries */
+    for (i = 0; i < header.nparent_polygons; i++)
+    {
+        get_tile_range(bb_min[i].x, bb_max[i].x, -180.0, header.tile_size,
+            header.num_cols, &first_col, &last_col);
+        get_tile_range(bb_min[i].y, bb_max[i].y, -90.0, header.tile_size,
+            header.num_rows, &first_row, &last_row);
+        for (row = first_row; row <= last_row; row++)
+        {
+            for (col = first_col; col <= last_col; col++)
+                tile_start[row * header.num_cols + col + 1]++;
+        }
+    }
+    for (i = 0; i < num_tiles; i++)
+    {
+        tile_start[i + 1] += tile_start[i];
+        cursor[i] = tile_start[i];
+    }
+
+    entries = malloc((tile_start[num_tiles] + 1) * sizeof(unsigned int));
+    if (entries == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon index entries");
+        free(tile_start);
+        free(cursor);
+        free(offset);
+        free(bb_min);
+        free(bb_max);
+        free(index_file);
+        return ERROR;
+    }
+
+    /* Fill in the entries.  Visiting the parents in order keeps the entries
+       of each tile sorted. */
+    for (i = 0; i < header.nparent_polygons; i++)
+    {
+        get_tile_range(bb_min[i].x, bb_max[i].x, -180.0, header.tile_size,
+            header.num_cols, &first_col, &last_col);
+        get_tile_range(bb_min[i].y, bb_max[i].y, -90.0, header.tile_size,
+            header.num_rows, &first_row, &last_row);
+        for (row = first_row; row <= last_row; row++)
+        {
+            for (col = first_col; col <= last_col; col++)
+                entries[cursor[row * header.num_cols + col]++] = i;
+        }
+    }
+    free(cursor);
+
+    /* Write the index */
+    if ((fp = ias_geo_open_temp_file(index_file, &temp_file)) == NULL)
+        status = ERROR;
+    else
+    {
+        if (fwrite(INDEX_MAGIC, 1, INDEX_MAGIC_SIZE, fp) != INDEX_MAGIC_SIZE
+            || fwrite(&header.polygon_size, sizeof(int64_t), 1, fp) != 1
+            || fwrite(&header.polygon_mtime, sizeof(int64_t), 1, fp) != 1
+            || fwrite(&header.nparent_polygons, sizeof(unsigned int), 1, fp)
+                != 1
+            || fwrite(&header.tile_size, sizeof(int), 1, fp) != 1
+            || fwrite(&header.num_cols, sizeof(int), 1, fp) != 1
+            || fwrite(&header.num_rows, sizeof(int), 1, fp) != 1
+            || fwrite(tile_start, sizeof(unsigned int), num_tiles + 1, fp)
+                != num_tiles + 1)
+        {
+            IAS_LOG_ERROR("Writing the polygon index header to %s",
+                index_file);
+            status = ERROR;
+        }
+
+        for (i = 0; i < header.nparent_polygons && status == SUCCESS; i++)
+        {
+            if (fwrite(&offset[i], sizeof(int64_t), 1, fp) != 1
+                || fwrite(&bb_min[i].x, sizeof(double), 1, fp) != 1
+                || fwrite(&bb_max[i].x, sizeof(double), 1, fp) != 1
+                || fwrite(&bb_min[i].y, sizeof(double), 1, fp) != 1
+                || fwrite(&bb_max[i].y, sizeof(double), 1, fp) != 1)
+            {
+                IAS_LOG_ERROR("Writing the parent polygon records to %s",
+                    index_file);
+                status = ERROR;
+            }
+        }
+
+        if (status == SUCCESS && fwrite(entries, sizeof(unsigned int),
+            tile_start[num_tiles], fp) != tile_start[num_tiles])
+        {
+            IAS_LOG_ERROR("Writing the polygon index entries to %s",
+                index_file);
+            status = ERROR;
+        }
+
+        /* Replace the index only once it is complete */
+        status = ias_geo_close_temp_file(fp, temp_file, index_file, status);
+    }
+
+    free(entries);
+    free(tile_start);
+    free(offset);
+    free(bb_min);
+    free(bb_max);
+    free(index_file);
+
+    return status;
+}
+
+/*****************************************************************************
+NAME:  read_index_offsets
+
+PURPOSE:  Use the spatial index to find the offsets of the parent polygons
+          whose bounding boxes overlap the area of interest.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    The index is missing, out of date, or couldn't be read
+
+NOTES:
+  1. The offsets are returned in parent polygon order, the same order a full
+     scan of the parent table finds them in.
+*****************************************************************************/
+static int read_index_offsets
+(
+    const char *polygon_file,   /* I: Polygon filename */
+    const char *index_file,     /* I: Index filename */
+    double min_x,               /* I: Minimum x value of interest */
+    double max_x,               /* I: Maximum x value of interest */
+    double min_y,               /* I: Minimum y value of interest */
+    double max_y,               /* I: Maximum y value of interest */
+    unsigned int *count,        /* O: Number of parent polygons found */
+    int64_t **offset            /* O: Offsets of the parent polygons; the
+                                      caller frees them */
+)
+{
+    POLYGON_INDEX_HEADER header;    /* Index header */
+    FILE *fp;                       /* Index file pointer */
+    char magic[INDEX_MAGIC_SIZE];   /* Index file magic */
+    int64_t polygon_size;           /* Current polygon file size */
+    int64_t polygon_mtime;          /* Current polygon file modify time */
+    off_t records_start;            /* File position of the parent records */
+    off_t entries_start;            /* File position of the tile entries */
+    unsigned int *tile_start = NULL;/* Entry range of a run of tiles */
+    unsigned int *entries = NULL;   /* Entries of a run of tiles */
+    unsigned int max_entries = 0;   /* Size of the entries buffer */
+    unsigned int num_entries;       /* Entries in a run of tiles */
+    unsigned char *selected = NULL; /* Flags the parents listed in the tiles */
+    unsigned int i;                 /* Counter */
+    int first_col, last_col;        /* Tile columns of the area */
+    int first_row, last_row;        /* Tile rows of the area */
+    int num_cols;                   /* Number of tile columns in a row run */
+    int row;                        /* Tile row */
+    int64_t record_offset;          /* Offset of a parent polygon */
+    double bounds[4];               /* Bounding box of a parent polygon */
+    int status = SUCCESS;           /* Return status */
+
+    *count = 0;
+    *offset = NULL;
+
+    if ((fp = fopen(index_file, "r")) == NULL)
+    {
+        IAS_LOG_DEBUG("No polygon index %s", index_file);
+        return ERROR;
+    }
+
+    /* Read and check the header */
+    if (fread(magic, 1, INDEX_MAGIC_SIZE, fp) != INDEX_MAGIC_SIZE
+        || fread(&header.polygon_size, sizeof(int64_t), 1, fp) != 1
+        || fread(&header.polygon_mtime, sizeof(int64_t), 1, fp) != 1
+        || fread(&header.nparent_polygons, sizeof(unsigned int), 1, fp) != 1
+        || fread(&header.tile_size, sizeof(int), 1, fp) != 1
+        || fread(&header.num_cols, sizeof(int), 1, fp) != 1
+        || fread(&header.num_rows, sizeof(int), 1, fp) != 1)
+    {
+        IAS_LOG_WARNING("Reading the polygon index header from %s",
+            index_file);
+        fclose(fp);
+        return ERROR;
+    }
+
+    if (memcmp(magic, INDEX_MAGIC, INDEX_MAGIC_SIZE) != 0
+        || header.tile_size <= 0 || header.nparent_polygons == 0
+        || header.num_cols != 360 / header.tile_size
+        || header.num_rows != 180 / header.tile_size)
+    {
+        IAS_LOG_WARNING("%s is not a valid polygon index", index_file);
+        fclose(fp);
+        return ERROR;
+    }
+
+    if (get_file_stamp(polygon_file, &polygon_size, &polygon_mtime)
+            != SUCCESS
+        || polygon_size != header.polygon_size
+        || polygon_mtime != header.polygon_mtime)
+    {
+        IAS_LOG_WARNING("Polygon index %s is out of date with %s",
+            index_file, polygon_file);
+        fclose(fp);
+        return ERROR;
+    }
+
+    records_start = INDEX_HEADER_SIZE + (off_t)(header.num_cols
+        * header.num_rows + 1) * sizeof(unsigned int);
+    entries_start = records_start
+        + (off_t)header.nparent_polygons * INDEX_RECORD_SIZE;
+
+    get_tile_range(min_x, max_x, -180.0, header.tile_size, header.num_cols,
+        &first_col, &last_col);
+    get_tile_range(min_y, max_y, -90.0, header.tile_size, header.num_rows,
+        &first_row, &last_row);
+    num_cols = last_col - first_col + 1;
+
+    tile_start = malloc((num_cols + 1) * sizeof(unsigned int));
+    selected = calloc(header.nparent_polygons, sizeof(unsigned char));
+    *offset = malloc(header.nparent_polygons * sizeof(int64_t));
+    if (tile_start == NULL || selected == NULL || *offset == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon index buffers");
+        status = ERROR;
+    }
+
+    /* Flag the parents listed in the tiles covering the area.  Each row's
+       run of tiles has contiguous entries, so it takes one read. */
+    for (row = first_row; row <= last_row && status == SUCCESS; row++)
+    {
+        if (fseeko(fp, INDEX_HEADER_SIZE + (off_t)(row * header.num_cols
+            + first_col) * sizeof(unsigned int), SEEK_SET) != 0
+            || fread(tile_start, sizeof(unsigned int), num_cols + 1, fp)
+                != (size_t)(num_cols + 1)
+            || tile_start[num_cols] < tile_start[0])
+        {
+            IAS_LOG_WARNING("Reading the polygon index tiles from %s",
+                index_file);
+            status = ERROR;
+            break;
+        }
+
+        num_entries = tile_start[num_cols] - tile_start[0];
+        if (num_entries == 0)
+            continue;
+
+        if (num_entries > max_entries)
+        {
+            unsigned int *new_entries; /* Resized entries buffer */
+
+            new_entries = realloc(entries,
+                num_entries * sizeof(unsigned int));
+            if (new_entries == NULL)
+            {
+                IAS_LOG_ERROR("Allocating the polygon index entries");
+                status = ERROR;
+                break;
+            }
+            entries = new_entries;
+            max_entries = num_entries;
+        }
+
+        if (fseeko(fp, entries_start + (off_t)tile_start[0]
+            * sizeof(unsigned int), SEEK_SET) != 0
+            || fread(entries, sizeof(unsigned int), num_entries, fp)
+                != num_entries)
+        {
+            IAS_LOG_WARNING("Reading the polygon index entries from %s",
+                index_file);
+            status = ERROR;
+            break;
+        }
+
+        for (i = 0; i < num_entries; i++)
+        {
+            if (entries[i] >= header.nparent_polygons)
+            {
+                IAS_LOG_WARNING("Invalid parent polygon in index %s",
+                    index_file);
+                status = ERROR;
+                break;
+            }
+            selected[entries[i]] = 1;
+        }
+    }
+
+    /* Check the bounding box of each flagged parent, the same check a full
+       scan of the parent table makes */
+    for (i = 0; i < header.nparent_polygons && status == SUCCESS; i++)
+    {
+        if (!selected[i])
+            continue;
+
+        if (fseeko(fp, records_start + (off_t)i * INDEX_RECORD_SIZE,
+            SEEK_SET) != 0
+            || fread(&record_offset, sizeof(int64_t), 1, fp) != 1
+            || fread(bounds, sizeof(double), 4, fp) != 4)
+        {
+            IAS_LOG_WARNING("Reading the parent polygon records from %s",
+                index_file);
+            status = ERROR;
+            break;
+        }
+
+        /* Bounds are min x, max x, min y, max y */
+        if (bounds[0] > max_x || bounds[1] < min_x ||
+            bounds[2] > max_y || bounds[3] < min_y)
+            continue;
+
+        (*offset)[(*count)++] = record_offset;
+    }
+
+    fclose(fp);
+    free(tile_start);
+    free(entries);
+    free(selected);
+
+    if (status != SUCCESS)
+    {
+        free(*offset);
+        *offset = NULL;
+        *count = 0;
+    }
+
+    return status;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_load_indexed_polygon
+
+PURPOSE:  Read the polygons overlapping the area of interest, using the
+          spatial index sidecar of the polygon file to avoid scanning the
+          whole parent table.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES:
+  1. If the index doesn't exist, is out of date, or can't be read, this
+     falls back to ias_geo_load_polygon, so the same polygons are returned
+     either way.
+  2. An area which wraps around (minimum x greater than maximum x) always
+     uses ias_geo_load_polygon.
+*****************************************************************************/
+int ias_geo_load_indexed_polygon
+(
+    const char *polygon_file,       /* I: Polygon filename */
+    FILE *fp,                       /* I: Polygon file pointer, positioned at
+                                          the start of the file */
+    double min_x,                   /* I: Minimum x value of interest */
+    double max_x,                   /* I: Maximum x value of interest */
+    double min_y,                   /* I: Minimum y value of interest */
+    double max_y,                   /* I: Maximum y value of interest */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+)
+{
+    char *index_file;               /* Index filename */
+    int64_t *offset;                /* Offsets of the parents in range */
+    unsigned int count;             /* Number of parents in range */
+    int status;                     /* Return status */
+
+    *head = NULL;
+
+    if (!(min_x <= max_x) || !(min_y <= max_y))
+        return ias_geo_load_polygon(fp, min_x, max_x, min_y, max_y, head);
+
+    index_file = get_index_name(polygon_file);
+    if (index_file == NULL)
+        return ERROR;
+
+    status = read_index_offsets(polygon_file, index_file, min_x, max_x,
+        min_y, max_y, &count, &offset);
+    free(index_file);
+    if (status != SUCCESS)
+    {
+        IAS_LOG_DEBUG("Scanning the full parent table of %s", polygon_file);
+        return ias_geo_load_polygon(fp, min_x, max_x, min_y, max_y, head);
+    }
+
+    status = ias_geo_load_polygon_offsets(fp, count, offset, head);
+    free(offset);
+
+    return status;
+}
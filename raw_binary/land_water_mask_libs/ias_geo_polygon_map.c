@@ -0,0 +1,714 @@
+/* Standard Library Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* IAS Library Includes */
+#include "ias_lw_geo.h"
+#include "ias_logging.h"
+
+/* Local Defines */
+#define MAP_MAGIC "LWPMAP02"    /* Identifies (and versions) a polygon map */
+#define MAP_MAGIC_SIZE 8
+#define MAP_NO_LINK -1          /* Link value for no child or next polygon */
+
+/* Polygon map layout.  The file holds the header, the polygon records, the
+   x coordinates of all the polygons, the y coordinates of all the polygons,
+   and the segment groups of all the polygons.  Each section starts on an 8
+   byte boundary so the arrays can be used in place once the file is mapped.
+   The parent polygons are the first records, in the same order as the
+   polygon file, and the children of a polygon are consecutive records after
+   it.  The parent records also hold the bounding boxes from the parent
+   polygon table, which select the parents just as ias_geo_load_polygon
+   does. */
+typedef struct polygon_map_header
+{
+    char magic[MAP_MAGIC_SIZE];     /* MAP_MAGIC */
+    unsigned int num_polygons;      /* Number of polygon records */
+    unsigned int num_parents;       /* Number of parent polygons */
+    int64_t num_points;             /* Total number of points */
+    int64_t num_segs;               /* Total number of segment groups */
+    int64_t records_offset;         /* File offset of the polygon records */
+    int64_t x_offset;               /* File offset of the x coordinates */
+    int64_t y_offset;               /* File offset of the y coordinates */
+    int64_t segs_offset;            /* File offset of the segment groups */
+} POLYGON_MAP_HEADER;
+
+typedef struct polygon_map_record
+{
+    unsigned int id;                /* Polygon id */
+    unsigned int num_points;        /* Number of points, including the copy
+                                       of the first point which closes the
+                                       polygon */
+    unsigned int num_segs;          /* Number of segment groups */
+    int child;                      /* Record of the first child, or
+                                       MAP_NO_LINK */
+    int next;                       /* Record of the next polygon in the same
+                                       list, or MAP_NO_LINK */
+    unsigned int pad;               /* Keeps the following members aligned */
+    int64_t first_point;            /* Index of the first point */
+    int64_t first_seg;              /* Index of the first segment group */
+    double min_x;                   /* Minimum x bounds */
+    double max_x;                   /* Maximum x bounds */
+    double min_y;                   /* Minimum y bounds */
+    double max_y;                   /* Maximum y bounds */
+    double bb_min_x;                /* Minimum x value of the parent
+                                       polygon table bounding box */
+    double bb_max_x;                /* Maximum x value of the parent
+                                       polygon table bounding box */
+    double bb_min_y;                /* Minimum y value of the parent
+                                       polygon table bounding box */
+    double bb_max_y;                /* Maximum y value of the parent
+                                       polygon table bounding box */
+} POLYGON_MAP_RECORD;
+
+struct ias_geo_polygon_map
+{
+    void *base;                         /* Start of the mapping */
+    size_t size;                        /* Size of the mapping */
+    const POLYGON_MAP_HEADER *header;   /* File header */
+    const POLYGON_MAP_RECORD *records;  /* Polygon records */
+    const double *point_x;              /* X coordinates */
+    const double *point_y;              /* Y coordinates */
+    const IAS_POLYGON_SEGMENT *poly_seg;/* Segment groups */
+};
+
+/*****************************************************************************
+NAME:  align_offset
+
+PURPOSE:  Round a file offset up to the next 8 byte boundary.
+
+RETURN VALUE:
+Type = int64_t
+Aligned offset
+
+*****************************************************************************/
+static int64_t align_offset
+(
+    int64_t offset          /* I: File offset */
+)
+{
+    return (offset + 7) & ~(int64_t)7;
+}
+
+/*****************************************************************************
+NAME:  write_padding
+
+PURPOSE:  Write zeros to pad the file out to the given offset.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+*****************************************************************************/
+static int write_padding
+(
+    FILE *fp,               /* I: Output file pointer */
+    int64_t *position,      /* I/O: Current file offset */
+    int64_t offset          /* I: File offset to pad out to */
+)
+{
+    static const char zeros[8] = {0}; /* Padding bytes */
+    size_t count = offset - *position;/* Number of padding bytes */
+
+    if (count > 0 && fwrite(zeros, 1, count, fp) != count)
+        return ERROR;
+
+    *position = offset;
+
+    return SUCCESS;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_write_polygon_map
+
+PURPOSE:  Convert a polygon file into the pre-processed polygon map format,
+          which can be mapped read-only and used without parsing.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES:
+  1. The whole polygon file is loaded to build the map.
+  2. The map is written to a temporary file and renamed into place.  A
+     process which has the old map mapped keeps using the old file, rather
+     than faulting when the file under its mapping is truncated.
+*****************************************************************************/
+int ias_geo_write_polygon_map
+(
+    const char *polygon_file,   /* I: Polygon filename */
+    const char *map_file        /* I: Output mapped polygon filename */
+)
+{
+    POLYGON_MAP_HEADER header;          /* Map header */
+    POLYGON_MAP_RECORD *records = NULL; /* Polygon records */
+    IAS_POLYGON_LINKED_LIST **nodes = NULL; /* Polygon of each record */
+    IAS_POLYGON_LINKED_LIST *head = NULL;   /* Parent polygon list */
+    IAS_POLYGON_LINKED_LIST *polygon;   /* Current polygon */
+    FILE *fp;                           /* Polygon/map file pointer */
+    char *temp_file;                    /* Temporary map filename */
+    int64_t *offset;                    /* Parent polygon offsets */
+    IAS_DBL_XY *bb_min = NULL;          /* Bounding box min x/y values */
+    IAS_DBL_XY *bb_max = NULL;          /* Bounding box max x/y values */
+    int64_t position;                   /* Current output file offset */
+    unsigned int count;                 /* Number of records assigned */
+    unsigned int i;                     /* Record counter */
+    int status = SUCCESS;               /* Return status */
+
+    /* Load every polygon in the file */
+    if ((fp = fopen(polygon_file, "r")) == NULL)
+    {
+        IAS_LOG_ERROR("Unable to open %s for reading.", polygon_file);
+        return ERROR;
+    }
+
+    if (ias_geo_read_polygon_parents(fp, &header.num_parents, &offset,
+        &bb_min, &bb_max) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Reading the parent polygon table from %s",
+            polygon_file);
+        fclose(fp);
+        return ERROR;
+    }
+
+    status = ias_geo_load_polygon_offsets(fp, header.num_parents, offset,
+        &head);
+    free(offset);
+    fclose(fp);
+    if (status != SUCCESS)
+    {
+        IAS_LOG_ERROR("Reading the polygons from %s", polygon_file);
+        free(bb_min);
+        free(bb_max);
+        return ERROR;
+    }
+
+    nodes = malloc(header.num_parents * sizeof(*nodes));
+    if (nodes == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon map records");
+        free(bb_min);
+        free(bb_max);
+        ias_geo_free_polygon_linked_list(head);
+        return ERROR;
+    }
+    count = 0;
+    for (polygon = head; polygon; polygon = polygon->next)
+        nodes[count++] = polygon;
+
+    /* Assign records breadth first, so each list of children gets
+       consecutive records after its parent */
+    header.num_points = 0;
+    header.num_segs = 0;
+    for (i = 0; i < count; i++)
+    {
+        unsigned int num_children = 0;  /* Number of children */
+
+        header.num_points += nodes[i]->num_points;
+        header.num_segs += nodes[i]->num_segs;
+
+        for (polygon = nodes[i]->child; polygon; polygon = polygon->next)
+            num_children++;
+        if (num_children == 0)
+            continue;
+
+        {
+            IAS_POLYGON_LINKED_LIST **new_nodes; /* Resized record list */
+
+            new_nodes = realloc(nodes, (count + num_children)
+                * sizeof(*nodes));
+            if (new_nodes == NULL)
+            {
+                IAS_LOG_ERROR("Allocating the polygon map records");
+                free(bb_min);
+                free(bb_max);
+                free(nodes);
+                ias_geo_free_polygon_linked_list(head);
+                return ERROR;
+            }
+            nodes = new_nodes;
+        }
+
+        for (polygon = nodes[i]->child; polygon; polygon = polygon->next)
+            nodes[count++] = polygon;
+    }
+    header.num_polygons = count;
+
+    records = calloc(count, sizeof(*records));
+    if (records == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon map records");
+        free(bb_min);
+        free(bb_max);
+        free(nodes);
+        ias_geo_free_polygon_linked_list(head);
+        return ERROR;
+    }
+
+    /* Fill in the records.  The children of a polygon are the records
+       following the ones already used, in the same order they were
+       assigned. */
+    {
+        int64_t first_point = 0;    /* First point of the next polygon */
+        int64_t first_seg = 0;      /* First segment of the next polygon */
+        unsigned int next_child = header.num_parents;
+                                    /* Record of the next unlinked child */
+
+        for (i = 0; i < count; i++)
+        {
+            polygon = nodes[i];
+            records[i].id = polygon->id;
+            records[i].num_points = polygon->num_points;
+            records[i].num_segs = polygon->num_segs;
+            records[i].child = MAP_NO_LINK;
+            records[i].next = polygon->next ? (int)(i + 1) : MAP_NO_LINK;
+            records[i].first_point = first_point;
+            records[i].first_seg = first_seg;
+            records[i].min_x = polygon->min_x;
+            records[i].max_x = polygon->max_x;
+            records[i].min_y = polygon->min_y;
+            records[i].max_y = polygon->max_y;
+
+            /* Only the parents are selected by bounding box, by the ones in
+               the parent polygon table */
+            if (i < header.num_parents)
+            {
+                records[i].bb_min_x = bb_min[i].x;
+                records[i].bb_max_x = bb_max[i].x;
+                records[i].bb_min_y = bb_min[i].y;
+                records[i].bb_max_y = bb_max[i].y;
+            }
+            else
+            {
+                records[i].bb_min_x = polygon->min_x;
+                records[i].bb_max_x = polygon->max_x;
+                records[i].bb_min_y = polygon->min_y;
+                records[i].bb_max_y = polygon->max_y;
+            }
+
+            if (polygon->child)
+            {
+                IAS_POLYGON_LINKED_LIST *child; /* Child counter */
+
+                records[i].child = next_child;
+                for (child = polygon->child; child; child = child->next)
+                    next_child++;
+            }
+
+            first_point += polygon->num_points;
+            first_seg += polygon->num_segs;
+        }
+    }
+    free(bb_min);
+    free(bb_max);
+
+    header.records_offset = align_offset(sizeof(header));
+    header.x_offset = align_offset(header.records_offset
+        + (int64_t)count * sizeof(*records));
+    header.y_offset = align_offset(header.x_offset
+        + header.num_points * sizeof(double));
+    header.segs_offset = align_offset(header.y_offset
+        + header.num_points * sizeof(double));
+    memcpy(header.magic, MAP_MAGIC, MAP_MAGIC_SIZE);
+
+    /* Write the map */
+    if ((fp = ias_geo_open_temp_file(map_file, &temp_file)) == NULL)
+    {
+        free(records);
+        free(nodes);
+        ias_geo_free_polygon_linked_list(head);
+        return ERROR;
+    }
+
+    position = sizeof(header);
+    if (fwrite(&header, sizeof(header), 1, fp) != 1
+        || write_padding(fp, &position, header.records_offset) != SUCCESS
+        || fwrite(records, sizeof(*records), count, fp) != count)
+    {
+        IAS_LOG_ERROR("Writing the polygon map records to %s", map_file);
+        status = ERROR;
+    }
+    position += (int64_t)count * sizeof(*records);
+
+    if (status == SUCCESS
+        && write_padding(fp, &position, header.x_offset) != SUCCESS)
+        status = ERROR;
+    for (i = 0; i < count && status == SUCCESS; i++)
+    {
+        if (fwrite(nodes[i]->point_x, sizeof(double), nodes[i]->num_points,
+            fp) != nodes[i]->num_points)
+            status = ERROR;
+        position += nodes[i]->num_points * sizeof(double);
+    }
+
+    if (status == SUCCESS
+        && write_padding(fp, &position, header.y_offset) != SUCCESS)
+        status = ERROR;
+    for (i = 0; i < count && status == SUCCESS; i++)
+    {
+        if (fwrite(nodes[i]->point_y, sizeof(double), nodes[i]->num_points,
+            fp) != nodes[i]->num_points)
+            status = ERROR;
+        position += nodes[i]->num_points * sizeof(double);
+    }
+
+    if (status == SUCCESS
+        && write_padding(fp, &position, header.segs_offset) != SUCCESS)
+        status = ERROR;
+    for (i = 0; i < count && status == SUCCESS; i++)
+    {
+        if (fwrite(nodes[i]->poly_seg, sizeof(IAS_POLYGON_SEGMENT),
+            nodes[i]->num_segs, fp) != nodes[i]->num_segs)
+            status = ERROR;
+    }
+
+    if (status != SUCCESS)
+        IAS_LOG_ERROR("Writing the polygon map to %s", map_file);
+
+    /* Replace the map only once it is complete */
+    status = ias_geo_close_temp_file(fp, temp_file, map_file, status);
+
+    free(records);
+    free(nodes);
+    ias_geo_free_polygon_linked_list(head);
+
+    return status;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_is_polygon_map
+
+PURPOSE:  Check whether an open polygon file is in the polygon map format.
+          The file is left positioned at the start.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+TRUE     The file is a polygon map
+FALSE    The file is not a polygon map
+
+*****************************************************************************/
+int ias_geo_is_polygon_map
+(
+    FILE *fp                    /* I: File pointer, positioned at the start
+                                      of the file */
+)
+{
+    char magic[MAP_MAGIC_SIZE]; /* Start of the file */
+    int is_map;                 /* Flag for a polygon map */
+
+    is_map = (fread(magic, 1, MAP_MAGIC_SIZE, fp) == MAP_MAGIC_SIZE
+        && memcmp(magic, MAP_MAGIC, MAP_MAGIC_SIZE) == 0);
+    rewind(fp);
+
+    return is_map ? TRUE : FALSE;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_open_polygon_map
+
+PURPOSE:  Map a polygon map file read-only into memory.  The mapping is
+          shared, so processes using the same file share one copy of it in
+          the page cache.
+
+RETURN VALUE:
+Type = IAS_GEO_POLYGON_MAP *
+Value    Description
+-----    -----------
+NULL     Operation failed
+other    Polygon map; close it with ias_geo_close_polygon_map
+
+NOTES:
+  1. Polygons loaded from the map point into it, so they need to be freed
+     before the map is closed.
+*****************************************************************************/
+IAS_GEO_POLYGON_MAP *ias_geo_open_polygon_map
+(
+    const char *map_file        /* I: Mapped polygon filename */
+)
+{
+    IAS_GEO_POLYGON_MAP *map;   /* Polygon map */
+    const POLYGON_MAP_HEADER *header; /* File header */
+    struct stat file_stat;      /* File status */
+    int fd;                     /* File descriptor */
+
+    fd = open(map_file, O_RDONLY);
+    if (fd < 0)
+    {
+        IAS_LOG_ERROR("Unable to open %s for reading.", map_file);
+        return NULL;
+    }
+
+    if (fstat(fd, &file_stat) != 0)
+    {
+        IAS_LOG_ERROR("Getting the status of %s", map_file);
+        close(fd);
+        return NULL;
+    }
+
+    if ((size_t)file_stat.st_size < sizeof(POLYGON_MAP_HEADER))
+    {
+        IAS_LOG_ERROR("%s is too small to be a polygon map", map_file);
+        close(fd);
+        return NULL;
+    }
+
+    map = calloc(1, sizeof(*map));
+    if (map == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the polygon map");
+        close(fd);
+        return NULL;
+    }
+
+    map->size = file_stat.st_size;
+    map->base = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map->base == MAP_FAILED)
+    {
+        IAS_LOG_ERROR("Mapping %s", map_file);
+        free(map);
+        return NULL;
+    }
+
+    /* Validate the header, making sure every section is inside the file */
+    header = map->base;
+    if (memcmp(header->magic, MAP_MAGIC, MAP_MAGIC_SIZE) != 0
+        || header->num_parents == 0
+        || header->num_parents > header->num_polygons
+        || header->num_polygons > (unsigned int)INT32_MAX
+        || header->num_points < 0 || header->num_segs < 0
+        || header->records_offset % 8 != 0 || header->x_offset % 8 != 0
+        || header->y_offset % 8 != 0 || header->segs_offset % 8 != 0
+        || header->records_offset < (int64_t)sizeof(*header)
+        || header->records_offset + (int64_t)header->num_polygons
+            * (int64_t)sizeof(POLYGON_MAP_RECORD) > header->x_offset
+        || header->x_offset + header->num_points * (int64_t)sizeof(double)
+            > header->y_offset
+        || header->y_offset + header->num_points * (int64_t)sizeof(double)
+            > header->segs_offset
+        || header->segs_offset + header->num_segs
+            * (int64_t)sizeof(IAS_POLYGON_SEGMENT) > (int64_t)map->size)
+    {
+        IAS_LOG_ERROR("%s is not a valid polygon map", map_file);
+        munmap(map->base, map->size);
+        free(map);
+        return NULL;
+    }
+
+    map->header = header;
+    map->records = (const POLYGON_MAP_RECORD *)
+        ((const char *)map->base + header->records_offset);
+    map->point_x = (const double *)
+        ((const char *)map->base + header->x_offset);
+    map->point_y = (const double *)
+        ((const char *)map->base + header->y_offset);
+    map->poly_seg = (const IAS_POLYGON_SEGMENT *)
+        ((const char *)map->base + header->segs_offset);
+
+    /* Let the kernel know the polygons will be looked up by location */
+    madvise(map->base, map->size, MADV_RANDOM);
+
+    return map;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_close_polygon_map
+
+PURPOSE:  Unmap a polygon map.
+
+RETURN VALUE:
+Type = void
+
+*****************************************************************************/
+void ias_geo_close_polygon_map
+(
+    IAS_GEO_POLYGON_MAP *map    /* I: Polygon map to close */
+)
+{
+    if (!map)
+        return;
+
+    munmap(map->base, map->size);
+    free(map);
+}
+
+/*****************************************************************************
+NAME:  load_mapped_record
+
+PURPOSE:  Create a polygon list node for a map record, along with nodes for
+          its children.  The node's point and segment arrays point into the
+          map.
+
+RETURN VALUE:
+Type = IAS_POLYGON_LINKED_LIST *
+Value    Description
+-----    -----------
+NULL     Operation failed
+other    Polygon node
+
+*****************************************************************************/
+static IAS_POLYGON_LINKED_LIST *load_mapped_record
+(
+    const IAS_GEO_POLYGON_MAP *map, /* I: Polygon map */
+    int index                       /* I: Record to load */
+)
+{
+    const POLYGON_MAP_RECORD *record = &map->records[index]; /* Record */
+    IAS_POLYGON_LINKED_LIST *polygon;   /* Polygon node */
+    IAS_POLYGON_LINKED_LIST *child;     /* Child node */
+    IAS_POLYGON_LINKED_LIST *child_tail = NULL; /* Last child node */
+    int child_index;                    /* Child record */
+
+    /* The point and segment ranges have to be inside the map */
+    if (record->first_point < 0 || record->first_seg < 0
+        || record->first_point + record->num_points
+            > map->header->num_points
+        || record->first_seg + record->num_segs > map->header->num_segs)
+    {
+        IAS_LOG_ERROR("Invalid polygon map record %d", index);
+        return NULL;
+    }
+
+    polygon = calloc(1, sizeof(IAS_POLYGON_LINKED_LIST));
+    if (polygon == NULL)
+    {
+        IAS_LOG_ERROR("Allocating memory for linked list");
+        return NULL;
+    }
+
+    polygon->id = record->id;
+    polygon->num_points = record->num_points;
+    polygon->point_x = (double *)&map->point_x[record->first_point];
+    polygon->point_y = (double *)&map->point_y[record->first_point];
+    polygon->min_x = record->min_x;
+    polygon->max_x = record->max_x;
+    polygon->min_y = record->min_y;
+    polygon->max_y = record->max_y;
+    polygon->num_segs = record->num_segs;
+    polygon->poly_seg = (IAS_POLYGON_SEGMENT *)&map->poly_seg[record->first_seg];
+    polygon->mapped = TRUE;
+
+    child_index = record->child;
+    while (child_index != MAP_NO_LINK)
+    {
+        /* Children always follow their parent */
+        if (child_index <= index
+            || child_index >= (int)map->header->num_polygons)
+        {
+            IAS_LOG_ERROR("Invalid child link in polygon map record %d",
+                index);
+            ias_geo_free_polygon_linked_list(polygon);
+            return NULL;
+        }
+
+        child = load_mapped_record(map, child_index);
+        if (child == NULL)
+        {
+            ias_geo_free_polygon_linked_list(polygon);
+            return NULL;
+        }
+
+        if (child_tail)
+        {
+            child_tail->next = child;
+            child->prev = child_tail;
+        }
+        else
+            polygon->child = child;
+        child_tail = child;
+
+        /* Siblings are consecutive records */
+        if (map->records[child_index].next != MAP_NO_LINK
+            && map->records[child_index].next != child_index + 1)
+        {
+            IAS_LOG_ERROR("Invalid next link in polygon map record %d",
+                child_index);
+            ias_geo_free_polygon_linked_list(polygon);
+            return NULL;
+        }
+        child_index = map->records[child_index].next;
+    }
+
+    return polygon;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_load_mapped_polygon
+
+PURPOSE:  Build the list of parent polygons (and their children) from a
+          polygon map whose bounding boxes overlap the area of interest.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES:
+  1. Only the list nodes are allocated.  The point and segment arrays are
+     used in place in the map, so the map has to stay open until the list is
+     freed with ias_geo_free_polygon_linked_list.
+  2. The same polygons are returned, in the same order, as
+     ias_geo_load_polygon returns for the polygon file the map was made
+     from.
+*****************************************************************************/
+int ias_geo_load_mapped_polygon
+(
+    const IAS_GEO_POLYGON_MAP *map, /* I: Polygon map */
+    double min_x,                   /* I: Minimum x value of interest */
+    double max_x,                   /* I: Maximum x value of interest */
+    double min_y,                   /* I: Minimum y value of interest */
+    double max_y,                   /* I: Maximum y value of interest */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+)
+{
+    IAS_POLYGON_LINKED_LIST *polygon;   /* Current polygon */
+    IAS_POLYGON_LINKED_LIST *list_tail = NULL; /* Last polygon in the list */
+    unsigned int i;                     /* Parent counter */
+
+    *head = NULL;
+
+    for (i = 0; i < map->header->num_parents; i++)
+    {
+        const POLYGON_MAP_RECORD *record = &map->records[i]; /* Parent */
+
+        if (record->bb_min_x > max_x || record->bb_max_x < min_x ||
+            record->bb_min_y > max_y || record->bb_max_y < min_y)
+            continue;
+
+        polygon = load_mapped_record(map, i);
+        if (polygon == NULL)
+        {
+            IAS_LOG_ERROR("Loading polygon map record %u", i);
+            ias_geo_free_polygon_linked_list(*head);
+            *head = NULL;
+            return ERROR;
+        }
+
+        if (list_tail)
+        {
+            list_tail->next = polygon;
+            polygon->prev = list_tail;
+        }
+        else
+            *head = polygon;
+        list_tail = polygon;
+    }
+
+    return SUCCESS;
+}
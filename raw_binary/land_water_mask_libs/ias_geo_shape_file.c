@@ -537,9 +537,10 @@ static int ias_geo_read_polygon
 }
 
 /*****************************************************************************
-NAME:  ias_geo_load_polygon
+NAME:  ias_geo_read_polygon_parents
 
-PURPOSE:  Read the polygons in from a file in the parent/child structure. 
+PURPOSE:  Read the parent polygon table (offsets and bounding boxes) from the
+          start of the polygon file.
 
 RETURN VALUE:
 Type = int
@@ -548,72 +549,72 @@ Value    Description
 SUCCESS  Successful completion
 ERROR    Operation failed
 
+NOTES:
+  1. Memory is allocated for the offset and bounding box arrays.  The caller
+     is responsible for freeing them upon successful return.
 *****************************************************************************/
-int ias_geo_load_polygon
+int ias_geo_read_polygon_parents
 (
-    FILE *fp,                       /* I: Input file pointer */
-    double min_x,                   /* I: Minimum x value of interest */
-    double max_x,                   /* I: Maximum x value of interest */
-    double min_y,                   /* I: Minimum y value of interest */
-    double max_y,                   /* I: Maximum y value of interest */
-    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+    FILE *fp,                       /* I: Input file pointer, positioned at
+                                          the start of the file */
+    unsigned int *nparent_polygons, /* O: Number of parent polygons */
+    int64_t **offset,               /* O: Parent polygon offsets */
+    IAS_DBL_XY **bb_min,            /* O: Bounding box min x/y values */
+    IAS_DBL_XY **bb_max             /* O: Bounding box max x/y values */
 )
 {
-    IAS_POLYGON_LINKED_LIST *polygon; /* Current polygon in loop */
-    IAS_POLYGON_LINKED_LIST *list_tail = NULL;
-                                /* Pointer to the tail of the polygon list */
     int id;                           /* Current id of polygon */
-    unsigned int nparent_polygons;    /* Number of parent polygons */
     unsigned int i;                   /* Generic counter */
-    int64_t *offset;                  /* Polygon offset in binary list */
     int error_occured = FALSE;        /* Error tracking flag */
-    IAS_DBL_XY *bb_max;               /* Bounding box max x/y values */
-    IAS_DBL_XY *bb_min;               /* Bounding box min x/y values */
 
-    /* Assume no polygons will be read */
-    *head = NULL;
+    *offset = NULL;
+    *bb_min = NULL;
+    *bb_max = NULL;
 
     /* Read the number of "parent" polygons. */
-    if (fread(&nparent_polygons, sizeof(unsigned int), 1, fp) != 1)
+    if (fread(nparent_polygons, sizeof(unsigned int), 1, fp) != 1)
     {
         IAS_LOG_ERROR("Reading the number of parent polygons");
         return ERROR;
     }
 
-    if (nparent_polygons == 0)
+    if (*nparent_polygons == 0)
     {
         IAS_LOG_ERROR("Only one parent polygon reported");
         return ERROR;
     }
 
     /* Allocate memory for offsets and bounding boxes */
-    offset = malloc(nparent_polygons * sizeof(int64_t));
-    if (offset == NULL)
+    *offset = malloc(*nparent_polygons * sizeof(int64_t));
+    if (*offset == NULL)
     {
         IAS_LOG_ERROR("Allocating space for polygon offsets");
         return ERROR;
     }
 
-    bb_max = malloc(nparent_polygons * sizeof(IAS_DBL_XY));
-    if (bb_max == NULL)
+    *bb_max = malloc(*nparent_polygons * sizeof(IAS_DBL_XY));
+    if (*bb_max == NULL)
     {
         IAS_LOG_ERROR("Allocating space for the bouding box maximum values");
-        free(offset);
+        free(*offset);
+        *offset = NULL;
         return ERROR;
     }
 
-    bb_min = malloc(nparent_polygons * sizeof(IAS_DBL_XY));
-    if (bb_min == NULL)
+    *bb_min = malloc(*nparent_polygons * sizeof(IAS_DBL_XY));
+    if (*bb_min == NULL)
     {
         IAS_LOG_ERROR("Allocating space for the bounding box minimum values");
-        free(offset);
-        free(bb_max);
+        free(*offset);
+        free(*bb_max);
+        *offset = NULL;
+        *bb_max = NULL;
         return ERROR;
     }
 
     /* Read the parent polygon offsets and bounding boxes. Verify that the
        number read agrees with the number reported */
-    for (i = 0; i < nparent_polygons; i++)
+    for (i = 0; i < *nparent_polygons; i++)
     {
         if (fread(&id, sizeof(int), 1, fp) != 1)
         {
@@ -625,35 +626,35 @@ int ias_geo_load_polygon
         if (id == 0)
             break;
 
-        if (fread(&offset[i], sizeof(int64_t), 1, fp) != 1)
+        if (fread(&(*offset)[i], sizeof(int64_t), 1, fp) != 1)
         {
             IAS_LOG_ERROR("Reading offset");
             error_occured = TRUE;
             break;
         }
 
-        if (fread(&bb_min[i].x, sizeof(double), 1, fp) != 1)
+        if (fread(&(*bb_min)[i].x, sizeof(double), 1, fp) != 1)
         {
             IAS_LOG_ERROR("Reading minimum X bound");
             error_occured = TRUE;
             break;
         }
 
-        if (fread(&bb_max[i].x, sizeof(double), 1, fp) != 1)
+        if (fread(&(*bb_max)[i].x, sizeof(double), 1, fp) != 1)
         {
             IAS_LOG_ERROR("Reading maximum X bound");
             error_occured = TRUE;
             break;
         }
 
-        if (fread(&bb_min[i].y, sizeof(double), 1, fp) != 1)
+        if (fread(&(*bb_min)[i].y, sizeof(double), 1, fp) != 1)
         {
             IAS_LOG_ERROR("Reading minimum Y bound");
             error_occured = TRUE;
             break;
         }
 
-        if (fread(&bb_max[i].y, sizeof(double), 1, fp) != 1)
+        if (fread(&(*bb_max)[i].y, sizeof(double), 1, fp) != 1)
         {
             IAS_LOG_ERROR("Reading maximum Y bound");
             error_occured = TRUE;
@@ -666,18 +667,13 @@ int ias_geo_load_polygon
     if (error_occured)
     {
         IAS_LOG_ERROR("Reading parent bounding box and offsets");
-        free(offset);
-        free(bb_min);
-        free(bb_max);
-        return ERROR;
     }
-
     /* Verify that the number read agrees with the number reported.
        Need to read a final polygon ID (which should be zero) */
-    if (i < nparent_polygons)
+    else if (i < *nparent_polygons)
     {
         IAS_LOG_ERROR( "Number of parents found (%d) doesn't agree "
-            "with the number reported (%d)", i, nparent_polygons);
+            "with the number reported (%d)", i, *nparent_polygons);
         error_occured = TRUE;
     }
     else
@@ -690,37 +686,66 @@ int ias_geo_load_polygon
         else if (id != 0)
         {
             IAS_LOG_ERROR("More parents found than reported (%d)",
-                nparent_polygons);
+                *nparent_polygons);
             error_occured = TRUE;
         }
+
+        /* Check if error occured during the parent validation */
+        if (error_occured)
+            IAS_LOG_ERROR("Validating the number of parent polygons");
     }
 
-    /* Check if error occured during the parent validation */
     if (error_occured)
     {
-        IAS_LOG_ERROR("Validating the number of parent polygons");
-        free(offset);
-        free(bb_min);
-        free(bb_max);
+        free(*offset);
+        free(*bb_min);
+        free(*bb_max);
+        *offset = NULL;
+        *bb_min = NULL;
+        *bb_max = NULL;
         return ERROR;
     }
 
-    /* Read the polygons within the range of interest. */
-    polygon = NULL;
-    for (i = 0; i < nparent_polygons; i++)
-    {
-        if (bb_min[i].x > max_x || bb_max[i].x < min_x ||
-            bb_min[i].y > max_y || bb_max[i].y < min_y)
-            continue;
+    return SUCCESS;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_load_polygon_offsets
+
+PURPOSE:  Read the parent polygons (and their children) at the given file
+          offsets into a linked list, in the order of the offsets.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+*****************************************************************************/
+int ias_geo_load_polygon_offsets
+(
+    FILE *fp,                       /* I: Input file pointer */
+    unsigned int count,             /* I: Number of parent polygons to read */
+    const int64_t *offset,          /* I: File offset of each parent polygon */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+)
+{
+    IAS_POLYGON_LINKED_LIST *polygon; /* Current polygon in loop */
+    IAS_POLYGON_LINKED_LIST *list_tail = NULL;
+                                /* Pointer to the tail of the polygon list */
+    unsigned int i;                   /* Generic counter */
+
+    /* Assume no polygons will be read */
+    *head = NULL;
 
+    for (i = 0; i < count; i++)
+    {
         if (fseeko(fp, offset[i], SEEK_SET) != 0)
         {
             IAS_LOG_ERROR("Using fseek to set the position in file pointer");
             ias_geo_free_polygon_linked_list(*head);
             *head = NULL;
-            free(offset);
-            free(bb_min);
-            free(bb_max);
             return ERROR;
         }
 
@@ -731,9 +756,6 @@ int ias_geo_load_polygon
             IAS_LOG_ERROR("Allocating memory for linked list");
             ias_geo_free_polygon_linked_list(*head);
             *head = NULL;
-            free(offset);
-            free(bb_min);
-            free(bb_max);
             return ERROR;
         }
 
@@ -743,9 +765,6 @@ int ias_geo_load_polygon
             IAS_LOG_ERROR("Reading polygons");
             ias_geo_free_polygon_linked_list(*head);
             *head = NULL;
-            free(offset);
-            free(bb_min);
-            free(bb_max);
             return ERROR;
         }
 
@@ -761,14 +780,74 @@ int ias_geo_load_polygon
         }
         /* This polygon is now the tail */
         list_tail = polygon;
+    }
+
+    return SUCCESS;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_load_polygon
+
+PURPOSE:  Read the polygons in from a file in the parent/child structure. 
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES:
+  1. Every parent bounding box in the file is checked.  See
+     ias_geo_load_indexed_polygon for a loader which uses the spatial index
+     sidecar to only visit the parents near the area of interest.
+*****************************************************************************/
+int ias_geo_load_polygon
+(
+    FILE *fp,                       /* I: Input file pointer */
+    double min_x,                   /* I: Minimum x value of interest */
+    double max_x,                   /* I: Maximum x value of interest */
+    double min_y,                   /* I: Minimum y value of interest */
+    double max_y,                   /* I: Maximum y value of interest */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+)
+{
+    unsigned int nparent_polygons;    /* Number of parent polygons */
+    unsigned int count;               /* Number of parents in range */
+    unsigned int i;                   /* Generic counter */
+    int64_t *offset;                  /* Polygon offset in binary list */
+    IAS_DBL_XY *bb_max;               /* Bounding box max x/y values */
+    IAS_DBL_XY *bb_min;               /* Bounding box min x/y values */
+    int status;                       /* Return status */
 
+    /* Assume no polygons will be read */
+    *head = NULL;
+
+    if (ias_geo_read_polygon_parents(fp, &nparent_polygons, &offset, &bb_min,
+        &bb_max) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Reading the parent polygon table");
+        return ERROR;
     }
 
-    free(offset);
+    /* Keep the offsets of the polygons within the range of interest */
+    count = 0;
+    for (i = 0; i < nparent_polygons; i++)
+    {
+        if (bb_min[i].x > max_x || bb_max[i].x < min_x ||
+            bb_min[i].y > max_y || bb_max[i].y < min_y)
+            continue;
+
+        offset[count++] = offset[i];
+    }
     free(bb_min);
     free(bb_max);
 
-    return SUCCESS;
+    /* Read the polygons within the range of interest. */
+    status = ias_geo_load_polygon_offsets(fp, count, offset, head);
+    free(offset);
+
+    return status;
 }
 
 /*****************************************************************************
@@ -793,6 +872,14 @@ void ias_geo_free_polygon_linked_list
 
     while (polygon)
     {
+        /* Arrays in a mapped polygon file belong to the mapping */
+        if (polygon->mapped)
+        {
+            polygon->point_x = NULL;
+            polygon->point_y = NULL;
+            polygon->poly_seg = NULL;
+        }
+
         if (polygon->point_x)
         {
             free(polygon->point_x);
@@ -23,6 +23,25 @@
 #error("This code does not properly support big endian")
 #endif
 
+/* Polygon side used by the scanline rasterizer.  The side crosses the mask
+   lines with latitudes from min_y up to, but not including, max_y. */
+typedef struct shape_edge
+{
+    double min_y;               /* Minimum latitude of the side */
+    double max_y;               /* Maximum latitude of the side */
+    double x0;                  /* Longitude of the first vertex */
+    double y0;                  /* Latitude of the first vertex */
+    double slope;               /* Change in longitude per degree latitude */
+} SHAPE_EDGE;
+
+/* Polygon sides crossing the mask */
+typedef struct shape_edge_table
+{
+    SHAPE_EDGE *edges;          /* Array of sides */
+    unsigned int num_edges;     /* Number of sides in the array */
+    unsigned int max_edges;     /* Number of sides allocated */
+} SHAPE_EDGE_TABLE;
+
 /*****************************************************************************
 NAME:  convert_target_xy_to_input_line_sample
 
@@ -79,11 +98,10 @@ static int convert_target_xy_to_input_line_sample
 }
 
 /*****************************************************************************
-NAME:  ias_geo_shape_mask
+NAME:  add_polygon_edges
 
-PURPOSE:  Generate a mask image (per-bit buffer) based on a set of polygons.
-          Values of zero denote locations outside the polygons, values of one
-          represent locations inside a polygon.
+PURPOSE:  Adds the sides of a set of polygons, and their children, which cross
+    the latitude range of the mask to the scanline edge table.
 
 RETURN VALUE:
 Type = int
@@ -92,67 +110,324 @@ Value    Description
 SUCCESS  Successful completion
 ERROR    Operation failed
 
+NOTES: Horizontal sides are left out since they never cross a mask line, as
+       are sides entirely west of the mask since their crossings never
+       change the inside/outside state of a mask sample.
 *****************************************************************************/
-int ias_geo_shape_mask
+static int add_polygon_edges
 (
-    const char *polygon_file,   /* I: Polygon filename */
+    const IAS_POLYGON_LINKED_LIST *polygon, /* I: Polygon list */
+    double min_lat,             /* I: Latitude of the last mask line */
+    double max_lat,             /* I: Latitude of the first mask line */
+    double min_lng,             /* I: Minimum mask sample longitude */
+    SHAPE_EDGE_TABLE *table     /* I/O: Edge table */
+)
+{
+    unsigned int point;         /* Point counter */
+
+    for (; polygon; polygon = polygon->next)
+    {
+        /* The point test can't handle these either, so let it report them */
+        if (polygon->num_points < 4)
+        {
+            IAS_LOG_ERROR("Polygon %d needs at least three sides",
+                polygon->id);
+            return ERROR;
+        }
+
+        /* Children are inside their parent, so skip them along with a parent
+           outside the mask lines */
+        if (polygon->min_y > max_lat || polygon->max_y <= min_lat
+            || polygon->max_x < min_lng)
+        {
+            continue;
+        }
+
+        for (point = 0; point < polygon->num_points - 1; point++)
+        {
+            double x0 = polygon->point_x[point];      /* First vertex */
+            double y0 = polygon->point_y[point];
+            double x1 = polygon->point_x[point + 1];  /* Second vertex */
+            double y1 = polygon->point_y[point + 1];
+            SHAPE_EDGE *edge;                         /* New edge */
+
+            if (y0 == y1 || (x0 < min_lng && x1 < min_lng))
+                continue;
+            if ((y0 > max_lat && y1 > max_lat)
+                || (y0 <= min_lat && y1 <= min_lat))
+            {
+                continue;
+            }
+
+            /* Grow the table as needed */
+            if (table->num_edges == table->max_edges)
+            {
+                unsigned int max_edges;   /* New table size */
+                SHAPE_EDGE *edges;        /* New table */
+
+                max_edges = (table->max_edges > 0)
+                    ? 2 * table->max_edges : 1024;
+                edges = realloc(table->edges, max_edges * sizeof(SHAPE_EDGE));
+                if (!edges)
+                {
+                    IAS_LOG_ERROR("Allocating the polygon edge table");
+                    return ERROR;
+                }
+                table->edges = edges;
+                table->max_edges = max_edges;
+            }
+
+            edge = &table->edges[table->num_edges++];
+            edge->x0 = x0;
+            edge->y0 = y0;
+            edge->slope = (x1 - x0) / (y1 - y0);
+            edge->min_y = (y0 < y1) ? y0 : y1;
+            edge->max_y = (y0 < y1) ? y1 : y0;
+        }
+
+        if (polygon->child)
+        {
+            if (add_polygon_edges(polygon->child, min_lat, max_lat, min_lng,
+                table) != SUCCESS)
+            {
+                return ERROR;
+            }
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*****************************************************************************
+NAME:  compare_edges
+
+PURPOSE:  qsort comparison function ordering the edges by decreasing maximum
+    latitude, which is the order the mask lines reach them.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+<0       First edge starts further north
+0        The edges start at the same latitude
+>0       Second edge starts further north
+*****************************************************************************/
+static int compare_edges
+(
+    const void *edge1,      /* I: First edge */
+    const void *edge2       /* I: Second edge */
+)
+{
+    double max_y1 = ((const SHAPE_EDGE *) edge1)->max_y;
+    double max_y2 = ((const SHAPE_EDGE *) edge2)->max_y;
+
+    if (max_y1 > max_y2)
+        return -1;
+    if (max_y1 < max_y2)
+        return 1;
+    return 0;
+}
+
+/*****************************************************************************
+NAME:  compare_crossings
+
+PURPOSE:  qsort comparison function ordering the crossing longitudes.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+<0       First crossing is west of the second
+0        The crossings are the same
+>0       First crossing is east of the second
+*****************************************************************************/
+static int compare_crossings
+(
+    const void *crossing1,  /* I: First crossing */
+    const void *crossing2   /* I: Second crossing */
+)
+{
+    double x1 = *(const double *) crossing1;
+    double x2 = *(const double *) crossing2;
+
+    if (x1 < x2)
+        return -1;
+    if (x1 > x2)
+        return 1;
+    return 0;
+}
+
+/*****************************************************************************
+NAME:  scanline_shape_mask
+
+PURPOSE:  Sets the bits of the mask inside the polygons a line at a time.
+    The polygon sides crossing each mask line are found with an active edge
+    table, and the crossing longitudes are sorted so each sample is set by
+    counting the crossings east of it.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES: 
+  1. This uses an even-odd fill over the sides of all the polygons and their
+     children, so a sample inside a child (e.g. a lake) is outside the mask,
+     a sample inside a child of the child (e.g. an island in the lake) is
+     inside, and so on.  This matches ias_geo_point_in_shape, apart from
+     samples exactly on a polygon side.
+  2. The mask must be zeroed by the caller.
+*****************************************************************************/
+static int scanline_shape_mask
+(
+    const IAS_POLYGON_LINKED_LIST *polygon_list, /* I: Polygon list */
     unsigned int num_lines,     /* I: Number of lines in mask */
     unsigned int num_samples,   /* I: Number of samples in mask */
     double upper_left_lat,      /* I: Upper left latitude for mask */
-    double lower_right_lat,     /* I: Lower right latitude for mask */
-    double upper_left_long,     /* I: Upper left longitude for mask */
-    double lower_right_long,    /* I: Lower right longitude for mask */
+    double delta_latitude,      /* I: Latitude change per mask line */
+    const double *longitude,    /* I: Longitude of each mask sample */
     unsigned char *mask         /* O: Mask buffer */
 )
 {
+    SHAPE_EDGE_TABLE table;     /* Edges crossing the mask lines */
+    unsigned int *active = NULL;/* Edges crossing the current line */
+    unsigned int num_active = 0;/* Number of active edges */
+    unsigned int next_edge = 0; /* Next edge to become active */
+    double *crossing = NULL;    /* Crossing longitudes for the line */
+    double min_lng;             /* Minimum sample longitude */
     unsigned int line;          /* Line counter */
-    unsigned int index;         /* Generic counter */
-    double delta_latitude;      /* Delta latitude */
-    double delta_longitude;     /* Delta longitude */
-    IAS_POLYGON_LINKED_LIST *polygon_list; /* Polygon linked list pointer */
-    FILE *fp;                   /* Polygon file pointer */
+    unsigned int sample;        /* Sample counter */
+    unsigned int index;         /* Edge or mask index */
 
-    /* Open the polygon file. */
-    if ((fp = fopen(polygon_file, "r")) == NULL)
-    {
-        IAS_LOG_ERROR("Unable to open %s for reading.", polygon_file);
-        return ERROR;
-    }
+    if (num_lines == 0 || num_samples == 0)
+        return SUCCESS;
 
-    /* Load the polygons. */
-    if (ias_geo_load_polygon(fp, upper_left_long, lower_right_long,
-        lower_right_lat, upper_left_lat, &polygon_list) != SUCCESS)
+    min_lng = longitude[0];
+    for (sample = 1; sample < num_samples; sample++)
     {
-        IAS_LOG_ERROR("Loading the polygon file %s", polygon_file);
-        fclose(fp);
-        return ERROR;
+        if (longitude[sample] < min_lng)
+            min_lng = longitude[sample];
     }
 
-    /* Close the polygon file. */
-    fclose(fp);
-
-    /* Discard polygons outside the bounding box. */
-    if (ias_geo_reduce_polygon(&polygon_list, upper_left_long, lower_right_long,
-        upper_left_lat, lower_right_lat) != SUCCESS)
+    /* Build the edge table and order it by where the lines reach it */
+    table.edges = NULL;
+    table.num_edges = 0;
+    table.max_edges = 0;
+    if (add_polygon_edges(polygon_list,
+        upper_left_lat - delta_latitude * (num_lines - 1), upper_left_lat,
+        min_lng, &table) != SUCCESS)
     {
-        IAS_LOG_ERROR("Reducing the polygon");
+        IAS_LOG_ERROR("Building the polygon edge table");
+        free(table.edges);
         return ERROR;
     }
+    qsort(table.edges, table.num_edges, sizeof(SHAPE_EDGE), compare_edges);
 
-    /* Initialize the mask to all zeros. */
-    memset(mask, 0, num_lines * num_samples / 8 + 1);
-
-    /* Determine the mask value for each sample location. */
-    delta_latitude = (upper_left_lat - lower_right_lat) / num_lines;
-    if (lower_right_long >= upper_left_long)
+    if (table.num_edges > 0)
     {
-        delta_longitude = (lower_right_long - upper_left_long) / num_samples;
+        active = malloc(table.num_edges * sizeof(unsigned int));
+        crossing = malloc(table.num_edges * sizeof(double));
+        if (!active || !crossing)
+        {
+            IAS_LOG_ERROR("Allocating the active edge table");
+            free(table.edges);
+            free(active);
+            free(crossing);
+            return ERROR;
+        }
     }
-    else
+
+    for (line = 0; line < num_lines; line++)
     {
-        delta_longitude = (lower_right_long - upper_left_long + 360) 
-            / num_samples;
-    }
+        double latitude;            /* Latitude */
+        unsigned int num_crossings; /* Number of crossings on the line */
+        unsigned int kept;          /* Number of edges kept active */
+        unsigned int west;          /* Crossings west of the sample */
+
+        latitude = upper_left_lat - delta_latitude * line;
+
+        /* Add the edges the line has reached */
+        while (next_edge < table.num_edges
+               && table.edges[next_edge].max_y > latitude)
+        {
+            active[num_active++] = next_edge++;
+        }
+
+        /* Drop the edges the line has passed, and find where the others
+           cross the line */
+        for (index = 0, kept = 0; index < num_active; index++)
+        {
+            const SHAPE_EDGE *edge = &table.edges[active[index]];
+
+            if (edge->min_y > latitude)
+                continue;
+
+            crossing[kept] = edge->x0 + (latitude - edge->y0) * edge->slope;
+            active[kept++] = active[index];
+        }
+        num_active = num_crossings = kept;
+        if (num_crossings == 0)
+            continue;
+
+        qsort(crossing, num_crossings, sizeof(double), compare_crossings);
+
+        /* A sample is inside if an odd number of sides cross the line east
+           of it.  The longitudes only decrease where they wrap at 180, which
+           restarts the crossing count. */
+        index = line * num_samples;
+        for (sample = 0, west = 0; sample < num_samples; sample++, index++)
+        {
+            if (sample > 0 && longitude[sample] < longitude[sample - 1])
+                west = 0;
+            while (west < num_crossings && crossing[west] <= longitude[sample])
+                west++;
+
+            if ((num_crossings - west) & 1)
+            {
+                unsigned int byte;  /* Byte level indexing */
+                unsigned int bit;   /* Bit-level indexing */
+                byte = index / 8;
+                bit = 7 - index % 8;
+                mask[byte] |= 1 << bit;
+            }
+        }
+    } /* latitude loop */
+
+    free(table.edges);
+    free(active);
+    free(crossing);
+
+    return SUCCESS;
+}
+
+/*****************************************************************************
+NAME:  point_test_shape_mask
+
+PURPOSE:  Sets the bits of the mask inside the polygons by testing the
+    samples against the polygons.  The distance to the nearest polygon side
+    is used to skip testing samples which can't be on the other side of it.
+
+RETURN VALUE:
+Type = void
+
+NOTES: The mask must be zeroed by the caller.
+*****************************************************************************/
+static void point_test_shape_mask
+(
+    IAS_POLYGON_LINKED_LIST *polygon_list, /* I: Polygon list */
+    unsigned int num_lines,     /* I: Number of lines in mask */
+    unsigned int num_samples,   /* I: Number of samples in mask */
+    double upper_left_lat,      /* I: Upper left latitude for mask */
+    double delta_latitude,      /* I: Latitude change per mask line */
+    double delta_longitude,     /* I: Longitude change per mask sample */
+    const double *longitude,    /* I: Longitude of each mask sample */
+    unsigned char *mask         /* O: Mask buffer */
+)
+{
+    unsigned int line;          /* Line counter */
+    unsigned int index;         /* Generic counter */
 
     /* Loop through each line */
     for (line = 0, index = 0; line < num_lines; line++)
@@ -167,25 +442,16 @@ int ias_geo_shape_mask
         {           
             IAS_POLYGON_LINKED_LIST *polygon_hit;  /* Polygon linked list 
                                                       pointer */
-            double longitude;           /* Longitude */
             double distance;            /* Distance from point to polygon */
             int inside_flag;            /* Inside/Outside polygon flag */
 
-            longitude = upper_left_long + delta_longitude * sample;
-
-            /* Adjust for 180 crossing. */
-            if (longitude >= 180)
-            {
-                longitude -= 360;
-            }
-
             /* Initialize the flag and distances */
             inside_flag = 0;
             distance = 1e10;
 
             /* Determine if point is inside the shape */
             inside_flag = ias_geo_point_in_shape_distance(polygon_list,
-                latitude, longitude, 0, &distance, &polygon_hit);
+                latitude, longitude[sample], 0, &distance, &polygon_hit);
             
             /* Progress down the line using the distance provided by 
                point_in_shape_distance so we don't have to recalculate
@@ -215,9 +481,147 @@ int ias_geo_shape_mask
             index--;
         } /* longitude loop */
     } /* latitude loop */
+}
+
+/*****************************************************************************
+NAME:  ias_geo_shape_mask
+
+PURPOSE:  Generate a mask image (per-bit buffer) based on a set of polygons.
+          Values of zero denote locations outside the polygons, values of one
+          represent locations inside a polygon.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  Successful completion
+ERROR    Operation failed
+
+NOTES: The mask is filled a line at a time by scanline_shape_mask.  The
+       per-sample point test in point_test_shape_mask is only used if the
+       polygon edge table can't be built.
+       The polygon file can be a polygon map made by
+       ias_geo_write_polygon_map, which is used in place instead of being
+       read.
+*****************************************************************************/
+int ias_geo_shape_mask
+(
+    const char *polygon_file,   /* I: Polygon filename */
+    unsigned int num_lines,     /* I: Number of lines in mask */
+    unsigned int num_samples,   /* I: Number of samples in mask */
+    double upper_left_lat,      /* I: Upper left latitude for mask */
+    double lower_right_lat,     /* I: Lower right latitude for mask */
+    double upper_left_long,     /* I: Upper left longitude for mask */
+    double lower_right_long,    /* I: Lower right longitude for mask */
+    unsigned char *mask         /* O: Mask buffer */
+)
+{
+    unsigned int sample;        /* Sample counter */
+    double delta_latitude;      /* Delta latitude */
+    double delta_longitude;     /* Delta longitude */
+    double *longitude;          /* Longitude of each sample */
+    IAS_POLYGON_LINKED_LIST *polygon_list; /* Polygon linked list pointer */
+    IAS_GEO_POLYGON_MAP *polygon_map = NULL; /* Mapped polygon file */
+    FILE *fp;                   /* Polygon file pointer */
+    int status;                 /* Return status */
+
+    /* Open the polygon file. */
+    if ((fp = fopen(polygon_file, "r")) == NULL)
+    {
+        IAS_LOG_ERROR("Unable to open %s for reading.", polygon_file);
+        return ERROR;
+    }
+
+    /* Load the polygons.  A pre-processed polygon map is used in place,
+       otherwise the polygons are read from the file. */
+    if (ias_geo_is_polygon_map(fp))
+    {
+        fclose(fp);
+        polygon_map = ias_geo_open_polygon_map(polygon_file);
+        if (polygon_map == NULL)
+        {
+            IAS_LOG_ERROR("Opening the polygon map %s", polygon_file);
+            return ERROR;
+        }
+
+        status = ias_geo_load_mapped_polygon(polygon_map, upper_left_long,
+            lower_right_long, lower_right_lat, upper_left_lat, &polygon_list);
+    }
+    else
+    {
+        status = ias_geo_load_indexed_polygon(polygon_file, fp,
+            upper_left_long, lower_right_long, lower_right_lat,
+            upper_left_lat, &polygon_list);
+
+        /* Close the polygon file. */
+        fclose(fp);
+    }
+    if (status != SUCCESS)
+    {
+        IAS_LOG_ERROR("Loading the polygon file %s", polygon_file);
+        ias_geo_close_polygon_map(polygon_map);
+        return ERROR;
+    }
+
+    /* Discard polygons outside the bounding box. */
+    if (ias_geo_reduce_polygon(&polygon_list, upper_left_long, lower_right_long,
+        upper_left_lat, lower_right_lat) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Reducing the polygon");
+        ias_geo_free_polygon_linked_list(polygon_list);
+        ias_geo_close_polygon_map(polygon_map);
+        return ERROR;
+    }
+
+    /* Initialize the mask to all zeros. */
+    memset(mask, 0, num_lines * num_samples / 8 + 1);
+
+    /* Determine the mask value for each sample location. */
+    delta_latitude = (upper_left_lat - lower_right_lat) / num_lines;
+    if (lower_right_long >= upper_left_long)
+    {
+        delta_longitude = (lower_right_long - upper_left_long) / num_samples;
+    }
+    else
+    {
+        delta_longitude = (lower_right_long - upper_left_long + 360) 
+            / num_samples;
+    }
+
+    /* Find the longitude of each sample, adjusting for the 180 crossing */
+    longitude = malloc(num_samples * sizeof(double));
+    if (num_samples > 0 && !longitude)
+    {
+        IAS_LOG_ERROR("Allocating the mask sample longitudes");
+        ias_geo_free_polygon_linked_list(polygon_list);
+        ias_geo_close_polygon_map(polygon_map);
+        return ERROR;
+    }
+    for (sample = 0; sample < num_samples; sample++)
+    {
+        longitude[sample] = upper_left_long + delta_longitude * sample;
+        if (longitude[sample] >= 180)
+        {
+            longitude[sample] -= 360;
+        }
+    }
+
+    /* Fill the mask a line at a time.  If that can't be done fall back to
+       testing the samples against the polygons. */
+    if (scanline_shape_mask(polygon_list, num_lines, num_samples,
+        upper_left_lat, delta_latitude, longitude, mask) != SUCCESS)
+    {
+        IAS_LOG_WARNING("Unable to scan convert the polygons, testing each "
+            "mask sample instead");
+        memset(mask, 0, num_lines * num_samples / 8 + 1);
+        point_test_shape_mask(polygon_list, num_lines, num_samples,
+            upper_left_lat, delta_latitude, delta_longitude, longitude, mask);
+    }
+    free(longitude);
     
-    /* Free storage. */
+    /* Free storage.  The polygons point into the map, so free them first. */
     ias_geo_free_polygon_linked_list(polygon_list);
+    ias_geo_close_polygon_map(polygon_map);
 
     return SUCCESS;
 }
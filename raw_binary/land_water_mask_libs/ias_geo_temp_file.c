@@ -0,0 +1,120 @@
+/* Standard Library Includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* IAS Library Includes */
+#include "ias_lw_geo.h"
+#include "ias_logging.h"
+
+/*****************************************************************************
+NAME:  ias_geo_open_temp_file
+
+PURPOSE:  Create a temporary file for writing in the same directory as the
+          output file.  Once it is written, ias_geo_close_temp_file renames
+          it over the output file, so readers of the output file never see a
+          partially written file.
+
+RETURN VALUE:
+Type = FILE *
+Value    Description
+-----    -----------
+NULL     Operation failed
+other    File pointer to the temporary file
+
+NOTES:
+  1. The temporary file is readable by everyone, like a file created with
+     fopen, since the output files are shared static data.
+*****************************************************************************/
+FILE *ias_geo_open_temp_file
+(
+    const char *filename,       /* I: Output filename */
+    char **temp_file            /* O: Temporary filename; freed by
+                                      ias_geo_close_temp_file */
+)
+{
+    FILE *fp;                   /* Temporary file pointer */
+    int fd;                     /* Temporary file descriptor */
+
+    *temp_file = malloc(strlen(filename) + strlen(".XXXXXX") + 1);
+    if (*temp_file == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the temporary filename for %s", filename);
+        return NULL;
+    }
+    sprintf(*temp_file, "%s.XXXXXX", filename);
+
+    fd = mkstemp(*temp_file);
+    if (fd < 0)
+    {
+        IAS_LOG_ERROR("Unable to create a temporary file for %s", filename);
+        free(*temp_file);
+        *temp_file = NULL;
+        return NULL;
+    }
+
+    /* mkstemp creates the file readable only by the owner */
+    if (fchmod(fd, 0644) != 0 || (fp = fdopen(fd, "w")) == NULL)
+    {
+        IAS_LOG_ERROR("Unable to open %s for writing.", *temp_file);
+        close(fd);
+        unlink(*temp_file);
+        free(*temp_file);
+        *temp_file = NULL;
+        return NULL;
+    }
+
+    return fp;
+}
+
+/*****************************************************************************
+NAME:  ias_geo_close_temp_file
+
+PURPOSE:  Close a temporary file from ias_geo_open_temp_file.  If it was
+          written successfully, it is flushed to disk and renamed over the
+          output file.  Otherwise it is removed and the output file is left
+          alone.
+
+RETURN VALUE:
+Type = int
+Value    Description
+-----    -----------
+SUCCESS  The output file was replaced
+ERROR    The write had failed, or closing or renaming the file failed
+
+*****************************************************************************/
+int ias_geo_close_temp_file
+(
+    FILE *fp,                   /* I: Temporary file pointer */
+    char *temp_file,            /* I: Temporary filename; freed here */
+    const char *filename,       /* I: Output filename */
+    int status                  /* I: SUCCESS if the file was written */
+)
+{
+    if (status == SUCCESS
+        && (fflush(fp) != 0 || fsync(fileno(fp)) != 0))
+    {
+        IAS_LOG_ERROR("Flushing %s", temp_file);
+        status = ERROR;
+    }
+
+    if (fclose(fp) != 0)
+    {
+        IAS_LOG_ERROR("Closing %s", temp_file);
+        status = ERROR;
+    }
+
+    if (status == SUCCESS && rename(temp_file, filename) != 0)
+    {
+        IAS_LOG_ERROR("Renaming %s to %s", temp_file, filename);
+        status = ERROR;
+    }
+
+    if (status != SUCCESS)
+        unlink(temp_file);
+    free(temp_file);
+
+    return status;
+}
@@ -18,8 +18,17 @@
 /* Define shape mask value */
 #define IAS_GEO_SHAPE_MASK_VALID 0x1
 
+/* Spatial index sidecar for the polygon file.  The index file name is the
+   polygon file name with the extension appended, and the index buckets the
+   parent polygons into tiles of the given size (degrees). */
+#define IAS_GEO_POLYGON_INDEX_EXTENSION ".idx"
+#define IAS_GEO_POLYGON_INDEX_TILE_SIZE 1
+
 /* Type defines for projection related structures */
 typedef struct ias_geo_proj_transformation IAS_GEO_PROJ_TRANSFORMATION;
+
+/* Pre-processed polygon file mapped read-only into memory */
+typedef struct ias_geo_polygon_map IAS_GEO_POLYGON_MAP;
 /* The ias_projection structure matches the gctp_projection structure
    definition.  The gctp_projection structure is not included here to prevent
    needing to modify the build to find gctp.h everywhere ias_geo.h is used. */
@@ -539,6 +548,24 @@ int ias_geo_dump_polygon
     unsigned int nparent_polygons          /* I: Number of parent polygons */
 );
 
+int ias_geo_read_polygon_parents
+(
+    FILE *fp,                       /* I: Input file pointer, positioned at
+                                          the start of the file */
+    unsigned int *nparent_polygons, /* O: Number of parent polygons */
+    int64_t **offset,               /* O: Parent polygon offsets */
+    IAS_DBL_XY **bb_min,            /* O: Bounding box min x/y values */
+    IAS_DBL_XY **bb_max             /* O: Bounding box max x/y values */
+);
+
+int ias_geo_load_polygon_offsets
+(
+    FILE *fp,                       /* I: Input file pointer */
+    unsigned int count,             /* I: Number of parent polygons to read */
+    const int64_t *offset,          /* I: File offset of each parent polygon */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+);
+
 int ias_geo_load_polygon
 (
     FILE *fp,                       /* I: Output file pointer */
@@ -549,6 +576,70 @@ int ias_geo_load_polygon
     IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
 );
 
+int ias_geo_build_polygon_index
+(
+    const char *polygon_file    /* I: Polygon filename */
+);
+
+FILE *ias_geo_open_temp_file
+(
+    const char *filename,       /* I: Output filename */
+    char **temp_file            /* O: Temporary filename; freed by
+                                      ias_geo_close_temp_file */
+);
+
+int ias_geo_close_temp_file
+(
+    FILE *fp,                   /* I: Temporary file pointer */
+    char *temp_file,            /* I: Temporary filename; freed here */
+    const char *filename,       /* I: Output filename */
+    int status                  /* I: SUCCESS if the file was written */
+);
+
+int ias_geo_load_indexed_polygon
+(
+    const char *polygon_file,       /* I: Polygon filename */
+    FILE *fp,                       /* I: Polygon file pointer, positioned at
+                                          the start of the file */
+    double min_x,                   /* I: Minimum x value of interest */
+    double max_x,                   /* I: Maximum x value of interest */
+    double min_y,                   /* I: Minimum y value of interest */
+    double max_y,                   /* I: Maximum y value of interest */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+);
+
+int ias_geo_write_polygon_map
+(
+    const char *polygon_file,   /* I: Polygon filename */
+    const char *map_file        /* I: Output mapped polygon filename */
+);
+
+int ias_geo_is_polygon_map
+(
+    FILE *fp                    /* I: File pointer, positioned at the start
+                                      of the file */
+);
+
+IAS_GEO_POLYGON_MAP *ias_geo_open_polygon_map
+(
+    const char *map_file        /* I: Mapped polygon filename */
+);
+
+void ias_geo_close_polygon_map
+(
+    IAS_GEO_POLYGON_MAP *map    /* I: Polygon map to close */
+);
+
+int ias_geo_load_mapped_polygon
+(
+    const IAS_GEO_POLYGON_MAP *map, /* I: Polygon map */
+    double min_x,                   /* I: Minimum x value of interest */
+    double max_x,                   /* I: Maximum x value of interest */
+    double min_y,                   /* I: Minimum y value of interest */
+    double max_y,                   /* I: Maximum y value of interest */
+    IAS_POLYGON_LINKED_LIST **head  /* O: Polygon pointer */
+);
+
 void ias_geo_free_polygon_linked_list
 (
     IAS_POLYGON_LINKED_LIST *polygon    /* I: First polygon in list */
@@ -22,6 +22,7 @@ NOTES:
 #include "espa_metadata.h"
 #include "parse_metadata.h"
 #include "raw_binary_io.h"
+#include "raw_binary_band.h"
 
 /* Defines */
 #define NBAND_OPTIONS 9
@@ -29,6 +30,9 @@ NOTES:
 #define LEVEL1_FILL 0
 #define BQA_FILL 1
 
+/* Number of lines of each band read, clipped, and written back at a time */
+#define CLIP_BLOCK_LINES 128
+
 /* Prototypes */
 int clip_band_misalignment
 (
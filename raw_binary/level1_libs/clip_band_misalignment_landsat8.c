@@ -42,6 +42,10 @@ NOTES:
   2. This only applies to OLI-only and combined OLI/TIRS products, thus any
      other sensors will simply be returned as-is.
   3. This is meant to be run on the Level-1 raw binary dataset.
+  4. The bands are processed CLIP_BLOCK_LINES lines at a time.  The fill mask
+     for a block is accumulated one band at a time, then applied to every
+     band and the quality band in a single pass before the block is written
+     back.
 ******************************************************************************/
 int clip_band_misalignment_landsat8
 (
@@ -50,10 +54,15 @@ int clip_band_misalignment_landsat8
 )
 {
     char FUNC_NAME[] = "clip_band_misalignment_landsat8";  /* function name */
-    char errmsg[STR_SIZE];    /* error message */
+    char errmsg[3 * STR_SIZE];  /* error message; room for two file names
+                                   along with the message */
     char curr_band[STR_SIZE]; /* current band to process */
     int i;                    /* looping variable */
-    int l, s;                 /* line, sample looping variable */
+    int l;                    /* starting line of the current block */
+    int nblk_lines;           /* number of lines in the current block */
+    size_t p;                 /* pixel looping variable */
+    size_t npix;              /* number of pixels in the current block */
+    size_t block_pix;         /* number of pixels in a full block */
     int bnd_count;            /* count of bands to process */
     int bnd;                  /* current band to process */
     int nlines = -99;         /* number of lines in the bands */
@@ -61,16 +70,19 @@ int clip_band_misalignment_landsat8
     int band_options[NBAND_OPTIONS_L8] = {1, 2, 3, 4, 5, 6, 7, 9, 10, 11};
                               /* various bands that will be used for clipping,
                                  skip the pan band */
-    bool fill;                /* is the current pixel fill */
+    uint8_t *fill_mask = NULL; /* fill mask for the current block; 1 if
+                                  the pixel is fill in any band */
     uint16_t *tmp_file_buf = NULL; /* overall buffer for uint16 input band
                                       data */
     uint16_t *file_buf[NBAND_OPTIONS_L8]; /* buffer for uint16 input band data
                                              one for each band */
     uint16_t *bqa_buf = NULL; /* buffer for band quality data */
+    Espa_band_meta_t *band1 = NULL;   /* metadata for the first band */
     Espa_global_meta_t *gmeta = NULL; /* pointer to global metadata structure */
     Espa_band_meta_t *bmeta = NULL;   /* pointer to array of bands metadata */
-    FILE *fp_rb[NBAND_OPTIONS_L8];    /* file pointer for the bands */
-    FILE *fp_bqa = NULL;              /* file pointer for band quality band */
+    Espa_band_file_t *band[NBAND_OPTIONS_L8];  /* handles for the bands */
+    Espa_band_file_t *bqa = NULL;          /* handle for the band quality
+                                              band */
 
     /* Set up the global and band metadata pointers */
     gmeta = &(xml_metadata->global);
@@ -96,8 +108,15 @@ int clip_band_misalignment_landsat8
             if (!strcmp (bmeta[i].name, curr_band))
             {
                 /* Open the band file */
-                fp_rb[bnd_count] = open_raw_binary (bmeta[i].file_name, "r+");
-                if (fp_rb[bnd_count] == NULL)
+                if (bmeta[i].data_type != ESPA_UINT16)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Band %s is not uint16",
+                        bmeta[i].name);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    return (ERROR);
+                }
+                band[bnd_count] = open_band_file (&bmeta[i], BAND_READ_WRITE);
+                if (band[bnd_count] == NULL)
                 {
                     sprintf (errmsg, "Opening the raw binary file: %s",
                         bmeta[i].file_name);
@@ -110,6 +129,7 @@ int clip_band_misalignment_landsat8
                 {
                     nlines = bmeta[i].nlines;
                     nsamps = bmeta[i].nsamps;
+                    band1 = &bmeta[i];
                 }
 
                 /* Increment the band count and goto the next metadata band */
@@ -122,8 +142,15 @@ int clip_band_misalignment_landsat8
         sprintf (curr_band, "bqa");
         if (!strcmp (bmeta[i].name, curr_band))
         {
-            fp_bqa = open_raw_binary (bmeta[i].file_name, "r+");
-            if (fp_bqa == NULL)
+            if (bmeta[i].data_type != ESPA_UINT16)
+            {
+                snprintf (errmsg, sizeof (errmsg), "The quality band is "
+                    "not uint16");
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+            bqa = open_band_file (&bmeta[i], BAND_READ_WRITE);
+            if (bqa == NULL)
             {
                 sprintf (errmsg, "Opening the quality band binary file: %s",
                     bmeta[i].file_name);
@@ -152,19 +179,41 @@ int clip_band_misalignment_landsat8
     }
 
     /* Make sure the quality band was found */
-    if (fp_bqa == NULL)
+    if (bqa == NULL)
     {
         sprintf (errmsg, "Unable to find the band quality band");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    /* Allocate one line of data for each band */
-    tmp_file_buf = calloc (nsamps * bnd_count, sizeof (uint16_t));
+    /* All the bands need to be the same size as the first band, since the
+       same block is read from each of them */
+    for (i = 0; i < bnd_count; i++)
+    {
+        if (band[i]->nlines != nlines || band[i]->nsamps != nsamps)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Band file %s is not the same "
+                "size as %s", band[i]->file_name, band1->file_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+    if (bqa->nlines != nlines || bqa->nsamps != nsamps)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Band quality file %s is not the "
+            "same size as %s", bqa->file_name, band1->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Allocate a block of lines for each band */
+    block_pix = (size_t) CLIP_BLOCK_LINES * nsamps;
+    tmp_file_buf = calloc (block_pix * bnd_count, sizeof (uint16_t));
     if (tmp_file_buf == NULL)
     {
         sprintf (errmsg, "Allocating memory for %d bands of uint16 data "
-            "containing %d samples.", bnd_count, nsamps);
+            "containing %d lines of %d samples.", bnd_count,
+            CLIP_BLOCK_LINES, nsamps);
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
@@ -172,143 +221,123 @@ int clip_band_misalignment_landsat8
     /* Break the buffer into bands */
     file_buf[0] = tmp_file_buf;
     for (i = 1; i < bnd_count; i++)
-        file_buf[i] = file_buf[i-1] + nsamps;
+        file_buf[i] = file_buf[i-1] + block_pix;
 
-    /* Allocate one line of data for the band quality band */
-    bqa_buf = calloc (nsamps, sizeof (uint16_t));
-    if (bqa_buf == NULL)
+    /* Allocate a block of lines for the band quality band and the fill
+       mask */
+    bqa_buf = calloc (block_pix, sizeof (uint16_t));
+    fill_mask = calloc (block_pix, sizeof (uint8_t));
+    if (bqa_buf == NULL || fill_mask == NULL)
     {
         sprintf (errmsg, "Allocating memory for band quality uint16 data "
-            "containing %d samples.", nsamps);
+            "containing %d lines of %d samples.", CLIP_BLOCK_LINES, nsamps);
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    /* Loop through the lines of data and process each file */
-    for (l = 0; l < nlines; l++)
+    /* Loop through the blocks of lines and process each file */
+    for (l = 0; l < nlines; l += CLIP_BLOCK_LINES)
     {
-        /* Read the current line from each band */
+        nblk_lines = CLIP_BLOCK_LINES;
+        if (l + nblk_lines > nlines)
+            nblk_lines = nlines - l;
+        npix = (size_t) nblk_lines * nsamps;
+
+        /* Read the current block from each band and the band quality band */
         for (i = 0; i < bnd_count; i++)
         {
-            /* Seek to the correct position to read the current line */
-            if (fseek (fp_rb[i], l * nsamps * sizeof (uint16_t), SEEK_SET)
-                == -1)
-            {   
-                sprintf (errmsg, "Not able to seek for line %d of raw binary "
-                    "file %d", l, i);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-
-            /* Read the line */
-            if (read_raw_binary (fp_rb[i], 1, nsamps, sizeof (uint16_t),
+            if (read_band_window (band[i], l, 0, nblk_lines, nsamps,
                 file_buf[i]) != SUCCESS)
-            {   
-                sprintf (errmsg, "Reading line %d of raw binary file %d", l, i);
+            {
+                snprintf (errmsg, sizeof (errmsg), "Reading lines %d-%d of "
+                    "raw binary file %d", l, l + nblk_lines - 1, i);
                 error_handler (true, FUNC_NAME, errmsg);
                 return (ERROR);
             }
         }
 
-        /* Read the band quality. Seek to the correct position to read the
-           current line. */
-        if (fseek (fp_bqa, l * nsamps * sizeof (uint16_t), SEEK_SET) == -1)
-        {   
-            sprintf (errmsg, "Not able to seek for line %d of band quality "
-                "file", l);
+        if (read_band_window (bqa, l, 0, nblk_lines, nsamps, bqa_buf)
+            != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Reading lines %d-%d of band "
+                "quality file", l, l + nblk_lines - 1);
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
 
-        /* Read the current line from the band quality band */
-        if (read_raw_binary (fp_bqa, 1, nsamps, sizeof (uint16_t), bqa_buf) !=
-            SUCCESS)
-        {   
-            sprintf (errmsg, "Reading line %d of band quality file", l);
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
+        /* Build the fill mask for the block.  The band quality fill is
+           included, since we have found a few cases where the band quality
+           is set to fill and none of the bands are fill.  Each band is
+           tested across the whole block without branches, so the compiler
+           can vectorize the comparisons. */
+        for (p = 0; p < npix; p++)
+            fill_mask[p] = (bqa_buf[p] == BQA_FILL);
+        for (i = 0; i < bnd_count; i++)
+        {
+            uint16_t *buf = file_buf[i];
+            for (p = 0; p < npix; p++)
+                fill_mask[p] |= (buf[p] == LEVEL1_FILL);
         }
 
-        /* Loop through all the pixels and assess if any are fill */
-        for (s = 0; s < nsamps; s++)
+        /* If a pixel is fill in any band or in the band quality band, then
+           set all bands to fill and set the band quality to fill (first bit
+           set to 1) */
+        for (i = 0; i < bnd_count; i++)
         {
-            /* Check the current pixel for each band to be fill */
-            fill = false;
-            for (i = 0; i < bnd_count; i++)
-            {
-                /* Check for fill in the current band */
-                if (file_buf[i][s] == LEVEL1_FILL)
-                {
-                    fill = true;
-                    break;
-                }
-            }
-
-            /* If a fill pixel was found or this pixel is flagged as fill in
-               the band quality band, then set all bands to fill and set the
-               band quality to fill. Technically if the band quality is set to
-               fill, then one of the bands should have been flagged as fill.
-               However, we have found a few cases where the band quality is
-               set to fill and none of the bands are fill. That case is fixed
-               in the following code block. */
-            if (fill || (bqa_buf[s] == BQA_FILL))
-            {
-                for (i = 0; i < bnd_count; i++)
-                    file_buf[i][s] = LEVEL1_FILL;
-                bqa_buf[s] = BQA_FILL;  /* first bit set to 1 for fill */
-            }
+            uint16_t *buf = file_buf[i];
+            for (p = 0; p < npix; p++)
+                buf[p] = fill_mask[p] ? LEVEL1_FILL : buf[p];
         }
+        for (p = 0; p < npix; p++)
+            bqa_buf[p] = fill_mask[p] ? BQA_FILL : bqa_buf[p];
 
-        /* Write the current line for each band */
+        /* Write the current block back out to each band and the band
+           quality band */
         for (i = 0; i < bnd_count; i++)
         {
-            /* Seek to the correct position to write the current line */
-            if (fseek (fp_rb[i], l * nsamps * sizeof (uint16_t), SEEK_SET)
-                == -1)
-            {   
-                sprintf (errmsg, "Not able to seek for line %d of raw binary "
-                    "file %d", l, i);
-                error_handler (true, FUNC_NAME, errmsg);
-                return (ERROR);
-            }
-
-            /* Write the current line back out to the file */
-            if (write_raw_binary (fp_rb[i], 1, nsamps, sizeof (uint16_t),
+            if (write_band_window (band[i], l, 0, nblk_lines, nsamps,
                 file_buf[i]) != SUCCESS)
-            {   
-                sprintf (errmsg, "Writing line %d of raw binary file %d", l, i);
+            {
+                snprintf (errmsg, sizeof (errmsg), "Writing lines %d-%d of "
+                    "raw binary file %d", l, l + nblk_lines - 1, i);
                 error_handler (true, FUNC_NAME, errmsg);
                 return (ERROR);
             }
         }
 
-        /* Seek to the correct position to write the current line */
-        if (fseek (fp_bqa, l * nsamps * sizeof (uint16_t), SEEK_SET) == -1)
-        {   
-            sprintf (errmsg, "Not able to seek for line %d of band quality "
-                "file", l);
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Write the current line back out to the band quality file */
-        if (write_raw_binary (fp_bqa, 1, nsamps, sizeof (uint16_t), bqa_buf) !=
-            SUCCESS)
-        {   
-            sprintf (errmsg, "Writing line %d of band quality file", l);
+        if (write_band_window (bqa, l, 0, nblk_lines, nsamps, bqa_buf)
+            != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Writing lines %d-%d of band "
+                "quality file", l, l + nblk_lines - 1);
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
     }  /* for l in nlines */
 
-    /* Free the raw binary band buffer and the band quality band buffer */
+    /* Free the raw binary band buffer, the band quality band buffer, and the
+       fill mask */
     free (tmp_file_buf);
     free (bqa_buf);
+    free (fill_mask);
 
     /* Close the data files */
     for (i = 0; i < bnd_count; i++)
-        close_raw_binary (fp_rb[i]);
-    close_raw_binary (fp_bqa);
+    {
+        if (close_band_file (band[i]) != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Closing raw binary file %d",
+                i);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+    if (close_band_file (bqa) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Closing the band quality file");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
 
     /* Successful conversion */
     return (SUCCESS);
@@ -63,6 +63,58 @@ int calculate_angles
     return SUCCESS;
 }
 
+/*******************************************************************************
+Name: calculate_angles_batch
+
+Purpose: Calculate the satellite and solar zenith and azimuth angles for an
+         array of L1T line/sample coordinates using the batch RPC evaluator.
+
+Note: ias_angle_gen_calculate_sat_sun_angles_rpc_batch will return the
+      angles in radians.  The angles are within IAS_ANGLE_GEN_BATCH_TRIG_ERROR radians of
+      the ones returned by calculate_angles.
+
+Return: SUCCESS / ERROR
+ ******************************************************************************/
+int calculate_angles_batch
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Angle metadata structure */
+    int num_points,                         /* I: Number of points */
+    const double *line,                     /* I: L1T line coordinates */
+    const double *samp,                     /* I: L1T sample coordinates */
+    const double *elev,                     /* I: Elevations (zero to ensure
+                                                  the full scene coverage) */
+    int band_index,                         /* I: Spectral band number */
+    ANGLE_TYPE angle_type,                  /* I: Type of angles to generate */
+    double *sat_zenith,                     /* O: Satellite zeniths (radians) */
+    double *sat_azimuth,                    /* O: Satellite azimuths (radians)*/
+    double *sun_zenith,                     /* O: Solar zeniths (radians) */
+    double *sun_azimuth                     /* O: Solar azimuths (radians) */
+)
+{
+    /* Skip the satellite angles for the solar type and the solar angles for
+       the satellite type.  The L1R locations are shared by both. */
+    if (angle_type == AT_SOLAR)
+    {
+        sat_zenith = NULL;
+        sat_azimuth = NULL;
+    }
+    else if (angle_type == AT_SATELLITE)
+    {
+        sun_zenith = NULL;
+        sun_azimuth = NULL;
+    }
+
+    if (ias_angle_gen_calculate_sat_sun_angles_rpc_batch(metadata, num_points,
+        line, samp, elev, band_index, NULL, sat_zenith, sat_azimuth,
+        sun_zenith, sun_azimuth) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Evaluating angles for band index %d", band_index);
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
 /*******************************************************************************
 Name: get_active_lines
 
@@ -0,0 +1,688 @@
+/* Standard Library Includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+/* ESPA Library Includes */
+#include "error_handler.h"
+
+/* Local Includes */
+#include "angles_interp.h"
+
+/* Local defines */
+#define INTERP_PI 3.14159265358979323846
+
+/* Sets of grid points evaluated for each row of cells.  Each set has one
+   entry per grid column; the corner and edge sets are at the grid columns
+   and the mid sets are halfway between grid columns. */
+enum
+{
+    GP_TOP = 0,     /* Corners on the top line of the row */
+    GP_BOTTOM,      /* Corners on the bottom line of the row */
+    GP_MID,         /* Left/right edge midpoints, on the middle line */
+    GP_TOP_MID,     /* Top edge midpoints */
+    GP_BOTTOM_MID,  /* Bottom edge midpoints */
+    GP_CENTER,      /* Cell centers */
+    GP_NSETS
+};
+
+/* Set of points to be evaluated exactly */
+typedef struct point_set
+{
+    int npoints;                    /* Number of points in the set */
+    double *line;                   /* L1T line of each point */
+    double *samp;                   /* L1T sample of each point */
+    double *angles[ANGLES_NFIELDS]; /* Angles of each point (radians) */
+    int *region;                    /* Region of each point */
+} POINT_SET;
+
+/******************************************************************************
+NAME: angles_interp_enabled
+
+PURPOSE: Determines if the interpolation controls ask for the angles to be
+interpolated from a coarse grid.
+
+RETURN VALUE: Type = bool
+    Value     Description
+    -----     -----------
+    true      The angles should be interpolated
+    false     Every pixel should be computed exactly
+******************************************************************************/
+bool angles_interp_enabled
+(
+    const ANGLES_INTERP *interp /* I: Interpolation controls, or NULL */
+)
+{
+    return (interp != NULL && interp->grid_step > 1);
+}
+
+/******************************************************************************
+NAME: free_point_set
+
+PURPOSE: Frees the arrays of a point set.
+
+RETURN VALUE: N/A
+******************************************************************************/
+static void free_point_set
+(
+    POINT_SET *set          /* I/O: Point set to be freed */
+)
+{
+    int f;                  /* Field index */
+
+    free(set->line);
+    free(set->samp);
+    for (f = 0; f < ANGLES_NFIELDS; f++)
+        free(set->angles[f]);
+    free(set->region);
+}
+
+/******************************************************************************
+NAME: alloc_point_set
+
+PURPOSE: Allocates the arrays of a point set.  Angle arrays are only allocated
+for the fields which are used.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The point set was allocated
+    ERROR     An error occurred allocating the point set
+******************************************************************************/
+static int alloc_point_set
+(
+    int max_points,                    /* I: Maximum number of points */
+    const bool use_field[ANGLES_NFIELDS], /* I: Fields to be evaluated */
+    POINT_SET *set                     /* O: Point set */
+)
+{
+    int f;                  /* Field index */
+    int status = SUCCESS;   /* Allocation status */
+
+    set->npoints = 0;
+    set->line = malloc(max_points * sizeof(double));
+    set->samp = malloc(max_points * sizeof(double));
+    set->region = malloc(max_points * sizeof(int));
+    if (!set->line || !set->samp || !set->region)
+        status = ERROR;
+
+    for (f = 0; f < ANGLES_NFIELDS; f++)
+    {
+        set->angles[f] = NULL;
+        if (use_field[f])
+        {
+            set->angles[f] = malloc(max_points * sizeof(double));
+            if (!set->angles[f])
+                status = ERROR;
+        }
+    }
+
+    return status;
+}
+
+/******************************************************************************
+NAME: add_point
+
+PURPOSE: Adds an output line/sample location to a point set.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    >= 0      Index of the point in the set
+******************************************************************************/
+static int add_point
+(
+    int sub_sample,         /* I: L1T pixels per output pixel */
+    int line,               /* I: Output line */
+    int samp,               /* I: Output sample */
+    POINT_SET *set          /* I/O: Point set */
+)
+{
+    set->line[set->npoints] = (double) line * sub_sample;
+    set->samp[set->npoints] = (double) samp * sub_sample;
+    return set->npoints++;
+}
+
+/******************************************************************************
+NAME: in_extent
+
+PURPOSE: Determines if an output pixel is inside the valid image extent.
+
+RETURN VALUE: Type = bool
+    Value     Description
+    -----     -----------
+    true      The pixel is inside the extent
+    false     The pixel is outside the extent
+******************************************************************************/
+static bool in_extent
+(
+    const ANGLES_EXTENT *extent, /* I: Valid samples of each line, or NULL */
+    int line,                    /* I: Output line */
+    int samp                     /* I: Output sample */
+)
+{
+    if (!extent)
+        return true;
+
+    return (samp >= extent[line].first_samp && samp <= extent[line].last_samp);
+}
+
+/******************************************************************************
+NAME: wrap_angle
+
+PURPOSE: Wraps an angle into the range -pi to pi.
+
+RETURN VALUE: Type = double
+    Wrapped angle (radians)
+******************************************************************************/
+static double wrap_angle
+(
+    double angle            /* I: Angle (radians) */
+)
+{
+    while (angle > INTERP_PI)
+        angle -= 2.0 * INTERP_PI;
+    while (angle <= -INTERP_PI)
+        angle += 2.0 * INTERP_PI;
+
+    return angle;
+}
+
+/******************************************************************************
+NAME: interp_value
+
+PURPOSE: Bilinearly interpolates an angle from the four corners of a cell.
+Azimuths are unwrapped relative to the first corner so cells straddling the
++/-pi seam interpolate the short way around.
+
+RETURN VALUE: Type = double
+    Interpolated angle (radians)
+******************************************************************************/
+static double interp_value
+(
+    const double corner[4], /* I: Corner angles (radians); upper left, upper
+                                  right, lower left, lower right */
+    double u,               /* I: Fractional sample position in the cell */
+    double v,               /* I: Fractional line position in the cell */
+    bool azimuth            /* I: Is this an azimuth angle? */
+)
+{
+    double c[4];            /* Corner values */
+    double value;           /* Interpolated value */
+    int i;                  /* Corner index */
+
+    c[0] = corner[0];
+    for (i = 1; i < 4; i++)
+    {
+        c[i] = corner[i];
+        if (azimuth)
+            c[i] = c[0] + wrap_angle(c[i] - c[0]);
+    }
+
+    value = (1.0 - v) * ((1.0 - u) * c[0] + u * c[1])
+        + v * ((1.0 - u) * c[2] + u * c[3]);
+
+    if (azimuth)
+        value = wrap_angle(value);
+
+    return value;
+}
+
+/******************************************************************************
+NAME: fraction
+
+PURPOSE: Computes the fractional position of a coordinate between two grid
+coordinates.
+
+RETURN VALUE: Type = double
+    Fractional position (0 to 1)
+******************************************************************************/
+static double fraction
+(
+    int coord,              /* I: Coordinate */
+    int start,              /* I: Grid coordinate at the start of the cell */
+    int end                 /* I: Grid coordinate at the end of the cell */
+)
+{
+    if (end == start)
+        return 0.0;
+
+    return (double) (coord - start) / (end - start);
+}
+
+/******************************************************************************
+NAME: cell_interpolates
+
+PURPOSE: Determines if the angles in a cell can be interpolated from its
+corners.  The corners and the check points (cell center and edge midpoints)
+must all be inside the image extent and in the same region, and the
+interpolated angles at the check points must be within the tolerance of the
+exact angles.
+
+RETURN VALUE: Type = bool
+    Value     Description
+    -----     -----------
+    true      The cell can be interpolated
+    false     The cell needs to be computed exactly
+******************************************************************************/
+static bool cell_interpolates
+(
+    const POINT_SET *grid,  /* I: Evaluated grid points */
+    const int *grid_index,  /* I: Index of each grid point in grid, or -1 */
+    int ngx,                /* I: Number of grid columns */
+    int col,                /* I: Cell column */
+    int top,                /* I: Top output line of the cell */
+    int bottom,             /* I: Bottom output line of the cell */
+    int left,               /* I: Left output sample of the cell */
+    int right,              /* I: Right output sample of the cell */
+    short *out[ANGLES_NFIELDS], /* I: Output bands; NULL fields are skipped */
+    double tolerance        /* I: Maximum interpolation error (radians) */
+)
+{
+    int right_col;          /* Grid column at the right of the cell */
+    int corner[4];          /* Grid point index of the corners */
+    int check[5];           /* Grid point index of the check points */
+    double check_u[5];      /* Fractional sample of the check points */
+    double check_v[5];      /* Fractional line of the check points */
+    double values[4];       /* Corner values for one field */
+    double diff;            /* Interpolation error */
+    int mid_line = (top + bottom) / 2;  /* Middle line of the cell */
+    int mid_samp = (left + right) / 2;  /* Middle sample of the cell */
+    int region;             /* Region of the first corner */
+    int i, f;               /* Looping variables */
+
+    right_col = (col + 1 < ngx) ? col + 1 : ngx - 1;
+    corner[0] = grid_index[GP_TOP * ngx + col];
+    corner[1] = grid_index[GP_TOP * ngx + right_col];
+    corner[2] = grid_index[GP_BOTTOM * ngx + col];
+    corner[3] = grid_index[GP_BOTTOM * ngx + right_col];
+
+    check[0] = grid_index[GP_TOP_MID * ngx + col];
+    check_u[0] = fraction(mid_samp, left, right);
+    check_v[0] = 0.0;
+    check[1] = grid_index[GP_BOTTOM_MID * ngx + col];
+    check_u[1] = check_u[0];
+    check_v[1] = 1.0;
+    check[2] = grid_index[GP_MID * ngx + col];
+    check_u[2] = 0.0;
+    check_v[2] = fraction(mid_line, top, bottom);
+    check[3] = grid_index[GP_MID * ngx + right_col];
+    check_u[3] = 1.0;
+    check_v[3] = check_v[2];
+    check[4] = grid_index[GP_CENTER * ngx + col];
+    check_u[4] = check_u[0];
+    check_v[4] = check_v[2];
+
+    /* All the points must be inside the image and in the same region */
+    for (i = 0; i < 4; i++)
+    {
+        if (corner[i] < 0)
+            return false;
+    }
+    region = grid->region[corner[0]];
+    for (i = 1; i < 4; i++)
+    {
+        if (grid->region[corner[i]] != region)
+            return false;
+    }
+    for (i = 0; i < 5; i++)
+    {
+        if (check[i] < 0 || grid->region[check[i]] != region)
+            return false;
+    }
+
+    /* Compare the interpolated and exact angles at the check points */
+    for (f = 0; f < ANGLES_NFIELDS; f++)
+    {
+        bool azimuth = (f == ANGLES_SAT_AZIMUTH || f == ANGLES_SUN_AZIMUTH);
+
+        if (!out[f])
+            continue;
+
+        for (i = 0; i < 4; i++)
+            values[i] = grid->angles[f][corner[i]];
+
+        for (i = 0; i < 5; i++)
+        {
+            diff = interp_value(values, check_u[i], check_v[i], azimuth)
+                - grid->angles[f][check[i]];
+            if (azimuth)
+                diff = wrap_angle(diff);
+            if (fabs(diff) > tolerance)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/******************************************************************************
+NAME: evaluate_points
+
+PURPOSE: Evaluates the exact angles for the points in a point set.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The angles were evaluated
+    ERROR     An error occurred evaluating the angles
+******************************************************************************/
+static int evaluate_points
+(
+    ANGLES_EVALUATOR evaluate,  /* I: Exact angle evaluator */
+    void *eval_data,            /* I: Data passed to the evaluator */
+    POINT_SET *set              /* I/O: Point set to evaluate */
+)
+{
+    if (set->npoints == 0)
+        return SUCCESS;
+
+    return evaluate(eval_data, set->npoints, set->line, set->samp, set->angles,
+        set->region);
+}
+
+/******************************************************************************
+NAME: grid_coord
+
+PURPOSE: Returns the output coordinate of a grid line or column.
+
+RETURN VALUE: Type = int
+    Output line or sample of the grid point
+******************************************************************************/
+static int grid_coord
+(
+    int index,              /* I: Grid line or column index */
+    int step,               /* I: Output pixels between grid points */
+    int size                /* I: Number of output lines or samples */
+)
+{
+    int coord = index * step;   /* Grid coordinate */
+
+    return (coord < size) ? coord : size - 1;
+}
+
+/******************************************************************************
+NAME: angles_interp_block
+
+PURPOSE: Generates the angles for a block of output lines by computing the
+exact angles on a coarse grid and bilinearly interpolating them to the rest
+of the pixels.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The angles were generated
+    ERROR     An error occurred generating the angles
+
+NOTES:
+  1. The output is split into cells of grid_step x grid_step pixels.  The
+     exact angles are computed at the cell corners, and at the cell center
+     and edge midpoints, which is where the bilinear interpolation error of a
+     smooth field peaks.  A cell is interpolated if the interpolated angles
+     at those check points are within max_error of the exact angles.
+  2. Cells are computed exactly, pixel by pixel, if they fail the error
+     check, if any of their grid points fall outside the image extent, or if
+     their grid points aren't all in the same region (e.g. they cross an SCA
+     boundary).
+  3. The grid points of the cell rows overlapping the block are computed by
+     the block, so a block is independent of the other blocks and blocks can
+     be generated concurrently.
+  4. The output buffers only need to hold the lines from buffer_line through
+     end_line - 1, so a caller can generate a band a few blocks at a time
+     without keeping the whole band in memory.
+******************************************************************************/
+int angles_interp_block
+(
+    ANGLES_EVALUATOR evaluate,  /* I: Exact angle evaluator */
+    void *eval_data,            /* I: Data passed to the evaluator */
+    const ANGLES_INTERP *interp,/* I: Interpolation controls */
+    int sub_sample,             /* I: L1T pixels per output pixel */
+    int num_lines,              /* I: Number of lines in the output band */
+    int num_samps,              /* I: Number of samples in the output band */
+    const ANGLES_EXTENT *extent,/* I: Valid samples of each output line, or
+                                      NULL if all samples are valid */
+    int start_line,             /* I: First output line to generate */
+    int end_line,               /* I: Last output line to generate + 1 */
+    int buffer_line,            /* I: Output line held in the first line of
+                                      out; 0 if out holds the whole band */
+    short background,           /* I: Value for pixels outside the extent */
+    short *out[ANGLES_NFIELDS]  /* O: Output band for each field (degrees
+                                      scaled by 100); NULL fields are not
+                                      generated */
+)
+{
+    char FUNC_NAME[] = "angles_interp_block";  /* function name */
+    char errmsg[STR_SIZE];      /* error message */
+    int step;                   /* Output pixels between grid points */
+    int ngx, ngy;               /* Number of grid columns and lines */
+    int ncols, nrows;           /* Number of cell columns and rows */
+    int row;                    /* Cell row */
+    int first_row, last_row;    /* First and last cell rows of the block */
+    int col;                    /* Cell column */
+    int line;                   /* Output line */
+    int samp;                   /* Output sample */
+    int set;                    /* Grid point set */
+    int k;                      /* Grid column or point index */
+    int f;                      /* Field index */
+    int status = SUCCESS;       /* Return status */
+    bool use_field[ANGLES_NFIELDS]; /* Fields evaluated */
+    double tolerance;           /* Maximum interpolation error (radians) */
+    double r2d = 4500.0 / atan(1.0);  /* Conversion to hundredths of degrees;
+                                         this includes the conversion of radians
+                                         to degrees in addition to scaling by
+                                         100.0 */
+    int *grid_index = NULL;     /* Index of each grid point in the grid point
+                                   set, or -1 if outside the extent */
+    bool *cell_ok = NULL;       /* Can each cell of the row be interpolated */
+    int *pixel_samp = NULL;     /* Output sample of each exact pixel */
+    POINT_SET grid;             /* Grid points of the current row */
+    POINT_SET pixels;           /* Exact pixels of the current line */
+
+    step = (interp->grid_step > 1) ? interp->grid_step : 1;
+    tolerance = interp->max_error * INTERP_PI / 180.0;
+
+    /* Zenith and azimuth are evaluated together */
+    use_field[ANGLES_SAT_ZENITH] = use_field[ANGLES_SAT_AZIMUTH] =
+        (out[ANGLES_SAT_ZENITH] || out[ANGLES_SAT_AZIMUTH]);
+    use_field[ANGLES_SUN_ZENITH] = use_field[ANGLES_SUN_AZIMUTH] =
+        (out[ANGLES_SUN_ZENITH] || out[ANGLES_SUN_AZIMUTH]);
+
+    /* The last grid line and column are always on the image edge */
+    ngx = (num_samps + step - 2) / step + 1;
+    ngy = (num_lines + step - 2) / step + 1;
+    ncols = (ngx > 1) ? ngx - 1 : 1;
+    nrows = (ngy > 1) ? ngy - 1 : 1;
+
+    /* Allocate the work arrays */
+    grid_index = malloc(GP_NSETS * ngx * sizeof(int));
+    cell_ok = malloc(ncols * sizeof(bool));
+    pixel_samp = malloc(num_samps * sizeof(int));
+    if (alloc_point_set(GP_NSETS * ngx, use_field, &grid) != SUCCESS)
+        status = ERROR;
+    if (alloc_point_set(num_samps, use_field, &pixels) != SUCCESS)
+        status = ERROR;
+    if (status != SUCCESS || !grid_index || !cell_ok || !pixel_samp)
+    {
+        sprintf(errmsg, "Allocating the angle interpolation arrays");
+        error_handler(true, FUNC_NAME, errmsg);
+        status = ERROR;
+    }
+
+    first_row = start_line / step;
+    if (first_row > nrows - 1)
+        first_row = nrows - 1;
+    last_row = (end_line - 1) / step;
+    if (last_row > nrows - 1)
+        last_row = nrows - 1;
+
+    for (row = first_row; status == SUCCESS && row <= last_row; row++)
+    {
+        int top = grid_coord(row, step, num_lines);     /* Top line */
+        int bottom = grid_coord(row + 1, step, num_lines); /* Bottom line */
+        int mid_line = (top + bottom) / 2;               /* Middle line */
+        int row_end;                /* Last output line of the row + 1 */
+
+        /* Gather the grid points of this row which are inside the image */
+        grid.npoints = 0;
+        for (set = 0; set < GP_NSETS; set++)
+        {
+            for (k = 0; k < ngx; k++)
+            {
+                int gline;          /* Output line of the grid point */
+                int gsamp;          /* Output sample of the grid point */
+                int right_col = (k + 1 < ngx) ? k + 1 : ngx - 1;
+
+                grid_index[set * ngx + k] = -1;
+
+                if (set == GP_TOP || set == GP_TOP_MID)
+                    gline = top;
+                else if (set == GP_BOTTOM || set == GP_BOTTOM_MID)
+                    gline = bottom;
+                else
+                    gline = mid_line;
+
+                if (set == GP_TOP || set == GP_BOTTOM || set == GP_MID)
+                    gsamp = grid_coord(k, step, num_samps);
+                else if (k < ncols)
+                    gsamp = (grid_coord(k, step, num_samps)
+                        + grid_coord(right_col, step, num_samps)) / 2;
+                else
+                    continue;
+
+                if (in_extent(extent, gline, gsamp))
+                {
+                    grid_index[set * ngx + k] = add_point(sub_sample, gline,
+                        gsamp, &grid);
+                }
+            }
+        }
+
+        if (evaluate_points(evaluate, eval_data, &grid) != SUCCESS)
+        {
+            sprintf(errmsg, "Evaluating the angle grid for output line %d",
+                top);
+            error_handler(true, FUNC_NAME, errmsg);
+            status = ERROR;
+            break;
+        }
+
+        /* Decide which cells of the row can be interpolated */
+        for (col = 0; col < ncols; col++)
+        {
+            cell_ok[col] = cell_interpolates(&grid, grid_index, ngx, col, top,
+                bottom, grid_coord(col, step, num_samps),
+                grid_coord(col + 1, step, num_samps), out, tolerance);
+        }
+
+        /* Generate the lines of this row which are in the block */
+        line = row * step;
+        if (line < start_line)
+            line = start_line;
+        row_end = (row == nrows - 1) ? num_lines : (row + 1) * step;
+        if (row_end > end_line)
+            row_end = end_line;
+
+        for (; line < row_end; line++)
+        {
+            size_t index;                               /* Buffer offset */
+            double v = fraction(line, top, bottom);     /* Line fraction */
+            int first_samp = 0;                         /* First valid samp */
+            int last_samp = num_samps - 1;              /* Last valid samp */
+
+            index = (size_t) (line - buffer_line) * num_samps;
+
+            /* Start the line out as fill */
+            for (f = 0; f < ANGLES_NFIELDS; f++)
+            {
+                if (!out[f])
+                    continue;
+                for (samp = 0; samp < num_samps; samp++)
+                    out[f][index + samp] = background;
+            }
+
+            if (extent)
+            {
+                if (extent[line].first_samp > first_samp)
+                    first_samp = extent[line].first_samp;
+                if (extent[line].last_samp < last_samp)
+                    last_samp = extent[line].last_samp;
+            }
+
+            /* Interpolate the pixels in good cells, and gather the others to
+               be computed exactly */
+            pixels.npoints = 0;
+            for (samp = first_samp; samp <= last_samp; samp++)
+            {
+                int left;           /* Left sample of the cell */
+                int right;          /* Right sample of the cell */
+                double u;           /* Sample fraction */
+                int corner[4];      /* Grid point index of the corners */
+                int right_col;      /* Grid column at the right of the cell */
+
+                col = samp / step;
+                if (col > ncols - 1)
+                    col = ncols - 1;
+
+                if (!cell_ok[col])
+                {
+                    pixel_samp[pixels.npoints] = samp;
+                    add_point(sub_sample, line, samp, &pixels);
+                    continue;
+                }
+
+                right_col = (col + 1 < ngx) ? col + 1 : ngx - 1;
+                left = grid_coord(col, step, num_samps);
+                right = grid_coord(right_col, step, num_samps);
+                u = fraction(samp, left, right);
+                corner[0] = grid_index[GP_TOP * ngx + col];
+                corner[1] = grid_index[GP_TOP * ngx + right_col];
+                corner[2] = grid_index[GP_BOTTOM * ngx + col];
+                corner[3] = grid_index[GP_BOTTOM * ngx + right_col];
+
+                for (f = 0; f < ANGLES_NFIELDS; f++)
+                {
+                    double values[4];   /* Corner values */
+
+                    if (!out[f])
+                        continue;
+
+                    for (k = 0; k < 4; k++)
+                        values[k] = grid.angles[f][corner[k]];
+
+                    out[f][index + samp] = (short) round (r2d *
+                        interp_value(values, u, v,
+                        (f == ANGLES_SAT_AZIMUTH || f == ANGLES_SUN_AZIMUTH)));
+                }
+            }
+
+            if (evaluate_points(evaluate, eval_data, &pixels) != SUCCESS)
+            {
+                sprintf(errmsg, "Evaluating the angles for output line %d",
+                    line);
+                error_handler(true, FUNC_NAME, errmsg);
+                status = ERROR;
+                break;
+            }
+
+            for (k = 0; k < pixels.npoints; k++)
+            {
+                for (f = 0; f < ANGLES_NFIELDS; f++)
+                {
+                    if (out[f])
+                    {
+                        out[f][index + pixel_samp[k]] = (short) round (r2d *
+                            pixels.angles[f][k]);
+                    }
+                }
+            }
+        }  /* for line */
+    }  /* for row */
+
+    free_point_set(&grid);
+    free_point_set(&pixels);
+    free(grid_index);
+    free(cell_ok);
+    free(pixel_samp);
+
+    return status;
+}
@@ -0,0 +1,84 @@
+#ifndef _ANGLES_INTERP_H_
+#define _ANGLES_INTERP_H_
+
+/* Standard Library Includes */
+#include <stdbool.h>
+
+/* Number of angle fields which can be generated */
+#define ANGLES_NFIELDS 4
+
+/* Default grid spacing (output pixels) and maximum error (degrees) for the
+   interpolated angles */
+#define ANGLES_INTERP_DEFAULT_STEP 16
+#define ANGLES_INTERP_DEFAULT_MAX_ERROR 0.02
+
+/* Angle fields, used to index the angle arrays passed around by the
+   interpolation routines */
+typedef enum angles_field
+{
+    ANGLES_SAT_ZENITH = 0,  /* Satellite zenith */
+    ANGLES_SAT_AZIMUTH,     /* Satellite azimuth */
+    ANGLES_SUN_ZENITH,      /* Solar zenith */
+    ANGLES_SUN_AZIMUTH      /* Solar azimuth */
+} ANGLES_FIELD;
+
+/* Controls generating the angles on a coarse grid and interpolating them to
+   the rest of the output pixels */
+typedef struct angles_interp
+{
+    int grid_step;          /* Output pixels between the exactly computed grid
+                               points; 1 or less computes every pixel */
+    double max_error;       /* Maximum interpolation error allowed (degrees) */
+} ANGLES_INTERP;
+
+/* Range of valid output samples in an output line.  Pixels outside of the
+   range are set to the background value. */
+typedef struct angles_extent
+{
+    int first_samp;         /* First valid output sample */
+    int last_samp;          /* Last valid output sample; less than first_samp
+                               if the line has no valid samples */
+} ANGLES_EXTENT;
+
+/* Evaluates the exact angles for an array of L1T line/sample locations.  Both
+   the zenith and azimuth arrays of a satellite or solar pair are non-NULL when
+   that pair is requested, the other pair is NULL.  The angles are returned in
+   radians.  Points are only interpolated between grid points in the same
+   region (e.g. the same set of SCAs). */
+typedef int (*ANGLES_EVALUATOR)
+(
+    void *eval_data,        /* I: Sensor specific evaluation data */
+    int num_points,         /* I: Number of points to evaluate */
+    const double *line,     /* I: L1T line of each point */
+    const double *samp,     /* I: L1T sample of each point */
+    double *angles[ANGLES_NFIELDS], /* O: Angles for each field (radians) */
+    int *region             /* O: Region of each point */
+);
+
+/***************************** PROTOTYPES START *******************************/
+bool angles_interp_enabled
+(
+    const ANGLES_INTERP *interp /* I: Interpolation controls, or NULL */
+);
+
+int angles_interp_block
+(
+    ANGLES_EVALUATOR evaluate,  /* I: Exact angle evaluator */
+    void *eval_data,            /* I: Data passed to the evaluator */
+    const ANGLES_INTERP *interp,/* I: Interpolation controls */
+    int sub_sample,             /* I: L1T pixels per output pixel */
+    int num_lines,              /* I: Number of lines in the output band */
+    int num_samps,              /* I: Number of samples in the output band */
+    const ANGLES_EXTENT *extent,/* I: Valid samples of each output line, or
+                                      NULL if all samples are valid */
+    int start_line,             /* I: First output line to generate */
+    int end_line,               /* I: Last output line to generate + 1 */
+    int buffer_line,            /* I: Output line held in the first line of
+                                      out; 0 if out holds the whole band */
+    short background,           /* I: Value for pixels outside the extent */
+    short *out[ANGLES_NFIELDS]  /* O: Output band for each field (degrees
+                                      scaled by 100); NULL fields are not
+                                      generated */
+);
+
+#endif
@@ -13,9 +13,40 @@
 /* Local Includes */
 #include "l8_angles.h"
 
+/* Fill value of the reflective band angles which are averaged, to match the
+   Landsat 8 image data */
+#define L8_AVG_BAND_FILL -9999
+
+/* Average arrays filled in by copy_avg_block; NULL fields aren't returned */
+typedef struct l8_avg_angles_copy
+{
+    short **avg[ANGLES_NFIELDS]; /* Addr of the average array of each field */
+} L8_AVG_ANGLES_COPY;
+
 /* Prototypes */
 static int process_parameters (char *angle_coeff_name, int subsamp_fact,
     short fill_pix_value, char *band_list, L8_ANGLES_PARAMETERS *parameters);
+static int setup_angle_bands (char *angle_coeff_name, int subsamp_fact,
+    short fill_pix_value, const ANGLES_INTERP *interp, char *band_list,
+    ANGLE_TYPE angle_type, L8_ANGLES_PARAMETERS *parameters,
+    IAS_ANGLE_GEN_METADATA *metadata, ANGLES_FRAME frame[L8_NBANDS],
+    IAS_MISC_LINE_EXTENT *trim_lut[IAS_MAX_NBANDS],
+    ANGLES_EXTENT *extent[IAS_MAX_NBANDS], int nlines[L8_NBANDS],
+    int nsamps[L8_NBANDS]);
+static int copy_avg_block (void *write_data, int num_lines, int num_samps,
+    int start_line, int end_line, short *avg[ANGLES_NFIELDS]);
+static void free_trim_luts (IAS_MISC_LINE_EXTENT *trim_lut[IAS_MAX_NBANDS],
+    ANGLES_EXTENT *extent[IAS_MAX_NBANDS]);
+static ANGLES_EXTENT *create_output_extent (const IAS_MISC_LINE_EXTENT
+    *trim_lut, int sub_sample, int num_lines, int num_samps);
+static int evaluate_l8_angles (void *eval_data, int num_points,
+    const double *line, const double *samp, double *angles[ANGLES_NFIELDS],
+    int *region);
+static int calculate_angle_block (const IAS_ANGLE_GEN_METADATA *metadata,
+    const L8_ANGLES_PARAMETERS *parameters, const L8_ANGLE_BLOCK *block,
+    const ANGLES_FRAME *frame, const IAS_MISC_LINE_EXTENT *trim_lut,
+    const ANGLES_EXTENT *extent, int num_lines, int num_samps, short *solar_zenith, short *solar_azimuth,
+    short *sat_zenith, short *sat_azimuth);
 
 /**************************************************************************
 NAME: l8_per_pixel_angles
@@ -43,6 +74,13 @@ NOTES:
   3. It will be up to the calling routine to delete the memory allocated
      for these per band angle arrays.
   4. The angles that are returned are in degrees and have been scaled by 100.
+  5. The bands are split into blocks of L8_ANGLE_BLOCK_LINES output lines,
+     and the blocks are processed concurrently by nthreads threads when
+     OpenMP is enabled.  Each pixel only depends on the read-only angle
+     metadata, so the results don't depend on the number of threads.
+  6. If interp has a grid_step larger than 1, the angles are computed exactly
+     on a grid every grid_step output pixels and interpolated to the other
+     pixels, within interp->max_error degrees.  See angles_interp_block.
 ***************************************************************************/
 int l8_per_pixel_angles
 (
@@ -51,6 +89,10 @@ int l8_per_pixel_angles
                                   angles (1=full resolution). OW take every Nth
                                   sample from the line, where N=subsamp_fact */
     short fill_pix_value,   /* I: Fill pixel value to use (-32768:32767) */
+    int nthreads,           /* I: Number of threads to use for computing the
+                                  angles */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
     char *band_list,        /* I: Band list used to calculate angles for.
                                   "ALL" - defaults to all bands 1 - 11.
                                   Must be comma separated with no spaces in
@@ -81,18 +123,20 @@ int l8_per_pixel_angles
 )
 {
     int band_index;                   /* Metadata band index */
-    int sub_sample;                   /* Subsampling factor */
-    int num_lines;                    /* Lines in output angle band */
-    int num_samps;                    /* Samps in output angle band */
+    int i;                            /* Block index */
+    int nblocks;                      /* Number of line blocks to process */
+    int status = SUCCESS;             /* Status of the block processing */
+    int curr_status;                  /* Status seen by the current thread */
     size_t angle_size;                /* Malloc angle size */
+    ANGLE_TYPE angle_type;            /* Type of angles to generate */
     L8_ANGLES_PARAMETERS parameters;  /* Parameters read in from file */
     IAS_ANGLE_GEN_METADATA metadata;  /* Angle metadata structure */ 
-    char root_filename[PATH_MAX];     /* Root filename */
-    char *base_ptr;                   /* Basename pointer */
-    double r2d = 4500.0 / atan(1.0);  /* Conversion to hundredths of degrees;
-                                         this includes the conversion of radians
-                                         to degrees in addition to scaling by
-                                         100.0 */
+    IAS_MISC_LINE_EXTENT *trim_lut[IAS_MAX_NBANDS]; /* Image trim lookup
+                                         tables, one per band */
+    ANGLES_EXTENT *extent[IAS_MAX_NBANDS]; /* Valid output samples of each
+                                         output line, one per band; only used
+                                         when interpolating */
+    L8_ANGLE_BLOCK *blocks = NULL;    /* Line blocks to be processed */
 
     /* Make sure there is something to process */
     if (solar_zenith == NULL && solar_azimuth == NULL &&
@@ -103,131 +147,50 @@ int l8_per_pixel_angles
         return ERROR;
     }
 
-    /* Initialize the logging library */
-    if (ias_log_initialize("L8 Angles") != SUCCESS)
-    {
-        IAS_LOG_ERROR("Error initializing logging library");
-        return ERROR;
-    }
-
-    /* Initialize the satellite attributes */
-    if (ias_sat_attr_initialize(IAS_L8) != SUCCESS)
-    {
-        IAS_LOG_ERROR("Initializing satellite attributes library");
-        return ERROR;
-    }
-
-    /* Process the arguments */
-    if (process_parameters(angle_coeff_name, subsamp_fact, fill_pix_value,
-        band_list, &parameters) != SUCCESS)
-    {
-        IAS_LOG_ERROR("Invalid input parameters");
-        return ERROR;
-    }
-
-    /* Setup local sub sampling factor variable */
-    sub_sample = parameters.sub_sample_factor;
-
-    /* Read the metadata file */
-    if (ias_angle_gen_read_ang(parameters.metadata_filename, &metadata) 
-        != SUCCESS)
-    {
-        IAS_LOG_ERROR("Reading the metadata file %s", 
-            parameters.metadata_filename);
-        return ERROR;
-    }
-
-    /* Extract the basename from the file path */
-    base_ptr = strrchr(parameters.metadata_filename, '/');
-    if (base_ptr)
-    {
-        base_ptr++; /* Move past the the last forward slash */
-    }
-    else
-    {
-        base_ptr = parameters.metadata_filename;
-    }
-
-    /* Check that the base buffer won't overflow the target buffer */
-    if ((strlen(base_ptr) * sizeof(char)) > sizeof(root_filename))
-    {
-        IAS_LOG_ERROR("Angle coefficient filename too long");
-        return ERROR;
-    }
-    strcpy(root_filename, base_ptr);
-
-    /* Strip off the extension */
-    base_ptr = strrchr(root_filename, '.');
-    if (base_ptr)
-    {
-        *base_ptr = '\0'; /* Strip off the '.' by putting ending char */
-    }
-
-    /* Extract the root file name */
-    base_ptr = strrchr(root_filename, '_');
-    if (base_ptr)
-    {
-        *base_ptr = '\0'; /* Strip off the '_' by putting ending char */
-    }
+    /* Use at least one thread */
+    if (nthreads < 1)
+        nthreads = 1;
 
     /* Use the solar_azimuth, solar_zenith, sat_azimuth, sat_zenith arrays to
-       determine the parameters.angle_type.  If either one of the azimuth or
-       zenith angles are specified, then turn that angle type on. */
-    parameters.angle_type = AT_UNKNOWN;
+       determine the angle type.  If either one of the azimuth or zenith
+       angles are specified, then turn that angle type on. */
+    angle_type = AT_UNKNOWN;
     if (solar_azimuth || solar_zenith)
     {
         if (sat_azimuth || sat_zenith)
-            parameters.angle_type = AT_BOTH;
+            angle_type = AT_BOTH;
         else
-            parameters.angle_type = AT_SOLAR;
+            angle_type = AT_SOLAR;
     }
     else if (sat_azimuth || sat_zenith)
-        parameters.angle_type = AT_SATELLITE;
+        angle_type = AT_SATELLITE;
+
+    /* Read the metadata and set up the frame and trim lookup table of each
+       band to be processed */
+    if (setup_angle_bands(angle_coeff_name, subsamp_fact, fill_pix_value,
+        interp, band_list, angle_type, &parameters, &metadata, frame,
+        trim_lut, extent, nlines, nsamps) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Setting up the bands to be processed");
+        return ERROR;
+    }
 
-    /* Process the angles for each band */
+    /* Allocate the output buffers of each band.  This is done serially up
+       front so the angle computations below can be spread across the bands
+       and line blocks. */
+    nblocks = 0;
     for (band_index = 0; band_index < IAS_MAX_NBANDS; band_index++)
     {
-        int line;                       /* Line index */
-        int samp;                       /* Sample index */
-        int index;                      /* Current sample index*/
-        int tmp_percent;                /* Current percentage for printing
-                                           status */
-        int curr_tmp_percent;           /* Percentage for current line */
-        IAS_MISC_LINE_EXTENT *trim_lut; /* Image trim lookup table */
         int band_number;                /* Band number */ 
 
-        /* Retrieve the band number for current index */
-        band_number = ias_sat_attr_convert_band_index_to_number(band_index);
-        if (band_number == ERROR)
-        {
-            IAS_LOG_ERROR("Getting band number for band index %d", band_index);
-            ias_angle_gen_free(&metadata);
-            return ERROR;
-        }
-
-        /* Check if this band should be processed */
-        if (!parameters.process_band[band_index])
+        /* Skip the bands which aren't processed */
+        if (!trim_lut[band_index])
             continue;
-
-        /* Get framing information for this band if return is not successful
-           then band is not present in metadata so continue */
-        if (get_frame(&metadata, band_index, &frame[band_index]) != SUCCESS)
-        {
-            IAS_LOG_WARNING("Band not present in metadata for band number %d",
-                band_number);
-            continue;
-        }
-
-        /* Calculate size of subsampled output image */
-        num_lines = (frame[band_index].num_lines - 1) / sub_sample + 1;
-        num_samps = (frame[band_index].num_samps - 1) / sub_sample + 1;
-        IAS_LOG_INFO("Processing band number %d using %d as subsampling "
-            "factor", band_number, sub_sample);
+        band_number = frame[band_index].band_number;
 
         /* Calculate the angle sizes */
-        nlines[band_index] = num_lines;
-        nsamps[band_index] = num_samps;
-        angle_size = num_lines * num_samps * sizeof(short);
+        angle_size = (size_t) nlines[band_index] * nsamps[band_index]
+            * sizeof(short);
 
         /* Allocate the satellite buffers if needed */
         if (sat_zenith != NULL)
@@ -237,6 +200,7 @@ int l8_per_pixel_angles
             {
                 IAS_LOG_ERROR("Allocating satellite zenith angle array for "
                     "band number %d", band_number);
+                free_trim_luts(trim_lut, extent);
                 ias_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -249,6 +213,7 @@ int l8_per_pixel_angles
             {
                 IAS_LOG_ERROR("Allocating satellite azimuth angle array for "
                     "band number %d", band_number);
+                free_trim_luts(trim_lut, extent);
                 ias_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -262,6 +227,7 @@ int l8_per_pixel_angles
             {
                 IAS_LOG_ERROR("Allocating solar zenith angle array for band "
                     "number %d", band_number);
+                free_trim_luts(trim_lut, extent);
                 ias_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -274,135 +240,95 @@ int l8_per_pixel_angles
             {
                 IAS_LOG_ERROR("Allocating solar azimuth angle array for band "
                     "number %d", band_number);
+                free_trim_luts(trim_lut, extent);
                 ias_angle_gen_free(&metadata);
                 return ERROR;
             }
         }
 
-        /* Retrieve the trim look up table to remove the scene crenulation */
-        trim_lut = ias_misc_create_output_image_trim_lut(
-            get_active_lines(&metadata, band_index), 
-            get_active_samples(&metadata, band_index),
-            frame[band_index].num_lines, frame[band_index].num_samps);
-        if (!trim_lut)
-        {
-            IAS_LOG_ERROR("Creating the scene trim lookup table for band "
-                "number %d", band_number);
-            ias_angle_gen_free(&metadata);
-            return ERROR;
-        }
+        nblocks += (nlines[band_index] + L8_ANGLE_BLOCK_LINES - 1)
+            / L8_ANGLE_BLOCK_LINES;
+    }  /* for band */
 
-        /* Loop through the L1T lines and samples, and just fill everything
-           with fill. */
-        if (sat_zenith)
-        {
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    sat_zenith[band_index][index] = parameters.background;
-        }
+    /* Break the bands up into blocks of output lines.  These are the units
+       of work handed out to the threads. */
+    blocks = malloc(nblocks * sizeof(L8_ANGLE_BLOCK));
+    if (nblocks > 0 && !blocks)
+    {
+        IAS_LOG_ERROR("Allocating the list of angle line blocks");
+        free_trim_luts(trim_lut, extent);
+        ias_angle_gen_free(&metadata);
+        return ERROR;
+    }
 
-        if (sat_azimuth)
-        {
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    sat_azimuth[band_index][index] = parameters.background;
-        }
+    for (band_index = 0, i = 0; band_index < IAS_MAX_NBANDS; band_index++)
+    {
+        int line;                       /* Output line index */
 
-        if (solar_zenith)
-        {
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    solar_zenith[band_index][index] = parameters.background;
-        }
+        if (!trim_lut[band_index])
+            continue;
 
-        if (solar_azimuth)
+        for (line = 0; line < nlines[band_index];
+             line += L8_ANGLE_BLOCK_LINES, i++)
         {
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    solar_azimuth[band_index][index] =
-                        parameters.background;
+            blocks[i].band_index = band_index;
+            blocks[i].start_line = line;
+            blocks[i].end_line = line + L8_ANGLE_BLOCK_LINES;
+            if (blocks[i].end_line > nlines[band_index])
+                blocks[i].end_line = nlines[band_index];
+            blocks[i].buffer_line = 0;
         }
+    }
 
-        /* Loop through the L1T lines and samples */
-        tmp_percent = 0;
-        for (line = 0, index = 0; line < frame[band_index].num_lines;
-             line += sub_sample)
-        {
-            double sun_angles[2];   /* Solar angles */
-            double sat_angles[2];   /* Viewing angles */
-
-            /* update status? */
-            curr_tmp_percent = 100 * line / frame[band_index].num_lines;
-            if (curr_tmp_percent > tmp_percent)
-            {
-                tmp_percent = curr_tmp_percent;
-                if (tmp_percent % 100 == 0)
-                {
-                    printf ("%d%% ", tmp_percent);
-                    fflush (stdout);
-                }
-            }
+    /* Compute the angles for each block.  The metadata and trim tables are
+       read-only here and each block writes its own lines of the output
+       arrays, so the blocks are independent.  Once a block fails the
+       remaining blocks are skipped. */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic) num_threads (nthreads) \
+        private (curr_status)
+#endif
+    for (i = 0; i < nblocks; i++)
+    {
+        int bi = blocks[i].band_index;  /* Band index for this block */
 
-            for (samp = 0; samp < frame[band_index].num_samps;
-                 samp += sub_sample, index++)
-            {
-                /* If the current sample falls outside the actual range of
-                   image data in this scene, then goto the next pixel.  Fill
-                   pixels are already handled. */
-                if (samp <= trim_lut[line].start_sample || 
-                    samp >= trim_lut[line].end_sample)
-                {
-                    continue;
-                }
+#ifdef _OPENMP
+        #pragma omp atomic read
+#endif
+        curr_status = status;
+        if (curr_status != SUCCESS)
+            continue;
 
-                /* Calculate the satellite and solar azimuth and zenith */
-                if (calculate_angles (&metadata, line, samp, band_index, 
-                    parameters.angle_type, sat_angles, sun_angles) != SUCCESS)
-                {
-                    IAS_LOG_ERROR("Evaluating angles in band %d", band_number);
-                    free(trim_lut);
-                    ias_angle_gen_free(&metadata);
-                    return ERROR;
-                }
+        if (calculate_angle_block(&metadata, &parameters, &blocks[i],
+            &frame[bi], trim_lut[bi], extent[bi], nlines[bi], nsamps[bi],
+            solar_zenith ? solar_zenith[bi] : NULL,
+            solar_azimuth ? solar_azimuth[bi] : NULL,
+            sat_zenith ? sat_zenith[bi] : NULL,
+            sat_azimuth ? sat_azimuth[bi] : NULL) != SUCCESS)
+        {
+            IAS_LOG_ERROR("Evaluating angles in band number %d",
+                frame[bi].band_number);
+#ifdef _OPENMP
+            #pragma omp atomic write
+#endif
+            status = ERROR;
+        }
+    }
 
-                /* Quantize the angles by converting from radians to degrees 
-                   and scaling by a factor of 100 so it can be stored in the
-                   short integer image */
-                if (sat_azimuth)
-                    sat_azimuth[band_index][index] = (short) round (r2d *
-                        sat_angles[IAS_ANGLE_GEN_AZIMUTH_INDEX]);
-                if (sat_zenith)
-                    sat_zenith[band_index][index] = (short) round (r2d *
-                        sat_angles[IAS_ANGLE_GEN_ZENITH_INDEX]);
-                if (solar_azimuth)
-                    solar_azimuth[band_index][index] = (short) round (r2d *
-                        sun_angles[IAS_ANGLE_GEN_AZIMUTH_INDEX]);
-                if (solar_zenith)
-                    solar_zenith[band_index][index] = (short) round (r2d *
-                        sun_angles[IAS_ANGLE_GEN_ZENITH_INDEX]);
-            }  /* for samp */
-        }  /* for line */
-
-        /* update status */
-        printf ("100%%\n");
-        fflush (stdout);
-
-        /* Free the lookup table */
-        free(trim_lut);
-        trim_lut = NULL;
-    }  /* for band */
+    /* Free the lookup tables and the block list */
+    free(blocks);
+    free_trim_luts(trim_lut, extent);
 
     /* Release the metadata */
     ias_angle_gen_free(&metadata);
 
+    if (status != SUCCESS)
+        return ERROR;
+
+    /* update status */
+    printf ("100%%\n");
+    fflush (stdout);
+
     return SUCCESS;
 }
 
@@ -433,6 +359,10 @@ NOTES:
   3. It will be up to the calling routine to delete the memory allocated
      for this reflectance band average angle array.
   4. The angles that are returned are in degrees and have been scaled by 100.
+  5. The averages are generated by l8_per_pixel_avg_refl_angles_stream and
+     copied into the returned arrays, so only the average bands are held in
+     memory.  Callers which write the averages out should use the streaming
+     routine directly.
 ***************************************************************************/
 int l8_per_pixel_avg_refl_angles
 (
@@ -442,6 +372,10 @@ int l8_per_pixel_avg_refl_angles
                                     Nth sample from the line, where
                                     N=subsamp_fact */
     short fill_pix_value,     /* I: Fill pixel value to use (-32768:32767) */
+    int nthreads,             /* I: Number of threads to use for computing the
+                                    angles */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                    NULL computes every pixel exactly */
     ANGLES_FRAME *avg_frame,  /* O: Image frame info for the scene */
     short **avg_solar_zenith, /* O: Addr of pointer for the average solar zenith
                                     angle array (if NULL, don't process),
@@ -461,292 +395,972 @@ int l8_per_pixel_avg_refl_angles
                                     the subsample factor */
 )
 {
-    int band_index;                   /* band index */
-    int sub_sample;                   /* subsampling factor */
-    int line;                         /* line index */
-    int samp;                         /* sample index */
-    int index;                        /* current sample index */
-    int angle_size;                   /* memory alloc angle size */
-    ushort *pix_count = NULL;         /* array to carry the count of the
-                                         non-zero pixels used for the sum */
-    long *sum = NULL;                 /* array to carry the sum of the angles
-                                         for all the bands */
-    ANGLES_FRAME frame[L8_NBANDS];    /* image frame info for each band */
-    short *solar_zenith[L8_NBANDS];   /* array of pointers for the solar zenith
-                                         angle array, one per reflectance band.
-                                         Degrees scaled by 100 */
-    short *solar_azimuth[L8_NBANDS];  /* array of pointers for the solar
-                                         azimuth angle array, one per
-                                         reflectance band. Degrees scaled by
-                                         100 */
-    short *sat_zenith[L8_NBANDS];     /* array of pointers for the satellite
-                                         zenith angle array, one per
-                                         reflectance band. Degrees scaled by
-                                         100 */
-    short *sat_azimuth[L8_NBANDS];    /* array of pointers for the satellite
-                                         azimuth angle array, one per
-                                         reflectance band. Degrees scaled by
-                                         100 */
-    char refl_band_list[] = "1,2,3,4,5,6,7,9"; /* list of reflectance bands to
-                                         be used in the average */
-    bool process_band[L8_NBANDS] = {true, true, true, true, true, true, true,
-        false /* pan */, true, false /* band 10 */, false /* band 11 */};
-                                         /* which bands will be processed as
-                                            the average of reflectance bands */
-    int nlines[L8_NBANDS];  /* number of lines for each band, based on the
-                               subsample factor */
-    int nsamps[L8_NBANDS];  /* number of samples for each band, based on the
-                               subsample factor */
-
-    /* Create the Landsat 8 angle bands for the reflectance bands.  Create a
-       sub_sample product with a fill value of -9999 to match the Landsat 8
-       image data.  This call also allocates memory for the solar angles and
-       satellite/view angles for the reflectance band list. */
-    sub_sample = subsamp_fact;
-    if (l8_per_pixel_angles (angle_coeff_name, sub_sample, -9999,
-        refl_band_list, frame, solar_zenith, solar_azimuth, sat_zenith,
-        sat_azimuth, nlines, nsamps) != SUCCESS)
-    {  /* Error messages already written */
-        IAS_LOG_ERROR("Creating the per-pixel angles for the reflective bands");
+    int f;                            /* Field index */
+    ANGLE_TYPE angle_type;            /* Type of angles to generate */
+    L8_AVG_ANGLES_COPY copy;          /* Arrays receiving the averages */
+
+    copy.avg[ANGLES_SAT_ZENITH] = avg_sat_zenith;
+    copy.avg[ANGLES_SAT_AZIMUTH] = avg_sat_azimuth;
+    copy.avg[ANGLES_SUN_ZENITH] = avg_solar_zenith;
+    copy.avg[ANGLES_SUN_AZIMUTH] = avg_solar_azimuth;
+    for (f = 0; f < ANGLES_NFIELDS; f++)
+    {
+        if (copy.avg[f])
+            *copy.avg[f] = NULL;
+    }
+
+    /* Determine the angle type from the requested averages */
+    if (avg_solar_zenith || avg_solar_azimuth)
+    {
+        if (avg_sat_zenith || avg_sat_azimuth)
+            angle_type = AT_BOTH;
+        else
+            angle_type = AT_SOLAR;
+    }
+    else if (avg_sat_zenith || avg_sat_azimuth)
+        angle_type = AT_SATELLITE;
+    else
+    {
+        IAS_LOG_ERROR("Solar and Satellite zenith/azimuth average pointers "
+            "are NULL. Nothing to process.");
         return ERROR;
     }
 
-    /* Allocate memory for the angle bands.  Just use the first band (band 1)
-       for the size of the band. */
-    angle_size = nlines[0] * nsamps[0];
-    if (avg_solar_zenith != NULL)
+    if (l8_per_pixel_avg_refl_angles_stream (angle_coeff_name, subsamp_fact,
+        fill_pix_value, nthreads, interp, angle_type, copy_avg_block, &copy,
+        avg_frame, avg_nlines, avg_nsamps) != SUCCESS)
     {
-        *avg_solar_zenith = calloc (angle_size, sizeof (short));
-        if (*avg_solar_zenith == NULL)
+        IAS_LOG_ERROR("Creating the average per-pixel angles for the "
+            "reflective bands");
+        for (f = 0; f < ANGLES_NFIELDS; f++)
         {
-            IAS_LOG_ERROR("Allocating average solar zenith angle array");
-            return ERROR;
+            if (copy.avg[f])
+            {
+                free (*copy.avg[f]);
+                *copy.avg[f] = NULL;
+            }
         }
+        return ERROR;
     }
 
-    if (avg_solar_azimuth != NULL)
+    return SUCCESS;
+}
+
+/**************************************************************************
+NAME: l8_per_pixel_avg_refl_angles_stream
+
+PURPOSE:   Uses the coefficients in the angle coefficients file to generate
+the satellite viewing angle and/or solar angle values for the reflective
+bands, and passes the per-pixel average of the reflective bands to
+write_block a block of lines at a time.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           An error occurred generating the per-pixel solar and/or
+                view angles, or write_block failed
+SUCCESS         Angle band generation was successful
+
+NOTES:
+  1. The angles of all the reflective bands are computed for a chunk of
+     output lines, averaged, and handed to write_block before moving on to
+     the next chunk.  Only one chunk of the band angles and averages is held
+     in memory, rather than full size arrays for every reflective band.
+  2. A chunk holds enough L8_ANGLE_BLOCK_LINES blocks of each reflective
+     band to keep nthreads threads busy.  The blocks of a chunk are computed
+     concurrently when OpenMP is enabled.
+  3. Zero angles occur on the scene edges and are left out of the average,
+     as are fill angles.  Pixels without any band angles to average are set
+     to fill_pix_value.
+  4. The reflective bands are expected to be the same size.  The angles are
+     generated with a fill value of -9999 to match the Landsat 8 image data.
+  5. The angles that are returned are in degrees and have been scaled by 100.
+***************************************************************************/
+int l8_per_pixel_avg_refl_angles_stream
+(
+    char *angle_coeff_name, /* I: Angle coefficient filename */
+    int subsamp_fact,       /* I: Subsample factor used when calculating the
+                                  angles (1=full resolution). OW take every Nth
+                                  sample from the line, where N=subsamp_fact */
+    short fill_pix_value,   /* I: Fill pixel value to use (-32768:32767) */
+    int nthreads,           /* I: Number of threads to use for computing the
+                                  angles */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
+    ANGLE_TYPE angle_type,  /* I: Type of angles to generate */
+    L8_AVG_ANGLES_WRITER write_block, /* I: Routine receiving each block of
+                                  the average angles */
+    void *write_data,       /* I: Data passed to write_block */
+    ANGLES_FRAME *avg_frame,/* O: Image frame info for the scene */
+    int *avg_nlines,        /* O: Number of lines for the bands, based on the
+                                  subsample factor */
+    int *avg_nsamps         /* O: Number of samples for the bands, based on
+                                  the subsample factor */
+)
+{
+    int band_index;                   /* Metadata band index */
+    int num_lines = 0;                /* Lines in the average band */
+    int num_samps = 0;                /* Samples in the average band */
+    int nrefl = 0;                    /* Number of bands being averaged */
+    int nfields = 0;                  /* Number of fields generated */
+    int chunk_blocks;                 /* Blocks of each band in a chunk */
+    int chunk_lines;                  /* Output lines in a chunk */
+    int nblocks;                      /* Number of blocks in the chunk */
+    int start_line;                   /* First output line of the chunk */
+    int end_line;                     /* Last output line of the chunk + 1 */
+    int i;                            /* Block index */
+    int f;                            /* Field index */
+    int status = SUCCESS;             /* Status of the processing */
+    int curr_status;                  /* Status seen by the current thread */
+    int refl_index[L8_NBANDS];        /* Band index of each averaged band */
+    int field_slot[ANGLES_NFIELDS];   /* Buffer slot of each field, or -1 */
+    size_t chunk_size;                /* Pixels in a chunk of one band */
+    short *band_buf = NULL;           /* Chunk of angles for each averaged
+                                         band and field */
+    short *avg_buf = NULL;            /* Chunk of averages for each field */
+    short *avg[ANGLES_NFIELDS];       /* Chunk of averages for each field, or
+                                         NULL if not generated */
+    L8_ANGLE_BLOCK *blocks = NULL;    /* Line blocks of the chunk */
+    L8_ANGLES_PARAMETERS parameters;  /* Parameters read in from file */
+    IAS_ANGLE_GEN_METADATA metadata;  /* Angle metadata structure */ 
+    IAS_MISC_LINE_EXTENT *trim_lut[IAS_MAX_NBANDS]; /* Image trim lookup
+                                         tables, one per band */
+    ANGLES_EXTENT *extent[IAS_MAX_NBANDS]; /* Valid output samples of each
+                                         output line, one per band; only used
+                                         when interpolating */
+    ANGLES_FRAME frame[L8_NBANDS];    /* image frame info for each band */
+    int nlines[L8_NBANDS];            /* number of lines for each band */
+    int nsamps[L8_NBANDS];            /* number of samples for each band */
+    char refl_band_list[] = "1,2,3,4,5,6,7,9"; /* list of reflectance bands to
+                                         be used in the average */
+
+    /* Determine the fields to generate */
+    if (angle_type != AT_BOTH && angle_type != AT_SATELLITE
+        && angle_type != AT_SOLAR)
+    {
+        IAS_LOG_ERROR("Invalid angle type %d for the band average",
+            angle_type);
+        return ERROR;
+    }
+    for (f = 0; f < ANGLES_NFIELDS; f++)
     {
-        *avg_solar_azimuth = calloc (angle_size, sizeof (short));
-        if (*avg_solar_azimuth == NULL)
+        bool sat_field = (f == ANGLES_SAT_ZENITH || f == ANGLES_SAT_AZIMUTH);
+
+        field_slot[f] = -1;
+        if (angle_type == AT_BOTH
+            || (angle_type == AT_SATELLITE && sat_field)
+            || (angle_type == AT_SOLAR && !sat_field))
         {
-            IAS_LOG_ERROR("Allocating average solar azimuth angle array");
-            return ERROR;
+            field_slot[f] = nfields++;
         }
     }
 
-    if (avg_sat_zenith != NULL)
+    /* Use at least one thread */
+    if (nthreads < 1)
+        nthreads = 1;
+
+    /* Set up the reflectance bands.  Create the angles with a fill value of
+       -9999 to match the Landsat 8 image data. */
+    if (setup_angle_bands(angle_coeff_name, subsamp_fact, L8_AVG_BAND_FILL,
+        interp, refl_band_list, angle_type, &parameters, &metadata, frame,
+        trim_lut, extent, nlines, nsamps) != SUCCESS)
     {
-        *avg_sat_zenith = calloc (angle_size, sizeof (short));
-        if (*avg_sat_zenith == NULL)
-        {
-            IAS_LOG_ERROR("Allocating average satellite zenith angle array");
-            return ERROR;
-        }
+        IAS_LOG_ERROR("Setting up the reflective bands to be averaged");
+        return ERROR;
     }
 
-    if (avg_sat_azimuth != NULL)
+    /* The average is the size of the first reflective band, and the other
+       bands have to match it */
+    for (band_index = 0; band_index < IAS_MAX_NBANDS; band_index++)
     {
-        *avg_sat_azimuth = calloc (angle_size, sizeof (short));
-        if (*avg_sat_azimuth == NULL)
+        if (!trim_lut[band_index])
+            continue;
+
+        if (nrefl == 0)
+        {
+            num_lines = nlines[band_index];
+            num_samps = nsamps[band_index];
+            *avg_frame = frame[band_index];
+        }
+        else if (nlines[band_index] != num_lines
+            || nsamps[band_index] != num_samps)
         {
-            IAS_LOG_ERROR("Allocating average satellite azimuth angle array");
+            IAS_LOG_ERROR("Band number %d is not the same size as band number "
+                "%d and can't be averaged", frame[band_index].band_number,
+                avg_frame->band_number);
+            free_trim_luts(trim_lut, extent);
+            ias_angle_gen_free(&metadata);
             return ERROR;
         }
+        refl_index[nrefl++] = band_index;
     }
-
-    /* Allocate memory to hold the sum of the angles from all the bands.
-       Just use the first band (band 1) for the size of the band.  Also keep
-       an array for counting the non-zero pixels in the sum which will be used
-       to compute the average. */
-    angle_size = nlines[0] * nsamps[0];
-    sum = calloc (angle_size, sizeof (long));
-    if (sum == NULL)
+    if (nrefl == 0)
     {
-        IAS_LOG_ERROR("Allocating array for holding the sum of the bands");
+        IAS_LOG_ERROR("None of the reflective bands are present in the "
+            "metadata");
+        free_trim_luts(trim_lut, extent);
+        ias_angle_gen_free(&metadata);
         return ERROR;
     }
 
-    pix_count = calloc (angle_size, sizeof (ushort));
-    if (pix_count == NULL)
+    /* Size the chunks so each thread has a block to work on */
+    chunk_blocks = (nthreads + nrefl - 1) / nrefl;
+    chunk_lines = chunk_blocks * L8_ANGLE_BLOCK_LINES;
+    if (chunk_lines > num_lines)
+        chunk_lines = num_lines;
+    chunk_size = (size_t) chunk_lines * num_samps;
+
+    /* Allocate the chunk buffers */
+    band_buf = malloc((size_t) nrefl * nfields * chunk_size * sizeof(short));
+    avg_buf = malloc((size_t) nfields * chunk_size * sizeof(short));
+    blocks = malloc(nrefl * chunk_blocks * sizeof(L8_ANGLE_BLOCK));
+    if (!band_buf || !avg_buf || !blocks)
     {
-        IAS_LOG_ERROR("Allocating array for holding the pixel count");
+        IAS_LOG_ERROR("Allocating the band average chunk buffers");
+        free(band_buf);
+        free(avg_buf);
+        free(blocks);
+        free_trim_luts(trim_lut, extent);
+        ias_angle_gen_free(&metadata);
         return ERROR;
     }
+    for (f = 0; f < ANGLES_NFIELDS; f++)
+    {
+        if (field_slot[f] < 0)
+            avg[f] = NULL;
+        else
+            avg[f] = &avg_buf[field_slot[f] * chunk_size];
+    }
 
-    if (avg_sat_zenith != NULL)
+    for (start_line = 0; status == SUCCESS && start_line < num_lines;
+         start_line = end_line)
     {
-        /* Loop through the reflectance bands and compute the average of these
-           bands. Some of the pixels on the scene edge will be zero and throws
-           off the average, so don't count the zero values. */
-        printf ("Computing average for satellite zenith ...\n");
-        for (band_index = 0; band_index < L8_NBANDS; band_index++)
+        int line;                     /* Output line index */
+        int band_blocks;              /* Blocks of each band in this chunk */
+        size_t chunk_pixels;          /* Pixels in this chunk of one band */
+
+        end_line = start_line + chunk_lines;
+        if (end_line > num_lines)
+            end_line = num_lines;
+        chunk_pixels = (size_t) (end_line - start_line) * num_samps;
+
+        /* Break the chunk of each band up into blocks, ordered by band */
+        nblocks = 0;
+        for (i = 0; i < nrefl; i++)
+        {
+            for (line = start_line; line < end_line;
+                 line += L8_ANGLE_BLOCK_LINES, nblocks++)
+            {
+                blocks[nblocks].band_index = refl_index[i];
+                blocks[nblocks].start_line = line;
+                blocks[nblocks].end_line = line + L8_ANGLE_BLOCK_LINES;
+                if (blocks[nblocks].end_line > end_line)
+                    blocks[nblocks].end_line = end_line;
+                blocks[nblocks].buffer_line = start_line;
+            }
+        }
+        band_blocks = nblocks / nrefl;
+
+        /* Compute the angles of each block into the chunk of its band */
+#ifdef _OPENMP
+        #pragma omp parallel for schedule (dynamic) num_threads (nthreads) \
+            private (curr_status)
+#endif
+        for (i = 0; i < nblocks; i++)
+        {
+            int bi = blocks[i].band_index;  /* Band index for this block */
+            int refl = i / band_blocks;     /* Averaged band of the block */
+            short *out[ANGLES_NFIELDS];     /* Chunk of the band's angles */
+            int k;                          /* Field index */
+
+#ifdef _OPENMP
+            #pragma omp atomic read
+#endif
+            curr_status = status;
+            if (curr_status != SUCCESS)
+                continue;
+
+            for (k = 0; k < ANGLES_NFIELDS; k++)
+            {
+                if (field_slot[k] < 0)
+                    out[k] = NULL;
+                else
+                    out[k] = &band_buf[((size_t) refl * nfields
+                        + field_slot[k]) * chunk_size];
+            }
+
+            if (calculate_angle_block(&metadata, &parameters, &blocks[i],
+                &frame[bi], trim_lut[bi], extent[bi], nlines[bi], nsamps[bi],
+                out[ANGLES_SUN_ZENITH], out[ANGLES_SUN_AZIMUTH],
+                out[ANGLES_SAT_ZENITH], out[ANGLES_SAT_AZIMUTH]) != SUCCESS)
+            {
+                IAS_LOG_ERROR("Evaluating angles in band number %d",
+                    frame[bi].band_number);
+#ifdef _OPENMP
+                #pragma omp atomic write
+#endif
+                status = ERROR;
+            }
+        }
+        if (status != SUCCESS)
+            break;
+
+        /* Average the bands.  Skip values of 0 since they occur on the scene
+           edges and we don't want to count them, and skip fill.  Pixels with
+           nothing to average are fill. */
+        for (f = 0; f < ANGLES_NFIELDS; f++)
         {
-            /* Check if this band be added to the average */
-            if (!process_band[band_index])
+            size_t pix;               /* Pixel index in the chunk */
+
+            if (!avg[f])
                 continue;
 
-            /* Add this band to the sum.  Skip values of 0 since they occur on
-               the scene edges and we don't want to count them. */
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    if (sat_zenith[band_index][index] != 0)
+            for (pix = 0; pix < chunk_pixels; pix++)
+            {
+                long sum = 0;         /* Sum of the band angles */
+                int pix_count = 0;    /* Number of angles in the sum */
+
+                for (i = 0; i < nrefl; i++)
+                {
+                    short angle = band_buf[((size_t) i * nfields
+                        + field_slot[f]) * chunk_size + pix];
+
+                    if (angle != 0 && angle != L8_AVG_BAND_FILL
+                        && angle != fill_pix_value)
                     {
-                        sum[index] += sat_zenith[band_index][index];
-                        pix_count[index]++;
+                        sum += angle;
+                        pix_count++;
                     }
+                }
+                if (pix_count == 0)
+                    avg[f][pix] = fill_pix_value;
+                else
+                    avg[f][pix] = (short) (round ((float) sum / pix_count));
+            }
+        }
 
-            /* Release the memory */
-            free (sat_zenith[band_index]);
+        /* Hand the averages for the chunk off */
+        if ((*write_block)(write_data, num_lines, num_samps, start_line,
+            end_line, avg) != SUCCESS)
+        {
+            IAS_LOG_ERROR("Writing the band average for output lines %d to %d",
+                start_line, end_line - 1);
+            status = ERROR;
         }
+    }
+
+    /* Free the chunk buffers and the lookup tables */
+    free(band_buf);
+    free(avg_buf);
+    free(blocks);
+    free_trim_luts(trim_lut, extent);
+
+    /* Release the metadata */
+    ias_angle_gen_free(&metadata);
+
+    if (status != SUCCESS)
+        return ERROR;
+
+    *avg_nlines = num_lines;
+    *avg_nsamps = num_samps;
+
+    /* update status */
+    printf ("100%%\n");
+    fflush (stdout);
+
+    return SUCCESS;
+}
+
+/******************************************************************************
+NAME: setup_angle_bands
+
+PURPOSE: Processes the parameters, reads the angle metadata, and sets up the
+frame, output size, and trim lookup table of each band to be processed.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The bands were successfully set up
+    ERROR     An error occurred setting up the bands
+
+NOTES:
+  1. On success the caller is responsible for releasing the metadata with
+     ias_angle_gen_free and the lookup tables with free_trim_luts.  On error
+     they have already been released.
+  2. The trim lookup table of the bands which aren't processed, or aren't
+     present in the metadata, is left NULL.
+******************************************************************************/
+static int setup_angle_bands
+(
+    char *angle_coeff_name, /* I: Angle coefficient filename */
+    int subsamp_fact,       /* I: Subsample factor */
+    short fill_pix_value,   /* I: Fill pixel value to use */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
+    char *band_list,        /* I: Band list used to calculate angles for */
+    ANGLE_TYPE angle_type,  /* I: Type of angles to generate */
+    L8_ANGLES_PARAMETERS *parameters, /* O: Generation parameters */
+    IAS_ANGLE_GEN_METADATA *metadata, /* O: Angle metadata structure */
+    ANGLES_FRAME frame[L8_NBANDS], /* O: Image frame info for each band */
+    IAS_MISC_LINE_EXTENT *trim_lut[IAS_MAX_NBANDS], /* O: Trim lookup tables,
+                                                          one per band */
+    ANGLES_EXTENT *extent[IAS_MAX_NBANDS], /* O: Output extents, one per band;
+                                                only set when interpolating */
+    int nlines[L8_NBANDS],  /* O: Number of lines for each band */
+    int nsamps[L8_NBANDS]   /* O: Number of samples for each band */
+)
+{
+    int band_index;                   /* Metadata band index */
+    int sub_sample;                   /* Subsampling factor */
+    int num_lines;                    /* Lines in output angle band */
+    int num_samps;                    /* Samps in output angle band */
+    char root_filename[PATH_MAX];     /* Root filename */
+    char *base_ptr;                   /* Basename pointer */
 
-        /* Get the average */
-        band_index = 0;
-        for (line = 0, index = 0; line < frame[band_index].num_lines;
-             line += sub_sample)
-            for (samp = 0; samp < frame[band_index].num_samps;
-                 samp += sub_sample, index++)
-                (*avg_sat_zenith)[index] =
-                    (short) (round ((float) sum[index] / pix_count[index]));
+    for (band_index = 0; band_index < IAS_MAX_NBANDS; band_index++)
+    {
+        trim_lut[band_index] = NULL;
+        extent[band_index] = NULL;
     }
 
-    if (avg_sat_azimuth != NULL)
+    /* Initialize the logging library */
+    if (ias_log_initialize("L8 Angles") != SUCCESS)
     {
-        /* Clear the sum and pixel count arrays back to 0 */
-        memset (sum, 0, angle_size * sizeof (long));
-        memset (pix_count, 0, angle_size * sizeof (ushort));
+        IAS_LOG_ERROR("Error initializing logging library");
+        return ERROR;
+    }
 
-        /* Loop through the reflectance bands and compute the average of these
-           bands. Some of the pixels on the scene edge will be zero and throws
-           off the average, so don't count the zero values. */
-        printf ("Computing average for satellite azimuth ...\n");
-        for (band_index = 0; band_index < L8_NBANDS; band_index++)
-        {
-            /* Check if this band be added to the average */
-            if (!process_band[band_index])
-                continue;
+    /* Initialize the satellite attributes */
+    if (ias_sat_attr_initialize(IAS_L8) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Initializing satellite attributes library");
+        return ERROR;
+    }
 
-            /* Add this band to the sum */
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    if (sat_azimuth[band_index][index] != 0)
-                    {
-                        sum[index] += sat_azimuth[band_index][index];
-                        pix_count[index]++;
-                    }
+    /* Process the arguments */
+    if (process_parameters(angle_coeff_name, subsamp_fact, fill_pix_value,
+        band_list, parameters) != SUCCESS)
+    {
+        IAS_LOG_ERROR("Invalid input parameters");
+        return ERROR;
+    }
+    parameters->angle_type = angle_type;
 
-            /* Release the memory */
-            free (sat_azimuth[band_index]);
+    /* Setup local sub sampling factor variable */
+    sub_sample = parameters->sub_sample_factor;
+
+    /* Setup the interpolation controls; by default every pixel is computed */
+    parameters->interp.grid_step = 1;
+    parameters->interp.max_error = ANGLES_INTERP_DEFAULT_MAX_ERROR;
+    if (interp)
+        parameters->interp = *interp;
+    if (angles_interp_enabled(&parameters->interp))
+    {
+        if (parameters->interp.max_error <= 0.0)
+        {
+            IAS_LOG_ERROR("Maximum interpolation error must be positive");
+            return ERROR;
         }
+        IAS_LOG_INFO("Interpolating the angles from a grid every %d output "
+            "pixels with a maximum error of %g degrees",
+            parameters->interp.grid_step, parameters->interp.max_error);
+    }
 
-        /* Get the average */
-        band_index = 0;
-        for (line = 0, index = 0; line < frame[band_index].num_lines;
-             line += sub_sample)
-            for (samp = 0; samp < frame[band_index].num_samps;
-                 samp += sub_sample, index++)
-                (*avg_sat_azimuth)[index] =
-                    (short) (round ((float) sum[index] / pix_count[index]));
+    /* Read the metadata file */
+    if (ias_angle_gen_read_ang(parameters->metadata_filename, metadata) 
+        != SUCCESS)
+    {
+        IAS_LOG_ERROR("Reading the metadata file %s", 
+            parameters->metadata_filename);
+        return ERROR;
     }
 
-    if (avg_solar_zenith != NULL)
+    /* Extract the basename from the file path */
+    base_ptr = strrchr(parameters->metadata_filename, '/');
+    if (base_ptr)
     {
-        /* Clear the sum and pixel count arrays back to 0 */
-        memset (sum, 0, angle_size * sizeof (long));
-        memset (pix_count, 0, angle_size * sizeof (ushort));
+        base_ptr++; /* Move past the the last forward slash */
+    }
+    else
+    {
+        base_ptr = parameters->metadata_filename;
+    }
 
-        /* Loop through the reflectance bands and compute the average of these
-           bands. Some of the pixels on the scene edge will be zero and throws
-           off the average, so don't count the zero values. */
-        printf ("Computing average for solar zenith ...\n");
-        for (band_index = 0; band_index < L8_NBANDS; band_index++)
+    /* Check that the base buffer won't overflow the target buffer */
+    if ((strlen(base_ptr) * sizeof(char)) > sizeof(root_filename))
+    {
+        IAS_LOG_ERROR("Angle coefficient filename too long");
+        ias_angle_gen_free(metadata);
+        return ERROR;
+    }
+    strcpy(root_filename, base_ptr);
+
+    /* Strip off the extension */
+    base_ptr = strrchr(root_filename, '.');
+    if (base_ptr)
+    {
+        *base_ptr = '\0'; /* Strip off the '.' by putting ending char */
+    }
+
+    /* Extract the root file name */
+    base_ptr = strrchr(root_filename, '_');
+    if (base_ptr)
+    {
+        *base_ptr = '\0'; /* Strip off the '_' by putting ending char */
+    }
+
+    /* Set up each band to be processed: the frame, the output size, and the
+       trim lookup table */
+    for (band_index = 0; band_index < IAS_MAX_NBANDS; band_index++)
+    {
+        int band_number;                /* Band number */ 
+
+        /* Retrieve the band number for current index */
+        band_number = ias_sat_attr_convert_band_index_to_number(band_index);
+        if (band_number == ERROR)
         {
-            /* Check if this band be added to the average */
-            if (!process_band[band_index])
-                continue;
+            IAS_LOG_ERROR("Getting band number for band index %d", band_index);
+            free_trim_luts(trim_lut, extent);
+            ias_angle_gen_free(metadata);
+            return ERROR;
+        }
 
-            /* Add this band to the sum */
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    if (solar_zenith[band_index][index] != 0)
-                    {
-                        sum[index] += solar_zenith[band_index][index];
-                        pix_count[index]++;
-                    }
+        /* Check if this band should be processed */
+        if (!parameters->process_band[band_index])
+            continue;
 
-            /* Release the memory */
-            free (solar_zenith[band_index]);
+        /* Get framing information for this band if return is not successful
+           then band is not present in metadata so continue */
+        if (get_frame(metadata, band_index, &frame[band_index]) != SUCCESS)
+        {
+            IAS_LOG_WARNING("Band not present in metadata for band number %d",
+                band_number);
+            continue;
         }
 
-        /* Get the average */
-        band_index = 0;
-        for (line = 0, index = 0; line < frame[band_index].num_lines;
-             line += sub_sample)
-            for (samp = 0; samp < frame[band_index].num_samps;
-                 samp += sub_sample, index++)
+        /* Calculate size of subsampled output image */
+        num_lines = (frame[band_index].num_lines - 1) / sub_sample + 1;
+        num_samps = (frame[band_index].num_samps - 1) / sub_sample + 1;
+        IAS_LOG_INFO("Processing band number %d using %d as subsampling "
+            "factor", band_number, sub_sample);
+        nlines[band_index] = num_lines;
+        nsamps[band_index] = num_samps;
+
+        /* Retrieve the trim look up table to remove the scene crenulation */
+        trim_lut[band_index] = ias_misc_create_output_image_trim_lut(
+            get_active_lines(metadata, band_index), 
+            get_active_samples(metadata, band_index),
+            frame[band_index].num_lines, frame[band_index].num_samps);
+        if (!trim_lut[band_index])
+        {
+            IAS_LOG_ERROR("Creating the scene trim lookup table for band "
+                "number %d", band_number);
+            free_trim_luts(trim_lut, extent);
+            ias_angle_gen_free(metadata);
+            return ERROR;
+        }
+
+        /* Convert the trim lookup table to the valid output samples of each
+           output line for the interpolation */
+        if (angles_interp_enabled(&parameters->interp))
+        {
+            extent[band_index] = create_output_extent(trim_lut[band_index],
+                sub_sample, num_lines, num_samps);
+            if (!extent[band_index])
+            {
+                IAS_LOG_ERROR("Creating the output extent for band number %d",
+                    band_number);
+                free_trim_luts(trim_lut, extent);
+                ias_angle_gen_free(metadata);
+                return ERROR;
+            }
+        }
+    }  /* for band */
+
+    return SUCCESS;
+}
+
+/******************************************************************************
+NAME: copy_avg_block
+
+PURPOSE: Band average writer used by l8_per_pixel_avg_refl_angles.  Copies a
+block of the average angles into the full size average arrays, allocating
+them with the first block.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The block was successfully copied
+    ERROR     An error occurred allocating the average arrays
+******************************************************************************/
+static int copy_avg_block
+(
+    void *write_data,       /* I: L8_AVG_ANGLES_COPY with the average arrays */
+    int num_lines,          /* I: Number of lines in the average band */
+    int num_samps,          /* I: Number of samples in the average band */
+    int start_line,         /* I: First output line in the block */
+    int end_line,           /* I: Last output line in the block + 1 */
+    short *avg[ANGLES_NFIELDS] /* I: Average angles of the block */
+)
+{
+    L8_AVG_ANGLES_COPY *copy = write_data; /* Average arrays */
+    int f;                  /* Field index */
+
+    for (f = 0; f < ANGLES_NFIELDS; f++)
+    {
+        if (!copy->avg[f] || !avg[f])
+            continue;
+
+        if (!*copy->avg[f])
+        {
+            *copy->avg[f] = malloc((size_t) num_lines * num_samps
+                * sizeof(short));
+            if (!*copy->avg[f])
             {
-                (*avg_solar_zenith)[index] =
-                    (short) (round ((float) sum[index] / pix_count[index]));
+                IAS_LOG_ERROR("Allocating the average angle array");
+                return ERROR;
             }
+        }
+
+        memcpy(&(*copy->avg[f])[(size_t) start_line * num_samps], avg[f],
+            (size_t) (end_line - start_line) * num_samps * sizeof(short));
     }
 
-    if (avg_solar_azimuth != NULL)
+    return SUCCESS;
+}
+
+/******************************************************************************
+NAME: free_trim_luts
+
+PURPOSE: Frees the trim lookup tables and output extents for each band.
+
+RETURN VALUE: N/A
+******************************************************************************/
+static void free_trim_luts
+(
+    IAS_MISC_LINE_EXTENT *trim_lut[IAS_MAX_NBANDS], /* I/O: Trim lookup tables,
+                                                            one per band */
+    ANGLES_EXTENT *extent[IAS_MAX_NBANDS]  /* I/O: Output extents, one per
+                                                   band */
+)
+{
+    int band_index;   /* Band index */
+
+    for (band_index = 0; band_index < IAS_MAX_NBANDS; band_index++)
     {
-        /* Clear the sum and pixel count arrays back to 0 */
-        memset (sum, 0, angle_size * sizeof (long));
-        memset (pix_count, 0, angle_size * sizeof (ushort));
+        free(trim_lut[band_index]);
+        trim_lut[band_index] = NULL;
+        free(extent[band_index]);
+        extent[band_index] = NULL;
+    }
+}
+
+/******************************************************************************
+NAME: create_output_extent
+
+PURPOSE: Converts the trim lookup table, which holds the valid L1T samples of
+each L1T line, to the valid output samples of each output line.
+
+RETURN VALUE: Type = ANGLES_EXTENT *
+    Value     Description
+    -----     -----------
+    NULL      An error occurred allocating the extent
+    non-NULL  Array of num_lines output line extents
+******************************************************************************/
+static ANGLES_EXTENT *create_output_extent
+(
+    const IAS_MISC_LINE_EXTENT *trim_lut, /* I: Trim lookup table */
+    int sub_sample,         /* I: Subsampling factor */
+    int num_lines,          /* I: Number of lines in the output band */
+    int num_samps           /* I: Number of samples in the output band */
+)
+{
+    ANGLES_EXTENT *extent;  /* Output extent */
+    int line;               /* Output line */
 
-        /* Loop through the reflectance bands and compute the average of these
-           bands. Some of the pixels on the scene edge will be zero and throws
-           off the average, so don't count the zero values. */
-        printf ("Computing average for solar azimuth ...\n");
-        for (band_index = 0; band_index < L8_NBANDS; band_index++)
+    extent = malloc(num_lines * sizeof(ANGLES_EXTENT));
+    if (!extent)
+        return NULL;
+
+    /* L1T samples strictly between start_sample and end_sample are valid,
+       which matches the per-pixel trim test in calculate_angle_block */
+    for (line = 0; line < num_lines; line++)
+    {
+        const IAS_MISC_LINE_EXTENT *trim = &trim_lut[line * sub_sample];
+
+        if (trim->start_sample < 0)
+            extent[line].first_samp = 0;
+        else
+            extent[line].first_samp = trim->start_sample / sub_sample + 1;
+
+        if (trim->end_sample <= 0)
+            extent[line].last_samp = -1;
+        else
+            extent[line].last_samp = (trim->end_sample - 1) / sub_sample;
+        if (extent[line].last_samp > num_samps - 1)
+            extent[line].last_samp = num_samps - 1;
+    }
+
+    return extent;
+}
+
+/******************************************************************************
+NAME: evaluate_l8_angles
+
+PURPOSE: Angle evaluator used by the interpolation routines.  Computes the
+exact angles for an array of L1T locations, along with the set of SCAs each
+location falls in so the interpolation doesn't cross SCA boundaries.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The angles were successfully calculated
+    ERROR     An error occurred evaluating the angles
+******************************************************************************/
+static int evaluate_l8_angles
+(
+    void *eval_data,        /* I: L8_ANGLES_EVAL for the band */
+    int num_points,         /* I: Number of points to evaluate */
+    const double *line,     /* I: L1T line of each point */
+    const double *samp,     /* I: L1T sample of each point */
+    double *angles[ANGLES_NFIELDS], /* O: Angles for each field (radians) */
+    int *region             /* O: SCA mask of each point */
+)
+{
+    const L8_ANGLES_EVAL *eval = eval_data; /* Evaluation data */
+    static const double elev[IAS_ANGLE_GEN_BATCH_SIZE]; /* Elevations, always
+                                         0 to ensure the full scene coverage */
+    ANGLE_TYPE angle_type;  /* Angles to generate */
+    int start;              /* First point in the current chunk */
+    int count;              /* Number of points in the current chunk */
+    int i;                  /* Point index */
+
+    if (angles[ANGLES_SAT_ZENITH] && angles[ANGLES_SUN_ZENITH])
+        angle_type = AT_BOTH;
+    else if (angles[ANGLES_SAT_ZENITH])
+        angle_type = AT_SATELLITE;
+    else
+        angle_type = AT_SOLAR;
+
+    for (start = 0; start < num_points; start += IAS_ANGLE_GEN_BATCH_SIZE)
+    {
+        count = num_points - start;
+        if (count > IAS_ANGLE_GEN_BATCH_SIZE)
+            count = IAS_ANGLE_GEN_BATCH_SIZE;
+
+        if (calculate_angles_batch(eval->metadata, count, &line[start],
+            &samp[start], elev, eval->band_index, angle_type,
+            angles[ANGLES_SAT_ZENITH] ? &angles[ANGLES_SAT_ZENITH][start]
+                : NULL,
+            angles[ANGLES_SAT_AZIMUTH] ? &angles[ANGLES_SAT_AZIMUTH][start]
+                : NULL,
+            angles[ANGLES_SUN_ZENITH] ? &angles[ANGLES_SUN_ZENITH][start]
+                : NULL,
+            angles[ANGLES_SUN_AZIMUTH] ? &angles[ANGLES_SUN_AZIMUTH][start]
+                : NULL) != SUCCESS)
         {
-            /* Check if this band be added to the average */
-            if (!process_band[band_index])
-                continue;
+            return ERROR;
+        }
 
-            /* Add this band to the sum */
-            for (line = 0, index = 0; line < frame[band_index].num_lines;
-                 line += sub_sample)
-                for (samp = 0; samp < frame[band_index].num_samps;
-                     samp += sub_sample, index++)
-                    if (solar_azimuth[band_index][index] != 0)
-                    {
-                        sum[index] += solar_azimuth[band_index][index];
-                        pix_count[index]++;
-                    }
+        for (i = start; i < start + count; i++)
+        {
+            if (ias_angle_gen_find_sca_mask(eval->metadata, eval->band_index,
+                line[i], samp[i], &elev[0], &region[i]) != SUCCESS)
+            {
+                return ERROR;
+            }
+        }
+    }
+
+    return SUCCESS;
+}
+
+/******************************************************************************
+NAME: calculate_angle_block
+
+PURPOSE: Calculates the solar and/or satellite angles for a block of output
+lines in one band.  Pixels outside of the active image area are set to the
+background value.
+
+RETURN VALUE: Type = int
+    Value     Description
+    -----     -----------
+    SUCCESS   The angles were successfully calculated
+    ERROR     An error occurred evaluating the angles
+
+NOTES:
+  1. This is called concurrently for different blocks, so it only writes the
+     output lines of its own block and keeps all scratch values local.
+  2. The active samples of each output line are gathered into arrays and
+     evaluated together with calculate_angles_batch, which uses the
+     vectorized RPC evaluator.
+  3. When interpolation is enabled the block is handed to
+     angles_interp_block, which computes the exact angles on a coarse grid
+     and interpolates the rest.
+  4. The output arrays start at output line block->buffer_line, so they may
+     hold a chunk of the band rather than the whole band.
+******************************************************************************/
+static int calculate_angle_block
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Angle metadata structure */
+    const L8_ANGLES_PARAMETERS *parameters, /* I: Generation parameters */
+    const L8_ANGLE_BLOCK *block,        /* I: Block of output lines */
+    const ANGLES_FRAME *frame,          /* I: Image frame info for the band */
+    const IAS_MISC_LINE_EXTENT *trim_lut, /* I: Trim lookup table for the
+                                                band */
+    const ANGLES_EXTENT *extent, /* I: Valid output samples of each output
+                                       line; only used when interpolating */
+    int num_lines,          /* I: Number of lines in the output band */
+    int num_samps,          /* I: Number of samples in the output band */
+    short *solar_zenith,    /* O: Solar zenith array for the band, or NULL */
+    short *solar_azimuth,   /* O: Solar azimuth array for the band, or NULL */
+    short *sat_zenith,      /* O: Satellite zenith array for the band, or
+                                  NULL */
+    short *sat_azimuth      /* O: Satellite azimuth array for the band, or
+                                  NULL */
+)
+{
+    int out_line;                     /* Output line index */
+    int out_samp;                     /* Output sample index */
+    int line;                         /* L1T line */
+    int samp;                         /* L1T sample */
+    int npts;                         /* Number of points in the line */
+    int pt;                           /* Point index */
+    int status = SUCCESS;             /* Status of the block */
+    int sub_sample = parameters->sub_sample_factor; /* Subsampling factor */
+    size_t index;                     /* Current output pixel index */
+    int *pt_samp = NULL;              /* Output sample of each point */
+    double *pt_buf = NULL;            /* Buffer for the point arrays */
+    double *l1t_line;                 /* L1T line of each point */
+    double *l1t_samp;                 /* L1T sample of each point */
+    double *elev;                     /* Elevation of each point; always 0 */
+    double *sat_zen;                  /* Satellite zenith of each point */
+    double *sat_az;                   /* Satellite azimuth of each point */
+    double *sun_zen;                  /* Solar zenith of each point */
+    double *sun_az;                   /* Solar azimuth of each point */
+    double r2d = 4500.0 / atan(1.0);  /* Conversion to hundredths of degrees;
+                                         this includes the conversion of radians
+                                         to degrees in addition to scaling by
+                                         100.0 */
 
-            /* Release the memory */
-            free (solar_azimuth[band_index]);
+    /* Interpolate the angles from a coarse grid if requested */
+    if (angles_interp_enabled(&parameters->interp))
+    {
+        L8_ANGLES_EVAL eval;            /* Evaluation data for the band */
+        short *out[ANGLES_NFIELDS];     /* Output bands */
+
+        eval.metadata = metadata;
+        eval.band_index = block->band_index;
+        out[ANGLES_SAT_ZENITH] = sat_zenith;
+        out[ANGLES_SAT_AZIMUTH] = sat_azimuth;
+        out[ANGLES_SUN_ZENITH] = solar_zenith;
+        out[ANGLES_SUN_AZIMUTH] = solar_azimuth;
+
+        if (angles_interp_block(evaluate_l8_angles, &eval,
+            &parameters->interp, sub_sample, num_lines, num_samps, extent,
+            block->start_line, block->end_line, block->buffer_line,
+            parameters->background, out)
+            != SUCCESS)
+        {
+            IAS_LOG_ERROR("Interpolating the angles for band index %d",
+                block->band_index);
+            return ERROR;
         }
 
-        /* Get the average */
-        band_index = 0;
-        for (line = 0, index = 0; line < frame[band_index].num_lines;
-             line += sub_sample)
-            for (samp = 0; samp < frame[band_index].num_samps;
-                 samp += sub_sample, index++)
-                (*avg_solar_azimuth)[index] =
-                    (short) (round ((float) sum[index] / pix_count[index]));
+        return SUCCESS;
     }
 
-    /* Free memory */
-    free (sum);
-    free (pix_count);
+    /* Allocate the point arrays for one output line.  The elevation is
+       zeroed by calloc to ensure the full scene coverage. */
+    pt_samp = malloc(num_samps * sizeof(int));
+    pt_buf = calloc((size_t) num_samps * 7, sizeof(double));
+    if (pt_samp == NULL || pt_buf == NULL)
+    {
+        IAS_LOG_ERROR("Allocating the angle point arrays");
+        free(pt_samp);
+        free(pt_buf);
+        return ERROR;
+    }
+    l1t_line = pt_buf;
+    l1t_samp = l1t_line + num_samps;
+    elev = l1t_samp + num_samps;
+    sat_zen = elev + num_samps;
+    sat_az = sat_zen + num_samps;
+    sun_zen = sat_az + num_samps;
+    sun_az = sun_zen + num_samps;
+
+    for (out_line = block->start_line; out_line < block->end_line; out_line++)
+    {
+        line = out_line * sub_sample;
+        index = (size_t) (out_line - block->buffer_line) * num_samps;
 
-    /* Populate the band average frame using the first band (band 1) from the
-       band frames */
-    *avg_frame = frame[0];
-    *avg_nlines = nlines[0];
-    *avg_nsamps = nsamps[0];
+        /* Start the line out as fill.  The pixels in the active image area
+           are overwritten below. */
+        for (out_samp = 0; out_samp < num_samps; out_samp++)
+        {
+            if (sat_zenith)
+                sat_zenith[index + out_samp] = parameters->background;
+            if (sat_azimuth)
+                sat_azimuth[index + out_samp] = parameters->background;
+            if (solar_zenith)
+                solar_zenith[index + out_samp] = parameters->background;
+            if (solar_azimuth)
+                solar_azimuth[index + out_samp] = parameters->background;
+        }
 
-    return SUCCESS;
+        /* Gather the samples which fall inside the actual range of image
+           data in this scene.  Fill pixels are already handled. */
+        npts = 0;
+        for (samp = 0, out_samp = 0; samp < frame->num_samps;
+             samp += sub_sample, out_samp++)
+        {
+            if (samp <= trim_lut[line].start_sample || 
+                samp >= trim_lut[line].end_sample)
+            {
+                continue;
+            }
+
+            pt_samp[npts] = out_samp;
+            l1t_line[npts] = line;
+            l1t_samp[npts] = samp;
+            npts++;
+        }
+        if (npts == 0)
+            continue;
+
+        /* Calculate the satellite and solar azimuth and zenith for the
+           whole line */
+        if (calculate_angles_batch (metadata, npts, l1t_line, l1t_samp, elev,
+            block->band_index, parameters->angle_type, sat_zen, sat_az,
+            sun_zen, sun_az) != SUCCESS)
+        {
+            status = ERROR;
+            break;
+        }
+
+        /* Quantize the angles by converting from radians to degrees and
+           scaling by a factor of 100 so it can be stored in the short
+           integer image */
+        for (pt = 0; pt < npts; pt++)
+        {
+            size_t pix = index + pt_samp[pt];  /* Output pixel index */
+
+            if (sat_azimuth)
+                sat_azimuth[pix] = (short) round (r2d * sat_az[pt]);
+            if (sat_zenith)
+                sat_zenith[pix] = (short) round (r2d * sat_zen[pt]);
+            if (solar_azimuth)
+                solar_azimuth[pix] = (short) round (r2d * sun_az[pt]);
+            if (solar_zenith)
+                solar_zenith[pix] = (short) round (r2d * sun_zen[pt]);
+        }
+    }  /* for out_line */
+
+    free(pt_samp);
+    free(pt_buf);
+
+    return status;
 }
 
 /******************************************************************************
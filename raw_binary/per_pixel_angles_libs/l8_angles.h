@@ -13,9 +13,16 @@
 #include "raw_binary_io.h"
 #include "envi_header.h"
 
+/* Local Includes */
+#include "angles_interp.h"
+
 #define L8_NBANDS 11
 #define ANGLE_SCALE 100
 
+/* Number of output lines in each block of work handed to a thread when
+   computing the per-pixel angles */
+#define L8_ANGLE_BLOCK_LINES 32
+
 typedef enum angle_type
 {
     AT_UNKNOWN = 0, /* Unknown angle type */
@@ -45,8 +52,42 @@ typedef struct l8_angles_parameters
     ANGLE_TYPE angle_type;       /* Type of angles to be generated */
     int sub_sample_factor;       /* Sub-sampling factor to be used */
     short background;            /* Background value used for fill pixels */
+    ANGLES_INTERP interp;        /* Coarse grid interpolation controls */
 } L8_ANGLES_PARAMETERS;
 
+/* Block of output lines in a band, used as the unit of work when computing
+   the per-pixel angles */
+typedef struct l8_angle_block
+{
+    int band_index;         /* Band index for this block */
+    int start_line;         /* First output line in the block */
+    int end_line;           /* Last output line in the block + 1 */
+    int buffer_line;        /* Output line held in the first line of the
+                               output buffers; 0 if they hold the whole band */
+} L8_ANGLE_BLOCK;
+
+/* Receives the reflective band average angles from
+   l8_per_pixel_avg_refl_angles_stream, a block of output lines at a time.
+   The blocks are passed in order starting at the top of the band. */
+typedef int (*L8_AVG_ANGLES_WRITER)
+(
+    void *write_data,       /* I: Data passed through from the caller */
+    int num_lines,          /* I: Number of lines in the average band */
+    int num_samps,          /* I: Number of samples in the average band */
+    int start_line,         /* I: First output line in the block */
+    int end_line,           /* I: Last output line in the block + 1 */
+    short *avg[ANGLES_NFIELDS] /* I: Average angles of the block for each
+                                     field, degrees scaled by 100; fields not
+                                     generated are NULL */
+);
+
+/* Data passed to the angle evaluator when interpolating the angles */
+typedef struct l8_angles_eval
+{
+    const IAS_ANGLE_GEN_METADATA *metadata; /* Angle metadata structure */
+    int band_index;         /* Band index being evaluated */
+} L8_ANGLES_EVAL;
+
 /***************************** PROTOTYPES START *******************************/
 int l8_per_pixel_angles
 (
@@ -55,6 +96,10 @@ int l8_per_pixel_angles
                                   angles (1=full resolution). OW take every Nth
                                   sample from the line, where N=subsamp_fact */
     short fill_pix_value,   /* I: Fill pixel value to use (-32768:32767) */
+    int nthreads,           /* I: Number of threads to use for computing the
+                                  angles */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
     char *band_list,        /* I: Band list used to calculate angles for.
                                   "ALL" - defaults to all bands 1 - 11.
                                   Must be comma separated with no spaces in
@@ -85,6 +130,10 @@ int l8_per_pixel_avg_refl_angles
                                   angles (1=full resolution). OW take every Nth
                                   sample from the line, where N=subsamp_fact */
     short fill_pix_value,   /* I: Fill pixel value to use (-32768:32767) */
+    int nthreads,           /* I: Number of threads to use for computing the
+                                  angles */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
     ANGLES_FRAME *avg_frame,  /* O: Image frame info for the scene */
     short **avg_solar_zenith, /* O: Addr of pointer for the average solar zenith
                                     angle array (if NULL, don't process),
@@ -115,6 +164,43 @@ int calculate_angles
     double *sun_angles                      /* O: Solar angles */
 );
 
+int calculate_angles_batch
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Angle metadata structure */
+    int num_points,                         /* I: Number of points */
+    const double *line,                     /* I: L1T line coordinates */
+    const double *samp,                     /* I: L1T sample coordinates */
+    const double *elev,                     /* I: Elevations */
+    int band_index,                         /* I: Spectral band number */
+    ANGLE_TYPE angle_type,                  /* I: Type of angles to generate */
+    double *sat_zenith,                     /* O: Satellite zenith angles */
+    double *sat_azimuth,                    /* O: Satellite azimuth angles */
+    double *sun_zenith,                     /* O: Solar zenith angles */
+    double *sun_azimuth                     /* O: Solar azimuth angles */
+);
+
+int l8_per_pixel_avg_refl_angles_stream
+(
+    char *angle_coeff_name, /* I: Angle coefficient filename */
+    int subsamp_fact,       /* I: Subsample factor used when calculating the
+                                  angles (1=full resolution). OW take every Nth
+                                  sample from the line, where N=subsamp_fact */
+    short fill_pix_value,   /* I: Fill pixel value to use (-32768:32767) */
+    int nthreads,           /* I: Number of threads to use for computing the
+                                  angles */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
+    ANGLE_TYPE angle_type,  /* I: Type of angles to generate */
+    L8_AVG_ANGLES_WRITER write_block, /* I: Routine receiving each block of
+                                  the average angles */
+    void *write_data,       /* I: Data passed to write_block */
+    ANGLES_FRAME *avg_frame,/* O: Image frame info for the scene */
+    int *avg_nlines,        /* O: Number of lines for the bands, based on the
+                                  subsample factor */
+    int *avg_nsamps         /* O: Number of samples for the bands, based on
+                                  the subsample factor */
+);
+
 const double *get_active_lines
 (
     const IAS_ANGLE_GEN_METADATA *metadata, /* I: Angle metadata structure */ 
@@ -0,0 +1,464 @@
+/* Standard Library Includes */
+#include <math.h>
+
+/* IAS Library Includes */
+#include "ias_logging.h"
+#include "ias_angle_gen_private.h"
+
+/* Local Defines */
+#define BATCH_MAX_SCAS 2  /* Max number of SCAs a point can fall in */
+#define BATCH_PI 3.14159265358979323846
+#define BATCH_MAX_ENTRIES (BATCH_MAX_SCAS * IAS_ANGLE_GEN_BATCH_SIZE)
+
+/* Located points for one chunk.  Each point/SCA combination is an entry,
+   and the offset coordinates are stored per entry so the angle polynomials
+   can be evaluated over contiguous arrays.  The L1R locations only depend
+   on the band, so one chunk is shared by the satellite and solar angles. */
+typedef struct batch_chunk
+{
+    int count;              /* Number of points in the chunk */
+    int num_entries;        /* Number of point/SCA entries in the chunk */
+    int nsca_found[IAS_ANGLE_GEN_BATCH_SIZE]; /* SCAs found per point */
+    int entry_point[BATCH_MAX_ENTRIES]; /* Point index for each entry */
+    double t_line[BATCH_MAX_ENTRIES];   /* Offset L1T line for each entry */
+    double t_samp[BATCH_MAX_ENTRIES];   /* Offset L1T sample for each entry */
+    double r_line[BATCH_MAX_ENTRIES];   /* Offset L1R line for each entry */
+    double r_samp[BATCH_MAX_ENTRIES];   /* Offset L1R sample for each entry */
+    double height[BATCH_MAX_ENTRIES];   /* Offset height for each entry */
+} BATCH_CHUNK;
+
+/*******************************************************************************
+Name: fast_acos
+
+Purpose: Approximates acos(x) for -1 <= x <= 1 using the minimax polynomial
+         from Abramowitz and Stegun 4.4.46.  The absolute error is bounded by
+         IAS_ANGLE_GEN_BATCH_TRIG_ERROR radians.  The function is branch free
+         so loops calling it can be vectorized.
+
+Return:
+    Type = double
+    Angle in radians (0 to pi)
+ ******************************************************************************/
+static inline double fast_acos
+(
+    double x           /* I: Cosine of the angle */
+)
+{
+    double ax;         /* Absolute value of x */
+    double result;     /* Angle for |x| */
+
+    ax = fabs(x);
+    ax = (ax > 1.0) ? 1.0 : ax;
+
+    result = sqrt(1.0 - ax) * (1.5707963050 + ax * (-0.2145988016
+        + ax * (0.0889789874 + ax * (-0.0501743046 + ax * (0.0308918810
+        + ax * (-0.0170881256 + ax * (0.0066700901
+        + ax * -0.0012624911)))))));
+
+    /* acos(-x) = pi - acos(x) */
+    return (x < 0.0) ? (BATCH_PI - result) : result;
+}
+
+/*******************************************************************************
+Name: fast_atan2
+
+Purpose: Approximates atan2(y, x) using the minimax polynomial for atan on
+         [0, 1] from Abramowitz and Stegun 4.4.49, with the usual octant
+         reduction.  The absolute error is bounded by
+         IAS_ANGLE_GEN_BATCH_TRIG_ERROR radians.  The function is branch free
+         so loops calling it can be vectorized.
+
+Return:
+    Type = double
+    Angle in radians (-pi to pi)
+ ******************************************************************************/
+static inline double fast_atan2
+(
+    double y,          /* I: Y coordinate */
+    double x           /* I: X coordinate */
+)
+{
+    double ax;         /* Absolute value of x */
+    double ay;         /* Absolute value of y */
+    double num;        /* Smaller of ax and ay */
+    double den;        /* Larger of ax and ay */
+    double t;          /* Ratio in [0, 1] */
+    double t2;         /* Square of the ratio */
+    double result;     /* Angle in the first octant */
+
+    ax = fabs(x);
+    ay = fabs(y);
+    num = (ax < ay) ? ax : ay;
+    den = (ax < ay) ? ay : ax;
+    t = num / ((den > 0.0) ? den : 1.0);
+    t2 = t * t;
+
+    result = t * (1.0 + t2 * (-0.3333314528 + t2 * (0.1999355085
+        + t2 * (-0.1420889944 + t2 * (0.1065626393 + t2 * (-0.0752896400
+        + t2 * (0.0429096138 + t2 * (-0.0161657367
+        + t2 * 0.0028662257))))))));
+
+    /* Undo the octant reduction */
+    result = (ay > ax) ? (BATCH_PI / 2.0 - result) : result;
+    result = (x < 0.0) ? (BATCH_PI - result) : result;
+    return (y < 0.0) ? -result : result;
+}
+
+/*******************************************************************************
+Name: evaluate_rpc_vector_batch
+
+Purpose: Evaluates one component of the angle rational polynomial for a
+         batch of offset L1T/L1R coordinates.  This is the same polynomial
+         as calculate_rpc_vector_value in ias_angle_gen_calculate_angles_rpc.c
+         laid out over contiguous arrays so the compiler can vectorize it.
+
+Return:
+    Type = void
+ ******************************************************************************/
+static void evaluate_rpc_vector_batch
+(
+    int count,                          /* I: Number of entries */
+    const double *restrict l1t_line,    /* I: Offset L1T lines */
+    const double *restrict l1t_samp,    /* I: Offset L1T samples */
+    const double *restrict l1r_line,    /* I: Offset L1R lines */
+    const double *restrict l1r_samp,    /* I: Offset L1R samples */
+    const double *restrict height,      /* I: Offset heights */
+    double mean_offset,                 /* I: Vector mean offset */
+    const IAS_ANGLE_GEN_ANG_RPC_TERMS *terms, /* I: RPC terms */
+    double *restrict output_value       /* O: Output vector values */
+)
+{
+    int i;                              /* Entry index */
+    const double *n = terms->numerator; /* Numerator coefficients */
+    const double *d = terms->denominator; /* Denominator coefficients */
+
+#ifdef _OPENMP
+    #pragma omp simd
+#endif
+    for (i = 0; i < count; i++)
+    {
+        double tl = l1t_line[i];
+        double ts = l1t_samp[i];
+        double rl = l1r_line[i];
+        double rs = l1r_samp[i];
+        double h = height[i];
+        double rl2 = rl * rl;
+        double equation_num;    /* Equation numerator */
+        double equation_den;    /* Equation denominator */
+
+        equation_num = n[0] + n[1] * tl + n[2] * ts + n[3] * h + n[4] * rl
+            + n[5] * tl * tl + n[6] * ts * tl + n[7] * ts * ts
+            + n[8] * rs * rl2 + n[9] * rl2 * rl;
+        equation_den = 1.0 + d[0] * tl + d[1] * ts + d[2] * h + d[3] * rl
+            + d[4] * tl * tl + d[5] * tl * ts + d[6] * ts * ts
+            + d[7] * rs * rl2 + d[8] * rl2 * rl;
+
+        output_value[i] = mean_offset + equation_num / equation_den;
+    }
+}
+
+/*******************************************************************************
+Name: locate_chunk
+
+Purpose: Locates the SCA(s) for each point in a chunk and gathers the offset
+         coordinates for each point/SCA combination.
+
+Return:
+    Type = integer
+    SUCCESS / ERROR
+ ******************************************************************************/
+static int locate_chunk
+(
+    const IAS_ANGLE_GEN_BAND *band_ptr, /* I: Metadata for current band */
+    int count,              /* I: Number of points in the chunk */
+    const double *l1t_line, /* I: Output space line of each point */
+    const double *l1t_samp, /* I: Output space sample of each point */
+    const double *elev,     /* I: Elevation of each point or NULL if mean
+                                  scene height should be used */
+    BATCH_CHUNK *chunk      /* O: Located chunk */
+)
+{
+    int point;              /* Point index within the chunk */
+
+    chunk->count = count;
+    chunk->num_entries = 0;
+    for (point = 0; point < count; point++)
+    {
+        int sca_index;          /* SCA index */
+        int entry;              /* Entry index */
+        double l1r_line[BATCH_MAX_SCAS]; /* L1R lines for the point */
+        double l1r_samp[BATCH_MAX_SCAS]; /* L1R samples for the point */
+        const double *point_elev = NULL; /* Elevation for the point */
+        double point_height;    /* Model height for the point */
+
+        if (elev)
+            point_elev = &elev[point];
+        point_height = band_ptr->satellite.mean_height;
+        if (point_elev)
+            point_height = *point_elev;
+
+        chunk->nsca_found[point] = ias_angle_gen_find_scas(band_ptr,
+            l1t_line[point], l1t_samp[point], point_elev, l1r_line, l1r_samp);
+        if (chunk->nsca_found[point] > BATCH_MAX_SCAS)
+        {
+            IAS_LOG_ERROR("Too many SCAs found locating point in active "
+                "image");
+            return ERROR;
+        }
+
+        for (sca_index = 0; sca_index < chunk->nsca_found[point]; sca_index++)
+        {
+            entry = chunk->num_entries;
+            chunk->entry_point[entry] = point;
+            chunk->t_line[entry] = l1t_line[point]
+                - band_ptr->satellite.line_terms.l1t_mean_offset;
+            chunk->t_samp[entry] = l1t_samp[point]
+                - band_ptr->satellite.samp_terms.l1t_mean_offset;
+            chunk->height[entry] = point_height
+                - band_ptr->satellite.mean_height;
+            chunk->r_line[entry] = l1r_line[sca_index]
+                - band_ptr->satellite.line_terms.l1r_mean_offset;
+            chunk->r_samp[entry] = l1r_samp[sca_index]
+                - band_ptr->satellite.samp_terms.l1r_mean_offset;
+            chunk->num_entries++;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*******************************************************************************
+Name: evaluate_chunk
+
+Purpose: Evaluates the zenith and azimuth angles of one angle type for a
+         located chunk, averaging the angles over the SCAs of each point.
+
+Return:
+    Type = integer
+    SUCCESS / ERROR
+ ******************************************************************************/
+static int evaluate_chunk
+(
+    const BATCH_CHUNK *chunk,   /* I: Located chunk */
+    const IAS_ANGLE_GEN_ANG_RPC *data_ptr, /* I: Solar or satellite data */
+    double *zenith,         /* O: Zenith angle of each point (radians) */
+    double *azimuth         /* O: Azimuth angle of each point (radians) */
+)
+{
+    int num_entries = chunk->num_entries; /* Number of entries */
+    int point;              /* Point index within the chunk */
+    int entry;              /* Entry index */
+    double vx[BATCH_MAX_ENTRIES]; /* X component of the vector, then the
+                                     zenith */
+    double vy[BATCH_MAX_ENTRIES]; /* Y component of the vector, then the
+                                     azimuth */
+    double vz[BATCH_MAX_ENTRIES]; /* Z component of the vector */
+
+    /* Evaluate the vector components */
+    evaluate_rpc_vector_batch(num_entries, chunk->t_line, chunk->t_samp,
+        chunk->r_line, chunk->r_samp, chunk->height, data_ptr->mean_offset.x,
+        &data_ptr->x_terms, vx);
+    evaluate_rpc_vector_batch(num_entries, chunk->t_line, chunk->t_samp,
+        chunk->r_line, chunk->r_samp, chunk->height, data_ptr->mean_offset.y,
+        &data_ptr->y_terms, vy);
+    evaluate_rpc_vector_batch(num_entries, chunk->t_line, chunk->t_samp,
+        chunk->r_line, chunk->r_samp, chunk->height, data_ptr->mean_offset.z,
+        &data_ptr->z_terms, vz);
+
+    /* A zero length vector can't be normalized */
+    for (entry = 0; entry < num_entries; entry++)
+    {
+        if (vx[entry] == 0.0 && vy[entry] == 0.0 && vz[entry] == 0.0)
+        {
+            IAS_LOG_ERROR("Unable to normalize the rpc vector");
+            return ERROR;
+        }
+    }
+
+    /* Normalize the vectors in case the polynomial fit results in
+       non-unit vectors, and convert them to zenith and azimuth angles.
+       The zenith replaces the x component and the azimuth the y
+       component. */
+#ifdef _OPENMP
+    #pragma omp simd
+#endif
+    for (entry = 0; entry < num_entries; entry++)
+    {
+        double inv_magnitude;   /* Inverse of the vector length */
+        double ux, uy, uz;      /* Unit vector */
+
+        inv_magnitude = 1.0 / sqrt(vx[entry] * vx[entry]
+            + vy[entry] * vy[entry] + vz[entry] * vz[entry]);
+        ux = vx[entry] * inv_magnitude;
+        uy = vy[entry] * inv_magnitude;
+        uz = vz[entry] * inv_magnitude;
+
+        vx[entry] = fast_acos(uz);
+        vy[entry] = fast_atan2(ux, uy);
+    }
+
+    /* Average the angles over the SCAs for each point */
+    for (point = 0; point < chunk->count; point++)
+    {
+        zenith[point] = 0.0;
+        azimuth[point] = 0.0;
+    }
+
+    for (entry = 0; entry < num_entries; entry++)
+    {
+        zenith[chunk->entry_point[entry]] += vx[entry];
+        azimuth[chunk->entry_point[entry]] += vy[entry];
+    }
+
+    for (point = 0; point < chunk->count; point++)
+    {
+        if (chunk->nsca_found[point] > 1)
+        {
+            zenith[point] /= chunk->nsca_found[point];
+            azimuth[point] /= chunk->nsca_found[point];
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*******************************************************************************
+Name: ias_angle_gen_calculate_sat_sun_angles_rpc_batch
+
+Purpose: Calculates the satellite viewing and/or solar illumination zenith
+         and azimuth angles for an array of L1T line/sample locations.  The
+         results match ias_angle_gen_calculate_angles_rpc called for each
+         point and angle type, except that acos/atan2 are replaced by bounded
+         polynomial approximations (see IAS_ANGLE_GEN_BATCH_TRIG_ERROR).
+
+Note: The points are processed in chunks of IAS_ANGLE_GEN_BATCH_SIZE.  For
+      each chunk the SCA search is done once per point, and the located L1R
+      coordinates are gathered into contiguous arrays which are shared by
+      the satellite and solar angles.  The angle polynomials, the unit
+      vector normalization, and the trig are then evaluated over those
+      arrays in vectorizable loops.  All scratch space is on the stack, so
+      this may be called concurrently from several threads.
+
+      Pass NULL for both arrays of an angle type to skip it.
+
+Return:
+    Type = integer
+    SUCCESS / ERROR
+ ******************************************************************************/
+int ias_angle_gen_calculate_sat_sun_angles_rpc_batch
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Metadata structure */
+    int num_points,         /* I: Number of points */
+    const double *l1t_line, /* I: Array of output space line coordinates */
+    const double *l1t_samp, /* I: Array of output space sample coordinates */
+    const double *elev,     /* I: Array of input elevations or NULL if mean
+                                  scene height should be used */
+    int band_index,         /* I: Current band index */
+    int *outside_image_flag,/* O: Array of flags indicating the point was
+                                  outside the image, or NULL */
+    double *sat_zenith,     /* O: Array of satellite zenith angles (radians),
+                                  or NULL */
+    double *sat_azimuth,    /* O: Array of satellite azimuth angles (radians),
+                                  or NULL */
+    double *sun_zenith,     /* O: Array of solar zenith angles (radians), or
+                                  NULL */
+    double *sun_azimuth     /* O: Array of solar azimuth angles (radians), or
+                                  NULL */
+)
+{
+    int start;              /* First point in the current chunk */
+    const IAS_ANGLE_GEN_BAND *band_ptr; /* Pointer to current band */
+    BATCH_CHUNK chunk;      /* Located points for the current chunk */
+
+    /* Check that the band index is valid */
+    if (!ias_angle_gen_valid_band_index(metadata, band_index))
+    {
+        IAS_LOG_ERROR("Band index %d is invalid", band_index);
+        return ERROR;
+    }
+    band_ptr = &metadata->band_metadata[band_index];
+
+    for (start = 0; start < num_points; start += IAS_ANGLE_GEN_BATCH_SIZE)
+    {
+        int count;          /* Number of points in this chunk */
+        int point;          /* Point index within the chunk */
+
+        count = num_points - start;
+        if (count > IAS_ANGLE_GEN_BATCH_SIZE)
+            count = IAS_ANGLE_GEN_BATCH_SIZE;
+
+        if (locate_chunk(band_ptr, count, &l1t_line[start], &l1t_samp[start],
+                elev ? &elev[start] : NULL, &chunk) != SUCCESS)
+        {
+            return ERROR;
+        }
+
+        if (sat_zenith && sat_azimuth)
+        {
+            if (evaluate_chunk(&chunk, &band_ptr->satellite,
+                    &sat_zenith[start], &sat_azimuth[start]) != SUCCESS)
+            {
+                return ERROR;
+            }
+        }
+
+        if (sun_zenith && sun_azimuth)
+        {
+            if (evaluate_chunk(&chunk, &band_ptr->solar,
+                    &sun_zenith[start], &sun_azimuth[start]) != SUCCESS)
+            {
+                return ERROR;
+            }
+        }
+
+        if (outside_image_flag)
+        {
+            for (point = 0; point < count; point++)
+            {
+                outside_image_flag[start + point]
+                    = (chunk.nsca_found[point] < 1);
+            }
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*******************************************************************************
+Name: ias_angle_gen_calculate_angles_rpc_batch
+
+Purpose: Calculates the satellite viewing or solar illumination zenith and
+         azimuth angles for an array of L1T line/sample locations.  See
+         ias_angle_gen_calculate_sat_sun_angles_rpc_batch.
+
+Return:
+    Type = integer
+    SUCCESS / ERROR
+ ******************************************************************************/
+int ias_angle_gen_calculate_angles_rpc_batch
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Metadata structure */
+    int num_points,         /* I: Number of points */
+    const double *l1t_line, /* I: Array of output space line coordinates */
+    const double *l1t_samp, /* I: Array of output space sample coordinates */
+    const double *elev,     /* I: Array of input elevations or NULL if mean
+                                  scene height should be used */
+    int band_index,         /* I: Current band index */
+    IAS_ANGLE_GEN_TYPE sat_or_sun_type,     /* I: Angle calculation type */
+    int *outside_image_flag,/* O: Array of flags indicating the point was
+                                  outside the image, or NULL */
+    double *zenith,         /* O: Array of zenith angles (radians) */
+    double *azimuth         /* O: Array of azimuth angles (radians) */
+)
+{
+    if (sat_or_sun_type == IAS_ANGLE_GEN_SATELLITE)
+    {
+        return ias_angle_gen_calculate_sat_sun_angles_rpc_batch(metadata,
+            num_points, l1t_line, l1t_samp, elev, band_index,
+            outside_image_flag, zenith, azimuth, NULL, NULL);
+    }
+
+    return ias_angle_gen_calculate_sat_sun_angles_rpc_batch(metadata,
+        num_points, l1t_line, l1t_samp, elev, band_index, outside_image_flag,
+        NULL, NULL, zenith, azimuth);
+}
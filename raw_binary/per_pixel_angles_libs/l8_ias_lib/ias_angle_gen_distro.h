@@ -13,6 +13,13 @@
 #define IAS_ANGLE_GEN_SCENE_ID_LENGTH 21 /* Scene ID length */
 #define IAS_ANGLE_GEN_ZENITH_INDEX 0    /* Array index for the zenith angle */
 #define IAS_ANGLE_GEN_AZIMUTH_INDEX 1   /* Array index for the azimuth angle */
+#define IAS_ANGLE_GEN_BATCH_SIZE 256   /* Number of points evaluated together
+                                          by the batch angle calculation */
+#define IAS_ANGLE_GEN_BATCH_TRIG_ERROR 5.0e-8 /* Max error (radians) of the
+                                          approximate acos/atan2 used by the
+                                          batch angle calculation */
+#define IAS_ANGLE_GEN_SCA_LOOKUP_STEP 16 /* L1T lines between the rows of
+                                          the SCA lookup table */
 
 typedef enum ias_angle_gen_type
 {
@@ -73,6 +80,18 @@ typedef struct IAS_ANGLE_GEN_ANG_RPC
     IAS_ANGLE_GEN_ANG_RPC_TERMS z_terms; /* Z axis coefficients */
 } IAS_ANGLE_GEN_ANG_RPC;
 
+/* Approximate L1T sample range of each SCA, tabulated every
+   IAS_ANGLE_GEN_SCA_LOOKUP_STEP L1T lines.  It is computed once per band from
+   the L1T to L1R sample RPCs and tells ias_angle_gen_find_scas which SCA to
+   start searching from. */
+typedef struct IAS_ANGLE_GEN_SCA_LOOKUP
+{
+    int num_rows;           /* Number of rows in the table */
+    int num_scas;           /* Number of SCAs in each row */
+    float *start_samp;      /* First L1T sample of each SCA, by row */
+    float *end_samp;        /* Last L1T sample of each SCA, by row */
+} IAS_ANGLE_GEN_SCA_LOOKUP;
+
 /* All of the rational polynomial coefficients and metadata for a band needed
    to calculate the azimuth and zenith angles and map L1T line/sample to L1R
    line/sample */
@@ -93,6 +112,7 @@ typedef struct IAS_ANGLE_GEN_BAND
     IAS_ANGLE_GEN_ANG_RPC satellite;   /* Satellite viewing angles */
     IAS_ANGLE_GEN_ANG_RPC solar;       /* Solar angles */
     IAS_ANGLE_GEN_IMAGE_RPC sca_metadata[IAS_MAX_NSCAS]; /* SCA RPCs */
+    IAS_ANGLE_GEN_SCA_LOOKUP *sca_lookup; /* SCA lookup table, or NULL */
 } IAS_ANGLE_GEN_BAND;
 
 /* Sample time and position for each ephemeris or solar vector point */
@@ -141,6 +161,53 @@ int ias_angle_gen_calculate_angles_rpc
     double *angle           /* O: Array containing zenith and azimuth angles */
 );
 
+int ias_angle_gen_calculate_angles_rpc_batch
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Metadata structure */
+    int num_points,         /* I: Number of points */
+    const double *l1t_line, /* I: Array of output space line coordinates */
+    const double *l1t_samp, /* I: Array of output space sample coordinates */
+    const double *elev,     /* I: Array of input elevations or NULL if mean
+                                  scene height should be used */
+    int band_index,         /* I: Current band index */
+    IAS_ANGLE_GEN_TYPE sat_or_sun_type,     /* I: Angle calculation type */
+    int *outside_image_flag,/* O: Array of flags indicating the point was
+                                  outside the image, or NULL */
+    double *zenith,         /* O: Array of zenith angles (radians) */
+    double *azimuth         /* O: Array of azimuth angles (radians) */
+);
+
+int ias_angle_gen_calculate_sat_sun_angles_rpc_batch
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Metadata structure */
+    int num_points,         /* I: Number of points */
+    const double *l1t_line, /* I: Array of output space line coordinates */
+    const double *l1t_samp, /* I: Array of output space sample coordinates */
+    const double *elev,     /* I: Array of input elevations or NULL if mean
+                                  scene height should be used */
+    int band_index,         /* I: Current band index */
+    int *outside_image_flag,/* O: Array of flags indicating the point was
+                                  outside the image, or NULL */
+    double *sat_zenith,     /* O: Array of satellite zenith angles (radians),
+                                  or NULL to skip the satellite angles */
+    double *sat_azimuth,    /* O: Array of satellite azimuth angles (radians),
+                                  or NULL to skip the satellite angles */
+    double *sun_zenith,     /* O: Array of solar zenith angles (radians), or
+                                  NULL to skip the solar angles */
+    double *sun_azimuth     /* O: Array of solar azimuth angles (radians), or
+                                  NULL to skip the solar angles */
+);
+
+int ias_angle_gen_find_sca_mask
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Angle metadata */
+    int band_index,         /* I: Current band index */
+    double l1t_line,        /* I: Input L1T line */
+    double l1t_samp,        /* I: Input L1T sample */
+    const double *height,   /* I: Input height, NULL for zero height */
+    int *sca_mask           /* O: Bit mask of the SCAs containing the point */
+);
+
 void ias_angle_gen_free
 (
     IAS_ANGLE_GEN_METADATA *metadata /* I: Metadata structure */
@@ -10,11 +10,15 @@ Name: ias_angle_gen_find_scas
 Purpose: Uses the L1T to L1R rational polynomials to determine which SCA, or
          SCAs, the input L1T line/sample/height location falls in, and 
          returns the L1R line/sample coordinates associated with each valid 
-         SCA
+         SCA.  The search starts from the SCA given by the band's SCA lookup
+         table, which is normally the SCA containing the point, so only
+         the one or two SCAs covering the point are evaluated.
 
 Note: If height not needed in find pass NULL pointer as height. Also the
       l1r_line and l1r_samp pointers need to have space to for 2 SCA 
-      line/sample combinations.
+      line/sample combinations.  Where two SCAs overlap, the order they
+      are returned in depends on the SCA the search starts from, so callers
+      must not depend on it.
 
 Return: 
     Type = integer
@@ -38,7 +42,7 @@ int ias_angle_gen_find_scas
     /* Initialize the number found */
     nsca_found = 0;
     scas_tested = 0;
-    sca_index = metadata->num_scas / 2;
+    sca_index = ias_angle_gen_lookup_sca(metadata, l1t_line, l1t_samp);
 
     /* Compute the location for this SCA */
     while (sca_index >= 0 && sca_index < metadata->num_scas)
@@ -65,6 +65,11 @@ void ias_angle_gen_free
     IAS_ANGLE_GEN_METADATA *metadata /* I: Metadata structure */
 )           
 {
+    int index;  /* Band index */
+
+    for (index = 0; index < IAS_MAX_NBANDS; index++)
+        ias_angle_gen_free_sca_lookup(&metadata->band_metadata[index]);
+
     free(metadata->ephemeris);
     metadata->ephemeris = NULL;
 
@@ -26,6 +26,23 @@ int ias_angle_gen_find_scas
     double *l1r_samp      /* O: Array of output L1R sample numbers */
 );
 
+int ias_angle_gen_build_sca_lookup
+(
+    IAS_ANGLE_GEN_BAND *metadata  /* I/O: Metadata for the band */
+);
+
+void ias_angle_gen_free_sca_lookup
+(
+    IAS_ANGLE_GEN_BAND *metadata  /* I/O: Metadata for the band */
+);
+
+int ias_angle_gen_lookup_sca
+(
+    const IAS_ANGLE_GEN_BAND *metadata,/* I: Metadata for current band */
+    double l1t_line,      /* I: Input L1T line */
+    double l1t_samp       /* I: Input L1T sample */
+);
+
 int ias_angle_gen_interpolate_ephemeris
 (
     const IAS_ANGLE_GEN_EPHEMERIS *ephemeris,/* I: Metadata ephemeris points */
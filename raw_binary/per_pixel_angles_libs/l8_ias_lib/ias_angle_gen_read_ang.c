@@ -1021,7 +1021,10 @@ int ias_angle_gen_read_ang
 
     /* Initialize the band present field to false */
     for (index = 0; index < IAS_MAX_NBANDS; index++)
+    {
         metadata->band_present[index] = FALSE;
+        metadata->band_metadata[index].sca_lookup = NULL;
+    }
 
     /* Read data */
     /* File information group */
@@ -1064,6 +1067,17 @@ int ias_angle_gen_read_ang
             ias_angle_gen_free(metadata);
             return ERROR;
         }
+
+        /* Tabulate where each SCA falls in the L1T image */
+        if (ias_angle_gen_build_sca_lookup(&metadata->band_metadata[index])
+            != SUCCESS)
+        {
+            IAS_LOG_ERROR("Building the SCA lookup table for band index %d",
+                index);
+            ias_odl_free_tree(odl_data);
+            ias_angle_gen_free(metadata);
+            return ERROR;
+        }
     }
 
     /* Release the ODL structure */
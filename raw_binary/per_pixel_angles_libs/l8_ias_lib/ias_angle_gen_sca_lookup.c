@@ -0,0 +1,238 @@
+/* Standard Library Includes */
+#include <stdlib.h>
+#include <math.h>
+
+/* IAS Library Includes */
+#include "ias_logging.h"
+#include "ias_angle_gen_private.h"
+
+/*******************************************************************************
+Name: find_sca_sample_range
+
+Purpose: Finds the L1T sample range covered by one SCA on an L1T line.  For a
+         fixed L1T line and height the L1T to L1R sample RPC is a ratio of two
+         linear functions of the L1T sample, so the L1T samples at the first
+         and last L1R samples of the SCA are found directly.
+
+Return:
+    Type = void
+ ******************************************************************************/
+static void find_sca_sample_range
+(
+    const IAS_ANGLE_GEN_BAND *metadata,/* I: Metadata for current band */
+    int sca_index,          /* I: SCA index */
+    double l1t_line,        /* I: Input L1T line */
+    float *start_samp,      /* O: First L1T sample of the SCA */
+    float *end_samp         /* O: Last L1T sample of the SCA */
+)
+{
+    const IAS_ANGLE_GEN_IMAGE_RPC_TERMS *line_terms;/* Line terms pointer */
+    const IAS_ANGLE_GEN_IMAGE_RPC_TERMS *samp_terms;/* Samp terms pointer */
+    double line_offset;     /* Offset value of L1T line */
+    double a, b, c, d;      /* L1R sample = (a + b * samp) / (c + d * samp) */
+    double target;          /* Offset L1R sample at the SCA edge */
+    double denominator;     /* Denominator of the inverse */
+    double edge[2];         /* L1T samples at the SCA edges */
+    int index;              /* Edge index */
+
+    line_terms = &metadata->sca_metadata[sca_index].line_terms;
+    samp_terms = &metadata->sca_metadata[sca_index].samp_terms;
+    line_offset = l1t_line - line_terms->l1t_mean_offset;
+
+    /* Collect the terms which don't depend on the sample, using a zero height
+       offset.  The table only picks the starting SCA, so it doesn't need to
+       account for the height. */
+    a = samp_terms->numerator[0] + samp_terms->numerator[1] * line_offset;
+    b = samp_terms->numerator[2] + samp_terms->numerator[4] * line_offset;
+    c = 1.0 + samp_terms->denominator[0] * line_offset;
+    d = samp_terms->denominator[1] + samp_terms->denominator[3] * line_offset;
+
+    for (index = 0; index < 2; index++)
+    {
+        target = ((index == 0) ? 0.0 : (metadata->l1r_samps - 1))
+            - samp_terms->l1r_mean_offset;
+        denominator = b - target * d;
+
+        /* A degenerate fit covers everything, so the SCA is always a
+           candidate */
+        if (fabs(denominator) < 1.0e-12)
+        {
+            *start_samp = -HUGE_VALF;
+            *end_samp = HUGE_VALF;
+            return;
+        }
+
+        edge[index] = (target * c - a) / denominator
+            + samp_terms->l1t_mean_offset;
+    }
+
+    if (edge[0] <= edge[1])
+    {
+        *start_samp = edge[0];
+        *end_samp = edge[1];
+    }
+    else
+    {
+        *start_samp = edge[1];
+        *end_samp = edge[0];
+    }
+}
+
+/*******************************************************************************
+Name: ias_angle_gen_build_sca_lookup
+
+Purpose: Builds the SCA lookup table for a band, which holds the L1T sample
+         range of each SCA every IAS_ANGLE_GEN_SCA_LOOKUP_STEP L1T lines.
+
+Return:
+    Type = integer
+    SUCCESS / ERROR
+ ******************************************************************************/
+int ias_angle_gen_build_sca_lookup
+(
+    IAS_ANGLE_GEN_BAND *metadata  /* I/O: Metadata for the band */
+)
+{
+    IAS_ANGLE_GEN_SCA_LOOKUP *lookup; /* Lookup table */
+    int row;                /* Table row */
+    int sca_index;          /* SCA index */
+
+    ias_angle_gen_free_sca_lookup(metadata);
+
+    if (metadata->num_scas < 1 || metadata->num_scas > IAS_MAX_NSCAS
+        || metadata->l1t_lines < 1)
+    {
+        IAS_LOG_ERROR("Invalid band dimensions for the SCA lookup table");
+        return ERROR;
+    }
+
+    lookup = malloc(sizeof(*lookup));
+    if (!lookup)
+    {
+        IAS_LOG_ERROR("Allocating the SCA lookup table");
+        return ERROR;
+    }
+
+    /* One extra row so the last L1T line is bracketed */
+    lookup->num_rows = (metadata->l1t_lines - 1)
+        / IAS_ANGLE_GEN_SCA_LOOKUP_STEP + 2;
+    lookup->num_scas = metadata->num_scas;
+    lookup->start_samp = malloc(lookup->num_rows * lookup->num_scas
+        * sizeof(float));
+    lookup->end_samp = malloc(lookup->num_rows * lookup->num_scas
+        * sizeof(float));
+    if (!lookup->start_samp || !lookup->end_samp)
+    {
+        IAS_LOG_ERROR("Allocating the SCA lookup table");
+        free(lookup->start_samp);
+        free(lookup->end_samp);
+        free(lookup);
+        return ERROR;
+    }
+
+    for (row = 0; row < lookup->num_rows; row++)
+    {
+        for (sca_index = 0; sca_index < lookup->num_scas; sca_index++)
+        {
+            int entry = row * lookup->num_scas + sca_index; /* Table entry */
+
+            find_sca_sample_range(metadata, sca_index,
+                (double) row * IAS_ANGLE_GEN_SCA_LOOKUP_STEP,
+                &lookup->start_samp[entry], &lookup->end_samp[entry]);
+        }
+    }
+
+    metadata->sca_lookup = lookup;
+
+    return SUCCESS;
+}
+
+/*******************************************************************************
+Name: ias_angle_gen_free_sca_lookup
+
+Purpose: Frees the SCA lookup table for a band.
+
+Return:
+    Type = void
+ ******************************************************************************/
+void ias_angle_gen_free_sca_lookup
+(
+    IAS_ANGLE_GEN_BAND *metadata  /* I/O: Metadata for the band */
+)
+{
+    if (!metadata->sca_lookup)
+        return;
+
+    free(metadata->sca_lookup->start_samp);
+    free(metadata->sca_lookup->end_samp);
+    free(metadata->sca_lookup);
+    metadata->sca_lookup = NULL;
+}
+
+/*******************************************************************************
+Name: ias_angle_gen_lookup_sca
+
+Purpose: Uses the SCA lookup table to find the SCA the input L1T line/sample
+         most likely falls in.  This is where ias_angle_gen_find_scas starts
+         its search.
+
+Note: Without a lookup table the middle SCA is returned, which is where the
+      search used to always start.  If the point isn't inside any SCA's
+      range, the SCA with the closest range is returned.
+
+Return:
+    Type = integer
+    SCA index to start the search from
+ ******************************************************************************/
+int ias_angle_gen_lookup_sca
+(
+    const IAS_ANGLE_GEN_BAND *metadata,/* I: Metadata for current band */
+    double l1t_line,      /* I: Input L1T line */
+    double l1t_samp       /* I: Input L1T sample */
+)
+{
+    const IAS_ANGLE_GEN_SCA_LOOKUP *lookup = metadata->sca_lookup;
+    const float *start_samp;    /* Start samples for the row */
+    const float *end_samp;      /* End samples for the row */
+    double row_position;        /* Fractional table row */
+    double distance;            /* Distance from the SCA range */
+    double best_distance;       /* Distance from the closest SCA range */
+    int row;                    /* Table row */
+    int sca_index;              /* SCA index */
+    int best_sca;               /* SCA with the closest range */
+
+    if (!lookup)
+        return metadata->num_scas / 2;
+
+    /* Use the nearest row */
+    row_position = l1t_line / IAS_ANGLE_GEN_SCA_LOOKUP_STEP + 0.5;
+    if (row_position < 0.0)
+        row = 0;
+    else if (row_position >= lookup->num_rows)
+        row = lookup->num_rows - 1;
+    else
+        row = (int) row_position;
+
+    start_samp = &lookup->start_samp[row * lookup->num_scas];
+    end_samp = &lookup->end_samp[row * lookup->num_scas];
+
+    best_sca = metadata->num_scas / 2;
+    best_distance = HUGE_VAL;
+    for (sca_index = 0; sca_index < lookup->num_scas; sca_index++)
+    {
+        if (l1t_samp < start_samp[sca_index])
+            distance = start_samp[sca_index] - l1t_samp;
+        else if (l1t_samp > end_samp[sca_index])
+            distance = l1t_samp - end_samp[sca_index];
+        else
+            return sca_index;
+
+        if (distance < best_distance)
+        {
+            best_distance = distance;
+            best_sca = sca_index;
+        }
+    }
+
+    return best_sca;
+}
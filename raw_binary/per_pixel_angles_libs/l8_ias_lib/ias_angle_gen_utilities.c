@@ -65,3 +65,52 @@ double ias_angle_gen_valid_band_index
 
     return TRUE;
 }
+
+/*******************************************************************************
+Name: ias_angle_gen_find_sca_mask
+
+Purpose: Finds the set of SCAs the input L1T line/sample/height location falls
+         in, as a bit mask with bit N set for SCA index N.  Locations in the
+         same SCA overlap region have the same mask, so it can be used to keep
+         interpolation from crossing SCA boundaries.
+
+Note: If height not needed pass NULL pointer as height.
+
+Returns: 
+    Type = integer
+    SUCCESS / ERROR
+*******************************************************************************/
+int ias_angle_gen_find_sca_mask
+(
+    const IAS_ANGLE_GEN_METADATA *metadata, /* I: Angle metadata */
+    int band_index,         /* I: Current band index */
+    double l1t_line,        /* I: Input L1T line */
+    double l1t_samp,        /* I: Input L1T sample */
+    const double *height,   /* I: Input height, NULL for zero height */
+    int *sca_mask           /* O: Bit mask of the SCAs containing the point */
+)
+{
+    const IAS_ANGLE_GEN_BAND *band_ptr; /* Band metadata pointer */
+    double l1r_line[IAS_MAX_NSCAS];     /* L1R lines for each SCA found */
+    double l1r_samp[IAS_MAX_NSCAS];     /* L1R samples for each SCA found */
+    int nsca_found;                     /* Number of SCAs found */
+    int index;                          /* SCA found index */
+
+    *sca_mask = 0;
+
+    if (!ias_angle_gen_valid_band_index(metadata, band_index))
+    {
+        IAS_LOG_ERROR("Invalid band index %d", band_index);
+        return ERROR;
+    }
+    band_ptr = &metadata->band_metadata[band_index];
+
+    nsca_found = ias_angle_gen_find_scas(band_ptr, l1t_line, l1t_samp, height,
+        l1r_line, l1r_samp);
+
+    /* The SCA index is folded into the returned L1R sample */
+    for (index = 0; index < nsca_found; index++)
+        *sca_mask |= 1 << (int) (l1r_samp[index] / band_ptr->l1r_samps);
+
+    return SUCCESS;
+}
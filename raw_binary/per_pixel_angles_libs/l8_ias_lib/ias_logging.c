@@ -298,6 +298,7 @@ static int format_time
 )
 {
     time_t ptime;                 /* Time in seconds  */
+    struct tm ltime_buf;          /* Buffer for the local time */
     struct tm *ltime;             /* Time in local time */
 
     /* Get the current time */
@@ -309,7 +310,7 @@ static int format_time
     }
 
     /* Convert the current time to local time */
-    ltime = localtime(&ptime);
+    ltime = localtime_r(&ptime, &ltime_buf);
     if (ltime == NULL)
     {
         stamp[0] = '\0';
@@ -348,15 +349,6 @@ static void log_message
     char temp_string[500];
     static const char *log_level_message[] = {"DEBUG", "INFO", "WARN", "ERROR"};
 
-    /* if file_ptr is not set (ias_log_message is not called), stdout is used */
-    if (file_ptr == NULL)      
-        file_ptr = stdout;
-
-    /* if pid is not set (ias_log_message is not called), getpid is called to
-       get the current processor id */
-    if (pid == 0)
-        pid = getpid();
-
     /* if log_level is out of range, log_level is set to be 
        IAS_LOG_LEVEL_ERROR */
     if (log_level < IAS_LOG_LEVEL_DEBUG || log_level > IAS_LOG_LEVEL_ERROR)
@@ -367,13 +359,30 @@ static void log_message
                          "IAS_LOG_LEVEL_WARN, and IAS_LOG_LEVEL_ERROR");
     }
 
-    /* if log_level is high enough, output the message */
-    if (log_level >= ias_log_message_level)
+    /* if log_level isn't high enough, there is nothing to output */
+    if (log_level < ias_log_message_level)
+        return;
+
+    /* Set arg_ptr to beginning of list of optional arguments */
+    vsnprintf(temp_string, sizeof(temp_string), format, ap);
+    format_time(time_stamp, sizeof(time_stamp),"%F %H:%M:%S");
+
+    /* Messages may be logged from the threads of the per-pixel angle loops,
+       so serialize the lazy setup of the output and the message itself */
+#ifdef _OPENMP
+    #pragma omp critical (ias_log)
+#endif
     {
-        /* Set arg_ptr to beginning of list of optional arguments */
-        vsnprintf(temp_string, sizeof(temp_string), format, ap);
+        /* if file_ptr is not set (ias_log_message is not called), stdout is
+           used */
+        if (file_ptr == NULL)      
+            file_ptr = stdout;
+
+        /* if pid is not set (ias_log_message is not called), getpid is called
+           to get the current processor id */
+        if (pid == 0)
+            pid = getpid();
 
-        format_time(time_stamp, sizeof(time_stamp),"%F %H:%M:%S");
         fprintf(file_ptr, "%19s  %s  %7d %-20s  %6d  %s %s\n",
                 time_stamp, program_name, pid, filename, 
                 line_number, log_level_message[log_level], temp_string);     
@@ -132,6 +132,10 @@ typedef struct ias_polygon_linked_list
     struct ias_polygon_linked_list *next;/* Pointer to next polygon */
     struct ias_polygon_linked_list *child;/* Pointer to linked list of children 
                                              (polygons within this polygon) */
+    int mapped;                          /* Flag indicating the point and
+                                            segment arrays point into a
+                                            mapped polygon file and are not
+                                            freed with the polygon */
 } IAS_POLYGON_LINKED_LIST;
 
 typedef struct ias_epoch_time
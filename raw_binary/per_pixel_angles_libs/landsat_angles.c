@@ -19,6 +19,26 @@
 /* Local defines */
 #define SCALED_R2D 4500.0 / atan(1.0)
 
+/* Data passed to the angle evaluator when interpolating the angles */
+typedef struct landsat_angles_eval
+{
+    const gxx_angle_gen_metadata_TYPE *metadata; /* Angle metadata structure */
+    gxx_angle_gen_rigor_TYPE *rigor; /* Rigorous model context; NULL to use
+                                        the RPCs */
+    int band_index;                 /* Band index being evaluated */
+    double scan_buffer;             /* Scan buffering */
+    int sub_sample;                 /* Subsample factor */
+} LANDSAT_ANGLES_EVAL;
+
+/* Prototypes */
+static int evaluate_landsat_angles (void *eval_data, int num_points,
+    const double *line, const double *samp, double *angles[ANGLES_NFIELDS],
+    int *region);
+static int calculate_rigorous_line (gxx_angle_gen_rigor_TYPE *rigor,
+    int line, int sub_sample, int num_samps, int band_index,
+    double scan_buffer, double *sat_zenith, double *sat_azimuth,
+    double *sun_zenith, double *sun_azimuth);
+
 /**************************************************************************
 NAME: landsat_per_pixel_angles
 
@@ -45,6 +65,12 @@ NOTES:
   3. It will be up to the calling routine to delete the memory allocated
      for these per band angle arrays.
   4. The angles that are returned are in degrees and have been scaled by 100.
+  5. If interp has a grid_step larger than 1, the angles are computed exactly
+     on a grid every grid_step output pixels and interpolated to the other
+     pixels, within interp->max_error degrees.  See angles_interp_block.
+  6. With LANDSAT_ANGLES_RIGOROUS the angles come from the ephemeris and
+     solar vector interpolated at each pixel's observation time, rather than
+     from the angle RPCs.  This is for validating the RPC angles.
 ***************************************************************************/
 int landsat_per_pixel_angles
 (
@@ -52,6 +78,9 @@ int landsat_per_pixel_angles
     int sub_sample,         /* I: Subsample factor used when calculating the
                                   angles (1=full resolution). OW take every Nth
                                   sample from the line, where N=sub_sample */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
+    LANDSAT_ANGLES_MODEL model, /* I: Model used to compute the angles */
     char *band_list,        /* I: Band list used to calculate angles for.
                                   "ALL" - defaults to all bands 1-8 / 1-7.
                                   Must be comma separated with no spaces in
@@ -82,6 +111,7 @@ int landsat_per_pixel_angles
 {
     double scan_buffer = 0.0;             /* Scan buffering -- not used */
     gxx_angle_gen_metadata_TYPE metadata; /* Angle metadata structure */
+    gxx_angle_gen_rigor_TYPE *rigor = NULL; /* Rigorous model context */
     char sensor_type[STRLEN];             /* Sensor Type */
     char msg[STRLEN];                     /* Error messages */
     char band[STRLEN];                    /* Band number in the band_list */
@@ -129,6 +159,14 @@ int landsat_per_pixel_angles
         return ERROR;
     }
 
+    /* Make sure the interpolation error is usable */
+    if (angles_interp_enabled(interp) && interp->max_error <= 0.0)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+            "Maximum interpolation error must be positive.");
+        return ERROR;
+    }
+
     /* Read the angle coefficient file. */
     if (gxx_angle_gen_read_ang(angle_coeff_name, &metadata))
     {
@@ -196,6 +234,18 @@ int landsat_per_pixel_angles
         }
     }
 
+    /* Set up the rigorous model if it was requested */
+    if (model == LANDSAT_ANGLES_RIGOROUS)
+    {
+        rigor = gxx_angle_gen_create_rigor(&metadata);
+        if (rigor == NULL)
+        {
+            xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                "Error setting up the rigorous angle model.");
+            gxx_angle_gen_free(&metadata);
+            return ERROR;
+        }
+    }
 
     /* Process the angles for each band */
     for (band_index = 0; band_index < (int)metadata.num_bands; band_index++)
@@ -205,12 +255,14 @@ int landsat_per_pixel_angles
         short *sat_az = NULL;           /* Satellite azimuth angle */
         short *sun_zn = NULL;           /* Solar zenith angle */
         short *sun_az = NULL;           /* Solar azimuth angle */
-        double satang[2];               /* Satellite viewing angles */
-        double sunang[2];               /* Solar viewing angles */
+        double *line_angles = NULL;     /* Angles for one line */
+        double *line_sat_zn;            /* Satellite zeniths for the line */
+        double *line_sat_az;            /* Satellite azimuths for the line */
+        double *line_sun_zn;            /* Solar zeniths for the line */
+        double *line_sun_az;            /* Solar azimuths for the line */
         int index;                      /* Output sample counter */
         int line;                       /* Line index */
-        int samp;                       /* Sample index */
-        int outside_image;              /* Return was outside image */
+        int samp;                       /* Output sample index */
         int tmp_percent;                /* Current percentage for printing
                                            status */
         int curr_tmp_percent;           /* Percentage for current line */
@@ -252,6 +304,7 @@ int landsat_per_pixel_angles
             {
                 xxx_LogStatus(PROGRAM, __FILE__, __LINE__, "Error allocating "
                     "satellite zenith angle array.");
+                gxx_angle_gen_free_rigor(rigor);
                 gxx_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -265,6 +318,7 @@ int landsat_per_pixel_angles
             {
                 xxx_LogStatus(PROGRAM, __FILE__, __LINE__, "Error allocating "
                     "satellite azimuth angle array.");
+                gxx_angle_gen_free_rigor(rigor);
                 gxx_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -278,6 +332,7 @@ int landsat_per_pixel_angles
             {
                 xxx_LogStatus(PROGRAM, __FILE__, __LINE__, "Error allocating "
                     "solar zenith angle array.");
+                gxx_angle_gen_free_rigor(rigor);
                 gxx_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -291,6 +346,7 @@ int landsat_per_pixel_angles
             {
                 xxx_LogStatus(PROGRAM, __FILE__, __LINE__, "Error allocating "
                     "solar azimuth angle array.");
+                gxx_angle_gen_free_rigor(rigor);
                 gxx_angle_gen_free(&metadata);
                 return ERROR;
             }
@@ -307,10 +363,60 @@ int landsat_per_pixel_angles
         frame.ul_corner.x = metadata.corners.upleft.x;
         frame.ul_corner.y = metadata.corners.upleft.y;
 
-        /* Loop through the L1T lines and samples */
+        /* Interpolate the angles from a coarse grid if requested */
+        printf ("0%% ");
+        if (angles_interp_enabled(interp))
+        {
+            LANDSAT_ANGLES_EVAL eval;       /* Evaluation data for the band */
+            short *out[ANGLES_NFIELDS];     /* Output bands */
+
+            eval.metadata = &metadata;
+            eval.rigor = rigor;
+            eval.band_index = band_index;
+            eval.scan_buffer = scan_buffer;
+            eval.sub_sample = sub_sample;
+            out[ANGLES_SAT_ZENITH] = sat_zn;
+            out[ANGLES_SAT_AZIMUTH] = sat_az;
+            out[ANGLES_SUN_ZENITH] = sun_zn;
+            out[ANGLES_SUN_AZIMUTH] = sun_az;
+
+            /* Every pixel of the L1T frame is generated, so there is no
+               extent and no background */
+            if (angles_interp_block(evaluate_landsat_angles, &eval, interp,
+                sub_sample, num_lines, num_samps, NULL, 0, num_lines, 0, 0, out)
+                != SUCCESS)
+            {
+                sprintf(msg, "Error interpolating angles in band %d.",
+                        metadata.band_metadata[band_index].band_number);
+                xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
+                gxx_angle_gen_free_rigor(rigor);
+                gxx_angle_gen_free(&metadata);
+                return ERROR;
+            }
+
+            printf ("100%%\n");
+            fflush (stdout);
+            continue;
+        }
+
+        /* Allocate the angles for one line */
+        line_angles = malloc(ANGLES_NFIELDS * num_samps * sizeof(double));
+        if (line_angles == NULL)
+        {
+            xxx_LogStatus(PROGRAM, __FILE__, __LINE__, "Error allocating "
+                "the line angle buffer.");
+            gxx_angle_gen_free_rigor(rigor);
+            gxx_angle_gen_free(&metadata);
+            return ERROR;
+        }
+        line_sat_zn = &line_angles[ANGLES_SAT_ZENITH * num_samps];
+        line_sat_az = &line_angles[ANGLES_SAT_AZIMUTH * num_samps];
+        line_sun_zn = &line_angles[ANGLES_SUN_ZENITH * num_samps];
+        line_sun_az = &line_angles[ANGLES_SUN_AZIMUTH * num_samps];
+
+        /* Loop through the L1T lines */
         tmp_percent = 0;
         index = 0;
-        printf ("0%% ");
         for (line = 0; line < metadata.band_metadata[band_index].l1t_lines; 
              line += sub_sample)
         {
@@ -326,48 +432,66 @@ int landsat_per_pixel_angles
                 }
             }
 
-            for (samp = 0; samp < metadata.band_metadata[band_index].l1t_samps; 
-                 samp += sub_sample, index++)
+            /* Process the satellite and solar angles for the line as one
+               run, sharing the scan direction search between them */
+            if (rigor)
+            {
+                if (calculate_rigorous_line(rigor, line, sub_sample,
+                    num_samps, band_index, scan_buffer,
+                    (sat_zn && sat_az) ? line_sat_zn : NULL,
+                    (sat_zn && sat_az) ? line_sat_az : NULL,
+                    (sun_zn && sun_az) ? line_sun_zn : NULL,
+                    (sun_zn && sun_az) ? line_sun_az : NULL) != SUCCESS)
+                {
+                    sprintf(msg, "Error evaluating rigorous angles in band "
+                            "%d.",
+                            metadata.band_metadata[band_index].band_number);
+                    xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
+                    free(line_angles);
+                    gxx_angle_gen_free_rigor(rigor);
+                    gxx_angle_gen_free(&metadata);
+                    return ERROR;
+                }
+            }
+            else if (gxx_angle_gen_calculate_sat_sun_angles_rpc_run(&metadata,
+                (double)line, 0.0, (double)sub_sample, num_samps, height,
+                band_index, scan_buffer, sub_sample,
+                (sat_zn && sat_az) ? line_sat_zn : NULL,
+                (sat_zn && sat_az) ? line_sat_az : NULL,
+                (sun_zn && sun_az) ? line_sun_zn : NULL,
+                (sun_zn && sun_az) ? line_sun_az : NULL) != SUCCESS)
+            {
+                sprintf(msg, "Error evaluating angles in band %d.",
+                        metadata.band_metadata[band_index].band_number);
+                xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
+                free(line_angles);
+                gxx_angle_gen_free_rigor(rigor);
+                gxx_angle_gen_free(&metadata);
+                return ERROR;
+            }
+
+            for (samp = 0; samp < num_samps; samp++, index++)
             {
-                /* Process satellite angles */
+                /* Convert the satellite angles */
                 if (sat_az && sat_zn)
                 {
-                    if (gxx_angle_gen_calculate_angles_rpc(&metadata,
-                        (double)line, (double)samp, height, band_index,
-                        scan_buffer, sub_sample, GXX_ANGLE_GEN_SATELLITE,
-                        &outside_image, satang) != SUCCESS)
-                    {
-                        sprintf(msg,"Error evaluating view angles in band %d.",
-                                metadata.band_metadata[band_index].band_number);
-                        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
-                        return ERROR;
-                    }
-
-                    /* Calculate satellite angles from vector */
-                    sat_zn[index] = (short)floor(SCALED_R2D*satang[0] + 0.5);
-                    sat_az[index] = (short)floor(SCALED_R2D*satang[1] + 0.5);
+                    sat_zn[index] =
+                        (short)floor(SCALED_R2D*line_sat_zn[samp] + 0.5);
+                    sat_az[index] =
+                        (short)floor(SCALED_R2D*line_sat_az[samp] + 0.5);
                 }
 
-                /* Process solar angles */
+                /* Convert the solar angles */
                 if (sun_az && sun_zn)
                 {
-                    if (gxx_angle_gen_calculate_angles_rpc(&metadata,
-                        (double)line, (double)samp, height, band_index,
-                        scan_buffer, sub_sample, GXX_ANGLE_GEN_SOLAR,
-                        &outside_image, sunang) != SUCCESS)
-                    {
-                        sprintf(msg,"Error evaluating solar angles in band %d.",
-                                metadata.band_metadata[band_index].band_number);
-                        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
-                        return ERROR;
-                    }
-
-                    /* Calculate solar angles from vector */
-                    sun_zn[index] = (short)floor(SCALED_R2D*sunang[0] + 0.5);
-                    sun_az[index] = (short)floor(SCALED_R2D*sunang[1] + 0.5);
+                    sun_zn[index] =
+                        (short)floor(SCALED_R2D*line_sun_zn[samp] + 0.5);
+                    sun_az[index] =
+                        (short)floor(SCALED_R2D*line_sun_az[samp] + 0.5);
                 }
             }  /* for samp */
         }  /* for line */
+        free(line_angles);
 
         /* update status */
         printf ("100%%\n");
@@ -375,11 +499,170 @@ int landsat_per_pixel_angles
     }  /* for band_index */
 
     /* Free the ephemeris structure */
+    gxx_angle_gen_free_rigor(rigor);
     gxx_angle_gen_free(&metadata);
     return SUCCESS;
 }
 
 
+/******************************************************************************
+MODULE:  evaluate_landsat_angles
+
+PURPOSE:  Angle evaluator used by the interpolation routines.  Computes the
+exact angles for an array of L1T locations.  The region of each point is the
+L1R scan it falls in, so points are only interpolated within a scan.
+
+NOTES:
+  1. The forward and reverse scans aren't continuous with each other, so the
+     angles can jump between adjacent L1T lines in different scans.  The scan
+     is found with gxx_angle_gen_find_dir the same way the RPC and rigorous
+     models pick the scan direction, and numbered from the L1R line.
+  2. Points which aren't in any scan get a region of -1.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           An error occurred evaluating the angles
+SUCCESS         The angles were successfully calculated
+******************************************************************************/
+static int evaluate_landsat_angles
+(
+    void *eval_data,        /* I: LANDSAT_ANGLES_EVAL for the band */
+    int num_points,         /* I: Number of points to evaluate */
+    const double *line,     /* I: L1T line of each point */
+    const double *samp,     /* I: L1T sample of each point */
+    double *angles[ANGLES_NFIELDS], /* O: Angles for each field (radians) */
+    int *region             /* O: L1R scan of each point, or -1 */
+)
+{
+    const LANDSAT_ANGLES_EVAL *eval = eval_data; /* Evaluation data */
+    const gxx_angle_gen_band_TYPE *band_ptr =
+        &eval->metadata->band_metadata[eval->band_index]; /* Current band */
+    double l1r_line[2];     /* L1R line in each scan direction */
+    double l1r_samp[2];     /* L1R sample in each scan direction */
+    int num_dir;            /* Number of scan directions found */
+    gxx_scan_direction_TYPE scan_dir; /* Scan direction found */
+    int dir;                /* Index of the L1R location used */
+    double sat_ang[2];      /* Satellite zenith and azimuth angles */
+    double sun_ang[2];      /* Solar zenith and azimuth angles */
+    int outside_image;      /* Return was outside image */
+    int status;             /* Return status */
+    int i;                  /* Point index */
+
+    for (i = 0; i < num_points; i++)
+    {
+        /* Find the scan the point falls in */
+        gxx_angle_gen_find_dir(line[i], samp[i],
+            band_ptr->satellite.mean_height, eval->scan_buffer,
+            eval->sub_sample, band_ptr, l1r_line, l1r_samp, &num_dir,
+            &scan_dir);
+        if (num_dir < 1)
+            region[i] = -1;
+        else
+        {
+            dir = (num_dir > 1 && scan_dir == second_scan_direction) ? 1 : 0;
+            if (band_ptr->lines_per_scan > 0)
+                region[i] = (int)floor(l1r_line[dir]
+                    / band_ptr->lines_per_scan);
+            else
+                region[i] = dir;
+        }
+
+        if (eval->rigor)
+            status = gxx_angle_gen_calculate_sat_sun_angles_rigor(eval->rigor,
+                line[i], samp[i], NULL, eval->band_index, eval->scan_buffer,
+                eval->sub_sample, &outside_image,
+                angles[ANGLES_SAT_ZENITH] ? sat_ang : NULL,
+                angles[ANGLES_SUN_ZENITH] ? sun_ang : NULL);
+        else
+            status = gxx_angle_gen_calculate_sat_sun_angles_rpc(
+                eval->metadata, line[i], samp[i], NULL, eval->band_index,
+                eval->scan_buffer, eval->sub_sample, &outside_image,
+                angles[ANGLES_SAT_ZENITH] ? sat_ang : NULL,
+                angles[ANGLES_SUN_ZENITH] ? sun_ang : NULL);
+        if (status != SUCCESS)
+        {
+            xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                "Error evaluating angles.");
+            return ERROR;
+        }
+
+        if (angles[ANGLES_SAT_ZENITH])
+        {
+            angles[ANGLES_SAT_ZENITH][i] = sat_ang[0];
+            angles[ANGLES_SAT_AZIMUTH][i] = sat_ang[1];
+        }
+
+        if (angles[ANGLES_SUN_ZENITH])
+        {
+            angles[ANGLES_SUN_ZENITH][i] = sun_ang[0];
+            angles[ANGLES_SUN_AZIMUTH][i] = sun_ang[1];
+        }
+    }
+
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+MODULE:  calculate_rigorous_line
+
+PURPOSE:  Computes the angles for one output line with the rigorous model.
+Fills the same line buffers as gxx_angle_gen_calculate_sat_sun_angles_rpc_run.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           An error occurred evaluating the angles
+SUCCESS         The angles were successfully calculated
+******************************************************************************/
+static int calculate_rigorous_line
+(
+    gxx_angle_gen_rigor_TYPE *rigor, /* I: Rigorous model context */
+    int line,               /* I: L1T line */
+    int sub_sample,         /* I: Subsample factor */
+    int num_samps,          /* I: Number of output samples in the line */
+    int band_index,         /* I: Band index being evaluated */
+    double scan_buffer,     /* I: Scan buffering */
+    double *sat_zenith,     /* O: Satellite zeniths (radians), or NULL */
+    double *sat_azimuth,    /* O: Satellite azimuths (radians), or NULL */
+    double *sun_zenith,     /* O: Solar zeniths (radians), or NULL */
+    double *sun_azimuth     /* O: Solar azimuths (radians), or NULL */
+)
+{
+    double sat_ang[2];      /* Satellite zenith and azimuth angles */
+    double sun_ang[2];      /* Solar zenith and azimuth angles */
+    int outside_image;      /* Return was outside image */
+    int samp;               /* Output sample index */
+
+    for (samp = 0; samp < num_samps; samp++)
+    {
+        if (gxx_angle_gen_calculate_sat_sun_angles_rigor(rigor, (double)line,
+            (double)(samp * sub_sample), NULL, band_index, scan_buffer,
+            sub_sample, &outside_image, sat_zenith ? sat_ang : NULL,
+            sun_zenith ? sun_ang : NULL) != SUCCESS)
+        {
+            return ERROR;
+        }
+
+        if (sat_zenith)
+        {
+            sat_zenith[samp] = sat_ang[0];
+            sat_azimuth[samp] = sat_ang[1];
+        }
+        if (sun_zenith)
+        {
+            sun_zenith[samp] = sun_ang[0];
+            sun_azimuth[samp] = sun_ang[1];
+        }
+    }
+
+    return SUCCESS;
+}
+
+
 /******************************************************************************
 MODULE:  init_per_pixel_angles
 
@@ -13,6 +13,18 @@
 #include "raw_binary_io.h"
 #include "envi_header.h"
 
+/* Local Includes */
+#include "angles_interp.h"
+
+/* Model used to compute the angles */
+typedef enum landsat_angles_model
+{
+    LANDSAT_ANGLES_RPC = 0,     /* Rational polynomials from the ANG file */
+    LANDSAT_ANGLES_RIGOROUS     /* Ephemeris and solar vector interpolated at
+                                   the observation time of each pixel; slower,
+                                   meant for validating the RPC angles */
+} LANDSAT_ANGLES_MODEL;
+
 /* Used as median between API and main routine for the band metadata needed to
     write the image to file */
 typedef struct angle_frame
@@ -33,6 +45,9 @@ int landsat_per_pixel_angles
     int sub_sample,         /* I: Subsample factor used when calculating the
                                   angles (1=full resolution). OW take every Nth
                                   sample from the line, where N=sub_sample */
+    const ANGLES_INTERP *interp, /* I: Coarse grid interpolation controls;
+                                  NULL computes every pixel exactly */
+    LANDSAT_ANGLES_MODEL model, /* I: Model used to compute the angles */
     char *band_list,        /* I: Band list used to calculate angles for.
                                   "ALL" - defaults to all bands 1-8.
                                   Must be comma separated with no spaces in
@@ -0,0 +1,258 @@
+/******************************************************************************/
+/**
+ * @file gxx_angle_gen_calculate_angles_rigor.c
+ * @brief Calculates the satellite viewing and solar angles using the
+ * rigorous ephemeris based model
+ * @ingroup gpsAngleCoef
+ */
+/******************************************************************************/
+
+/* Standard Library Includes */
+#include <stdlib.h>
+#include <math.h>
+
+/* IAS Library Includes */
+#include "xxx_LogStatus.h"
+#include "gxx_angle_gen_distro.h"
+#include "gxx_angle_gen_private.h"
+
+/* Context for evaluating the rigorous model over a whole scene.  Holds the
+   interpolation contexts for the ephemeris and solar vector, and the
+   metadata the projection transformation is cached in. */
+struct gxx_angle_gen_rigor
+{
+    gxx_angle_gen_metadata_TYPE *metadata;      /* Metadata structure */
+    gxx_angle_gen_ephem_interp_TYPE sat_interp; /* Ephemeris context */
+    gxx_angle_gen_ephem_interp_TYPE sun_interp; /* Solar vector context */
+};
+
+/******************************************************************************/
+/**
+ * @brief Finds the L1R location of an L1T location and evaluates the
+ * rigorous view vectors there, then converts them to angles.
+ *
+ * @return ERROR: Failed to calculate angles
+ * @return SUCCESS: Successfully calculated angles
+ */
+/******************************************************************************/
+static int calculate_angles_rigor
+(
+    gxx_angle_gen_metadata_TYPE *metadata, //!<[in] Metadata structure
+    gxx_angle_gen_ephem_interp_TYPE *sat_interp, //!<[in/out] Ephemeris
+                                                 // context or NULL
+    gxx_angle_gen_ephem_interp_TYPE *sun_interp, //!<[in/out] Solar vector
+                                                 // context or NULL
+    double l1t_line,        //!<[in] Output space line coordinate
+    double l1t_samp,        //!<[in] Output space sample coordinate
+    const double *elev,     //!<[in] Pointer to input elevation or NULL if mean
+                            // scene height should be used
+    int band_index,         //!<[in] Current band index
+    double scan_buffer,     //!<[in] Scan buffer
+    int subsamp,            //!<[in] Sub sample factor
+    int *outside_image_flag,//!<[out] Flag indicating return was outside image
+    double *sat_angle,      //!<[out] Satellite zenith and azimuth angles, or
+                            // NULL
+    double *sun_angle       //!<[out] Solar zenith and azimuth angles, or NULL
+)
+{
+    double height;      /* Model height */
+    double l1r_line[2]; /* Input space (L1R) line coordinates */
+    double l1r_samp[2]; /* Input space (L1R) sample coordinates */
+    const gxx_angle_gen_band_TYPE *band_ptr;    /* Pointer to current band */
+    gxx_scan_direction_TYPE scan_dir; /* Scan direction */
+    int num_dir;        /* Number of scan directions found */
+    int index;          /* Index of the L1R location used */
+    int dir;            /* Scan direction of the L1R location used */
+    VECTOR sat_view;    /* Satellite view vector */
+    VECTOR sun_view;    /* Solar view vector */
+
+    band_ptr = &metadata->band_metadata[band_index];
+
+    /* Set the height to use */
+    height = band_ptr->satellite.mean_height;
+    if (elev) 
+        height = *elev;
+
+    /* Get the scan direction and L1R location the point falls in */
+    gxx_angle_gen_find_dir(l1t_line, l1t_samp, height, scan_buffer, subsamp,
+                           band_ptr, l1r_line, l1r_samp, &num_dir, &scan_dir);
+    *outside_image_flag = (num_dir < 1);
+
+    /* Use the same L1R location as the RPC angles, with the scan time
+       polynomial of the direction it was found in */
+    index = 0;
+    if (num_dir > 1 && scan_dir == second_scan_direction)
+        index = 1;
+    dir = (scan_dir == second_scan_direction) ? 1 : 0;
+
+    if (gxx_angle_gen_calculate_sat_sun_vectors(metadata, sat_interp,
+        sun_interp, l1t_line, l1t_samp, l1r_line[index], l1r_samp[index],
+        height, band_index, dir, sat_angle ? &sat_view : NULL,
+        sun_angle ? &sun_view : NULL) != SUCCESS)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error calculating the view vectors");
+        return ERROR;
+    }
+
+    /* Calculate zenith and azimuth angles */
+    if (sat_angle)
+    {
+        sat_angle[IAS_ANGLE_GEN_ZENITH_INDEX] = acos(sat_view.z);
+        sat_angle[IAS_ANGLE_GEN_AZIMUTH_INDEX] = atan2(sat_view.x, sat_view.y);
+    }
+    if (sun_angle)
+    {
+        sun_angle[IAS_ANGLE_GEN_ZENITH_INDEX] = acos(sun_view.z);
+        sun_angle[IAS_ANGLE_GEN_AZIMUTH_INDEX] = atan2(sun_view.x, sun_view.y);
+    }
+
+    return SUCCESS;
+}
+
+/******************************************************************************/
+/**
+ * @brief Calculates the satellite viewing or solar angles using the rigorous
+ * ephemeris based model
+ *
+ * Calculates the satellite viewing or solar illumination zenith and azimuth
+ * angles for a specified L1T line/sample and height by interpolating the
+ * ephemeris or solar vector at the observation time.  This is meant for
+ * checking individual points; use gxx_angle_gen_create_rigor and
+ * gxx_angle_gen_calculate_sat_sun_angles_rigor for whole scenes.
+ *
+ * @return ERROR: Failed to calculate angles
+ * @return SUCCESS: Successfully calculated angles
+ */
+/******************************************************************************/
+int gxx_angle_gen_calculate_angles_rigor
+(
+    gxx_angle_gen_metadata_TYPE *metadata,//!<[in] Metadata structure
+    double l1t_line,    //!<[in] Output space line coordinate
+    double l1t_samp,    //!<[in] Output space sample coordinate
+    const double *elev, //!<[in] Pointer to input elevation or NULL if
+                        // mean scene height should be used
+    int band_index,     //!<[in] Current band index
+    double scan_buffer, //!<[in] scan buffer
+    int subsamp,        //!<[in] sub sample factor
+    gxx_angle_gen_TYPE sat_or_sun_type, //!<[in] Angle calculation type
+    int *outside_image_flag,//!<[out] Flag indicating return was outside image
+    double *angle       //!<[out] Array containing zenith and azimuth angles
+)
+{
+    return calculate_angles_rigor(metadata, NULL, NULL, l1t_line, l1t_samp,
+        elev, band_index, scan_buffer, subsamp, outside_image_flag,
+        (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE) ? angle : NULL,
+        (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE) ? NULL : angle);
+}
+
+/******************************************************************************/
+/**
+ * @brief Sets up a context for evaluating the rigorous model over a scene
+ *
+ * The projection transformation is set up once and cached in the metadata,
+ * and the ephemeris and solar vector get interpolation contexts which find
+ * the interpolation window from the previous one and use precomputed
+ * Lagrange weights.  The metadata must outlive the context.
+ *
+ * @return Pointer to the context, or NULL on error
+ */
+/******************************************************************************/
+gxx_angle_gen_rigor_TYPE *gxx_angle_gen_create_rigor
+(
+    gxx_angle_gen_metadata_TYPE *metadata //!<[in/out] Metadata structure
+)
+{
+    gxx_angle_gen_rigor_TYPE *rigor;    /* New context */
+
+    if (gxx_angle_gen_create_transformation(metadata) != SUCCESS)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error setting up the projection transformation");
+        return NULL;
+    }
+
+    rigor = malloc(sizeof(*rigor));
+    if (!rigor)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error allocating the rigorous model context");
+        return NULL;
+    }
+    rigor->metadata = metadata;
+
+    if (gxx_angle_gen_init_ephem_interp(metadata->ephemeris,
+        metadata->ephem_count, &rigor->sat_interp) != SUCCESS)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error setting up the ephemeris interpolation");
+        free(rigor);
+        return NULL;
+    }
+
+    if (gxx_angle_gen_init_ephem_interp(metadata->solar_vector,
+        metadata->ephem_count, &rigor->sun_interp) != SUCCESS)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error setting up the solar vector interpolation");
+        gxx_angle_gen_free_ephem_interp(&rigor->sat_interp);
+        free(rigor);
+        return NULL;
+    }
+
+    return rigor;
+}
+
+/******************************************************************************/
+/**
+ * @brief Frees a rigorous model context
+ */
+/******************************************************************************/
+void gxx_angle_gen_free_rigor
+(
+    gxx_angle_gen_rigor_TYPE *rigor //!<[in] Context to free, or NULL
+)
+{
+    if (!rigor)
+        return;
+
+    gxx_angle_gen_free_ephem_interp(&rigor->sat_interp);
+    gxx_angle_gen_free_ephem_interp(&rigor->sun_interp);
+    free(rigor);
+}
+
+/******************************************************************************/
+/**
+ * @brief Calculates the satellite viewing and solar angles together using
+ * the rigorous ephemeris based model
+ *
+ * Same as gxx_angle_gen_calculate_angles_rigor for each angle type, but the
+ * scan direction search, geographic location, and observation time are
+ * shared, and the interpolation uses the context.  A context must not be
+ * used by more than one thread at a time.  Pass NULL for sat_angle or
+ * sun_angle to skip that angle type.
+ *
+ * @return ERROR: Failed to calculate angles
+ * @return SUCCESS: Successfully calculated angles
+ */
+/******************************************************************************/
+int gxx_angle_gen_calculate_sat_sun_angles_rigor
+(
+    gxx_angle_gen_rigor_TYPE *rigor, //!<[in/out] Rigorous model context
+    double l1t_line,        //!<[in] Output space line coordinate
+    double l1t_samp,        //!<[in] Output space sample coordinate
+    const double *elev,     //!<[in] Pointer to input elevation or NULL if mean
+                            // scene height should be used
+    int band_index,         //!<[in] Current band index
+    double scan_buffer,     //!<[in] Scan buffer
+    int subsamp,            //!<[in] Sub sample factor
+    int *outside_image_flag,//!<[out] Flag indicating return was outside image
+    double *sat_angle,      //!<[out] Satellite zenith and azimuth angles, or
+                            // NULL
+    double *sun_angle       //!<[out] Solar zenith and azimuth angles, or NULL
+)
+{
+    return calculate_angles_rigor(rigor->metadata, &rigor->sat_interp,
+        &rigor->sun_interp, l1t_line, l1t_samp, elev, band_index, scan_buffer,
+        subsamp, outside_image_flag, sat_angle, sun_angle);
+}
@@ -62,6 +62,72 @@ static void calculate_rpc_vector_value
     *output_value = mean_offset + (equation_num / equation_den);
 }
 
+/******************************************************************************/
+/**
+ * @brief Picks which of the L1R locations found by gxx_angle_gen_find_dir is
+ * used to evaluate the angles.
+ *
+ * @return Index of the L1R location to use
+ */
+/******************************************************************************/
+static int select_dir
+(
+    int num_dir,                        //!<[in] Number of directions found
+    gxx_scan_direction_TYPE scan_dir    //!<[in] Scan direction found
+)
+{
+    if (num_dir > 1 && scan_dir == second_scan_direction)
+        return 1;
+
+    return 0;
+}
+
+/******************************************************************************/
+/**
+ * @brief Evaluates the zenith and azimuth angles for one angle type at an
+ * L1T location which has already been mapped to L1R.
+ */
+/******************************************************************************/
+static void calculate_angles_at_l1r
+(
+    const gxx_angle_gen_ang_rpc_TYPE *data_ptr, //!<[in] Solar or satellite
+                                                // coefficients
+    double l1t_line,        //!<[in] Offset output space line coordinate
+    double l1t_samp,        //!<[in] Offset output space sample coordinate
+    double height,          //!<[in] Offset height
+    double l1r_line,        //!<[in] L1R line coordinate
+    double l1r_samp,        //!<[in] L1R sample coordinate
+    double *angle           //!<[out] Array containing zenith and azimuth
+                            // angles
+)
+{
+    VECTOR vector;          /* Viewing vector */
+
+    /* Determine the line and sample location using the L1R offset */
+    l1r_line -= data_ptr->line_terms.l1r_mean_offset;
+    l1r_samp -= data_ptr->samp_terms.l1r_mean_offset;
+
+    /* Calculate the rpc vector */ 
+    calculate_rpc_vector_value(l1t_line, l1t_samp, l1r_line, 
+        l1r_samp, data_ptr->mean_offset.x, height, 
+        data_ptr->x_terms.numerator, data_ptr->x_terms.denominator, 
+        &vector.x);
+
+    calculate_rpc_vector_value(l1t_line, l1t_samp, l1r_line, 
+        l1r_samp, data_ptr->mean_offset.y, height, 
+        data_ptr->y_terms.numerator, data_ptr->y_terms.denominator, 
+        &vector.y);
+
+    calculate_rpc_vector_value(l1t_line, l1t_samp, l1r_line, 
+        l1r_samp, data_ptr->mean_offset.z, height, 
+        data_ptr->z_terms.numerator, data_ptr->z_terms.denominator, 
+        &vector.z);
+
+    /* Calculate zenith and azimuth angles */
+    angle[IAS_ANGLE_GEN_ZENITH_INDEX] = acos(vector.z);
+    angle[IAS_ANGLE_GEN_AZIMUTH_INDEX] = atan2(vector.x, vector.y);
+}
+
 /******************************************************************************/
 /**
  * @brief Calculates the satellite viewing and solar angles using rational
@@ -89,6 +155,48 @@ int gxx_angle_gen_calculate_angles_rpc
     int *outside_image_flag,//!<[out] Flag indicating return was outside image 
     double *angle          //!<[out] Array containing zenith and azimuth angles
 )       
+{
+    if (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE)
+    {
+        return gxx_angle_gen_calculate_sat_sun_angles_rpc(metadata, l1t_line,
+            l1t_samp, elev, band_index, scan_buffer, subsamp,
+            outside_image_flag, angle, NULL);
+    }
+
+    return gxx_angle_gen_calculate_sat_sun_angles_rpc(metadata, l1t_line,
+        l1t_samp, elev, band_index, scan_buffer, subsamp, outside_image_flag,
+        NULL, angle);
+}
+
+/******************************************************************************/
+/**
+ * @brief Calculates the satellite viewing and solar angles together using
+ * rational polynomial coefficients
+ *
+ * Same as calling gxx_angle_gen_calculate_angles_rpc for the satellite and
+ * the solar angles, but the scan direction search and the L1T/L1R offsets
+ * are only done once and shared by both angle types.  Pass NULL for
+ * sat_angle or sun_angle to skip that angle type.
+ *
+ * @return ERROR: Failed to calculate angles
+ * @return SUCCESS: Successfully calculated angles
+ */
+/******************************************************************************/
+int gxx_angle_gen_calculate_sat_sun_angles_rpc
+(
+    const gxx_angle_gen_metadata_TYPE *metadata, //!<[in] Metadata structure 
+    double l1t_line,        //!<[in] Output space line coordinate 
+    double l1t_samp,        //!<[in] Output space sample coordinate 
+    const double *elev,     //!<[in] Pointer to input elevation or NULL if mean
+                            // scene height should be used
+    int band_index,         //!<[in] Current band index
+    double scan_buffer,     //!<[in] Scan buffer
+    int subsamp,            //!<[in] Sub sample factor
+    int *outside_image_flag,//!<[out] Flag indicating return was outside image 
+    double *sat_angle,      //!<[out] Satellite zenith and azimuth angles, or
+                            // NULL
+    double *sun_angle       //!<[out] Solar zenith and azimuth angles, or NULL
+)       
 {
     double height;      /* Model height */
     double l1r_line[2]; /* Input space (L1R) line coordinate declared size 2
@@ -96,14 +204,10 @@ int gxx_angle_gen_calculate_angles_rpc
     double l1r_samp[2]; /* Input space (L1R) sample coordinate declared size
                            2 so it can support 2 SCAs */
     const gxx_angle_gen_band_TYPE *band_ptr;    /* Pointer to current band */
-    const gxx_angle_gen_ang_rpc_TYPE *data_ptr; /* Solar or satellite pointer */
     int dir;            /* Scan direction */
     gxx_scan_direction_TYPE scan_dir; /*Scan direction */
     int num_dir;
 
-    /* Initialize the output zenith and azimuth*/
-    angle[IAS_ANGLE_GEN_ZENITH_INDEX] = 0.0;
-    angle[IAS_ANGLE_GEN_AZIMUTH_INDEX] = 0.0;
     *outside_image_flag = 0;
 
     /* Setup the band pointer */
@@ -115,64 +219,139 @@ int gxx_angle_gen_calculate_angles_rpc
         height = *elev;
 
     /* Get the scan direction the point falls in. */
-    dir = gxx_angle_gen_find_dir(l1t_line, l1t_samp, height, scan_buffer, 
-                                 subsamp,
-                                 &(metadata->band_metadata[band_index]),
-                                 l1r_line, l1r_samp, &num_dir, &scan_dir);
-
-    if (dir == SUCCESS && scan_dir != no_scan_direction)
-    {
-        dir = 0;
-    }
-    
-    if( num_dir > 1 )
-    {
-        if( scan_dir == first_scan_direction )
-            dir = 0;
-        else if( scan_dir == second_scan_direction )
-            dir = 1;
-        else
-            dir = 0;
-    }
-    else
-            dir = 0;
+    gxx_angle_gen_find_dir(l1t_line, l1t_samp, height, scan_buffer, subsamp,
+                           band_ptr, l1r_line, l1r_samp, &num_dir, &scan_dir);
+    dir = select_dir(num_dir, scan_dir);
 
     /* Offset the output space coordinates */
     l1t_line -= band_ptr->satellite.line_terms.l1t_mean_offset;
     l1t_samp -= band_ptr->satellite.samp_terms.l1t_mean_offset;
     height -= band_ptr->satellite.mean_height;
 
-    data_ptr = &band_ptr->solar;
-    if (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE)
+    if (sat_angle)
     {
-        data_ptr = &band_ptr->satellite;
+        calculate_angles_at_l1r(&band_ptr->satellite, l1t_line, l1t_samp,
+            height, l1r_line[dir], l1r_samp[dir], sat_angle);
     }
 
-    VECTOR vector;          /* Viewing vector */
+    if (sun_angle)
+    {
+        calculate_angles_at_l1r(&band_ptr->solar, l1t_line, l1t_samp,
+            height, l1r_line[dir], l1r_samp[dir], sun_angle);
+    }
 
-    /* Determine the line and sample location using the L1R offset */
-    l1r_line[dir] -= data_ptr->line_terms.l1r_mean_offset;
-    l1r_samp[dir] -= data_ptr->samp_terms.l1r_mean_offset;
+    return SUCCESS;
+}
 
-    /* Calculate the rpc vector */ 
-    calculate_rpc_vector_value(l1t_line, l1t_samp, l1r_line[dir], 
-        l1r_samp[dir], data_ptr->mean_offset.x, height, 
-        data_ptr->x_terms.numerator, data_ptr->x_terms.denominator, 
-        &vector.x);
+/******************************************************************************/
+/**
+ * @brief Calculates the satellite viewing and solar angles for a run of
+ * samples on one L1T line
+ *
+ * Same as calling gxx_angle_gen_calculate_sat_sun_angles_rpc for each sample
+ * in the run, except the scan direction search uses
+ * gxx_angle_gen_find_dir_run so the line dependent parts of the image RPCs
+ * are only evaluated once per run.  Pass NULL for both arrays of an angle
+ * type to skip it.
+ *
+ * @return ERROR: Failed to calculate angles
+ * @return SUCCESS: Successfully calculated angles
+ */
+/******************************************************************************/
+int gxx_angle_gen_calculate_sat_sun_angles_rpc_run
+(
+    const gxx_angle_gen_metadata_TYPE *metadata, //!<[in] Metadata structure 
+    double l1t_line,        //!<[in] Output space line coordinate 
+    double start_samp,      //!<[in] Output space sample of the first sample
+    double samp_step,       //!<[in] Output space samples between samples
+    int num_samps,          //!<[in] Number of samples in the run
+    const double *elev,     //!<[in] Pointer to the input elevation for the
+                            // run or NULL if mean scene height should be used
+    int band_index,         //!<[in] Current band index
+    double scan_buffer,     //!<[in] Scan buffer
+    int subsamp,            //!<[in] Sub sample factor
+    double *sat_zenith,     //!<[out] Satellite zenith angles, or NULL
+    double *sat_azimuth,    //!<[out] Satellite azimuth angles, or NULL
+    double *sun_zenith,     //!<[out] Solar zenith angles, or NULL
+    double *sun_azimuth     //!<[out] Solar azimuth angles, or NULL
+)
+{
+    double height;          /* Model height */
+    double l1r_line[2 * GXX_ANGLE_GEN_RUN_SIZE]; /* L1R lines, 2 per sample */
+    double l1r_samp[2 * GXX_ANGLE_GEN_RUN_SIZE]; /* L1R samps, 2 per sample */
+    int num_dir[GXX_ANGLE_GEN_RUN_SIZE]; /* Directions found per sample */
+    gxx_scan_direction_TYPE scan_dir[GXX_ANGLE_GEN_RUN_SIZE];
+                            /* Scan direction found per sample */
+    const gxx_angle_gen_band_TYPE *band_ptr;    /* Pointer to current band */
+    double line_offset;     /* Offset output space line */
+    double height_offset;   /* Offset height */
+    int do_sat;             /* Calculate the satellite angles? */
+    int do_sun;             /* Calculate the solar angles? */
+    int start;              /* First sample of the current chunk */
 
-    calculate_rpc_vector_value(l1t_line, l1t_samp, l1r_line[dir], 
-        l1r_samp[dir], data_ptr->mean_offset.y, height, 
-        data_ptr->y_terms.numerator, data_ptr->y_terms.denominator, 
-        &vector.y);
+    band_ptr = &metadata->band_metadata[band_index];
+    do_sat = (sat_zenith && sat_azimuth);
+    do_sun = (sun_zenith && sun_azimuth);
 
-    calculate_rpc_vector_value(l1t_line, l1t_samp, l1r_line[dir], 
-        l1r_samp[dir], data_ptr->mean_offset.z, height, 
-        data_ptr->z_terms.numerator, data_ptr->z_terms.denominator, 
-        &vector.z);
+    /* Set the height to use */
+    height = band_ptr->satellite.mean_height;
+    if (elev) 
+        height = *elev;
 
-    /* Calculate zenith and azimuth angles */
-    angle[IAS_ANGLE_GEN_ZENITH_INDEX] += acos(vector.z);
-    angle[IAS_ANGLE_GEN_AZIMUTH_INDEX] += atan2(vector.x, vector.y);
+    line_offset = l1t_line - band_ptr->satellite.line_terms.l1t_mean_offset;
+    height_offset = height - band_ptr->satellite.mean_height;
+
+    for (start = 0; start < num_samps; start += GXX_ANGLE_GEN_RUN_SIZE)
+    {
+        int count;          /* Number of samples in this chunk */
+        int index;          /* Sample index in the chunk */
+
+        count = num_samps - start;
+        if (count > GXX_ANGLE_GEN_RUN_SIZE)
+            count = GXX_ANGLE_GEN_RUN_SIZE;
+
+        /* Get the scan direction for each sample of the chunk */
+        if (gxx_angle_gen_find_dir_run(l1t_line,
+            start_samp + start * samp_step, samp_step, count, height,
+            scan_buffer, subsamp, band_ptr, l1r_line, l1r_samp, num_dir,
+            scan_dir) != SUCCESS)
+        {
+            xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                "Error finding the scan directions for a run of samples");
+            return ERROR;
+        }
+
+        for (index = 0; index < count; index++)
+        {
+            double samp_offset; /* Offset output space sample */
+            double angle[2];    /* Zenith and azimuth angles */
+            int dir;            /* Scan direction */
+
+            dir = 2 * index + select_dir(num_dir[index], scan_dir[index]);
+            samp_offset = start_samp + (start + index) * samp_step
+                - band_ptr->satellite.samp_terms.l1t_mean_offset;
+
+            if (do_sat)
+            {
+                calculate_angles_at_l1r(&band_ptr->satellite, line_offset,
+                    samp_offset, height_offset, l1r_line[dir], l1r_samp[dir],
+                    angle);
+                sat_zenith[start + index] = angle[IAS_ANGLE_GEN_ZENITH_INDEX];
+                sat_azimuth[start + index]
+                    = angle[IAS_ANGLE_GEN_AZIMUTH_INDEX];
+            }
+
+            if (do_sun)
+            {
+                calculate_angles_at_l1r(&band_ptr->solar, line_offset,
+                    samp_offset, height_offset, l1r_line[dir], l1r_samp[dir],
+                    angle);
+                sun_zenith[start + index] = angle[IAS_ANGLE_GEN_ZENITH_INDEX];
+                sun_azimuth[start + index]
+                    = angle[IAS_ANGLE_GEN_AZIMUTH_INDEX];
+            }
+        }
+    }
 
     return SUCCESS;
 }
@@ -79,6 +79,87 @@ static void gxx_angle_gen_l1t_to_proj
         - metadata->band_metadata[band_index].pixel_size * l1t_line;
 }
 
+/******************************************************************************/
+/**
+ * @brief Converts an ECEF vector (satellite position or solar vector) to a
+ * view vector in the local vertical frame
+ *
+ * @return SUCCESS: Successful completion
+ * @return ERROR: Operation failed
+ */
+/******************************************************************************/
+static int gxx_angle_gen_ecef_to_view
+(
+    const gxx_angle_gen_metadata_TYPE *metadata, //!<[in] Metadata structure
+    gxx_angle_gen_TYPE sat_or_sun_type, //!<[in] Angle type
+    const VECTOR *ecef_vertical, //!<[in] Local vertical basis vectors
+    double latitude,            //!<[in] Latitude (radians)
+    double longitude,           //!<[in] Longitude (radians)
+    double height,              //!<[in] Current L1T height
+    VECTOR ecef_vector,         //!<[in] Interpolated ECEF vector
+    VECTOR *view                //!<[out] View vector
+)
+{
+    VECTOR ground_position;        /* Ground ECEF vector */
+
+    /* Adjust the ecef vector for the satellite */
+    if (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE)
+    {
+        /* Calculate the ground position vector */
+        gxx_angle_gen_geo_to_ecef(metadata, latitude, longitude, height, 
+            &ground_position);
+
+        ecef_vector.x -= ground_position.x;
+        ecef_vector.y -= ground_position.y;
+        ecef_vector.z -= ground_position.z;
+    } 
+
+    /* Calculate the ECEF vector */
+    if (gxx_unit(&ecef_vector, &ground_position) != SUCCESS)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error normalizing the ECEF vector");
+        return ERROR;
+    }
+
+    /* Calculate the view vector */
+    view->x = gxx_dot(&ground_position, &ecef_vertical[0]);
+    view->y = gxx_dot(&ground_position, &ecef_vertical[1]);
+    view->z = gxx_dot(&ground_position, &ecef_vertical[2]);
+
+    return SUCCESS;
+}
+
+/******************************************************************************/
+/**
+ * @brief Interpolates an ephemeris, using the interpolation context if there
+ * is one
+ *
+ * @return SUCCESS: Successful completion
+ * @return ERROR: Operation failed
+ */
+/******************************************************************************/
+static int gxx_angle_gen_interpolate
+(
+    const gxx_angle_gen_metadata_TYPE *metadata, //!<[in] Metadata structure
+    gxx_angle_gen_ephem_interp_TYPE *interp, //!<[in/out] Interpolation
+                                             // context or NULL
+    const gxx_angle_gen_ephemeris_TYPE *ephemeris, //!<[in] Ephemeris used
+                                                   // without a context
+    double sample_time,         //!<[in] Sample time from epoch
+    VECTOR *ecef_vector         //!<[out] Interpolated vector
+)
+{
+    if (interp)
+    {
+        return gxx_angle_gen_interpolate_ephemeris_ctx(interp, sample_time,
+            ecef_vector);
+    }
+
+    return gxx_angle_gen_interpolate_ephemeris(ephemeris,
+        metadata->ephem_count, sample_time, ecef_vector);
+}
+
 /******************************************************************************/
 /**
  * @brief Calculate the satellite viewing and solar illumination vectors at a 
@@ -101,6 +182,51 @@ int gxx_angle_gen_calculate_vector
     gxx_angle_gen_TYPE sat_or_sun_type, //!<[in] Angle type
     VECTOR *view         //!<[out] View vector
 )   
+{
+    if (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE)
+    {
+        return gxx_angle_gen_calculate_sat_sun_vectors(metadata, NULL, NULL,
+            l1t_line, l1t_samp, l1r_line, l1r_samp, height, band_index, dir,
+            view, NULL);
+    }
+
+    return gxx_angle_gen_calculate_sat_sun_vectors(metadata, NULL, NULL,
+        l1t_line, l1t_samp, l1r_line, l1r_samp, height, band_index, dir,
+        NULL, view);
+}
+
+/******************************************************************************/
+/**
+ * @brief Calculate the satellite viewing and solar illumination vectors 
+ * together at a specified L1T line/sample/height location
+ *
+ * The geographic location, local vertical frame, and observation time are
+ * computed once and shared by both vectors.  The ephemeris and solar vector
+ * are interpolated with the interpolation contexts when they are provided,
+ * otherwise with gxx_angle_gen_interpolate_ephemeris.  Pass NULL for
+ * sat_view or sun_view to skip that vector.
+ *
+ * @return SUCCESS: Successful completion
+ * @return ERROR: Operation failed
+ */
+/******************************************************************************/
+int gxx_angle_gen_calculate_sat_sun_vectors
+(
+    gxx_angle_gen_metadata_TYPE *metadata,//!<[in] Metadata structure
+    gxx_angle_gen_ephem_interp_TYPE *sat_interp, //!<[in/out] Ephemeris
+                                                 // context or NULL
+    gxx_angle_gen_ephem_interp_TYPE *sun_interp, //!<[in/out] Solar vector
+                                                 // context or NULL
+    double l1t_line,         //!<[in] Current L1T line number
+    double l1t_samp,         //!<[in] Current L1T sample number
+    double l1r_line,         //!<[in] Current L1R line number
+    double l1r_samp,         //!<[in] Current L1R sample number
+    double height,           //!<[in] Current L1T height
+    unsigned int band_index, //!<[in] Current band index
+    unsigned int dir,        //!<[in] scan direction
+    VECTOR *sat_view,        //!<[out] Satellite view vector, or NULL
+    VECTOR *sun_view         //!<[out] Solar view vector, or NULL
+)   
 {
     double projection_x;               /* Projection X coordinate */
     double projection_y;               /* Projection Y coordinate */
@@ -109,7 +235,6 @@ int gxx_angle_gen_calculate_vector
     double sample_time;                /* Sample time from epoch */
     VECTOR ecef_vertical[3];       /* Vertical ECEF basis vectors */
     VECTOR ecef_vector;            /* ECEF vector */
-    gxx_angle_gen_ephemeris_TYPE *ephemeris;/* Ephemeris pointer */
     char err_msg[STRLEN];
 
     /* Convert the line/sample to projection coordinates */
@@ -141,48 +266,44 @@ int gxx_angle_gen_calculate_vector
     sample_time = gxx_angle_gen_l1r_to_time(
         &metadata->band_metadata[band_index], 
         &metadata->scan_time, dir, l1r_line, l1r_samp);
-    
-    /* Determine the correct ephemeris */
-    ephemeris = metadata->solar_vector;
-    if (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE)
-    {
-        ephemeris = metadata->ephemeris;
-    }
 
-    /* Interpolate the ecef vector */
-    if (gxx_angle_gen_interpolate_ephemeris(ephemeris, metadata->ephem_count, 
-        sample_time, &ecef_vector) != SUCCESS)
+    if (sat_view)
     {
-        xxx_LogStatus(PROGRAM, __FILE__,__LINE__, 
-                      "Error interpolating the ephemeris");
-        return ERROR;
-    }  
+        /* Interpolate the satellite position */
+        if (gxx_angle_gen_interpolate(metadata, sat_interp,
+            metadata->ephemeris, sample_time, &ecef_vector) != SUCCESS)
+        {
+            xxx_LogStatus(PROGRAM, __FILE__,__LINE__, 
+                          "Error interpolating the ephemeris");
+            return ERROR;
+        }  
 
-    VECTOR ground_position;        /* Ground ECEF vector */
-    /* Adjust the ecef vector for the satellite */
-    if (sat_or_sun_type == GXX_ANGLE_GEN_SATELLITE)
-    {
-        /* Calculate the ground position vector */
-        gxx_angle_gen_geo_to_ecef(metadata, latitude, longitude, height, 
-            &ground_position);
-
-        ecef_vector.x -= ground_position.x;
-        ecef_vector.y -= ground_position.y;
-        ecef_vector.z -= ground_position.z;
-    } 
+        if (gxx_angle_gen_ecef_to_view(metadata, GXX_ANGLE_GEN_SATELLITE,
+            ecef_vertical, latitude, longitude, height, ecef_vector,
+            sat_view) != SUCCESS)
+        {
+            return ERROR;
+        }
+    }
 
-    /* Calculate the ECEF vector */
-    if (gxx_unit(&ecef_vector, &ground_position) != SUCCESS)
+    if (sun_view)
     {
-        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
-                      "Error normalizing the ECEF vector");
-        return ERROR;
-    }
+        /* Interpolate the solar vector */
+        if (gxx_angle_gen_interpolate(metadata, sun_interp,
+            metadata->solar_vector, sample_time, &ecef_vector) != SUCCESS)
+        {
+            xxx_LogStatus(PROGRAM, __FILE__,__LINE__, 
+                          "Error interpolating the solar vector");
+            return ERROR;
+        }  
 
-    /* Calculate the view vector */
-    view->x = gxx_dot(&ground_position, &ecef_vertical[0]);
-    view->y = gxx_dot(&ground_position, &ecef_vertical[1]);
-    view->z = gxx_dot(&ground_position, &ecef_vertical[2]);
+        if (gxx_angle_gen_ecef_to_view(metadata, GXX_ANGLE_GEN_SOLAR,
+            ecef_vertical, latitude, longitude, height, ecef_vector,
+            sun_view) != SUCCESS)
+        {
+            return ERROR;
+        }
+    }
 
     return SUCCESS;
 }
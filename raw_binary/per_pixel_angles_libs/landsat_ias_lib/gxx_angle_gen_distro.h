@@ -21,6 +21,8 @@
 #define IAS_ANGLE_GEN_ZENITH_INDEX 0    /* Array index for the zenith angle */
 #define IAS_ANGLE_GEN_AZIMUTH_INDEX 1   /* Array index for the azimuth angle */
 #define SCAN_TIME_POLY_NCOEFF 4
+#define GXX_ANGLE_GEN_RUN_SIZE 256      /* Samples per scan direction search
+                                           in the run based angle routines */
 
 typedef enum gxx_angle_gen_TYPE
 {
@@ -131,6 +133,9 @@ typedef struct gxx_angle_gen_ephemeris_TYPE
 /* Type defines for projection related structures */
 typedef struct gxx_proj_transformation gxx_PROJ_TRANSFORMATION;
 
+/* Context for evaluating the rigorous ephemeris based model over a scene */
+typedef struct gxx_angle_gen_rigor gxx_angle_gen_rigor_TYPE;
+
 typedef struct gxx_angle_gen_scan_time_TYPE
 {
     unsigned int ncoeff;
@@ -191,6 +196,32 @@ int gxx_angle_gen_calculate_angles_rigor
     double *angle       /* O: Array containing zenith and azimuth angles */
 );
 
+gxx_angle_gen_rigor_TYPE *gxx_angle_gen_create_rigor
+(
+    gxx_angle_gen_metadata_TYPE *metadata /* I/O: Metadata structure */
+);
+
+void gxx_angle_gen_free_rigor
+(
+    gxx_angle_gen_rigor_TYPE *rigor /* I: Context to free, or NULL */
+);
+
+int gxx_angle_gen_calculate_sat_sun_angles_rigor
+(
+    gxx_angle_gen_rigor_TYPE *rigor, /* I/O: Rigorous model context */
+    double l1t_line,        /* I: Output space line coordinate */
+    double l1t_samp,        /* I: Output space sample coordinate */
+    const double *elev,     /* I: Pointer to input elevation or NULL if mean
+                              scene height should be used*/
+    int band_index,         /* I: Current band index */
+    double scan_buffer,     /* I: Scan buffer */
+    int subsamp,            /* I: Sub sample factor */
+    int *outside_image_flag,/* O: Flag indicating return was outside image */
+    double *sat_angle,      /* O: Satellite zenith and azimuth angles, or
+                              NULL */
+    double *sun_angle       /* O: Solar zenith and azimuth angles, or NULL */
+);
+
 int gxx_angle_gen_calculate_angles_rpc
 (
     const gxx_angle_gen_metadata_TYPE *metadata, /* I: Metadata structure */
@@ -206,6 +237,40 @@ int gxx_angle_gen_calculate_angles_rpc
     double *angle           /* O: Array containing zenith and azimuth angles */
 );
 
+int gxx_angle_gen_calculate_sat_sun_angles_rpc
+(
+    const gxx_angle_gen_metadata_TYPE *metadata, /* I: Metadata structure */
+    double l1t_line,        /* I: Output space line coordinate */
+    double l1t_samp,        /* I: Output space sample coordinate */
+    const double *elev,     /* I: Pointer to input elevation or NULL if mean
+                              scene height should be used*/
+    int band_index,         /* I: Current band index */
+    double scan_buffer,     /* I: Scan buffer */
+    int subsamp,            /* I: Sub sample factor */
+    int *outside_image_flag,/* O: Flag indicating return was outside image */
+    double *sat_angle,      /* O: Satellite zenith and azimuth angles, or
+                              NULL */
+    double *sun_angle       /* O: Solar zenith and azimuth angles, or NULL */
+);
+
+int gxx_angle_gen_calculate_sat_sun_angles_rpc_run
+(
+    const gxx_angle_gen_metadata_TYPE *metadata, /* I: Metadata structure */
+    double l1t_line,        /* I: Output space line coordinate */
+    double start_samp,      /* I: Output space sample of the first sample */
+    double samp_step,       /* I: Output space samples between samples */
+    int num_samps,          /* I: Number of samples in the run */
+    const double *elev,     /* I: Pointer to the input elevation for the run
+                              or NULL if mean scene height should be used */
+    int band_index,         /* I: Current band index */
+    double scan_buffer,     /* I: Scan buffer */
+    int subsamp,            /* I: Sub sample factor */
+    double *sat_zenith,     /* O: Satellite zenith angles, or NULL */
+    double *sat_azimuth,    /* O: Satellite azimuth angles, or NULL */
+    double *sun_zenith,     /* O: Solar zenith angles, or NULL */
+    double *sun_azimuth     /* O: Solar azimuth angles, or NULL */
+);
+
 void gxx_angle_gen_free
 (
     gxx_angle_gen_metadata_TYPE *metadata /* I: Metadata structure */
@@ -246,4 +311,24 @@ int gxx_angle_gen_find_dir
     gxx_scan_direction_TYPE *scan_dir /* O: Scan direction found */
 );
 
+int gxx_angle_gen_find_dir_run
+(
+    double l1t_line,                /* I: L1T line */
+    double start_samp,              /* I: L1T sample of the first sample */
+    double samp_step,               /* I: L1T samples between samples */
+    int num_samps,                  /* I: Number of samples in the run */
+    double height,                  /* I: height */
+    double scan_buffer,             /* I: scan buffer */
+    int subsamp,                    /* I: sub sample factor */
+    const gxx_angle_gen_band_TYPE *eband, /* I: metadata current band */
+    double              *l1r_line,  /* O: Array of output L1R line numbers,
+                                          2 per sample */
+    double              *l1r_samp,  /* O: Array of output L1R sample numbers,
+                                          2 per sample */
+    int                 *num_dir_found, /* O: Number of directions found for
+                                              each sample */
+    gxx_scan_direction_TYPE *scan_dir /* O: Scan direction found for each
+                                           sample */
+);
+
 #endif
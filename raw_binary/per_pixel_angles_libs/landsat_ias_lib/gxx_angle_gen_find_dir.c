@@ -52,6 +52,63 @@ static int gxx_angle_gen_check_buffered_scan_gap
     return ERROR;
 }
 
+/******************************************************************************/
+/**
+ * @brief Checks whether an L1R location computed with the RPC for one scan
+ * direction really falls in a scan of that direction, and records it if so.
+ */
+/******************************************************************************/
+static void gxx_angle_gen_accept_dir
+(
+    double l1r_l,                   //!<[in] L1R line for the direction
+    double l1r_s,                   //!<[in] L1R sample for the direction
+    int dir,                        //!<[in] Scan direction of the RPC used
+    double scan_buffer,             //!<[in] scan buffer
+    int subsamp,                    //!<[in] sub sample factor
+    const gxx_angle_gen_band_TYPE *eband, //!<[in] metadata current band
+    double *l1r_line,               //!<[in/out] Array of L1R line numbers
+    double *l1r_samp,               //!<[in/out] Array of L1R sample numbers
+    int *num_dir,                   //!<[in/out] Number of directions found
+    gxx_scan_direction_TYPE *scan_dir //!<[in/out] Scan direction found
+)
+{
+    int     scan_number;            /* Scan number associated with L1r line */
+    int     l1r_dir;                /* Direction associated with L1r line */
+
+    if (l1r_l > 0 && l1r_l < eband->l1r_lines && l1r_s > 0 
+        && l1r_s < eband->l1r_samps)
+    {
+        scan_number = (int)( l1r_l / eband->lines_per_scan );
+        if (scan_number % 2 == 0) 
+            l1r_dir = 0;
+        else
+            l1r_dir = 1;
+
+        if (l1r_dir == dir)
+        {
+            l1r_line[*num_dir] = l1r_l;
+            l1r_samp[*num_dir] = l1r_s;
+            (*num_dir)++;
+            /* This might be dangerous, assumes counter matches 
+               scan_direction_type enumerated type. */
+            *scan_dir = dir;
+        }
+        else if (subsamp && *scan_dir == no_scan_direction)
+        {
+            if (gxx_angle_gen_check_buffered_scan_gap(scan_buffer, l1r_l, 
+                eband) == SUCCESS)
+            {
+                l1r_line[*num_dir] = l1r_l;
+                l1r_samp[*num_dir] = l1r_s;
+                (*num_dir)++;
+                /* This might be dangerous, assumes counter matches 
+                   scan_direction_type enumerated type. */
+                *scan_dir = dir;
+            }
+        }
+    }
+}
+
 /******************************************************************************/
 /**
  * @brief Finds the scan direction with input height as an optional factor.
@@ -81,8 +138,6 @@ int gxx_angle_gen_find_dir
     double  l1r_s;                  /* Local L1R sample */
     int     dir;                    /* Scan direction */
     int     num_dir = 0;            /* Number of scan directions found */
-    int     scan_number;            /* Scan number associated with L1r line */
-    int     l1r_dir;                /* Direction associated with L1r line */
 
     *scan_dir = no_scan_direction;
     *num_dir_found = 0;
@@ -155,40 +210,136 @@ int gxx_angle_gen_find_dir
                     + eband->scan_metadata[dir].samp_terms.l1r_mean_offset;
         }
 
-        if (l1r_l > 0 && l1r_l < eband->l1r_lines && l1r_s > 0 
-            && l1r_s < eband->l1r_samps)
+        gxx_angle_gen_accept_dir(l1r_l, l1r_s, dir, scan_buffer, subsamp,
+            eband, l1r_line, l1r_samp, &num_dir, scan_dir);
+    }
+
+    *num_dir_found = num_dir;
+    return(SUCCESS);
+}
+
+/******************************************************************************/
+/**
+ * @brief Finds the scan direction for a run of samples on one L1T line.
+ *
+ * Gives the same results as calling gxx_angle_gen_find_dir for each sample
+ * in the run, but the parts of the image RPCs that only depend on the line
+ * and height are evaluated once for the run.  For a fixed line and height
+ * the RPCs reduce to (a + b * sample) / (c + d * sample).  Without a height
+ * the terms are grouped the same way as gxx_angle_gen_find_dir, so the
+ * results are identical; with a height they can differ in the last bits.
+ *
+ * The L1R lines and samples are returned two per sample, so l1r_line and
+ * l1r_samp need space for 2 * num_samps values.
+ *
+ * @ returns integer (SUCCESS or ERROR)
+ */
+/******************************************************************************/
+int gxx_angle_gen_find_dir_run
+(
+    double l1t_line,                //!<[in] L1T line
+    double start_samp,              //!<[in] L1T sample of the first sample
+    double samp_step,               //!<[in] L1T samples between samples
+    int num_samps,                  //!<[in] Number of samples in the run
+    double height,                  //!<[in] height
+    double scan_buffer,             //!<[in] scan buffer
+    int subsamp,                    //!<[in] sub sample factor
+    const gxx_angle_gen_band_TYPE *eband, //!<[in] metadata current band
+    double *l1r_line,               //!<[out] Array of output L1R line numbers
+    double *l1r_samp,               //!<[out] Array of output L1R sample 
+                                    // numbers
+    int *num_dir_found,             //!<[out] Number of directions found for
+                                    // each sample
+    gxx_scan_direction_TYPE *scan_dir //!<[out] Scan direction found for
+                                      // each sample
+)
+{
+    const gxx_angle_gen_image_rpc_TYPE *rpc; /* RPC for a scan direction */
+    double  l1t_l;                  /* Offset value of L1T line */
+    double  hgt;                    /* Offset value of height */
+    double  line_a[MAX_RPC];        /* Line RPC sample independent numerator */
+    double  line_b[MAX_RPC];        /* Line RPC numerator sample factor */
+    double  line_c[MAX_RPC];        /* Line RPC sample independent denom. */
+    double  line_d[MAX_RPC];        /* Line RPC denominator sample factor */
+    double  samp_a[MAX_RPC];        /* Samp RPC sample independent numerator */
+    double  samp_b[MAX_RPC];        /* Samp RPC numerator sample factor */
+    double  samp_c[MAX_RPC];        /* Samp RPC sample independent denom. */
+    double  samp_d[MAX_RPC];        /* Samp RPC denominator sample factor */
+    int     dir;                    /* Scan direction */
+    int     num_dirs;               /* Number of scan directions */
+    int     index;                  /* Sample index in the run */
+
+    num_dirs = eband->number_scan_dirs;
+    if (num_dirs > MAX_RPC)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+            "Too many scan directions in the band metadata");
+        return ERROR;
+    }
+
+    /* Collect the terms which are constant along the run */
+    for (dir = 0; dir < num_dirs; dir++)
+    {
+        rpc = &eband->scan_metadata[dir];
+        l1t_l = l1t_line - rpc->line_terms.l1t_mean_offset;
+
+        line_a[dir] = rpc->line_terms.numerator[0]
+            + rpc->line_terms.numerator[1] * l1t_l;
+        line_b[dir] = rpc->line_terms.numerator[2]
+            + rpc->line_terms.numerator[4] * l1t_l;
+        line_c[dir] = 1.0 + rpc->line_terms.denominator[0] * l1t_l;
+        line_d[dir] = rpc->line_terms.denominator[1]
+            + rpc->line_terms.denominator[3] * l1t_l;
+        samp_a[dir] = rpc->samp_terms.numerator[0]
+            + rpc->samp_terms.numerator[1] * l1t_l;
+        samp_b[dir] = rpc->samp_terms.numerator[2]
+            + rpc->samp_terms.numerator[4] * l1t_l;
+        samp_c[dir] = 1.0 + rpc->samp_terms.denominator[0] * l1t_l;
+        samp_d[dir] = rpc->samp_terms.denominator[1]
+            + rpc->samp_terms.denominator[3] * l1t_l;
+
+        if (height != 0)  /* Factor in height. */
         {
-            scan_number = (int)( l1r_l / eband->lines_per_scan );
-            if (scan_number % 2 == 0) 
-                l1r_dir = 0;
-            else
-                l1r_dir = 1;
+            hgt = height - rpc->mean_height;
+            line_a[dir] += rpc->line_terms.numerator[3] * hgt;
+            line_c[dir] += rpc->line_terms.denominator[2] * hgt;
+            samp_a[dir] += rpc->samp_terms.numerator[3] * hgt;
+            samp_c[dir] += rpc->samp_terms.denominator[2] * hgt;
+        }
+    }
 
-            if (l1r_dir == dir)
-            {
-                l1r_line[num_dir] = l1r_l;
-                l1r_samp[num_dir] = l1r_s;
-                num_dir++;
-                /* This might be dangerous, assumes counter matches 
-                   scan_direction_type enumerated type. */
-                *scan_dir = dir;
-            }
-            else if (subsamp && *scan_dir == no_scan_direction)
-            {
-                if (gxx_angle_gen_check_buffered_scan_gap(scan_buffer, l1r_l, 
-                    eband) == SUCCESS)
-                {
-                    l1r_line[num_dir] = l1r_l;
-                    l1r_samp[num_dir] = l1r_s;
-                    num_dir++;
-                    /* This might be dangerous, assumes counter matches 
-                       scan_direction_type enumerated type. */
-                    *scan_dir = dir;
-                }
-            }
+    for (index = 0; index < num_samps; index++)
+    {
+        double *line_ptr = &l1r_line[2 * index]; /* L1R lines for sample */
+        double *samp_ptr = &l1r_samp[2 * index]; /* L1R samps for sample */
+        int num_dir = 0;            /* Number of scan directions found */
+
+        scan_dir[index] = no_scan_direction;
+        line_ptr[0] = line_ptr[1] = 0.0;
+        samp_ptr[0] = samp_ptr[1] = 0.0;
+
+        for (dir = 0; dir < num_dirs; dir++)
+        {
+            double l1t_s;           /* Offset value of L1T sample */
+            double l1r_l;           /* Local L1R line */
+            double l1r_s;           /* Local L1R sample */
+
+            rpc = &eband->scan_metadata[dir];
+            l1t_s = start_samp + index * samp_step
+                - rpc->samp_terms.l1t_mean_offset;
+            l1r_l = (line_a[dir] + line_b[dir] * l1t_s)
+                / (line_c[dir] + line_d[dir] * l1t_s)
+                + rpc->line_terms.l1r_mean_offset;
+            l1r_s = (samp_a[dir] + samp_b[dir] * l1t_s)
+                / (samp_c[dir] + samp_d[dir] * l1t_s)
+                + rpc->samp_terms.l1r_mean_offset;
+
+            gxx_angle_gen_accept_dir(l1r_l, l1r_s, dir, scan_buffer, subsamp,
+                eband, line_ptr, samp_ptr, &num_dir, &scan_dir[index]);
         }
+
+        num_dir_found[index] = num_dir;
     }
 
-    *num_dir_found = num_dir;
     return(SUCCESS);
 }
@@ -76,4 +76,6 @@ void gxx_angle_gen_free
 
     free(metadata->solar_vector);
     metadata->solar_vector = NULL;
+
+    gxx_angle_gen_free_transformation(metadata);
 }
@@ -16,6 +16,17 @@
 #include "gxx_proj.h"
 #include "gxx_angle_gen_private.h"
 
+/* Projection transformation from the L1T map projection to geographic
+   radians.  The projections and units only depend on the metadata, so they
+   are set up once and cached in the metadata. */
+struct gxx_proj_transformation
+{
+    gxx_projection_TYPE in_projection;  /* Source projection */
+    gxx_projection_TYPE out_projection; /* Destination projection */
+    int projection_units_in;            /* Source projection units */
+    int projection_units_out;           /* Destination projection units */
+};
+
 /******************************************************************************/
 /**
  * @brief Use projtran to transform a set of coordinates to a new projection.
@@ -25,8 +36,7 @@
 /******************************************************************************/
 static int gxx_angle_gen_transform_projection
 (
-    gxx_projection_TYPE in_projection,  /* I: input projection parms */
-    gxx_projection_TYPE out_projection, /* I: output projection parms */
+    gxx_PROJ_TRANSFORMATION *transformation, /* I: projection transformation */
     double in_x,                        /* I: x coordinate */
     double in_y,                        /* I: y coordinate */
     double *out_x,                      /* O: x coordinate */
@@ -36,45 +46,19 @@ static int gxx_angle_gen_transform_projection
     int status;          /* Projection package return code */
     double temp_in_x = in_x;
     double temp_in_y = in_y;
-    int projection_units_in;
-    int projection_units_out;
-    int i;
-    char msg[STRLEN];
-
-    for (i = 0; i<2; i++)
-    {
-        if (i)
-        {
-            /* Set the input projection units. */
-            if (gxx_get_units(in_projection.units, &projection_units_in) 
-                != SUCCESS)
-            {
-                sprintf(msg, "Getting the projection units for %s", 
-                        in_projection.units);
-                xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
-                return ERROR;
-            }
-        }
-        else
-        {
-            /* Set the output projection units. */
-            if (gxx_get_units(out_projection.units, &projection_units_out) 
-                != SUCCESS)
-            {
-                sprintf(msg, "Getting the projection units for %s", 
-                        out_projection.units);
-                xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
-                return ERROR;
-            }
-        }
-    }
 
     /* Apply transformation */
-    status = gxx_projtran(&in_projection.code, &projection_units_in, 
-        &in_projection.zone, in_projection.projprms, &in_projection.spheroid,
-        &out_projection.code, &projection_units_out, &out_projection.zone,
-        out_projection.projprms, &out_projection.spheroid, &temp_in_x, 
-        &temp_in_y, out_x, out_y);
+    status = gxx_projtran(&transformation->in_projection.code,
+        &transformation->projection_units_in,
+        &transformation->in_projection.zone,
+        transformation->in_projection.projprms,
+        &transformation->in_projection.spheroid,
+        &transformation->out_projection.code,
+        &transformation->projection_units_out,
+        &transformation->out_projection.zone,
+        transformation->out_projection.projprms,
+        &transformation->out_projection.spheroid, &temp_in_x, &temp_in_y,
+        out_x, out_y);
     return status;
 
 }
@@ -111,25 +95,34 @@ static void gxx_angle_gen_set_projection
 
 /******************************************************************************/
 /**
- * @brief Initialize the angle generation metadata transformation
+ * @brief Sets up the projection transformation from the L1T map projection
+ * to geographic radians and caches it in the metadata.  Does nothing if the
+ * transformation has already been set up.
  *
  * @return integer (SUCCESS or ERROR)
  */
 /******************************************************************************/
-int gxx_angle_gen_initialize_transformation
+int gxx_angle_gen_create_transformation
 (
-    gxx_angle_gen_metadata_TYPE *metadata,  /* I/O: Angle metadata struct */
-    double in_x,                            /* I: X coordinate */
-    double in_y,                            /* I: y coordinate */
-    double *out_x,                          /* O: x coordinate */
-    double *out_y                           /* O: y coordinate */
-)           
+    gxx_angle_gen_metadata_TYPE *metadata   /* I/O: Angle metadata struct */
+)
 {
     int index;                              /* Loop variable */
     double parameters[PROJPRMS_SIZE];       /* Geo parameter array */
-    gxx_projection_TYPE in_projection;      /* Source projection */
-    gxx_projection_TYPE out_projection;     /* Destination projection */
     char out_units[STRLEN] = "RADIANS";
+    gxx_PROJ_TRANSFORMATION *transformation; /* New transformation */
+    char msg[STRLEN];
+
+    if (metadata->transformation)
+        return SUCCESS;
+
+    transformation = malloc(sizeof(*transformation));
+    if (!transformation)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error allocating the projection transformation");
+        return ERROR;
+    }
 
     /* Initialize the geographic projection parameters */
     for (index = 0; index < PROJPRMS_SIZE; index++)
@@ -141,13 +134,77 @@ int gxx_angle_gen_initialize_transformation
     gxx_angle_gen_set_projection(metadata->projection.code, 
         metadata->projection.zone, metadata->units, 
         metadata->projection.spheroid, metadata->projection.projprms, 
-        &in_projection);
+        &transformation->in_projection);
     gxx_angle_gen_set_projection(GEO, NULLZONE, out_units, 
         metadata->projection.spheroid,
-        parameters, &out_projection);
+        parameters, &transformation->out_projection);
+
+    /* Set the input and output projection units. */
+    if (gxx_get_units(transformation->in_projection.units,
+        &transformation->projection_units_in) != SUCCESS)
+    {
+        sprintf(msg, "Getting the projection units for %s", 
+                transformation->in_projection.units);
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
+        free(transformation);
+        return ERROR;
+    }
+    if (gxx_get_units(transformation->out_projection.units,
+        &transformation->projection_units_out) != SUCCESS)
+    {
+        sprintf(msg, "Getting the projection units for %s", 
+                transformation->out_projection.units);
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, msg);
+        free(transformation);
+        return ERROR;
+    }
+
+    metadata->transformation = transformation;
+    return SUCCESS;
+}
+
+/******************************************************************************/
+/**
+ * @brief Frees the cached projection transformation.
+ */
+/******************************************************************************/
+void gxx_angle_gen_free_transformation
+(
+    gxx_angle_gen_metadata_TYPE *metadata   /* I/O: Angle metadata struct */
+)
+{
+    free(metadata->transformation);
+    metadata->transformation = NULL;
+}
+
+/******************************************************************************/
+/**
+ * @brief Initialize the angle generation metadata transformation
+ *
+ * Converts the input projection coordinates to geographic radians.  The
+ * transformation is set up on the first call and reused after that.
+ *
+ * @return integer (SUCCESS or ERROR)
+ */
+/******************************************************************************/
+int gxx_angle_gen_initialize_transformation
+(
+    gxx_angle_gen_metadata_TYPE *metadata,  /* I/O: Angle metadata struct */
+    double in_x,                            /* I: X coordinate */
+    double in_y,                            /* I: y coordinate */
+    double *out_x,                          /* O: x coordinate */
+    double *out_y                           /* O: y coordinate */
+)           
+{
+    if (gxx_angle_gen_create_transformation(metadata) != SUCCESS)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
+                      "Error setting up the projection transformation");
+        return ERROR;
+    }
 
-    /* Initialize the projection transformation */
-    if (gxx_angle_gen_transform_projection(in_projection, out_projection,
+    /* Apply the projection transformation */
+    if (gxx_angle_gen_transform_projection(metadata->transformation,
         in_x, in_y, out_x, out_y) != SUCCESS)
     {
         xxx_LogStatus(PROGRAM, __FILE__, __LINE__,
@@ -1,10 +1,14 @@
+/* Standard Library Includes */
+#include <stdlib.h>
+
 /* IAS Library Includes */
 #include "xxx_LogStatus.h"
 #include "gxx_geo_math.h"
 #include "gxx_angle_gen_private.h"
 
 /* Local Defines */
-#define NUM_INTERP  4 /* Number of points to use in Lagrange interpolation */
+#define NUM_INTERP  GXX_ANGLE_GEN_NUM_INTERP /* Number of points to use in
+                                                Lagrange interpolation */
 
 /******************************************************************************/
 /**
@@ -80,3 +84,222 @@ int gxx_angle_gen_interpolate_ephemeris
 
     return SUCCESS;
 }
+
+/******************************************************************************/
+/**
+ * @brief Finds the index of the first ephemeris point at or after the input
+ * time, or ephem_count if all the points are before it.  The point found for
+ * the previous call is checked first, then its successor, before falling
+ * back to a binary search.
+ *
+ * @returns Index of the first point at or after the input time
+ */
+/******************************************************************************/
+static unsigned int find_time_index
+(
+    gxx_angle_gen_ephem_interp_TYPE *interp, /* I/O: Interpolation context */
+    double in_time               /* I: Time from epoch to interpolate */
+)
+{
+    const gxx_angle_gen_ephemeris_TYPE *ephemeris = interp->ephemeris;
+    unsigned int count = interp->ephem_count; /* Number of points */
+    unsigned int cursor;         /* Candidate index */
+    unsigned int low, high;      /* Binary search bounds */
+
+    /* Check the last index found and the one after it */
+    for (cursor = interp->cursor; cursor <= interp->cursor + 1
+         && cursor <= count; cursor++)
+    {
+        if ((cursor == 0 || ephemeris[cursor - 1].sample_time < in_time)
+            && (cursor == count || ephemeris[cursor].sample_time >= in_time))
+        {
+            interp->cursor = cursor;
+            return cursor;
+        }
+    }
+
+    /* Search for the first point which isn't before the time */
+    low = 0;
+    high = count;
+    while (low < high)
+    {
+        unsigned int middle = low + (high - low) / 2;
+
+        if (ephemeris[middle].sample_time < in_time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    interp->cursor = low;
+    return low;
+}
+
+/******************************************************************************/
+/**
+ * @brief Sets up an ephemeris interpolation context.  The Lagrange basis
+ * weights are precomputed for the window starting at each ephemeris point.
+ *
+ * @returns integer (SUCCESS or ERROR)
+ */
+/******************************************************************************/
+int gxx_angle_gen_init_ephem_interp
+(
+    const gxx_angle_gen_ephemeris_TYPE *ephemeris, /* I: Metadata ephemeris
+                                                         points */
+    unsigned int ephem_count,    /* I: Number of entries in ephemeris */
+    gxx_angle_gen_ephem_interp_TYPE *interp /* O: Interpolation context */
+)
+{
+    unsigned int num_windows;    /* Number of interpolation windows */
+    unsigned int window_size;    /* Number of points in each window */
+    unsigned int window;         /* Window index */
+    unsigned int point;          /* Point index within the window */
+    unsigned int other;          /* Other point index within the window */
+
+    interp->ephemeris = ephemeris;
+    interp->ephem_count = ephem_count;
+    interp->cursor = 0;
+    interp->weights = NULL;
+
+    if (ephem_count < 1)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, 
+                      "Not enough points provided to interpolate");
+        return ERROR;
+    }
+
+    /* With few points every time uses all of them */
+    if (ephem_count <= NUM_INTERP)
+    {
+        num_windows = 1;
+        window_size = ephem_count;
+    }
+    else
+    {
+        num_windows = ephem_count - NUM_INTERP + 1;
+        window_size = NUM_INTERP;
+    }
+
+    interp->weights = malloc(num_windows * sizeof(*interp->weights));
+    if (!interp->weights)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, 
+                      "Error allocating the interpolation weights");
+        return ERROR;
+    }
+
+    for (window = 0; window < num_windows; window++)
+    {
+        for (point = 0; point < window_size; point++)
+        {
+            double product = 1.0;    /* Product of the time differences */
+
+            for (other = 0; other < window_size; other++)
+            {
+                if (other != point)
+                {
+                    product *= ephemeris[window + point].sample_time
+                        - ephemeris[window + other].sample_time;
+                }
+            }
+
+            if (product == 0.0)
+            {
+                xxx_LogStatus(PROGRAM, __FILE__, __LINE__, 
+                              "Duplicate ephemeris sample times");
+                free(interp->weights);
+                interp->weights = NULL;
+                return ERROR;
+            }
+            interp->weights[window][point] = 1.0 / product;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/******************************************************************************/
+/**
+ * @brief Frees an ephemeris interpolation context.
+ */
+/******************************************************************************/
+void gxx_angle_gen_free_ephem_interp
+(
+    gxx_angle_gen_ephem_interp_TYPE *interp /* I/O: Interpolation context */
+)
+{
+    free(interp->weights);
+    interp->weights = NULL;
+}
+
+/******************************************************************************/
+/**
+ * @brief Interpolates the ephemeris of an interpolation context at the
+ * provided input time.  Uses the same window of points as
+ * gxx_angle_gen_interpolate_ephemeris.
+ *
+ * @returns integer (SUCCESS or ERROR)
+ */
+/******************************************************************************/
+int gxx_angle_gen_interpolate_ephemeris_ctx
+(
+    gxx_angle_gen_ephem_interp_TYPE *interp, /* I/O: Interpolation context */
+    double in_time,              /* I: Time from epoch to interpolate */
+    VECTOR *vector               /* O: Output interpolated vector */
+)
+{
+    const gxx_angle_gen_ephemeris_TYPE *ephemeris; /* Window points */
+    const double *weights;       /* Window weights */
+    double diff[NUM_INTERP];     /* Time from each window point */
+    int window;                  /* First point of the window */
+    unsigned int used_count;     /* Number of points used */
+    unsigned int point;          /* Point index within the window */
+    unsigned int other;          /* Other point index within the window */
+
+    if (!interp->weights)
+    {
+        xxx_LogStatus(PROGRAM, __FILE__, __LINE__, 
+                      "The interpolation context is not initialized");
+        return ERROR;
+    }
+
+    if (interp->ephem_count <= NUM_INTERP)
+    {
+        window = 0;
+        used_count = interp->ephem_count;
+    }
+    else
+    {
+        /* Center the window on the samples that straddle the time */
+        window = (int)find_time_index(interp, in_time) - (NUM_INTERP + 1) / 2;
+        if (window < 0)
+            window = 0;
+        if (window > (int)(interp->ephem_count - NUM_INTERP))
+            window = interp->ephem_count - NUM_INTERP;
+        used_count = NUM_INTERP;
+    }
+
+    ephemeris = &interp->ephemeris[window];
+    weights = interp->weights[window];
+    for (point = 0; point < used_count; point++)
+        diff[point] = in_time - ephemeris[point].sample_time;
+
+    vector->x = vector->y = vector->z = 0.0;
+    for (point = 0; point < used_count; point++)
+    {
+        double basis = weights[point];  /* Lagrange basis polynomial value */
+
+        for (other = 0; other < used_count; other++)
+        {
+            if (other != point)
+                basis *= diff[other];
+        }
+
+        vector->x += basis * ephemeris[point].position.x;
+        vector->y += basis * ephemeris[point].position.y;
+        vector->z += basis * ephemeris[point].position.z;
+    }
+
+    return SUCCESS;
+}
@@ -4,6 +4,22 @@
 /* Local Library Includes */
 #include "gxx_angle_gen_distro.h" /* Angle gen structs */
 
+/* Number of points to use in the Lagrange interpolation of the ephemeris */
+#define GXX_ANGLE_GEN_NUM_INTERP 4
+
+/* Ephemeris interpolation context.  Keeps the window found for the last
+   time, so the nearly monotonic times of a scene are located without a
+   search, and the Lagrange basis weights for every window. */
+typedef struct gxx_angle_gen_ephem_interp_TYPE
+{
+    const gxx_angle_gen_ephemeris_TYPE *ephemeris; /* Ephemeris points */
+    unsigned int ephem_count;   /* Number of ephemeris points */
+    unsigned int cursor;        /* First point at or after the last time */
+    double (*weights)[GXX_ANGLE_GEN_NUM_INTERP]; /* Lagrange basis weights
+                                   (1 / product of the time differences) for
+                                   the window starting at each point */
+} gxx_angle_gen_ephem_interp_TYPE;
+
 int gxx_angle_gen_calculate_vector
 (
     gxx_angle_gen_metadata_TYPE *metadata,/* I: Metadata structure */
@@ -38,6 +54,53 @@ int gxx_angle_gen_initialize_transformation
     double *out_y                           /* O: y coordinate */
 );
 
+int gxx_angle_gen_create_transformation
+(
+    gxx_angle_gen_metadata_TYPE *metadata   /* I/O: Angle metadata struct */
+);
+
+void gxx_angle_gen_free_transformation
+(
+    gxx_angle_gen_metadata_TYPE *metadata   /* I/O: Angle metadata struct */
+);
+
+int gxx_angle_gen_init_ephem_interp
+(
+    const gxx_angle_gen_ephemeris_TYPE *ephemeris, /* I: Metadata ephemeris
+                                                         points */
+    unsigned int ephem_count,   /* I: Number of entries in ephemeris */
+    gxx_angle_gen_ephem_interp_TYPE *interp /* O: Interpolation context */
+);
+
+void gxx_angle_gen_free_ephem_interp
+(
+    gxx_angle_gen_ephem_interp_TYPE *interp /* I/O: Interpolation context */
+);
+
+int gxx_angle_gen_interpolate_ephemeris_ctx
+(
+    gxx_angle_gen_ephem_interp_TYPE *interp, /* I/O: Interpolation context */
+    double in_time,    /* I: Time from epoch to interpolate */
+    VECTOR *vector     /* O: Output interpolated vector */
+);
+
+int gxx_angle_gen_calculate_sat_sun_vectors
+(
+    gxx_angle_gen_metadata_TYPE *metadata,/* I: Metadata structure */
+    gxx_angle_gen_ephem_interp_TYPE *sat_interp, /* I/O: Ephemeris context */
+    gxx_angle_gen_ephem_interp_TYPE *sun_interp, /* I/O: Solar vector
+                                                       context */
+    double l1t_line,         /* I: Current L1T line number */
+    double l1t_samp,         /* I: Current L1T sample number */
+    double l1r_line,         /* I: Current L1R line number */
+    double l1r_samp,         /* I: Current L1R sample number */
+    double height,           /* I: Current L1T height */
+    unsigned int band_index, /* I: Current band index */
+    unsigned int dir,        /* I: scan direction */
+    VECTOR *sat_view,        /* O: Satellite view vector, or NULL */
+    VECTOR *sun_view         /* O: Solar view vector, or NULL */
+);
+
 int gxx_angle_gen_interpolate_ephemeris
 (
     const gxx_angle_gen_ephemeris_TYPE *ephemeris, /* I: Metadata ephemeris
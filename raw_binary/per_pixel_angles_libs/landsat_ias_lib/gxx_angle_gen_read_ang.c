@@ -1055,6 +1055,9 @@ int gxx_angle_gen_read_ang
     unsigned int index;     /* Loop index */
     char msg[STRLEN];
 
+    /* The projection transformation is set up when it is first used */
+    metadata->transformation = NULL;
+
     /* Open file */
     odl_data = xxx_OpenODL(ang_filename, xxx_NoEDCMeta, msg);
     if (!odl_data)
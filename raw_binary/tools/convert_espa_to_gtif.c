@@ -38,7 +38,9 @@ void usage ()
     printf ("usage: convert_espa_to_gtif "
             "--xml=input_metadata_filename "
             "--gtif=output_geotiff_base_filename "
-            "[--del_src_files]\n");
+            "[--del_src_files] [--threads=nthreads] "
+            "[--compress=none|deflate|lzw|zstd] [--compress_level=level] "
+            "[--predictor] [--tile_size=size] [--overviews=nlevels]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML metadata file which follows "
@@ -46,6 +48,19 @@ void usage ()
     printf ("    -gtif: base filename of the output GeoTIFF files\n");
     printf ("    -del_src_files: if specified the source image and header "
             "files will be removed\n");
+    printf ("    -threads: number of bands to convert concurrently (default "
+            "is 1).  Only used if built with ENABLE_THREADING.\n");
+    printf ("    -compress: compression to apply to the GeoTIFF files "
+            "(default is none)\n");
+    printf ("    -compress_level: compression level for deflate (1-9) or "
+            "zstd (1-22) compression (default is the libtiff default)\n");
+    printf ("    -predictor: if specified a horizontal (integer) or floating "
+            "point predictor is applied before compression\n");
+    printf ("    -tile_size: write the GeoTIFF files in square tiles of this "
+            "size, which must be a multiple of 16 (default is strips)\n");
+    printf ("    -overviews: number of reduced resolution overview levels, "
+            "each half the size of the previous level, up to %d (default "
+            "is 0)\n", TIFF_MAX_OVERVIEWS);
     printf ("\nExample: convert_espa_to_gtif "
             "--xml=LE07_L1TP_022033_20140228_20161028_01_T1.xml "
             "--gtif=LE07_L1TP_022033_20140228_20161028_01_T1\n");
@@ -77,7 +92,10 @@ short get_args
     char *argv[],         /* I: string of cmd-line args */
     char **xml_infile,    /* O: address of input XML filename */
     char **gtif_outfile,  /* O: address of output GeoTIFF base filename */
-    bool *del_src         /* O: should source files be removed? */
+    bool *del_src,        /* O: should source files be removed? */
+    int *nthreads,        /* O: number of bands to convert concurrently */
+    Tiff_output_opts_t *gtif_opts  /* O: GeoTIFF layout and compression
+                                         options */
 )
 {
     int c;                           /* current argument index */
@@ -85,11 +103,18 @@ short get_args
     char errmsg[STR_SIZE];           /* error message */
     char FUNC_NAME[] = "get_args";   /* function name */
     static int del_flag = 0;         /* flag for removing the source files */
+    static int predictor_flag = 0;   /* flag for applying the predictor */
     static struct option long_options[] =
     {
         {"del_src_files", no_argument, &del_flag, 1},
         {"xml", required_argument, 0, 'i'},
         {"gtif", required_argument, 0, 'o'},
+        {"threads", required_argument, 0, 't'},
+        {"compress", required_argument, 0, 'c'},
+        {"compress_level", required_argument, 0, 'l'},
+        {"predictor", no_argument, &predictor_flag, 1},
+        {"tile_size", required_argument, 0, 's'},
+        {"overviews", required_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -126,6 +151,41 @@ short get_args
                 *gtif_outfile = strdup (optarg);
                 break;
      
+            case 't':  /* number of threads */
+                *nthreads = atoi (optarg);
+                break;
+     
+            case 'c':  /* compression type */
+                if (!strcmp (optarg, "none"))
+                    gtif_opts->compress = TIFF_COMPRESS_NONE;
+                else if (!strcmp (optarg, "deflate"))
+                    gtif_opts->compress = TIFF_COMPRESS_DEFLATE;
+                else if (!strcmp (optarg, "lzw"))
+                    gtif_opts->compress = TIFF_COMPRESS_LZW;
+                else if (!strcmp (optarg, "zstd"))
+                    gtif_opts->compress = TIFF_COMPRESS_ZSTD;
+                else
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Unknown compression "
+                        "type %s", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'l':  /* compression level */
+                gtif_opts->compress_level = atoi (optarg);
+                break;
+     
+            case 's':  /* tile size */
+                gtif_opts->tile_size = atoi (optarg);
+                break;
+     
+            case 'v':  /* number of overview levels */
+                gtif_opts->noverviews = atoi (optarg);
+                break;
+     
             case '?':
             default:
                 sprintf (errmsg, "Unknown option %s", argv[optind-1]);
@@ -157,6 +217,80 @@ short get_args
     if (del_flag)
         *del_src = true;
 
+    /* Check the predictor flag */
+    if (predictor_flag)
+        gtif_opts->predictor = true;
+
+    /* Make sure the number of threads is valid */
+    if (*nthreads < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Number of threads must be at "
+            "least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* Make sure the layout options are valid */
+    if (gtif_opts->compress_level < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Compression level must not be "
+            "negative (0 = libtiff default)");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (gtif_opts->compress_level > 0 &&
+        gtif_opts->compress != TIFF_COMPRESS_DEFLATE &&
+        gtif_opts->compress != TIFF_COMPRESS_ZSTD)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Compression level is only used "
+            "for deflate or zstd compression");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (gtif_opts->compress == TIFF_COMPRESS_DEFLATE &&
+        gtif_opts->compress_level > TIFF_MAX_DEFLATE_LEVEL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Deflate compression level must "
+            "be between 1 and %d", TIFF_MAX_DEFLATE_LEVEL);
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (gtif_opts->compress == TIFF_COMPRESS_ZSTD &&
+        gtif_opts->compress_level > TIFF_MAX_ZSTD_LEVEL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Zstd compression level must be "
+            "between 1 and %d", TIFF_MAX_ZSTD_LEVEL);
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (gtif_opts->tile_size < 0 || gtif_opts->tile_size % 16 != 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Tile size must be a positive "
+            "multiple of 16");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (gtif_opts->noverviews < 0 ||
+        gtif_opts->noverviews > TIFF_MAX_OVERVIEWS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Number of overviews must be "
+            "between 0 and %d", TIFF_MAX_OVERVIEWS);
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
     return (SUCCESS);
 }
 
@@ -183,15 +317,20 @@ int main (int argc, char** argv)
     char *xml_infile = NULL;     /* input XML filename */
     char *gtif_outfile = NULL;   /* output base GeoTIFF filename */
     bool del_src = false;        /* should source files be removed? */
+    int nthreads = 1;            /* number of bands to convert concurrently */
+    Tiff_output_opts_t gtif_opts;  /* GeoTIFF layout and compression options */
 
     /* Read the command-line arguments */
-    if (get_args (argc, argv, &xml_infile, &gtif_outfile, &del_src) != SUCCESS)
+    init_tiff_output_opts (&gtif_opts);
+    if (get_args (argc, argv, &xml_infile, &gtif_outfile, &del_src,
+        &nthreads, &gtif_opts) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (EXIT_FAILURE);
     }
 
     /* Convert the internal ESPA raw binary product to GeoTIFF */
-    if (convert_espa_to_gtif (xml_infile, gtif_outfile, del_src) != SUCCESS)
+    if (convert_espa_to_gtif (xml_infile, gtif_outfile, del_src, nthreads,
+        &gtif_opts) != SUCCESS)
     {  /* Error messages already written */
         exit (EXIT_FAILURE);
     }
@@ -34,11 +34,14 @@ void usage ()
             "binary and associated XML metadata file) to HDF-EOS2 (HDF4).  "
             "Each band represented in the input XML file will be written to a "
             "a single HDF file with each SDS being represented as an external "
-            "dataset.\n\n");
+            "dataset.  If chunking or compression is requested, the SDSs are "
+            "stored inside the HDF file instead.\n\n");
     printf ("usage: convert_espa_to_hdf "
             "--xml=input_metadata_filename "
             "--hdf=output_hdf_filename "
-            "[--del_src_files]\n");
+            "[--del_src_files] [--compress=none|deflate|szip] "
+            "[--compress_level=level] [--chunk_lines=nlines] "
+            "[--chunk_samps=nsamps]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML metadata file which follows "
@@ -46,6 +49,16 @@ void usage ()
     printf ("    -hdf: filename of the output HDF file\n");
     printf ("    -del_src_files: if specified the source image and header "
             "files will be removed\n");
+    printf ("    -compress: compression to apply to the SDSs (default is "
+            "none)\n");
+    printf ("    -compress_level: deflate compression level 1-9 (default is "
+            "6)\n");
+    printf ("    -chunk_lines: number of lines in each SDS chunk (default is "
+            "no chunking, or %d if compression is specified)\n",
+            HDF_DEFAULT_CHUNK_SIZE);
+    printf ("    -chunk_samps: number of samples in each SDS chunk (default "
+            "is no chunking, or %d if compression is specified)\n",
+            HDF_DEFAULT_CHUNK_SIZE);
     printf ("\nExample: convert_espa_to_hdf "
             "--xml=LE07_L1TP_022033_20140228_20161028_01_T1.xml "
             "--hdf=LE07_L1TP_022033_20140228_20161028_01_T1.hdf\n");
@@ -77,7 +90,9 @@ short get_args
     char *argv[],         /* I: string of cmd-line args */
     char **xml_infile,    /* O: address of input XML filename */
     char **hdf_outfile,   /* O: address of output HDF filename */
-    bool *del_src         /* O: should source files be removed? */
+    bool *del_src,        /* O: should source files be removed? */
+    Hdf_output_opts_t *hdf_opts  /* O: SDS chunking and compression
+                                       options */
 )
 {
     int c;                           /* current argument index */
@@ -85,11 +100,16 @@ short get_args
     char errmsg[STR_SIZE];           /* error message */
     char FUNC_NAME[] = "get_args";   /* function name */
     static int del_flag = 0;         /* flag for removing the source files */
+    bool level_set = false;          /* was the deflate level specified? */
     static struct option long_options[] =
     {
         {"del_src_files", no_argument, &del_flag, 1},
         {"xml", required_argument, 0, 'i'},
         {"hdf", required_argument, 0, 'o'},
+        {"compress", required_argument, 0, 'c'},
+        {"compress_level", required_argument, 0, 'l'},
+        {"chunk_lines", required_argument, 0, 'y'},
+        {"chunk_samps", required_argument, 0, 'x'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -126,6 +146,36 @@ short get_args
                 *hdf_outfile = strdup (optarg);
                 break;
      
+            case 'c':  /* compression type */
+                if (!strcmp (optarg, "none"))
+                    hdf_opts->compress = HDF_COMPRESS_NONE;
+                else if (!strcmp (optarg, "deflate"))
+                    hdf_opts->compress = HDF_COMPRESS_DEFLATE;
+                else if (!strcmp (optarg, "szip"))
+                    hdf_opts->compress = HDF_COMPRESS_SZIP;
+                else
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Unknown compression "
+                        "type %s", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'l':  /* deflate level */
+                hdf_opts->deflate_level = atoi (optarg);
+                level_set = true;
+                break;
+     
+            case 'y':  /* chunk lines */
+                hdf_opts->chunk_lines = atoi (optarg);
+                break;
+     
+            case 'x':  /* chunk samples */
+                hdf_opts->chunk_samps = atoi (optarg);
+                break;
+     
             case '?':
             default:
                 sprintf (errmsg, "Unknown option %s", argv[optind-1]);
@@ -157,6 +207,28 @@ short get_args
     if (del_flag)
         *del_src = true;
 
+    /* Make sure the chunking and compression options are valid.  A deflate
+       level of 0 in the options selects the default, so a level given on the
+       command line must be 1-9. */
+    if (level_set &&
+        (hdf_opts->deflate_level < 1 || hdf_opts->deflate_level > 9))
+    {
+        snprintf (errmsg, sizeof (errmsg), "Compression level must be "
+            "between 1 and 9");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (hdf_opts->chunk_lines < 0 || hdf_opts->chunk_samps < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Chunk dimensions must not be "
+            "negative (0 = default)");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
     return (SUCCESS);
 }
 
@@ -183,15 +255,19 @@ int main (int argc, char** argv)
     char *xml_infile = NULL;     /* input XML filename */
     char *hdf_outfile = NULL;    /* output HDF filename */
     bool del_src = false;        /* should source files be removed? */
+    Hdf_output_opts_t hdf_opts;  /* SDS chunking and compression options */
 
     /* Read the command-line arguments */
-    if (get_args (argc, argv, &xml_infile, &hdf_outfile, &del_src) != SUCCESS)
+    init_hdf_output_opts (&hdf_opts);
+    if (get_args (argc, argv, &xml_infile, &hdf_outfile, &del_src,
+        &hdf_opts) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (EXIT_FAILURE);
     }
 
-    /* Convert the internal ESPA raw binary product to HDF with external SDSs */
-    if (convert_espa_to_hdf (xml_infile, hdf_outfile, del_src) != SUCCESS)
+    /* Convert the internal ESPA raw binary product to HDF */
+    if (convert_espa_to_hdf (xml_infile, hdf_outfile, del_src, &hdf_opts)
+        != SUCCESS)
     {  /* Error messages already written */
         exit (EXIT_FAILURE);
     }
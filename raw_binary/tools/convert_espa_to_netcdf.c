@@ -35,8 +35,11 @@ void usage ()
     printf ("usage: convert_espa_to_netcdf "
             "--xml=input_metadata_filename "
             "--netcdf=output_netcdf_filename "
-            "[--del_src_files]"
-            "[--no_compression]\n");
+            "[--del_src_files] "
+            "[--no_compression] [--compress_level=level] "
+            "[--coord_compress_level=level] "
+            "[--band_compress_level=band_name:level] "
+            "[--chunk_lines=nlines] [--chunk_samps=nsamps]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML metadata file which follows "
@@ -47,6 +50,17 @@ void usage ()
             "files will be removed\n");
     printf ("    -no_compression: if specified compression will not be used "
             "(the default is compression is used)\n");
+    printf ("    -compress_level: deflate level (0-9) for the band variables; "
+            "0 turns off compression (default is %d)\n", DEFLATE_LEVEL);
+    printf ("    -coord_compress_level: deflate level (0-9) for the x/y "
+            "coordinate variables (default is %d)\n", DEFLATE_LEVEL);
+    printf ("    -band_compress_level: deflate level (0-9) for a specific "
+            "band, overriding compress_level.  May be specified more than "
+            "once.\n");
+    printf ("    -chunk_lines: number of lines in each chunk of the band "
+            "variables (default is the NetCDF chunking)\n");
+    printf ("    -chunk_samps: number of samples in each chunk of the band "
+            "variables (default is the NetCDF chunking)\n");
     printf ("\nExample: convert_espa_to_netcdf "
             "--xml=LE07_L1TP_022033_20140228_20161028_01_T1.xml "
             "--netcdf=LE07_L1TP_022033_20140228_20161028_01_T1.nc\n");
@@ -79,13 +93,17 @@ short get_args
     char **xml_infile,     /* O: address of input XML filename */
     char **netcdf_outfile, /* O: address of output NetCDF filename */
     bool *del_src,         /* O: should source files be removed? */
-    bool *no_compression   /* O: should compression be used? */
+    Netcdf_output_opts_t *nc_opts  /* O: compression and chunking
+                                         options */
 )
 {
     int c;                           /* current argument index */
+    int i;                           /* looping variable */
     int option_index;                /* index for the command-line option */
     char errmsg[STR_SIZE];           /* error message */
     char FUNC_NAME[] = "get_args";   /* function name */
+    char *cptr = NULL;               /* pointer to the band level separator */
+    Netcdf_band_level_t *blevel = NULL;  /* current per-band level */
     static int del_flag = 0;         /* flag for removing the source files */
     static int no_compression_flag = 0; /* flag for compressing NetCDF file */
     static struct option long_options[] =
@@ -94,6 +112,11 @@ short get_args
         {"no_compression", no_argument, &no_compression_flag, 1},
         {"xml", required_argument, 0, 'i'},
         {"netcdf", required_argument, 0, 'o'},
+        {"compress_level", required_argument, 0, 'l'},
+        {"coord_compress_level", required_argument, 0, 'c'},
+        {"band_compress_level", required_argument, 0, 'b'},
+        {"chunk_lines", required_argument, 0, 'y'},
+        {"chunk_samps", required_argument, 0, 'x'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -130,6 +153,47 @@ short get_args
                 *netcdf_outfile = strdup (optarg);
                 break;
      
+            case 'l':  /* band deflate level */
+                nc_opts->deflate_level = atoi (optarg);
+                break;
+     
+            case 'c':  /* coordinate deflate level */
+                nc_opts->coord_deflate_level = atoi (optarg);
+                break;
+     
+            case 'b':  /* deflate level for a specific band */
+                cptr = strrchr (optarg, ':');
+                if (cptr == NULL || cptr == optarg ||
+                    cptr - optarg >= STR_SIZE)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Band compression "
+                        "level must be band_name:level");
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                if (nc_opts->nband_levels >= NC_MAX_BAND_LEVELS)
+                {
+                    snprintf (errmsg, sizeof (errmsg), "Too many band "
+                        "compression levels; maximum is %d",
+                        NC_MAX_BAND_LEVELS);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    return (ERROR);
+                }
+                blevel = &nc_opts->band_levels[nc_opts->nband_levels++];
+                strncpy (blevel->name, optarg, cptr - optarg);
+                blevel->name[cptr - optarg] = '\0';
+                blevel->deflate_level = atoi (cptr + 1);
+                break;
+     
+            case 'y':  /* chunk lines */
+                nc_opts->chunk_lines = atoi (optarg);
+                break;
+     
+            case 'x':  /* chunk samples */
+                nc_opts->chunk_samps = atoi (optarg);
+                break;
+     
             case '?':
             default:
                 sprintf (errmsg, "Unknown option %s", argv[optind-1]);
@@ -161,10 +225,47 @@ short get_args
     if (del_flag)
         *del_src = true;
 
-    /* Check the "no compression" flag */
+    /* Check the "no compression" flag, which overrides any of the deflate
+       levels */
     if (no_compression_flag)
-        *no_compression = true;
+    {
+        nc_opts->deflate_level = 0;
+        nc_opts->coord_deflate_level = 0;
+        nc_opts->nband_levels = 0;
+    }
+
+    /* Make sure the compression and chunking options are valid */
+    if (nc_opts->deflate_level < 0 || nc_opts->deflate_level > 9 ||
+        nc_opts->coord_deflate_level < 0 || nc_opts->coord_deflate_level > 9)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Compression levels must be "
+            "between 0 and 9");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    for (i = 0; i < nc_opts->nband_levels; i++)
+    {
+        if (nc_opts->band_levels[i].deflate_level < 0 ||
+            nc_opts->band_levels[i].deflate_level > 9)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Compression level for band "
+                "%s must be between 0 and 9", nc_opts->band_levels[i].name);
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+    }
 
+    if (nc_opts->chunk_lines < 0 || nc_opts->chunk_samps < 0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Chunk dimensions must not be "
+            "negative (0 = default)");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
 
     return (SUCCESS);
 }
@@ -190,18 +291,19 @@ int main (int argc, char** argv)
     char *xml_infile = NULL;     /* input XML filename */
     char *netcdf_outfile = NULL; /* output NetCDF filename */
     bool del_src = false;        /* should source files be removed? */
-    bool no_compression = false; /* should compression be used? */
+    Netcdf_output_opts_t nc_opts; /* compression and chunking options */
 
     /* Read the command-line arguments */
+    init_netcdf_output_opts (&nc_opts);
     if (get_args (argc, argv, &xml_infile, &netcdf_outfile, &del_src, 
-        &no_compression) != SUCCESS)
+        &nc_opts) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (EXIT_FAILURE);
     }
 
     /* Convert the internal ESPA raw binary product to NetCDF */
     if (convert_espa_to_netcdf (xml_infile, netcdf_outfile, del_src, 
-        no_compression) != SUCCESS)
+        &nc_opts) != SUCCESS)
     {  /* Error messages already written */
         exit (EXIT_FAILURE);
     }
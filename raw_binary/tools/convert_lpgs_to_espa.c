@@ -35,13 +35,15 @@ void usage ()
             "metadata file and associated raw binary files).\n\n");
     printf ("usage: convert_lpgs_to_espa "
             "--mtl=input_mtl_filename "
-            "[--del_src_files]\n");
+            "[--del_src_files] [--threads=nthreads]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -mtl: name of the input LPGS MTL metadata file\n");
     printf ("    -del_src_files: if specified the source GeoTIFF files will "
             "be removed.  The _MTL.txt file will remain along with the "
             "gap directory for ETM+ products.\n");
+    printf ("    -threads: number of bands to convert concurrently (default "
+            "is 1).  Only used if built with ENABLE_THREADING.\n");
     printf ("\nExample: convert_lpgs_to_espa "
             "--mtl=LE07_L1TP_022033_20140228_20161028_01_T1_MTL.txt\n");
 }
@@ -72,7 +74,8 @@ short get_args
     char *argv[],         /* I: string of cmd-line args */
     char **mtl_infile,    /* O: address of input LPGS MTL filename */
     char **xml_outfile,   /* O: address of output XML filename */
-    bool *del_src         /* O: should source files be removed? */
+    bool *del_src,        /* O: should source files be removed? */
+    int *nthreads         /* O: number of bands to convert concurrently */
 )
 {
     int c;                           /* current argument index */
@@ -85,6 +88,7 @@ short get_args
     {
         {"del_src_files", no_argument, &del_flag, 1},
         {"mtl", required_argument, 0, 'i'},
+        {"threads", required_argument, 0, 't'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -117,6 +121,10 @@ short get_args
                 *mtl_infile = strdup (optarg);
                 break;
      
+            case 't':  /* number of threads */
+                *nthreads = atoi (optarg);
+                break;
+     
             case '?':
             default:
                 sprintf (errmsg, "Unknown option %s", argv[optind-1]);
@@ -153,6 +161,16 @@ short get_args
     if (del_flag)
         *del_src = true;
 
+    /* Make sure the number of threads is valid */
+    if (*nthreads < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Number of threads must be at "
+            "least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
     return (SUCCESS);
 }
 
@@ -177,15 +195,18 @@ int main (int argc, char** argv)
     char *mtl_infile = NULL;      /* input LPGS MTL filename */
     char *xml_outfile = NULL;     /* output XML filename */
     bool del_src = false;         /* should source files be removed? */
+    int nthreads = 1;             /* number of bands to convert concurrently */
 
     /* Read the command-line arguments */
-    if (get_args (argc, argv, &mtl_infile, &xml_outfile, &del_src) != SUCCESS)
+    if (get_args (argc, argv, &mtl_infile, &xml_outfile, &del_src,
+        &nthreads) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (EXIT_FAILURE);
     }
 
     /* Convert the LPGS MTL and data to ESPA raw binary and XML */
-    if (convert_lpgs_to_espa (mtl_infile, xml_outfile, del_src) != SUCCESS)
+    if (convert_lpgs_to_espa (mtl_infile, xml_outfile, del_src, nthreads)
+        != SUCCESS)
     {  /* Error messages already written */
         exit (EXIT_FAILURE);
     }
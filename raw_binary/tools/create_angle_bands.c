@@ -63,13 +63,24 @@ void usage ()
             "by 100.\n\n");
     printf ("usage: create_angle_bands "
             "--xml=input_metadata_filename\n"
-            "{--average}");
+            "{--average} [--threads=nthreads]\n"
+            "[--interp_step=grid_step] [--max_interp_error=degrees]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML metadata file wich follows the "
             "ESPA internal raw binary schema\n");
     printf ("    -average: write the reflectance band averages instead of "
-            "writing each of the band angles\n\n");
+            "writing each of the band angles\n");
+    printf ("    -threads: number of threads to use for computing the "
+            "Landsat 8 angles (default is 1)\n");
+    printf ("    -interp_step: compute the exact angles every interp_step "
+            "pixels and interpolate the pixels in between (default is 1, "
+            "which computes every pixel)\n");
+    printf ("    -max_interp_error: maximum error in degrees allowed for the "
+            "interpolated angles; areas which can't be interpolated within "
+            "this error are computed exactly (default is %g)\n",
+            ANGLES_INTERP_DEFAULT_MAX_ERROR);
+    printf ("\n");
 
     printf ("\nExample: create_angle_bands "
             "--xml=LC08_L1TP_047027_20131014_20170308_01_T1.xml\n");
@@ -107,8 +118,10 @@ short get_args
     int argc,             /* I: number of cmd-line args */
     char *argv[],         /* I: string of cmd-line args */
     char **xml_infile,    /* O: address of input XML filename */
-    bool *band_avg        /* O: should the reflectance band average be
+    bool *band_avg,       /* O: should the reflectance band average be
                                 processed? */
+    int *nthreads,        /* O: number of threads for computing the angles */
+    ANGLES_INTERP *interp /* O: coarse grid interpolation controls */
 )
 {
     int c;                           /* current argument index */
@@ -121,6 +134,9 @@ short get_args
     {
         {"average", no_argument, &avg_flag, 1},
         {"xml", required_argument, 0, 'i'},
+        {"threads", required_argument, 0, 't'},
+        {"interp_step", required_argument, 0, 's'},
+        {"max_interp_error", required_argument, 0, 'e'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -152,6 +168,18 @@ short get_args
             case 'i':  /* XML file */
                 *xml_infile = strdup (optarg);
                 break;
+
+            case 's':  /* interpolation grid step */
+                interp->grid_step = atoi (optarg);
+                break;
+
+            case 'e':  /* maximum interpolation error */
+                interp->max_error = atof (optarg);
+                break;
+
+            case 't':  /* number of threads */
+                *nthreads = atoi (optarg);
+                break;
      
             case '?':
             default:
@@ -176,6 +204,108 @@ short get_args
     if (avg_flag)
         *band_avg = true;
 
+    /* Make sure the number of threads is valid */
+    if (*nthreads < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Number of threads must be at "
+            "least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* Make sure the interpolation controls are valid */
+    if (interp->grid_step < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Interpolation grid step must "
+            "be at least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (interp->max_error <= 0.0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Maximum interpolation error "
+            "must be positive");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE: write_avg_block
+
+PURPOSE: Writes a block of lines of the reflectance band average angles to
+the output angle band files.  This is the writer passed to
+l8_per_pixel_avg_refl_angles_stream.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the angle bands
+SUCCESS         No errors encountered
+
+NOTES:
+1. The blocks are passed in order, so each block is appended to the files.
+******************************************************************************/
+static int write_avg_block
+(
+    void *write_data,       /* I: array of NANGLE_BANDS output file pointers */
+    int num_lines,          /* I: number of lines in the average band */
+    int num_samps,          /* I: number of samples in the average band */
+    int start_line,         /* I: first line in the block */
+    int end_line,           /* I: last line in the block + 1 */
+    short *avg[ANGLES_NFIELDS] /* I: average angles of the block */
+)
+{
+    char FUNC_NAME[] = "write_avg_block";  /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    FILE **fptr = write_data;    /* output file pointers */
+    Angle_band_t ang;            /* looping variable for solar/senor angle */
+    short *curr_angle = NULL;    /* pointer to the current angle block */
+
+    for (ang = 0; ang < NANGLE_BANDS; ang++)
+    {
+        /* Grab the correct data block to be written for this angle band */
+        switch (ang)
+        {
+            case (SOLAR_ZEN):
+                curr_angle = avg[ANGLES_SUN_ZENITH];
+                break;
+            case (SOLAR_AZ):
+                curr_angle = avg[ANGLES_SUN_AZIMUTH];
+                break;
+            case (SENSOR_ZEN):
+                curr_angle = avg[ANGLES_SAT_ZENITH];
+                break;
+            case (SENSOR_AZ):
+                curr_angle = avg[ANGLES_SAT_AZIMUTH];
+                break;
+            default:
+                snprintf (errmsg, sizeof (errmsg), "Invalid angle type %d",
+                    ang);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+        }
+
+        /* Write the lines for this band */
+        if (write_raw_binary (fptr[ang], end_line - start_line, num_samps,
+            sizeof (short), curr_angle) != SUCCESS)
+        {
+            snprintf (errmsg, sizeof (errmsg), "Unable to write lines %d to "
+                "%d of the average angle band %d", start_line, end_line - 1,
+                ang);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+
     return (SUCCESS);
 }
 
@@ -205,6 +335,8 @@ NOTES:
    angles.  In order to make this a less memory hog, then break it down to
    process the solar angles, write the solar angles, process the
    satellite/sensor/view angles, and write the satellite/sensor/view angles.
+   The band average doesn't have this problem, since the averages are written
+   out a block of lines at a time as they are generated.
 ******************************************************************************/
 int main (int argc, char** argv)
 {
@@ -230,6 +362,9 @@ int main (int argc, char** argv)
     int curr_bndx;               /* index of current input band */
     int nbands;                  /* number of input bands to be read */
     int out_nbands;              /* number of output bands to be written */
+    int nthreads = 1;            /* number of threads for computing angles */
+    ANGLES_INTERP interp = {1, ANGLES_INTERP_DEFAULT_MAX_ERROR};
+                                 /* coarse grid interpolation controls */
     int nlines[MAX_NBANDS];      /* number of lines for each band */
     int nsamps[MAX_NBANDS];      /* number of samples for each band */
     int avg_nlines;              /* number of lines for band average */
@@ -247,10 +382,7 @@ int main (int argc, char** argv)
                                          azimuth angle array, one per band */
     short *curr_angle = NULL;      /* pointer to the current angle array */
     ANGLES_FRAME avg_frame;        /* image frame info for band average */
-    short *avg_solar_zenith=NULL;  /* array for solar zenith angle average */
-    short *avg_solar_azimuth=NULL; /* array for solar azimuth angle average */
-    short *avg_sat_zenith=NULL;    /* array for satellite zenith angle avg */
-    short *avg_sat_azimuth=NULL;   /* array for satellite azimuth angle avg */
+    FILE *avg_fptr[NANGLE_BANDS];  /* file pointers for the band averages */
     time_t tp;                     /* time structure */
     struct tm *tm = NULL;          /* time structure for UTC time */
     FILE *fptr=NULL;               /* file pointer */
@@ -264,7 +396,8 @@ int main (int argc, char** argv)
     Espa_internal_meta_t out_meta;      /* output metadata for angle bands */
 
     /* Read the command-line arguments */
-    if (get_args (argc, argv, &xml_infile, &band_avg) != SUCCESS)
+    if (get_args (argc, argv, &xml_infile, &band_avg, &nthreads,
+        &interp) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (ERROR);
     }
@@ -375,18 +508,18 @@ int main (int argc, char** argv)
            data. */
         if (process_l8)
         {  /* Landsat 8 */
-            if (l8_per_pixel_angles (ang_infile, 1, ANGLE_BAND_FILL, "ALL",
-                frame, solar_zenith, solar_azimuth, sat_zenith, sat_azimuth,
-                nlines, nsamps) != SUCCESS)
+            if (l8_per_pixel_angles (ang_infile, 1, ANGLE_BAND_FILL, nthreads,
+                &interp, "ALL", frame, solar_zenith, solar_azimuth, sat_zenith,
+                sat_azimuth, nlines, nsamps) != SUCCESS)
             {  /* Error messages already written */
                 exit (ERROR);
             }
         }
         else
         {  /* Landsat 4-7 */
-            if (landsat_per_pixel_angles (ang_infile, 1, "ALL", solar_zenith,
-                solar_azimuth, sat_zenith, sat_azimuth, nlines, nsamps) !=
-                SUCCESS)
+            if (landsat_per_pixel_angles (ang_infile, 1, &interp,
+                LANDSAT_ANGLES_RPC, "ALL", solar_zenith, solar_azimuth, sat_zenith, sat_azimuth, nlines,
+                nsamps) != SUCCESS)
             {  /* Error messages already written */
                 exit (ERROR);
             }
@@ -562,20 +695,8 @@ int main (int argc, char** argv)
     }  /* if !band_avg */
     else
     {
-        /* Create the average Landsat angle bands over the reflectance bands.
-           Create a full resolution product with a fill value to match the
-           Landsat image data. */
-        if (process_l8)
-        {  /* Landsat 8 */
-            if (l8_per_pixel_avg_refl_angles (ang_infile, 1, ANGLE_BAND_FILL,
-                &avg_frame, &avg_solar_zenith, &avg_solar_azimuth,
-                &avg_sat_zenith, &avg_sat_azimuth, &avg_nlines, &avg_nsamps) !=
-                SUCCESS)
-            {  /* Error messages already written */
-                exit (ERROR);
-            }
-        }
-        else
+        /* Only Landsat 8 supports the band average */
+        if (!process_l8)
         {  /* Landsat 4-7 */
            /* TODO HANDLE THIS */
             sprintf (errmsg, "Only Landsat 8 is currently supported for band "
@@ -648,8 +769,6 @@ int main (int argc, char** argv)
             out_bmeta->fill_value = ANGLE_BAND_FILL;
             out_bmeta->scale_factor = ANGLE_BAND_SCALE_FACT;
             strcpy (out_bmeta->data_units, "degrees");
-            out_bmeta->nlines = avg_nlines;
-            out_bmeta->nsamps = avg_nsamps;
             out_bmeta->pixel_size[0] = bmeta[0].pixel_size[0];
             out_bmeta->pixel_size[1] = bmeta[0].pixel_size[1];
             strcpy (out_bmeta->pixel_units, bmeta[0].pixel_units);
@@ -658,57 +777,41 @@ int main (int argc, char** argv)
             strcpy (out_bmeta->production_date, production_date);
         }
 
-        /* Loop through the four different angle bands and write them */
+        /* Open the output file for each angle band */
         for (ang = 0; ang < NANGLE_BANDS; ang++)
         {
-            printf ("Writing %s band average angle ...\n", band_angle[ang]);
-
-            /* Grab the correct data array to be written for this angle
-               band */
-            switch (ang)
-            {
-                case (SOLAR_ZEN):
-                    curr_angle = avg_solar_zenith;
-                    break;
-                case (SOLAR_AZ):
-                    curr_angle = avg_solar_azimuth;
-                    break;
-                case (SENSOR_ZEN):
-                    curr_angle = avg_sat_zenith;
-                    break;
-                case (SENSOR_AZ):
-                    curr_angle = avg_sat_azimuth;
-                    break;
-                default:
-                    sprintf (errmsg, "Invalid angle type %d", ang);
-                    error_handler (true, FUNC_NAME, errmsg);
-                    exit (ERROR);
-            }
-
-            /* Open the output file for this angle */
             out_bmeta = &out_meta.band[ang];
-            fptr = open_raw_binary (out_bmeta->file_name, "wb");
-            if (!fptr)
+            avg_fptr[ang] = open_raw_binary (out_bmeta->file_name, "wb");
+            if (!avg_fptr[ang])
             {
                 sprintf (errmsg, "Unable to open the average %s file",
                     band_angle[ang]);
                 error_handler (true, FUNC_NAME, errmsg);
                 exit (ERROR);
             }
-    
-            /* Write the data for this band */
-            if (write_raw_binary (fptr, avg_nlines, avg_nsamps, sizeof (short),
-                curr_angle) != SUCCESS)
-            {
-                sprintf (errmsg, "Unable to write to average %s file",
-                    band_angle[ang]);
-                error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
-            }
+        }
+
+        /* Create the average Landsat angle bands over the reflectance bands,
+           writing each block of lines to the output files as it is
+           averaged.  Create a full resolution product with a fill value to
+           match the Landsat image data. */
+        printf ("Writing the band average angles ...\n");
+        if (l8_per_pixel_avg_refl_angles_stream (ang_infile, 1,
+            ANGLE_BAND_FILL, nthreads, &interp, AT_BOTH, write_avg_block,
+            avg_fptr, &avg_frame, &avg_nlines, &avg_nsamps) != SUCCESS)
+        {  /* Error messages already written */
+            exit (ERROR);
+        }
 
-            /* Close the file and free the memory for this angle */
-            close_raw_binary (fptr);
-            free (curr_angle);
+        /* Close the files and write the ENVI headers */
+        for (ang = 0; ang < NANGLE_BANDS; ang++)
+        {
+            close_raw_binary (avg_fptr[ang]);
+
+            /* Set the size of the band */
+            out_bmeta = &out_meta.band[ang];
+            out_bmeta->nlines = avg_nlines;
+            out_bmeta->nsamps = avg_nsamps;
 
             /* Create the ENVI header */
             if (create_envi_struct (out_bmeta, gmeta, &envi_hdr) != SUCCESS)
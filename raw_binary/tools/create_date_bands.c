@@ -188,6 +188,8 @@ int main (int argc, char** argv)
     Espa_internal_meta_t out_meta;     /* output metadata for bands */
     Espa_internal_meta_t xml_metadata; /* XML metadata structure to be populated
                                           by reading the XML metadata file */
+    Espa_load_options_t load_options; /* only band 1 is needed from the XML */
+    char *load_bands[] = {"b1"};     /* bands to be loaded from the XML */
 
     /* Read the command-line arguments */
     if (get_args (argc, argv, &espa_xml_file) != SUCCESS)
@@ -204,10 +206,16 @@ int main (int argc, char** argv)
     /* Initialize the metadata structure */
     init_metadata_struct (&xml_metadata);
 
-    /* Parse the metadata file into our internal metadata structure; also
-       allocates space as needed for various pointers in the global and band
-       metadata */
-    if (parse_metadata (espa_xml_file, &xml_metadata) != SUCCESS)
+    /* Parse the global metadata and band 1 into our internal metadata
+       structure; the remaining bands and the QA descriptions are not used
+       so they are skipped.  Also allocates space as needed for various
+       pointers in the global and band metadata */
+    init_load_options (&load_options);
+    load_options.nband_names = 1;
+    load_options.band_names = load_bands;
+    load_options.skip_qa_descriptions = true;
+    if (parse_metadata_options (espa_xml_file, &xml_metadata, &load_options)
+        != SUCCESS)
     {  /* Error messages already written */
         exit (ERROR);
     }
@@ -57,12 +57,25 @@ void usage ()
             "These per-pixel angle values are only generated for band 4, which "
             "is the representative band for OLI.  Values are written in "
             "degrees and scaled by 100.\n\n");
-    printf ("usage: create_l8_angle_bands --xml=input_metadata_filename\n");
+    printf ("usage: create_l8_angle_bands --xml=input_metadata_filename "
+            "[--threads=nthreads]\n"
+            "    [--interp_step=grid_step] [--max_interp_error=degrees]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML metadata file wich follows the "
             "ESPA internal raw binary schema\n");
 
+    printf ("\nwhere the following parameters are optional:\n");
+    printf ("    -threads: number of threads to use for computing the "
+            "angles (default is 1)\n");
+    printf ("    -interp_step: compute the exact angles every interp_step "
+            "pixels and interpolate the pixels in between (default is 1, "
+            "which computes every pixel)\n");
+    printf ("    -max_interp_error: maximum error in degrees allowed for the "
+            "interpolated angles; areas which can't be interpolated within "
+            "this error are computed exactly (default is %g)\n",
+            ANGLES_INTERP_DEFAULT_MAX_ERROR);
+
     printf ("\nExample: create_l8_angle_bands "
             "--xml=LC08_L1TP_047027_20131014_20170308_01_T1.xml\n");
     printf ("This writes a band file for band 4 for each of the solar "
@@ -93,7 +106,9 @@ short get_args
 (
     int argc,             /* I: number of cmd-line args */
     char *argv[],         /* I: string of cmd-line args */
-    char **xml_infile     /* O: address of input XML filename */
+    char **xml_infile,    /* O: address of input XML filename */
+    int *nthreads,        /* O: number of threads for computing the angles */
+    ANGLES_INTERP *interp /* O: coarse grid interpolation controls */
 )
 {
     int c;                           /* current argument index */
@@ -103,6 +118,9 @@ short get_args
     static struct option long_options[] =
     {
         {"xml", required_argument, 0, 'i'},
+        {"threads", required_argument, 0, 't'},
+        {"interp_step", required_argument, 0, 's'},
+        {"max_interp_error", required_argument, 0, 'e'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -134,6 +152,18 @@ short get_args
             case 'i':  /* XML file */
                 *xml_infile = strdup (optarg);
                 break;
+
+            case 's':  /* interpolation grid step */
+                interp->grid_step = atoi (optarg);
+                break;
+
+            case 'e':  /* maximum interpolation error */
+                interp->max_error = atof (optarg);
+                break;
+
+            case 't':  /* number of threads */
+                *nthreads = atoi (optarg);
+                break;
      
             case '?':
             default:
@@ -154,6 +184,35 @@ short get_args
         return (ERROR);
     }
 
+    /* Make sure the number of threads is valid */
+    if (*nthreads < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Number of threads must be at "
+            "least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* Make sure the interpolation controls are valid */
+    if (interp->grid_step < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Interpolation grid step must "
+            "be at least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (interp->max_error <= 0.0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Maximum interpolation error "
+            "must be positive");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
     return (SUCCESS);
 }
 
@@ -205,6 +264,9 @@ int main (int argc, char** argv)
     int oli_band_indx[] = {3};   /* index in the overall input bands for the
                                     output bands [1,2,3,4,5,6,7,8,9,10,11] */
     int out_nbands;              /* number of output bands to be written */
+    int nthreads = 1;            /* number of threads for computing angles */
+    ANGLES_INTERP interp = {1, ANGLES_INTERP_DEFAULT_MAX_ERROR};
+                                 /* coarse grid interpolation controls */
     int nlines[L8_NBANDS];       /* number of lines for each band */
     int nsamps[L8_NBANDS];       /* number of samples for each band */
     Angle_band_t ang;            /* looping variable for solar/senor angle */
@@ -231,7 +293,7 @@ int main (int argc, char** argv)
     Espa_internal_meta_t out_meta;      /* output metadata for angle bands */
 
     /* Read the command-line arguments */
-    if (get_args (argc, argv, &xml_infile) != SUCCESS)
+    if (get_args (argc, argv, &xml_infile, &nthreads, &interp) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (ERROR);
     }
@@ -309,9 +371,9 @@ int main (int argc, char** argv)
 
     /* Create the Landsat 8 angle bands for the specified bands.  Create a full
        resolution product with a fill value to match the Landsat image data. */
-    if (l8_per_pixel_angles (ang_infile, 1, ANGLE_BAND_FILL, oli_list, frame,
-        solar_zenith, solar_azimuth, sat_zenith, sat_azimuth, nlines,
-        nsamps) != SUCCESS)
+    if (l8_per_pixel_angles (ang_infile, 1, ANGLE_BAND_FILL, nthreads,
+        &interp, oli_list, frame, solar_zenith, solar_azimuth, sat_zenith, sat_azimuth,
+        nlines, nsamps) != SUCCESS)
     {  /* Error messages already written */
         free_l8_per_pixel_angles (solar_zenith, solar_azimuth, sat_zenith,
             sat_azimuth);
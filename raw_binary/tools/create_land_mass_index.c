@@ -0,0 +1,98 @@
+/*****************************************************************************
+FILE: create_land_mass_index
+
+PURPOSE: Creates the spatial index sidecar for the land-mass polygon.  The
+index lets the land/water mask generation read only the polygons near the
+scene instead of scanning the whole global polygon.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+*****************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "error_handler.h"
+#include "ias_lw_geo.h"
+#include "land_mass_args.h"
+
+/******************************************************************************
+MODULE: usage
+
+PURPOSE: Prints the usage information for this application.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void usage ()
+{
+    printf ("create_land_mass_index creates the spatial index used to speed "
+            "up reading the land-mass polygon when generating the land/water "
+            "mask.\n\n");
+    printf ("usage: create_land_mass_index "
+            "[--polygon=land_mass_polygon_filename]\n");
+
+    printf ("\nwhere the following parameters are optional:\n");
+    printf ("    -polygon: name of the land-mass polygon file (default is "
+            "the ESPA_LAND_MASS_POLYGON environment variable)\n");
+    printf ("\nThe index is written next to the polygon, with %s appended "
+            "to the polygon filename, which is where the land/water mask "
+            "generation looks for it.\n", IAS_GEO_POLYGON_INDEX_EXTENSION);
+    printf ("\nExample: create_land_mass_index "
+            "--polygon=land_no_buf.ply\n");
+}
+
+
+/******************************************************************************
+MODULE:  main
+
+PURPOSE: Creates the spatial index for the land-mass polygon.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error creating the index
+SUCCESS         No errors encountered
+
+NOTES:
+  1. The index needs to be rebuilt whenever the land-mass polygon is
+     replaced.  An out of date index is detected and ignored by the land/water
+     mask generation, which then falls back to scanning the whole polygon.
+******************************************************************************/
+int main (int argc, char** argv)
+{
+    char FUNC_NAME[] = "create_land_mass_index";  /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char *polygon_file = NULL;   /* land-mass polygon filename */
+
+    /* Read the command-line arguments */
+    if (get_land_mass_args (argc, argv, NULL, usage, &polygon_file, NULL)
+        != SUCCESS)
+    {   /* get_land_mass_args already printed the error message */
+        exit (ERROR);
+    }
+
+    printf ("Indexing land-mass polygon file: %s\n", polygon_file);
+
+    /* Build and write the index */
+    if (ias_geo_build_polygon_index (polygon_file) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Creating the index for "
+            "land-mass polygon %s", polygon_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        exit (ERROR);
+    }
+
+    /* Free the pointers */
+    free (polygon_file);
+
+    /* Successful completion */
+    exit (SUCCESS);
+}
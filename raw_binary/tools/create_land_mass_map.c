@@ -0,0 +1,102 @@
+/*****************************************************************************
+FILE: create_land_mass_map
+
+PURPOSE: Converts the land-mass polygon into the pre-processed polygon map
+format.  The land/water mask generation maps the converted file read-only and
+uses it in place, so concurrent processes share one copy of the polygon data
+in the page cache instead of each reading and parsing its own.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+*****************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "error_handler.h"
+#include "ias_lw_geo.h"
+#include "land_mass_args.h"
+
+/******************************************************************************
+MODULE: usage
+
+PURPOSE: Prints the usage information for this application.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void usage ()
+{
+    printf ("create_land_mass_map converts the land-mass polygon into the "
+            "pre-processed polygon map format, which the land/water mask "
+            "generation uses in place.\n\n");
+    printf ("usage: create_land_mass_map "
+            "[--polygon=land_mass_polygon_filename] "
+            "--map=output_map_filename\n");
+
+    printf ("\nwhere the following parameters are required:\n");
+    printf ("    -map: name of the output polygon map file\n");
+    printf ("\nwhere the following parameters are optional:\n");
+    printf ("    -polygon: name of the land-mass polygon file (default is "
+            "the ESPA_LAND_MASS_POLYGON environment variable)\n");
+    printf ("\nPoint the ESPA_LAND_MASS_POLYGON environment variable at the "
+            "output map file to use it for the land/water mask.\n");
+    printf ("\nExample: create_land_mass_map "
+            "--polygon=land_no_buf.ply --map=land_no_buf.map\n");
+}
+
+
+/******************************************************************************
+MODULE:  main
+
+PURPOSE: Converts the land-mass polygon into the polygon map format.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error converting the land-mass polygon
+SUCCESS         No errors encountered
+
+NOTES:
+  1. The map is a snapshot of the land-mass polygon, so it needs to be
+     recreated whenever the land-mass polygon is replaced.
+******************************************************************************/
+int main (int argc, char** argv)
+{
+    char FUNC_NAME[] = "create_land_mass_map";  /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char *polygon_file = NULL;   /* land-mass polygon filename */
+    char *map_file = NULL;       /* output polygon map filename */
+
+    /* Read the command-line arguments */
+    if (get_land_mass_args (argc, argv, "map", usage, &polygon_file,
+        &map_file) != SUCCESS)
+    {   /* get_land_mass_args already printed the error message */
+        exit (ERROR);
+    }
+
+    printf ("Converting land-mass polygon file: %s\n", polygon_file);
+
+    /* Convert and write the map */
+    if (ias_geo_write_polygon_map (polygon_file, map_file) != SUCCESS)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Converting land-mass polygon "
+            "%s to map %s", polygon_file, map_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        exit (ERROR);
+    }
+
+    /* Free the pointers */
+    free (polygon_file);
+    free (map_file);
+
+    /* Successful completion */
+    exit (SUCCESS);
+}
@@ -57,12 +57,27 @@ void usage ()
             "the representative band for TM and ETM+.  Values are written in "
             "degrees and scaled by 100.\n\n");
     printf ("usage: create_angle_bands "
-            "--xml=input_metadata_filename\n");
+            "--xml=input_metadata_filename\n"
+            "[--interp_step=grid_step] [--max_interp_error=degrees]\n"
+            "[--rigorous]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML metadata file wich follows the "
             "ESPA internal raw binary schema\n");
 
+    printf ("\nwhere the following parameters are optional:\n");
+    printf ("    -interp_step: compute the exact angles every interp_step "
+            "pixels and interpolate the pixels in between (default is 1, "
+            "which computes every pixel)\n");
+    printf ("    -max_interp_error: maximum error in degrees allowed for the "
+            "interpolated angles; areas which can't be interpolated within "
+            "this error are computed exactly (default is %g)\n",
+            ANGLES_INTERP_DEFAULT_MAX_ERROR);
+    printf ("    -rigorous: compute the angles from the ephemeris and solar "
+            "vector at each pixel's observation time instead of the angle "
+            "rational polynomials; this is slower and meant for validating "
+            "the polynomial angles (default is false)\n");
+
     printf ("\nExample: create_angle_bands "
             "--xml=LE07_L1TP_022033_20140228_20161028_01_T1.xml\n");
     printf ("This writes a single band file for each of the bands (b4) for the "
@@ -93,16 +108,22 @@ short get_args
 (
     int argc,             /* I: number of cmd-line args */
     char *argv[],         /* I: string of cmd-line args */
-    char **xml_infile     /* O: address of input XML filename */
+    char **xml_infile,    /* O: address of input XML filename */
+    ANGLES_INTERP *interp, /* O: coarse grid interpolation controls */
+    LANDSAT_ANGLES_MODEL *model /* O: model used to compute the angles */
 )
 {
     int c;                           /* current argument index */
     int option_index;                /* index for the command-line option */
+    static int rigorous_flag = 0;    /* flag for using the rigorous model */
     char errmsg[STR_SIZE];           /* error message */
     char FUNC_NAME[] = "get_args";   /* function name */
     static struct option long_options[] =
     {
         {"xml", required_argument, 0, 'i'},
+        {"interp_step", required_argument, 0, 's'},
+        {"max_interp_error", required_argument, 0, 'e'},
+        {"rigorous", no_argument, &rigorous_flag, 1},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -134,6 +155,14 @@ short get_args
             case 'i':  /* XML file */
                 *xml_infile = strdup (optarg);
                 break;
+
+            case 's':  /* interpolation grid step */
+                interp->grid_step = atoi (optarg);
+                break;
+
+            case 'e':  /* maximum interpolation error */
+                interp->max_error = atof (optarg);
+                break;
      
             case '?':
             default:
@@ -154,6 +183,30 @@ short get_args
         return (ERROR);
     }
 
+    /* Check the rigorous model flag */
+    *model = LANDSAT_ANGLES_RPC;
+    if (rigorous_flag)
+        *model = LANDSAT_ANGLES_RIGOROUS;
+
+    /* Make sure the interpolation controls are valid */
+    if (interp->grid_step < 1)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Interpolation grid step must "
+            "be at least 1");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    if (interp->max_error <= 0.0)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Maximum interpolation error "
+            "must be positive");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
     return (SUCCESS);
 }
 
@@ -224,6 +277,9 @@ int main (int argc, char** argv)
     int tm_band_indx[] = {3};    /* index in the overall input bands for
                                     the output bands [1,2,3,4,5,6,7,8] */
     int out_nbands;              /* number of output bands to be written */
+    ANGLES_INTERP interp = {1, ANGLES_INTERP_DEFAULT_MAX_ERROR};
+                                 /* coarse grid interpolation controls */
+    LANDSAT_ANGLES_MODEL model;  /* model used to compute the angles */
     int nlines[L7_NBANDS];       /* number of lines for each band */
     int nsamps[L7_NBANDS];       /* number of samples for each band */
     Angle_band_t ang;            /* looping variable for solar/senor angle */
@@ -249,7 +305,7 @@ int main (int argc, char** argv)
     Espa_internal_meta_t out_meta;      /* output metadata for angle bands */
 
     /* Read the command-line arguments */
-    if (get_args (argc, argv, &xml_infile) != SUCCESS)
+    if (get_args (argc, argv, &xml_infile, &interp, &model) != SUCCESS)
     {   /* get_args already printed the error message */
         exit (ERROR);
     }
@@ -349,8 +405,9 @@ int main (int argc, char** argv)
 
     /* Create the Landsat angle bands for the specified bands.  Create a full
        resolution product. */
-    if (landsat_per_pixel_angles (ang_infile, 1, band_list, solar_zenith,
-        solar_azimuth, sat_zenith, sat_azimuth, nlines, nsamps) != SUCCESS)
+    if (landsat_per_pixel_angles (ang_infile, 1, &interp, model, band_list,
+        solar_zenith, solar_azimuth, sat_zenith, sat_azimuth, nlines, nsamps)
+        != SUCCESS)
     {  /* Error messages already written */
         free_per_pixel_angles (solar_zenith, solar_azimuth, sat_zenith,
             sat_azimuth);
@@ -0,0 +1,152 @@
+/*****************************************************************************
+FILE: land_mass_args
+
+PURPOSE: Contains the command-line handling shared by the tools which
+pre-process the land-mass polygon.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+*****************************************************************************/
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "error_handler.h"
+#include "land_mass_args.h"
+
+/******************************************************************************
+MODULE:  get_land_mass_args
+
+PURPOSE:  Gets the command-line arguments of a land-mass polygon tool and
+validates that the required arguments were specified.  The land-mass polygon
+defaults to the one used by create_land_water_mask.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error getting the command-line arguments or a command-line
+                argument and associated value were not specified
+SUCCESS         No errors encountered
+
+NOTES:
+  1. The tool takes --polygon, and --<output_option> if output_option isn't
+     NULL.  The output file is required.
+  2. If --polygon isn't specified, the ESPA_LAND_MASS_POLYGON environment
+     variable is used.
+  3. Memory is allocated for the polygon and output files.  These should be
+     character pointers set to NULL on input.  The caller is responsible for
+     freeing the allocated memory upon successful return.
+******************************************************************************/
+short get_land_mass_args
+(
+    int argc,                  /* I: number of cmd-line args */
+    char *argv[],              /* I: string of cmd-line args */
+    const char *output_option, /* I: name of the required output file
+                                     option, or NULL if there is none */
+    void (*usage) (void),      /* I: prints the usage of the tool */
+    char **polygon_file,       /* O: address of land-mass polygon filename */
+    char **output_file         /* O: address of output filename; may be
+                                     NULL if output_option is NULL */
+)
+{
+    int c;                           /* current argument index */
+    int option_index;                /* index for the command-line option */
+    char *env_polygon = NULL;        /* land-mass polygon from the
+                                        environment */
+    char errmsg[STR_SIZE];           /* error message */
+    char FUNC_NAME[] = "get_land_mass_args";  /* function name */
+    struct option long_options[] =
+    {
+        {"polygon", required_argument, 0, 'p'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+        {0, 0, 0, 0}
+    };
+
+    /* Add the output file option of the tool */
+    if (output_option != NULL)
+    {
+        long_options[2].name = output_option;
+        long_options[2].has_arg = required_argument;
+        long_options[2].val = 'o';
+    }
+
+    /* Loop through all the cmd-line options */
+    opterr = 0;   /* turn off getopt_long error msgs as we'll print our own */
+    while (1)
+    {
+        /* optstring in call to getopt_long is empty since we will only
+           support the long options */
+        c = getopt_long (argc, argv, "", long_options, &option_index);
+        if (c == -1)
+        {   /* Out of cmd-line options */
+            break;
+        }
+
+        switch (c)
+        {
+            case 0:
+                /* If this option set a flag, do nothing else now. */
+                if (long_options[option_index].flag != 0)
+                    break;
+
+            case 'h':  /* help */
+                usage ();
+                return (ERROR);
+                break;
+
+            case 'p':  /* land-mass polygon file */
+                free (*polygon_file);
+                *polygon_file = strdup (optarg);
+                break;
+
+            case 'o':  /* output file */
+                free (*output_file);
+                *output_file = strdup (optarg);
+                break;
+
+            case '?':
+            default:
+                snprintf (errmsg, sizeof (errmsg), "Unknown option %s",
+                    argv[optind-1]);
+                error_handler (true, FUNC_NAME, errmsg);
+                usage ();
+                return (ERROR);
+                break;
+        }
+    }
+
+    /* Make sure the output file was specified */
+    if (output_option != NULL && *output_file == NULL)
+    {
+        snprintf (errmsg, sizeof (errmsg), "Output %s file is a required "
+            "argument", output_option);
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* Default to the land-mass polygon used by create_land_water_mask */
+    if (*polygon_file == NULL)
+    {
+        env_polygon = getenv ("ESPA_LAND_MASS_POLYGON");
+        if (env_polygon == NULL)
+        {
+            snprintf (errmsg, sizeof (errmsg), "No land-mass polygon was "
+                "specified and the ESPA_LAND_MASS_POLYGON environment "
+                "variable is not defined.");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+        *polygon_file = strdup (env_polygon);
+    }
+
+    return (SUCCESS);
+}
@@ -0,0 +1,31 @@
+/*****************************************************************************
+FILE: land_mass_args.h
+
+PURPOSE: Contains the prototype for the command-line handling shared by the
+tools which pre-process the land-mass polygon (create_land_mass_index and
+create_land_mass_map).
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+*****************************************************************************/
+
+#ifndef LAND_MASS_ARGS_H
+#define LAND_MASS_ARGS_H
+
+short get_land_mass_args
+(
+    int argc,                  /* I: number of cmd-line args */
+    char *argv[],              /* I: string of cmd-line args */
+    const char *output_option, /* I: name of the required output file
+                                     option, or NULL if there is none */
+    void (*usage) (void),      /* I: prints the usage of the tool */
+    char **polygon_file,       /* O: address of land-mass polygon filename */
+    char **output_file         /* O: address of output filename; may be
+                                     NULL if output_option is NULL */
+);
+
+#endif